@@ -16,24 +16,53 @@
 #include <app.hpp>
 #include <data/domain.hpp>
 #include <http/middleware.hpp>
+#include <http/util.hpp>
+#include <util/config.hpp>
 #include <util/logging.hpp>
+#include <util/metrics.hpp>
 #include <virt/events/callbacks/lifecycle.hpp>
 #include <virt/events/lifecycle.hpp>
+#include <virt/events/metadata.hpp>
+#include <virt/instrumented.hpp>
 
 #include <pugixml.hpp>
 
 using namespace webvirt;
 
+using http::middleware::with_bump;
+using http::middleware::with_cache;
+using http::middleware::with_etag;
+using http::middleware::with_invalidation;
 using http::middleware::with_libvirt;
 using http::middleware::with_libvirt_domain;
 using http::middleware::with_methods;
+using http::middleware::with_single_flight;
+
+static std::chrono::milliseconds cache_ttl()
+{
+    double seconds = 5.0;
+    if (auto &conf = config::ref(); conf.has("cache-ttl")) {
+        seconds = conf.get<double>("cache-ttl");
+    }
+    return std::chrono::milliseconds(static_cast<long>(seconds * 1000));
+}
 
 app::app(http::io_context &io, const std::filesystem::path &socket_path)
     : io_(io)
     , server_(io_, socket_path.string())
+    , cache_(cache_ttl())
+    , read_lane_(thread::fair_executor::options::configured("read"))
+    , write_lane_(thread::fair_executor::options::configured("write"))
 {
     // General routes
     router_.route(R"(^.+[^/]$)", bind(&app::append_trailing_slash, this));
+    router_.route(R"(^/metrics/$)",
+                  with_methods({ beast::http::verb::get },
+                               bind(&views::metrics::show, &metrics_view_)));
+    router_.route(
+        R"(^/debug/requests/$)",
+        with_methods({ beast::http::verb::get },
+                     bind(&views::debug::requests, &debug_view_)));
 
     // Websocket routes
     router_.route(
@@ -42,66 +71,160 @@ app::app(http::io_context &io, const std::filesystem::path &socket_path)
             { beast::http::verb::get },
             with_libvirt(pool_, bind_libvirt(&app::websocket, this))));
 
+    // libvirt-bound routes below are queued on read_lane_ for reads and
+    // write_lane_ for mutations.
+
     // Host routes
-    router_.route(R"(^/users/([^/]+)/host/)",
-                  with_methods({ beast::http::verb::get },
-                               with_libvirt(pool_,
-                                            bind_libvirt(&views::host::show,
-                                                         &host_view_))));
+    router_.route(
+        R"(^/users/([^/]+)/host/)",
+        with_methods(
+            { beast::http::verb::get },
+            with_single_flight(
+                flights_,
+                with_cache(cache_,
+                           with_libvirt(pool_,
+                                        bind_libvirt(&views::host::show,
+                                                     &host_view_))))),
+        &read_lane_);
+    router_.route(
+        R"(^/users/([^/]+)/host/refresh/$)",
+        with_methods(
+            { beast::http::verb::post },
+            with_invalidation(
+                cache_,
+                with_libvirt(pool_,
+                             bind_libvirt(&views::host::refresh,
+                                          &host_view_)))),
+        &write_lane_);
     router_.route(
         R"(^/users/([^/]+)/host/networks/)",
         with_methods(
             { beast::http::verb::get },
-            with_libvirt(pool_,
-                         bind_libvirt(&views::host::networks, &host_view_))));
-
-    // Domain routes
+            with_single_flight(
+                flights_,
+                with_cache(cache_,
+                           with_libvirt(pool_,
+                                        bind_libvirt(&views::host::networks,
+                                                     &host_view_))))),
+        &read_lane_);
+
+    // Domain routes; domains are addressed by name or UUID. Their
+    // generations back entity tags and are bumped by mutations.
+    auto track = [this](const std::string &user) {
+        return this->track(user);
+    };
+    auto changed = [this](const std::string &user, const std::string &name,
+                          const std::string &uuid) {
+        this->changed(user, name, uuid);
+    };
     router_.route(
         R"(^/users/([^/]+)/domains/$)",
         with_methods(
             { beast::http::verb::get },
-            with_libvirt(
-                pool_, bind_libvirt(&views::domains::index, &domains_view_))));
-    router_.route(R"(^/users/([^/]+)/domains/([^/]+)/$)",
-                  with_methods({ beast::http::verb::get },
+            with_single_flight(
+                flights_,
+                with_etag(
+                    generations_,
+                    track,
+                    &views::domains::index_tagged,
+                    with_cache(cache_,
+                               with_libvirt(
+                                   pool_,
+                                   bind_libvirt(&views::domains::index,
+                                                &domains_view_)))))),
+        &read_lane_);
+    router_.route(
+        R"(^/users/([^/]+)/domains/([^/]+)/$)",
+        with_methods(
+            { beast::http::verb::get },
+            with_single_flight(
+                flights_,
+                with_etag(
+                    generations_,
+                    track,
+                    &views::domains::show_tagged,
+                    with_cache(cache_,
                                with_libvirt_domain(
                                    pool_,
                                    bind_libvirt_domain(&views::domains::show,
-                                                       &domains_view_))));
+                                                       &domains_view_)))))),
+        &read_lane_);
     router_.route(
         R"(^/users/([^/]+)/domains/([^/]+)/autostart/$)",
         with_methods(
             { beast::http::verb::post, beast::http::verb::delete_ },
-            with_libvirt_domain(pool_,
-                                bind_libvirt_domain(&views::domains::autostart,
-                                                    &domains_view_))));
+            with_bump(pool_,
+                      changed,
+                      with_libvirt_domain(
+                          pool_,
+                          bind_libvirt_domain(&views::domains::autostart,
+                                              &domains_view_)))),
+        &write_lane_);
     router_.route(
         R"(^/users/([^/]+)/domains/([^/]+)/metadata/$)",
-        with_methods(
-            { beast::http::verb::post },
-            with_libvirt_domain(pool_,
-                                bind_libvirt_domain(&views::domains::metadata,
-                                                    &domains_view_))));
+        with_methods({ beast::http::verb::post },
+                     with_bump(pool_,
+                               changed,
+                               with_libvirt_domain(
+                                   pool_,
+                                   bind_libvirt_domain(
+                                       &views::domains::metadata,
+                                       &domains_view_)))),
+        &write_lane_);
     router_.route(
         R"(^/users/([^/]+)/domains/([^/]+)/bootmenu/$)",
         with_methods(
             { beast::http::verb::post, beast::http::verb::delete_ },
-            with_libvirt_domain(pool_,
-                                bind_libvirt_domain(&views::domains::bootmenu,
-                                                    &domains_view_))));
-    router_.route(R"(^/users/([^/]+)/domains/([^/]+)/start/$)",
-                  with_methods({ beast::http::verb::post },
+            with_bump(pool_,
+                      changed,
+                      with_libvirt_domain(
+                          pool_,
+                          bind_libvirt_domain(&views::domains::bootmenu,
+                                              &domains_view_)))),
+        &write_lane_);
+    router_.route(
+        R"(^/users/([^/]+)/domains/([^/]+)/start/$)",
+        with_methods({ beast::http::verb::post },
+                     with_bump(pool_,
+                               changed,
                                with_libvirt_domain(
                                    pool_,
-                                   bind_libvirt_domain(&views::domains::start,
-                                                       &domains_view_))));
+                                   bind_libvirt_domain(
+                                       &views::domains::start,
+                                       &domains_view_)))),
+        &write_lane_);
     router_.route(
         R"(^/users/([^/]+)/domains/([^/]+)/shutdown/)",
-        with_methods(
-            { beast::http::verb::post },
-            with_libvirt_domain(pool_,
-                                bind_libvirt_domain(&views::domains::shutdown,
-                                                    &domains_view_))));
+        with_methods({ beast::http::verb::post },
+                     with_bump(pool_,
+                               changed,
+                               with_libvirt_domain(
+                                   pool_,
+                                   bind_libvirt_domain(
+                                       &views::domains::shutdown,
+                                       &domains_view_)))),
+        &write_lane_);
+
+    collector_ =
+        metrics::registry::ref().add_collector([this](auto &registry) {
+            registry
+                .counter("webvirtd_cache_hits_total",
+                         "GET responses served from the response cache")
+                .set(cache_.hits());
+            registry
+                .counter("webvirtd_cache_misses_total",
+                         "GET responses missing from the response cache")
+                .set(cache_.misses());
+            registry
+                .counter("webvirtd_single_flight_shared_total",
+                         "GET responses shared with identical requests")
+                .set(flights_.shared());
+            registry
+                .counter("webvirtd_log_records_dropped_total",
+                         "Log records dropped because the log buffer was "
+                         "full")
+                .set(logger::dropped());
+        });
 
     server_.on_request([this](http::connection_ptr http_conn,
                               const http::request &request,
@@ -112,6 +235,8 @@ app::app(http::io_context &io, const std::filesystem::path &socket_path)
 
 app::~app()
 {
+    metrics::registry::ref().remove_collector(collector_);
+
     event_loop_ = false;
     if (event_thread_.joinable()) {
         event_thread_.join();
@@ -143,6 +268,15 @@ http::server &app::server()
     return server_;
 }
 
+static void count_event(const char *event)
+{
+    metrics::registry::ref()
+        .counter("webvirtd_libvirt_events_total",
+                 "libvirt domain events received",
+                 { { "event", event } })
+        .inc();
+}
+
 static constexpr int TARGET_LIFECYCLE_EVENTS =
     (1 << VIR_DOMAIN_EVENT_STARTED) | (1 << VIR_DOMAIN_EVENT_SHUTDOWN) |
     (1 << VIR_DOMAIN_EVENT_STOPPED);
@@ -156,27 +290,53 @@ void app::remove_events(virt::connection &conn)
     if (it != events_.end()) {
         auto &events = it->second;
         events.remove(VIR_DOMAIN_EVENT_ID_LIFECYCLE);
+        events.remove(VIR_DOMAIN_EVENT_ID_METADATA_CHANGE);
         if (events.size() == 0) {
             events_.erase(it);
         }
     }
+
+    // Without events, changes to the user's domains go unnoticed; only
+    // the cache's TTL bounds how stale its responses become.
+    generations_.untrack(user);
+    conn.handles().enable(false);
 }
 
 void app::add_events(virt::connection &conn,
-                     const virt::lifecycle_callback &lifecycle_cb)
+                     const virt::lifecycle_callback &lifecycle_cb,
+                     const virt::metadata_callback &metadata_cb)
 {
     std::lock_guard<std::mutex> guard(events_mutex_);
 
     const auto &user = conn.user();
-    auto ev = std::make_shared<virt::lifecycle_event>(
-        conn, lifecycle_cb, [this, user](auto &, auto &domain, int type, int) {
+    auto lifecycle = std::make_shared<virt::lifecycle_event>(
+        conn,
+        lifecycle_cb,
+        [this, user](auto &event_conn, auto &domain, int type, int) {
+            count_event("lifecycle");
+            virt::instrumented_libvirt::scope scope(user);
+            const auto name = domain.name();
+            const auto uuid = domain.uuid();
+            event_conn.handles().lifecycle(type, name, uuid);
+            changed(user, name, uuid);
             if ((1 << type) & TARGET_LIFECYCLE_EVENTS) {
                 websockets_.broadcast(user, data::simple_domain(domain));
             }
         });
+    auto metadata = std::make_shared<virt::metadata_event>(
+        conn, metadata_cb, [this, user](auto &, auto &domain, int) {
+            count_event("metadata");
+            virt::instrumented_libvirt::scope scope(user);
+            changed(user, domain.name(), domain.uuid());
+        });
 
     auto &user_events = events_[user];
-    user_events.set(ev->id(), std::move(ev));
+    user_events.set(lifecycle->id(), std::move(lifecycle));
+    user_events.set(metadata->id(), std::move(metadata));
+    generations_.track(user, conn.get_ptr().get());
+
+    // Kept domain handles rely on these events to be dropped.
+    conn.handles().enable(true);
 
     on_virt_event_registration_(conn);
 }
@@ -187,6 +347,60 @@ virt::events &app::events(const std::string &username)
     return events_.at(username);
 }
 
+virt::generations &app::generations()
+{
+    return generations_;
+}
+
+http::cache &app::cache()
+{
+    return cache_;
+}
+
+void app::changed(const std::string &user, const std::string &name,
+                  const std::string &uuid)
+{
+    generations_.bump(user, name);
+    if (!uuid.empty()) {
+        generations_.bump(user, uuid);
+    }
+    cache_.invalidate(user);
+}
+
+bool app::track(const std::string &user)
+{
+    std::lock_guard<std::mutex> guard(tracking_mutex_);
+
+    // Only users who have connected through a route are considered.
+    auto *conn = pool_.find(user);
+    if (!conn || !*conn) {
+        return false;
+    }
+
+    if (generations_.tracked(user, conn->get_ptr().get())) {
+        return true;
+    }
+
+    // Events registered on a previous connection went away with it.
+    bool registered = false;
+    {
+        std::lock_guard<std::mutex> guard(events_mutex_);
+        registered = events_.find(user) != events_.end();
+    }
+    if (registered) {
+        remove_events(*conn);
+    }
+
+    try {
+        add_events(*conn);
+    } catch (const std::runtime_error &exc) {
+        logger::error(fmt::format("Unable to track domains: {}", exc.what()));
+        return false;
+    }
+
+    return true;
+}
+
 void app::event_loop()
 {
     if (virt::event::register_impl() == -1) {
@@ -211,11 +425,12 @@ void app::event_loop()
 
 void app::append_trailing_slash(http::connection_ptr,
                                 const std::smatch &location,
-                                const http::request &,
+                                const http::request &request,
                                 http::response &response)
 {
     std::string uri(location[0]);
     uri.push_back('/');
+    uri.append(http::target_query(std::string(request.target())));
     response.set(beast::http::field::location, uri);
     response.result(beast::http::status::temporary_redirect);
 }
@@ -240,10 +455,15 @@ void app::websocket(virt::connection &conn, http::connection_ptr http_conn,
     });
 
     // On close, remove the connection from internal websockets_ map
-    // bucket pertaining to `user`.
-    ws_conn->on_close([this, &conn, user, ws_conn] {
+    // bucket pertaining to `user`. The connection owns this handler, so
+    // it refers to the connection weakly; a strong reference would keep
+    // it, and the reactor lease it holds, alive forever.
+    std::weak_ptr<websocket::connection> weak_conn = ws_conn;
+    ws_conn->on_close([this, &conn, user, weak_conn] {
         // On closure, remove the ptr from websockets_
-        websockets_.remove(user, ws_conn);
+        if (auto ws_conn = weak_conn.lock()) {
+            websockets_.remove(user, ws_conn);
+        }
 
         // If we just removed the last websocket from the user's pool
         if (!websockets_[user].size()) {
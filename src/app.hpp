@@ -16,14 +16,21 @@
 #ifndef APP_HPP
 #define APP_HPP
 
+#include <http/cache.hpp>
 #include <http/io_context.hpp>
 #include <http/router.hpp>
 #include <http/server.hpp>
+#include <http/single_flight.hpp>
+#include <thread/fair_executor.hpp>
+#include <views/debug.hpp>
 #include <views/domains.hpp>
 #include <views/host.hpp>
+#include <views/metrics.hpp>
 #include <virt/connection_pool.hpp>
 #include <virt/events.hpp>
 #include <virt/events/lifecycle.hpp>
+#include <virt/events/metadata.hpp>
+#include <virt/generations.hpp>
 #include <ws/connection.hpp>
 #include <ws/pool.hpp>
 
@@ -54,6 +61,8 @@ private:
 
     views::host host_view_;
     views::domains domains_view_;
+    views::metrics metrics_view_;
+    views::debug debug_view_;
 
     virt::connection_pool pool_;
 
@@ -63,6 +72,19 @@ private:
     std::mutex events_mutex_;
     std::map<std::string, virt::events> events_;
 
+    // Domain generations backing ETags; see app::track.
+    std::mutex tracking_mutex_;
+    virt::generations generations_;
+
+    // Serialized GET responses; invalidated alongside generations_.
+    http::cache cache_;
+
+    // Identical GET requests in flight; shared before ETags are taken.
+    http::single_flight flights_;
+
+    // Publishes cache and single-flight counters to the metrics registry.
+    std::size_t collector_;
+
     std::atomic<bool> event_loop_ { true };
     std::atomic<bool> event_error_ { false };
     std::condition_variable event_cv_;
@@ -71,6 +93,13 @@ private:
 
     http::handler<virt::connection &> on_virt_event_registration_;
 
+    // Lanes running libvirt-bound routes, fairly across users: cheap
+    // reads and mutations have threads of their own, so that bursts of
+    // mutations do not delay reads. Declared last so that their threads
+    // are joined before what they use is destroyed.
+    thread::fair_executor read_lane_;
+    thread::fair_executor write_lane_;
+
 public:
     /** Construct the application
      *
@@ -117,11 +146,14 @@ public:
      * @param conn libvirt connection
      * @param user libvirt connection's username
      * @param lifecycle_cb Lifecycle event callback
+     * @param metadata_cb Metadata change event callback
      **/
     void add_events(
         virt::connection &,
         const virt::lifecycle_callback &lifecycle_cb =
-            virt::lifecycle_callback(virt::lifecycle_event::on_event_handler));
+            virt::lifecycle_callback(virt::lifecycle_event::on_event_handler),
+        const virt::metadata_callback &metadata_cb =
+            virt::metadata_callback(virt::metadata_event::on_event_handler));
 
     /** Return events bound to username
      *
@@ -130,6 +162,18 @@ public:
      **/
     virt::events &events(const std::string &);
 
+    /** Returns a reference to internal domain generations
+     *
+     * @returns Reference to internal domain generations
+     **/
+    virt::generations &generations();
+
+    /** Returns a reference to internal response cache
+     *
+     * @returns Reference to internal response cache
+     **/
+    http::cache &cache();
+
     handler_setter(on_virt_event_registration, on_virt_event_registration_);
 
 private: // Utilities
@@ -157,6 +201,26 @@ private: // Utilities
 private: // Handlers
     void event_loop();
 
+    /** Make sure a user's domain generations are being tracked
+     *
+     * Registers libvirt events on the user's connection when they are
+     * not registered yet, or were registered on a connection that has
+     * since been replaced.
+     *
+     * @param user libvirt user
+     * @returns True if generations for `user` are tracked
+     **/
+    bool track(const std::string &user);
+
+    /** Record a change to one of a user's domains
+     *
+     * @param user libvirt user
+     * @param name Domain name
+     * @param uuid Domain UUID string, if known
+     **/
+    void changed(const std::string &user, const std::string &name,
+                 const std::string &uuid = std::string());
+
 private: // Routes
     void append_trailing_slash(http::connection_ptr, const std::smatch &,
                                const http::request &, http::response &);
@@ -25,6 +25,7 @@
 
 #include <fmt/format.h>
 #include <gtest/gtest.h>
+#include <chrono>
 #include <json/json.h>
 #include <thread>
 #include <tuple>
@@ -215,7 +216,9 @@ public:
 
     void TearDown() override
     {
-        server_thread.join();
+        if (server_thread.joinable()) {
+            server_thread.join();
+        }
         libvirt::reset();
         logger::reset_debug();
         tmpdir_test::TearDown();
@@ -289,6 +292,25 @@ TEST_F(app_test, append_trailing_slash)
     EXPECT_EQ(response.at(beast::http::field::location), "/blah/");
 }
 
+TEST_F(app_test, metrics)
+{
+    client->async_get("/metrics/").run();
+    EXPECT_EQ(response.result(), beast::http::status::ok);
+    EXPECT_EQ(response[beast::http::field::content_type],
+              "text/plain; version=0.0.4");
+    EXPECT_NE(response.body().find("# TYPE webvirtd_cache_hits_total counter"),
+              std::string::npos);
+}
+
+TEST_F(app_test, debug_requests)
+{
+    client->async_get("/debug/requests/").run();
+    EXPECT_EQ(response.result(), beast::http::status::ok);
+
+    auto data = json::parse(response.body());
+    EXPECT_TRUE(data.isArray());
+}
+
 TEST_F(mock_app_test, domains_libvirt_error)
 {
     EXPECT_CALL(lv, virConnectOpen(_)).WillOnce(Return(nullptr));
@@ -382,7 +404,8 @@ TEST_F(mock_app_test, persistent_virt_connection)
 
 TEST_F(websocket_test, websocket)
 {
-    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _));
+    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _))
+        .Times(2);
     EXPECT_CALL(lv, virEventRunDefaultImpl()).WillRepeatedly(Return(0));
 
     start_app();
@@ -404,9 +427,53 @@ TEST_F(websocket_test, websocket)
     client->async_connect(endpoint).run();
 }
 
+TEST_F(websocket_test, reactor_lease)
+{
+    // Serve connections on a reactor, which counts each of them
+    auto &base = config::ref();
+    config conf(base);
+    conf.add_option("reactors",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(1)
+                        ->multitoken(),
+                    "number of reactors");
+    const char *argv[] = { "webvirtd" };
+    conf.parse(1, argv);
+    config::change(conf);
+
+    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _))
+        .Times(2);
+    EXPECT_CALL(lv, virEventRunDefaultImpl()).WillRepeatedly(Return(0));
+
+    // Keep serving past the websocket's close, to see its lease go.
+    app_->server().on_close(http::handler<>());
+    start_app();
+
+    client->on_handshake([this](auto c, auto) {
+        EXPECT_EQ(app_->server().connections(), 1);
+        c->close();
+    });
+    auto endpoint = fmt::format("/users/{}/websocket/", username);
+    client->async_connect(endpoint).run();
+
+    // A closed websocket is destroyed, giving its lease back
+    const auto until =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (app_->server().connections() &&
+           std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(app_->server().connections(), 0);
+
+    io_.stop();
+    server_thread.join();
+    config::change(base);
+}
+
 TEST_F(websocket_test, error_on_read)
 {
-    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _));
+    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _))
+        .Times(2);
     EXPECT_CALL(lv, virEventRunDefaultImpl()).WillRepeatedly(Return(0));
 
     app_->server().on_error([this](const char *, beast::error_code) {
@@ -444,7 +511,8 @@ TEST_F(websocket_test, error_on_accept)
 
 TEST_F(websocket_test, connection_write)
 {
-    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _));
+    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _))
+        .Times(2);
     EXPECT_CALL(lv, virEventRunDefaultImpl()).WillRepeatedly(Return(0));
 
     app_->server().on_handshake([](websocket::connection_ptr conn) {
@@ -466,7 +534,8 @@ TEST_F(websocket_test, connection_write)
 
 TEST_F(websocket_test, error_on_write)
 {
-    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _));
+    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _))
+        .Times(2);
     EXPECT_CALL(lv, virEventRunDefaultImpl()).WillRepeatedly(Return(0));
 
     app_->server().on_handshake([](auto ws) {
@@ -502,7 +571,8 @@ TEST_F(websocket_test, error_on_write)
 
 TEST_F(websocket_test, events)
 {
-    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _));
+    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _))
+        .Times(2);
 
     virt::lifecycle_callback cb(virt::lifecycle_event::on_event_handler);
     std::atomic<bool> ready = false;
@@ -513,13 +583,17 @@ TEST_F(websocket_test, events)
     });
 
     EXPECT_CALL(lv, virDomainGetID(_)).WillOnce(Return(1));
-    EXPECT_CALL(lv, virDomainGetName(_)).WillOnce(Return("test"));
+    EXPECT_CALL(lv, virDomainGetName(_))
+        .Times(2)
+        .WillRepeatedly(Return("test"));
     EXPECT_CALL(lv, virDomainGetState(_, _, _, _))
         .WillOnce(Invoke([](auto, int *state, auto, auto) {
             *state = VIR_DOMAIN_RUNNING;
             return 0;
         }));
     EXPECT_CALL(lv, virDomainGetMetadata(_, _, _, _)).Times(2);
+    EXPECT_CALL(lv, virDomainGetUUIDString(_))
+        .WillOnce(Return("4dea22b3-1d52-d8f3-2516-782e98ab3fa0"));
 
     webvirt::domain_ptr ptr_ = std::make_shared<webvirt::domain>();
     EXPECT_CALL(lv, virEventRunDefaultImpl())
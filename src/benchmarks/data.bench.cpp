@@ -0,0 +1,60 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <benchmarks/fixtures.hpp>
+#include <data/domain.hpp>
+#include <thread/executor.hpp>
+#include <virt/domain.hpp>
+
+#include <benchmark/benchmark.h>
+
+using namespace webvirt;
+
+// Domains are described by the stub libvirt; only the data layer's own
+// work is measured.
+class data_fixture : public benchmark::Fixture
+{
+protected:
+    benchmarks::libvirt lv;
+    thread::executor executor { 4 };
+    virt::domain domain { std::make_shared<webvirt::domain>() };
+
+public:
+    void SetUp(const benchmark::State &) override
+    {
+        libvirt::change(lv);
+        thread::executor::change(executor);
+    }
+
+    void TearDown(const benchmark::State &) override
+    {
+        thread::executor::reset();
+        libvirt::reset();
+    }
+};
+
+BENCHMARK_F(data_fixture, simple_domain)(benchmark::State &state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(data::simple_domain(domain));
+    }
+}
+
+BENCHMARK_F(data_fixture, domain)(benchmark::State &state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(data::domain(domain));
+    }
+}
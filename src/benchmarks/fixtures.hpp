@@ -0,0 +1,310 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef BENCHMARKS_FIXTURES_HPP
+#define BENCHMARKS_FIXTURES_HPP
+
+#include <libvirt.hpp>
+
+#include <iostream>
+#include <streambuf>
+
+namespace webvirt::benchmarks
+{
+
+/** XML of a typical q35 guest, as produced by virDomainGetXMLDesc */
+inline constexpr const char *domain_xml = R"(<domain type="kvm" id="3">
+  <name>bench-guest</name>
+  <uuid>0b6d4a3e-6f3c-4c1a-9d0b-58b0a5f3e2a1</uuid>
+  <title>Benchmark guest</title>
+  <description>Guest used by the micro-benchmark suite</description>
+  <metadata>
+    <libosinfo:libosinfo xmlns:libosinfo="http://libosinfo.org/xmlns/libvirt/domain/1.0">
+      <libosinfo:os id="http://debian.org/debian/12"/>
+    </libosinfo:libosinfo>
+  </metadata>
+  <memory unit="KiB">4194304</memory>
+  <currentMemory unit="KiB">4194304</currentMemory>
+  <vcpu placement="static">4</vcpu>
+  <resource>
+    <partition>/machine</partition>
+  </resource>
+  <os>
+    <type arch="x86_64" machine="pc-q35-7.2">hvm</type>
+    <boot dev="hd"/>
+    <bootmenu enable="yes"/>
+  </os>
+  <features>
+    <acpi/>
+    <apic/>
+    <vmport state="off"/>
+  </features>
+  <cpu mode="host-passthrough" check="none" migratable="on">
+    <topology sockets="1" dies="1" cores="2" threads="2"/>
+  </cpu>
+  <clock offset="utc">
+    <timer name="rtc" tickpolicy="catchup"/>
+    <timer name="pit" tickpolicy="delay"/>
+    <timer name="hpet" present="no"/>
+  </clock>
+  <on_poweroff>destroy</on_poweroff>
+  <on_reboot>restart</on_reboot>
+  <on_crash>destroy</on_crash>
+  <pm>
+    <suspend-to-mem enabled="no"/>
+    <suspend-to-disk enabled="no"/>
+  </pm>
+  <devices>
+    <emulator>/usr/bin/qemu-system-x86_64</emulator>
+    <disk type="file" device="disk">
+      <driver name="qemu" type="qcow2" discard="unmap"/>
+      <source file="/var/lib/libvirt/images/bench-guest.qcow2" index="2"/>
+      <backingStore/>
+      <target dev="vda" bus="virtio"/>
+      <alias name="virtio-disk0"/>
+      <address type="pci" domain="0x0000" bus="0x04" slot="0x00" function="0x0"/>
+    </disk>
+    <disk type="file" device="cdrom">
+      <driver name="qemu" type="raw"/>
+      <source file="/var/lib/libvirt/images/debian-12.iso" index="1"/>
+      <target dev="sda" bus="sata"/>
+      <readonly/>
+      <alias name="sata0-0-0"/>
+      <address type="drive" controller="0" bus="0" target="0" unit="0"/>
+    </disk>
+    <controller type="usb" index="0" model="qemu-xhci" ports="15">
+      <alias name="usb"/>
+      <address type="pci" domain="0x0000" bus="0x02" slot="0x00" function="0x0"/>
+    </controller>
+    <controller type="pci" index="0" model="pcie-root">
+      <alias name="pcie.0"/>
+    </controller>
+    <controller type="pci" index="1" model="pcie-root-port">
+      <model name="pcie-root-port"/>
+      <target chassis="1" port="0x10"/>
+      <alias name="pci.1"/>
+      <address type="pci" domain="0x0000" bus="0x00" slot="0x02" function="0x0" multifunction="on"/>
+    </controller>
+    <controller type="sata" index="0">
+      <alias name="ide"/>
+      <address type="pci" domain="0x0000" bus="0x00" slot="0x1f" function="0x2"/>
+    </controller>
+    <controller type="virtio-serial" index="0">
+      <alias name="virtio-serial0"/>
+      <address type="pci" domain="0x0000" bus="0x03" slot="0x00" function="0x0"/>
+    </controller>
+    <interface type="network">
+      <mac address="52:54:00:6b:3c:58"/>
+      <source network="default" portid="e4c2e0a6-3b5e-4a7c-9a41-3c3f3a3f4c1d" bridge="virbr0"/>
+      <target dev="vnet2"/>
+      <model type="virtio"/>
+      <alias name="net0"/>
+      <address type="pci" domain="0x0000" bus="0x01" slot="0x00" function="0x0"/>
+    </interface>
+    <serial type="pty">
+      <source path="/dev/pts/3"/>
+      <target type="isa-serial" port="0">
+        <model name="isa-serial"/>
+      </target>
+      <alias name="serial0"/>
+    </serial>
+    <console type="pty" tty="/dev/pts/3">
+      <source path="/dev/pts/3"/>
+      <target type="serial" port="0"/>
+      <alias name="serial0"/>
+    </console>
+    <channel type="unix">
+      <source mode="bind" path="/run/libvirt/qemu/channel/3-bench-guest/org.qemu.guest_agent.0"/>
+      <target type="virtio" name="org.qemu.guest_agent.0" state="connected"/>
+      <alias name="channel0"/>
+      <address type="virtio-serial" controller="0" bus="0" port="1"/>
+    </channel>
+    <input type="tablet" bus="usb">
+      <alias name="input0"/>
+      <address type="usb" bus="0" port="1"/>
+    </input>
+    <input type="mouse" bus="ps2">
+      <alias name="input1"/>
+    </input>
+    <graphics type="spice" port="5900" autoport="yes" listen="127.0.0.1">
+      <listen type="address" address="127.0.0.1"/>
+      <image compression="off"/>
+    </graphics>
+    <video>
+      <model type="qxl" ram="65536" vram="65536" vgamem="16384" heads="1" primary="yes"/>
+      <alias name="video0"/>
+      <address type="pci" domain="0x0000" bus="0x00" slot="0x01" function="0x0"/>
+    </video>
+    <memballoon model="virtio">
+      <alias name="balloon0"/>
+      <address type="pci" domain="0x0000" bus="0x05" slot="0x00" function="0x0"/>
+    </memballoon>
+    <rng model="virtio">
+      <backend model="random">/dev/urandom</backend>
+      <alias name="rng0"/>
+      <address type="pci" domain="0x0000" bus="0x06" slot="0x00" function="0x0"/>
+    </rng>
+  </devices>
+  <seclabel type="dynamic" model="dac" relabel="yes">
+    <label>+64055:+994</label>
+    <imagelabel>+64055:+994</imagelabel>
+  </seclabel>
+</domain>
+)";
+
+/** Host section of a typical virConnectGetCapabilities document */
+inline constexpr const char *capabilities_xml = R"(<capabilities>
+  <host>
+    <uuid>5e1a7c2f-93b4-4d0e-8f6a-2c9b1d7e4a30</uuid>
+    <cpu>
+      <arch>x86_64</arch>
+      <model>Skylake-Client-noTSX-IBRS</model>
+      <vendor>Intel</vendor>
+      <microcode version="240"/>
+      <signature family="6" model="158" stepping="10"/>
+      <counter name="tsc" frequency="3191999000" scaling="no"/>
+      <topology sockets="1" dies="1" cores="6" threads="2"/>
+      <maxphysaddr mode="emulate" bits="39"/>
+      <feature name="ds"/>
+      <feature name="acpi"/>
+      <feature name="ss"/>
+      <feature name="ht"/>
+      <feature name="tm"/>
+      <feature name="pbe"/>
+      <feature name="dtes64"/>
+      <feature name="monitor"/>
+      <feature name="vmx"/>
+      <feature name="tsc_adjust"/>
+      <feature name="md-clear"/>
+      <feature name="stibp"/>
+      <feature name="arch-capabilities"/>
+      <feature name="ssbd"/>
+      <feature name="xsaves"/>
+      <pages unit="KiB" size="4"/>
+      <pages unit="KiB" size="2048"/>
+      <pages unit="KiB" size="1048576"/>
+    </cpu>
+    <power_management>
+      <suspend_mem/>
+      <suspend_disk/>
+      <suspend_hybrid/>
+    </power_management>
+    <iommu support="yes"/>
+    <migration_features>
+      <live/>
+      <uri_transports>
+        <uri_transport>tcp</uri_transport>
+        <uri_transport>rdma</uri_transport>
+      </uri_transports>
+    </migration_features>
+    <topology>
+      <cells num="1">
+        <cell id="0">
+          <memory unit="KiB">32718240</memory>
+          <pages unit="KiB" size="4">8179560</pages>
+          <pages unit="KiB" size="2048">0</pages>
+          <pages unit="KiB" size="1048576">0</pages>
+          <distances>
+            <sibling id="0" value="10"/>
+          </distances>
+          <cpus num="12">
+            <cpu id="0" socket_id="0" die_id="0" core_id="0" siblings="0,6"/>
+            <cpu id="1" socket_id="0" die_id="0" core_id="1" siblings="1,7"/>
+            <cpu id="2" socket_id="0" die_id="0" core_id="2" siblings="2,8"/>
+            <cpu id="3" socket_id="0" die_id="0" core_id="3" siblings="3,9"/>
+            <cpu id="4" socket_id="0" die_id="0" core_id="4" siblings="4,10"/>
+            <cpu id="5" socket_id="0" die_id="0" core_id="5" siblings="5,11"/>
+            <cpu id="6" socket_id="0" die_id="0" core_id="0" siblings="0,6"/>
+            <cpu id="7" socket_id="0" die_id="0" core_id="1" siblings="1,7"/>
+            <cpu id="8" socket_id="0" die_id="0" core_id="2" siblings="2,8"/>
+            <cpu id="9" socket_id="0" die_id="0" core_id="3" siblings="3,9"/>
+            <cpu id="10" socket_id="0" die_id="0" core_id="4" siblings="4,10"/>
+            <cpu id="11" socket_id="0" die_id="0" core_id="5" siblings="5,11"/>
+          </cpus>
+        </cell>
+      </cells>
+    </topology>
+    <cache>
+      <bank id="0" level="3" type="both" size="12" unit="MiB" cpus="0-11"/>
+    </cache>
+    <secmodel>
+      <model>apparmor</model>
+      <doi>0</doi>
+    </secmodel>
+    <secmodel>
+      <model>dac</model>
+      <doi>0</doi>
+      <baselabel type="kvm">+64055:+994</baselabel>
+      <baselabel type="qemu">+64055:+994</baselabel>
+    </secmodel>
+  </host>
+</capabilities>
+)";
+
+/** Stub libvirt describing every domain with `domain_xml` */
+class libvirt : public webvirt::libvirt
+{
+public:
+    c_string virDomainGetXMLDesc(domain_ptr, int) override
+    {
+        return c_string(domain_xml);
+    }
+};
+
+/** Discards whatever is written to it */
+class null_buffer : public std::streambuf
+{
+protected:
+    int_type overflow(int_type c) override
+    {
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char_type *, std::streamsize n) override
+    {
+        return n;
+    }
+};
+
+/** Silence std::cout and std::cerr while in scope
+ *
+ * The daemon logs every request it serves. Benchmarks serving requests
+ * keep the cost of formatting those lines, but not of writing them out
+ * between benchmark results.
+ **/
+class quiet
+{
+private:
+    null_buffer buffer_;
+    std::streambuf *out_;
+    std::streambuf *err_;
+
+public:
+    quiet()
+        : out_(std::cout.rdbuf(&buffer_))
+        , err_(std::cerr.rdbuf(&buffer_))
+    {
+    }
+
+    ~quiet()
+    {
+        std::cout.rdbuf(out_);
+        std::cerr.rdbuf(err_);
+    }
+};
+
+}; // namespace webvirt::benchmarks
+
+#endif /* BENCHMARKS_FIXTURES_HPP */
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <benchmarks/fixtures.hpp>
+#include <http/connection.hpp>
+#include <http/io_context.hpp>
+#include <http/middleware.hpp>
+#include <http/router.hpp>
+
+#include <benchmark/benchmark.h>
+
+using namespace webvirt;
+
+using http::middleware::with_methods;
+
+static void noop(http::connection_ptr, const std::smatch &,
+                 const http::request &, http::response &)
+{
+}
+
+// A router holding app's route table, without its views.
+class router_fixture : public benchmark::Fixture
+{
+protected:
+    http::io_context io;
+    http::connection_ptr conn;
+    http::router router;
+
+public:
+    void SetUp(const benchmark::State &) override
+    {
+        conn = std::make_shared<http::connection>(
+            io, net::unix::socket { io }, std::chrono::milliseconds(50));
+
+        const std::vector<std::string> routes = {
+            R"(^.+[^/]$)",
+            R"(^/metrics/$)",
+            R"(^/debug/requests/$)",
+            R"(^/users/([^/]+)/websocket/)",
+            R"(^/users/([^/]+)/host/)",
+            R"(^/users/([^/]+)/host/refresh/$)",
+            R"(^/users/([^/]+)/host/networks/)",
+            R"(^/users/([^/]+)/domains/$)",
+            R"(^/users/([^/]+)/domains/([^/]+)/$)",
+            R"(^/users/([^/]+)/domains/([^/]+)/autostart/$)",
+            R"(^/users/([^/]+)/domains/([^/]+)/metadata/$)",
+            R"(^/users/([^/]+)/domains/([^/]+)/bootmenu/$)",
+            R"(^/users/([^/]+)/domains/([^/]+)/start/$)",
+            R"(^/users/([^/]+)/domains/([^/]+)/shutdown/)",
+        };
+        for (const auto &route : routes) {
+            router.route(route,
+                         with_methods({ beast::http::verb::get }, noop));
+        }
+    }
+
+    void TearDown(const benchmark::State &) override
+    {
+        conn.reset();
+    }
+
+    void dispatch(benchmark::State &state, const char *target)
+    {
+        http::request request;
+        request.method(beast::http::verb::get);
+        request.target(target);
+
+        benchmarks::quiet quiet;
+        for (auto _ : state) {
+            http::response response;
+            router.run(conn, request, response);
+            benchmark::DoNotOptimize(response);
+        }
+    }
+};
+
+BENCHMARK_F(router_fixture, run_metrics)(benchmark::State &state)
+{
+    dispatch(state, "/metrics/");
+}
+
+BENCHMARK_F(router_fixture, run_domain)(benchmark::State &state)
+{
+    dispatch(state, "/users/test/domains/bench-guest/");
+}
+
+BENCHMARK_F(router_fixture, run_not_found)(benchmark::State &state)
+{
+    dispatch(state, "/users/test/unknown/");
+}
+
+static void middleware_with_methods(benchmark::State &state,
+                                    beast::http::verb method)
+{
+    auto route = with_methods(
+        { beast::http::verb::get, beast::http::verb::post }, noop);
+
+    http::request request;
+    request.method(method);
+    std::smatch match;
+
+    for (auto _ : state) {
+        http::response response;
+        route(nullptr, match, request, response);
+        benchmark::DoNotOptimize(response);
+    }
+}
+BENCHMARK_CAPTURE(middleware_with_methods, get, beast::http::verb::get);
+BENCHMARK_CAPTURE(middleware_with_methods, options,
+                  beast::http::verb::options);
+BENCHMARK_CAPTURE(middleware_with_methods, not_allowed,
+                  beast::http::verb::delete_);
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <benchmarks/fixtures.hpp>
+#include <util/json.hpp>
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <pugixml.hpp>
+
+using namespace webvirt;
+
+// Convert an already parsed document, as the views do after libvirt
+// returned it.
+static void json_xml_to_json(benchmark::State &state, const char *xml,
+                             const char *root)
+{
+    pugi::xml_document doc;
+    doc.load_string(xml);
+    auto node = doc.child(root);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(json::xml_to_json(node));
+    }
+    state.SetBytesProcessed(state.iterations() * std::strlen(xml));
+}
+BENCHMARK_CAPTURE(json_xml_to_json, domain, benchmarks::domain_xml,
+                  "domain");
+BENCHMARK_CAPTURE(json_xml_to_json, capabilities,
+                  benchmarks::capabilities_xml, "capabilities");
+
+// Parse and convert, which is what each domain request pays for.
+static void json_parse_xml_to_json(benchmark::State &state, const char *xml,
+                                   const char *root)
+{
+    for (auto _ : state) {
+        pugi::xml_document doc;
+        doc.load_string(xml);
+        benchmark::DoNotOptimize(json::xml_to_json(doc.child(root)));
+    }
+    state.SetBytesProcessed(state.iterations() * std::strlen(xml));
+}
+BENCHMARK_CAPTURE(json_parse_xml_to_json, domain, benchmarks::domain_xml,
+                  "domain");
+BENCHMARK_CAPTURE(json_parse_xml_to_json, capabilities,
+                  benchmarks::capabilities_xml, "capabilities");
+
+// Serialize a listing of `range(0)` converted domains.
+static void json_stringify(benchmark::State &state)
+{
+    pugi::xml_document doc;
+    doc.load_string(benchmarks::domain_xml);
+    auto domain = json::xml_to_json(doc.child("domain"));
+
+    Json::Value listing(Json::arrayValue);
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        listing.append(domain);
+    }
+
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        auto output = json::stringify(listing);
+        bytes += output.size();
+        benchmark::DoNotOptimize(output);
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(json_stringify)->Arg(1)->Arg(64);
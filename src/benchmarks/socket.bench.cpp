@@ -0,0 +1,206 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <benchmarks/fixtures.hpp>
+#include <http/client.hpp>
+#include <http/connection.hpp>
+#include <http/io_context.hpp>
+#include <http/server.hpp>
+#include <http/util.hpp>
+#include <syscall.hpp>
+#include <util/config.hpp>
+#include <util/json.hpp>
+#include <util/util.hpp>
+#include <ws/client.hpp>
+#include <ws/connection.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <pugixml.hpp>
+#include <thread>
+#include <vector>
+
+using namespace webvirt;
+
+using clock_type = std::chrono::steady_clock;
+
+// A server on a unix socket, run by a thread of its own, and clients
+// run by the benchmark's thread. Every round trip passes through the
+// kernel and Asio's reactor on both ends, so running this suite from
+// an io_uring build and from an epoll build compares the two backends;
+// see -Dio_uring.
+class socket_fixture : public benchmark::Fixture
+{
+protected:
+    config conf;
+    std::filesystem::path tmpdir, socket_path;
+
+    // Declared ahead of server, which must be destroyed first.
+    std::unique_ptr<http::io_context> io, client_io;
+    std::unique_ptr<http::server> server;
+    std::thread server_thread;
+    std::unique_ptr<benchmarks::quiet> quiet;
+
+    std::promise<websocket::connection_ptr> websocket_;
+    std::atomic<bool> written { false };
+    std::vector<double> latencies;
+
+public:
+    socket_fixture()
+    {
+        conf.add_option("threads",
+                        boost::program_options::value<unsigned>()
+                            ->default_value(1)
+                            ->multitoken(),
+                        "number of worker threads");
+
+        const char *argv[] = { "webvirtd" };
+        conf.parse(1, argv);
+    }
+
+    void SetUp(const benchmark::State &) override
+    {
+        quiet = std::make_unique<benchmarks::quiet>();
+        config::change(conf);
+        tmpdir = socket_path = make_tmpdir();
+        socket_path /= "bench.sock";
+
+        io = std::make_unique<http::io_context>();
+        client_io = std::make_unique<http::io_context>();
+        server = std::make_unique<http::server>(*io, socket_path);
+        server->on_request([](http::connection_ptr conn,
+                              const http::request &request,
+                              http::response &response) {
+            if (beast::websocket::is_upgrade(request)) {
+                conn->upgrade();
+                response.result(beast::http::status::switching_protocols);
+                return;
+            }
+            http::set_response(response,
+                               std::string(R"({"status":"ok"})"),
+                               beast::http::status::ok);
+        });
+
+        websocket_ = std::promise<websocket::connection_ptr>();
+        server->on_handshake([this](websocket::connection_ptr conn) {
+            // A websocket allows one write at a time.
+            conn->on_write([this](auto) {
+                written = true;
+            });
+            websocket_.set_value(std::move(conn));
+        });
+
+        server_thread = std::thread([this] {
+            server->run();
+        });
+        latencies.clear();
+    }
+
+    void TearDown(const benchmark::State &) override
+    {
+        io->stop();
+        server_thread.join();
+        server.reset();
+        client_io.reset();
+        io.reset();
+        syscall::ref().fs_remove_all(tmpdir);
+        config::reset();
+        quiet.reset();
+    }
+
+protected:
+    // Report throughput, and latency percentiles in microseconds.
+    void report(benchmark::State &state)
+    {
+        state.SetItemsProcessed(state.iterations());
+        if (latencies.empty()) {
+            return;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [this](double p) {
+            auto i = static_cast<std::size_t>(p * (latencies.size() - 1));
+            return latencies[i] * 1e6;
+        };
+        state.counters["p50_us"] = percentile(0.50);
+        state.counters["p99_us"] = percentile(0.99);
+        state.counters["p999_us"] = percentile(0.999);
+    }
+};
+
+// Connect, GET and read a small JSON response; webvirtd closes every
+// HTTP connection after its response.
+BENCHMARK_DEFINE_F(socket_fixture, http_get)(benchmark::State &state)
+{
+    for (auto _ : state) {
+        const auto start = clock_type::now();
+        auto client =
+            std::make_shared<http::client>(*client_io, socket_path.string());
+        client_io->restart();
+        client->async_get("/").run();
+
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+        latencies.push_back(elapsed.count());
+    }
+    report(state);
+}
+BENCHMARK_REGISTER_F(socket_fixture, http_get)->UseRealTime();
+
+// Push a converted domain, as broadcast on lifecycle events, from the
+// server to a websocket client.
+BENCHMARK_DEFINE_F(socket_fixture, websocket_push)(benchmark::State &state)
+{
+    pugi::xml_document doc;
+    doc.load_string(benchmarks::domain_xml);
+    const auto message =
+        json::stringify(json::xml_to_json(doc.child("domain")));
+
+    bool received = false;
+    auto client = std::make_shared<websocket::client>(*client_io, socket_path);
+    client->on_read([&received](auto, const std::string &) {
+        received = true;
+    });
+    client->async_connect("/");
+
+    auto future = websocket_.get_future();
+    while (future.wait_for(std::chrono::seconds(0)) !=
+           std::future_status::ready) {
+        client_io->run_one_for(std::chrono::milliseconds(1));
+    }
+    auto conn = future.get();
+
+    for (auto _ : state) {
+        const auto start = clock_type::now();
+        received = written = false;
+        boost::asio::post(*io, [&conn, &message] {
+            conn->write(message);
+        });
+        while (!received) {
+            client_io->run_one();
+        }
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+        latencies.push_back(elapsed.count());
+
+        while (!written) {
+            std::this_thread::yield();
+        }
+    }
+    report(state);
+}
+BENCHMARK_REGISTER_F(socket_fixture, websocket_push)->UseRealTime();
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <benchmarks/fixtures.hpp>
+#include <http/io_context.hpp>
+#include <util/json.hpp>
+#include <ws/pool.hpp>
+
+#include <benchmark/benchmark.h>
+#include <pugixml.hpp>
+
+using namespace webvirt;
+
+// Broadcast a converted domain to `range(0)` websockets of one user.
+// The websockets are never opened, so writes fail in the io_context
+// without touching a socket; what remains is the pool's own fan-out.
+static void pool_broadcast(benchmark::State &state)
+{
+    http::io_context io;
+    websocket::pool pool;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        pool.add("test",
+                 std::make_shared<websocket::connection>(
+                     io, net::unix::socket { io }, http::request()));
+    }
+
+    pugi::xml_document doc;
+    doc.load_string(benchmarks::domain_xml);
+    auto domain = json::xml_to_json(doc.child("domain"));
+
+    benchmarks::quiet quiet;
+    for (auto _ : state) {
+        pool.broadcast("test", domain);
+
+        state.PauseTiming();
+        io.restart();
+        io.poll();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(pool_broadcast)->Arg(1)->Arg(16)->Arg(256);
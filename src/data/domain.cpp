@@ -14,9 +14,15 @@
  * permissions and limitations under the License.
  */
 #include <data/domain.hpp>
+#include <thread/executor.hpp>
+#include <thread/parallel.hpp>
 #include <util/json.hpp>
+#include <util/trace.hpp>
+#include <virt/instrumented.hpp>
 #include <virt/util.hpp>
 
+#include <map>
+
 using namespace webvirt;
 
 const std::vector<std::string> ARRAY_KEYS = {
@@ -25,73 +31,228 @@ const std::vector<std::string> ARRAY_KEYS = {
     "video",   "redirdev",   "memballoon", "rng"
 };
 
-Json::Value data::simple_domain(virt::domain &domain)
+const std::map<std::string, data::domain_fields::field> FIELDS = {
+    { "id", data::domain_fields::id },
+    { "name", data::domain_fields::name },
+    { "title", data::domain_fields::title },
+    { "description", data::domain_fields::description },
+    { "state", data::domain_fields::state },
+    { "autostart", data::domain_fields::autostart },
+    { "xml", data::domain_fields::xml },
+    { "block_info", data::domain_fields::block_info },
+};
+
+template <typename Func>
+static void for_each_field(const std::string &list, Func fn)
 {
-    Json::Value output(Json::objectValue);
+    std::size_t start = 0;
+    while (start <= list.size()) {
+        auto end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
 
-    output["id"] = domain.id();
+        auto name = list.substr(start, end - start);
+        if (name.size()) {
+            fn(name);
+        }
 
-    Json::Value name(Json::objectValue);
-    name["text"] = domain.name();
-    output["name"] = std::move(name);
+        start = end + 1;
+    }
+}
 
-    Json::Value title(Json::objectValue);
-    title["text"] = domain.title();
-    output["title"] = std::move(title);
+data::domain_fields::domain_fields(unsigned int flags)
+    : flags_(flags)
+    , all_keys_((flags & xml) != 0)
+{
+}
 
-    Json::Value description(Json::objectValue);
-    description["text"] = domain.description();
-    output["description"] = std::move(description);
+data::domain_fields &data::domain_fields::select(const std::string &list)
+{
+    if (list.empty()) {
+        return *this;
+    }
 
-    int state_id = domain.state();
-    Json::Value attrib(Json::objectValue);
-    attrib["id"] = state_id;
-    attrib["string"] = virt::state_string(state_id);
+    flags_ = 0;
+    all_keys_ = false;
+    keys_.clear();
+    for_each_field(list, [this](const std::string &name) {
+        add(name);
+    });
+    return *this;
+}
 
-    Json::Value state(Json::objectValue);
-    state["attrib"] = std::move(attrib);
-    output["state"] = std::move(state);
+data::domain_fields &data::domain_fields::include(const std::string &list)
+{
+    for_each_field(list, [this](const std::string &name) {
+        add(name);
+    });
+    return *this;
+}
 
-    return output;
+data::domain_fields &data::domain_fields::exclude(const std::string &list)
+{
+    for_each_field(list, [this](const std::string &name) {
+        auto it = FIELDS.find(name);
+        if (it != FIELDS.end()) {
+            flags_ &= ~it->second;
+
+            // Block information is read from the XML description's disks.
+            if (it->second == xml) {
+                flags_ &= ~block_info;
+            }
+        }
+        excluded_keys_.insert(name);
+    });
+    return *this;
+}
+
+bool data::domain_fields::has(field f) const
+{
+    return (flags_ & f) != 0;
+}
+
+bool data::domain_fields::has_key(const std::string &key) const
+{
+    if (excluded_keys_.count(key)) {
+        return false;
+    }
+    return all_keys_ || keys_.count(key);
+}
+
+void data::domain_fields::add(const std::string &name)
+{
+    auto it = FIELDS.find(name);
+    if (it == FIELDS.end()) {
+        // Any other name selects a top-level key of the XML description.
+        flags_ |= xml;
+        keys_.insert(name);
+        return;
+    }
+
+    flags_ |= it->second;
+    if (it->second == xml) {
+        all_keys_ = true;
+    } else if (it->second == block_info) {
+        flags_ |= xml;
+        keys_.insert("devices");
+    }
+}
+
+Json::Value data::simple_domain(virt::domain &domain)
+{
+    return data::domain(domain, domain_fields(domain_fields::simple));
 }
 
 Json::Value data::domain(virt::domain &domain)
 {
-    Json::Value output = simple_domain(domain);
+    return data::domain(domain, domain_fields());
+}
+
+Json::Value data::domain(virt::domain &domain, const domain_fields &fields)
+{
+    Json::Value output(Json::objectValue);
+
+    if (fields.has(domain_fields::id)) {
+        output["id"] = domain.id();
+    }
+
+    if (fields.has(domain_fields::name)) {
+        Json::Value name(Json::objectValue);
+        name["text"] = domain.name();
+        output["name"] = std::move(name);
+    }
+
+    if (fields.has(domain_fields::title)) {
+        Json::Value title(Json::objectValue);
+        title["text"] = domain.title();
+        output["title"] = std::move(title);
+    }
+
+    if (fields.has(domain_fields::description)) {
+        Json::Value description(Json::objectValue);
+        description["text"] = domain.description();
+        output["description"] = std::move(description);
+    }
+
+    if (fields.has(domain_fields::state)) {
+        int state_id = domain.state();
+        Json::Value attrib(Json::objectValue);
+        attrib["id"] = state_id;
+        attrib["string"] = virt::state_string(state_id);
+
+        Json::Value state(Json::objectValue);
+        state["attrib"] = std::move(attrib);
+        output["state"] = std::move(state);
+    }
 
     // Include metadata not included elsewhere
-    output["autostart"] = domain.autostart();
+    if (fields.has(domain_fields::autostart)) {
+        output["autostart"] = domain.autostart();
+    }
+
+    if (!fields.has(domain_fields::xml)) {
+        return output;
+    }
 
     // Integrate the XML document into `output`.
     // 1. json::xml_to_json
-    // 2. Copy each resulting JSON key/value pair into `output`
+    // 2. Copy each selected JSON key/value pair into `output`
     pugi::xml_document doc = domain.xml_document();
     Json::Value xml_output = json::xml_to_json(doc.child("domain"));
     for (const std::string &key : xml_output.getMemberNames()) {
-        output[key] = xml_output[key];
+        if (fields.has_key(key)) {
+            output[key] = xml_output[key];
+        }
+    }
+
+    if (!output.isMember("devices")) {
+        return output;
     }
 
     // Turn various JSON values into arrays
+    auto &devices = output["devices"];
     for (const auto &key : ARRAY_KEYS) {
-        if (output["devices"].isMember(key) &&
-            output["devices"][key].type() == Json::objectValue) {
-            auto current = output["devices"][key];
-            output["devices"][key] = Json::Value(Json::arrayValue);
-            output["devices"][key].append(std::move(current));
+        if (devices.isMember(key) &&
+            devices[key].type() == Json::objectValue) {
+            auto current = devices[key];
+            devices[key] = Json::Value(Json::arrayValue);
+            devices[key].append(std::move(current));
         }
     }
 
     // For each disk found which has a device == "disk", collect
     // and include block information.
-    if (output["devices"].isMember("disk")) {
-        for (auto &disk : output["devices"]["disk"]) {
+    if (fields.has(domain_fields::block_info) && devices.isMember("disk")) {
+        std::vector<Json::Value *> disks;
+        std::vector<std::string> devs;
+        for (auto &disk : devices["disk"]) {
             // If this is not a storage disk, continue on.
             if (disk["attrib"]["device"].asString() != "disk")
                 continue;
 
-            // Collect block_info sizing for the disk.
-            auto dev = disk["target"]["attrib"]["dev"].asString();
-            auto block_info_ptr = domain.block_info(dev);
+            disks.emplace_back(&disk);
+            devs.emplace_back(disk["target"]["attrib"]["dev"].asString());
+        }
+
+        // Each disk costs a libvirt round trip; issue them concurrently.
+        auto &executor = thread::executor::ref();
+        const auto user = virt::instrumented_libvirt::user();
+        auto *trace_context = trace::current();
+        auto block_infos = thread::parallel_map(
+            executor,
+            user,
+            devs,
+            [&domain, &user, trace_context](const std::string &dev) {
+                virt::instrumented_libvirt::scope scope(user);
+                trace::scope trace_scope(trace_context);
+                return domain.block_info(dev);
+            },
+            thread::executor::fan_out());
+
+        for (std::size_t i = 0; i < disks.size(); ++i) {
+            auto &disk = *disks[i];
+            auto &block_info_ptr = block_infos[i];
             auto block_info = Json::Value(Json::objectValue);
             block_info["unit"] = "KiB";
             block_info["capacity"] = boost::numeric_cast<unsigned long>(
@@ -19,10 +19,100 @@
 #include <virt/domain.hpp>
 
 #include <json/json.h>
+#include <set>
+#include <string>
 
 namespace webvirt::data
 {
 
+/** A selection of JSON fields produced for a libvirt domain
+ *
+ * Selections are built from the comma-separated ?fields=, ?include= and
+ * ?exclude= query parameters. Each field maps onto the libvirt calls
+ * needed to produce it, so data::domain only makes the calls whose output
+ * was asked for.
+ *
+ * Names other than those in domain_fields::field select top-level keys
+ * of the domain's XML description, e.g. ?fields=name,vcpu,memory.
+ **/
+class domain_fields
+{
+public:
+    enum field : unsigned int {
+        id = 1 << 0,
+        name = 1 << 1,
+        title = 1 << 2,
+        description = 1 << 3,
+        state = 1 << 4,
+        autostart = 1 << 5,
+        xml = 1 << 6,
+        block_info = 1 << 7,
+    };
+
+    /** Fields produced by GET /users/(user)/domains/ */
+    static constexpr unsigned int simple =
+        id | name | title | description | state;
+
+    /** Fields produced by GET /users/(user)/domains/(name)/ */
+    static constexpr unsigned int all = simple | autostart | xml | block_info;
+
+private:
+    unsigned int flags_;
+
+    // Selected and excluded top-level XML keys. When all_keys_ is set,
+    // every key not excluded is selected; only xml sets it.
+    bool all_keys_;
+    std::set<std::string> keys_;
+    std::set<std::string> excluded_keys_;
+
+public:
+    /** Construct a selection
+     *
+     * @param flags Bitwise OR of domain_fields::field values
+     **/
+    explicit domain_fields(unsigned int flags = all);
+
+    /** Replace the selection with a comma-separated list of fields
+     *
+     * An empty list leaves the selection untouched.
+     *
+     * @param list Comma-separated field names
+     * @returns Reference to this
+     **/
+    domain_fields &select(const std::string &);
+
+    /** Add a comma-separated list of fields to the selection
+     *
+     * @param list Comma-separated field names
+     * @returns Reference to this
+     **/
+    domain_fields &include(const std::string &);
+
+    /** Remove a comma-separated list of fields from the selection
+     *
+     * @param list Comma-separated field names
+     * @returns Reference to this
+     **/
+    domain_fields &exclude(const std::string &);
+
+    /** Test whether a field is selected
+     *
+     * @param f domain_fields::field
+     * @returns True if `f` is selected
+     **/
+    bool has(field) const;
+
+    /** Test whether a top-level XML key is selected
+     *
+     * @param key Top-level key produced from the domain's XML
+     * @returns True if `key` should be part of the output
+     **/
+    bool has_key(const std::string &) const;
+
+private:
+    void add(const std::string &);
+};
+
 /** Produce a simple JSON object for a libvirt domain
  *
  * See https://app.swaggerhub.com/apis/kevr/webvirtd for:
@@ -33,6 +123,14 @@ namespace webvirt::data
  **/
 Json::Value simple_domain(virt::domain &);
 
+/** Produce a JSON object for a libvirt domain from a field selection
+ *
+ * @param domain libvirt domain
+ * @param fields Fields to produce
+ * @returns JSON object holding the selected fields
+ **/
+Json::Value domain(virt::domain &, const domain_fields &);
+
 /** Produces a more detailed JSON object for a libvirt domain
  *
  * See https://app.swaggerhub.com/apis/kevr/webvirtd for:
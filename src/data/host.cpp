@@ -55,9 +55,14 @@ Json::Value data::networks(virt::connection &conn)
 
     auto networks = conn.networks();
     for (auto &network : networks) {
-        pugi::xml_document xml = network.xml_document();
-        output.append(json::xml_to_json(xml.child("network")));
+        output.append(data::network(network));
     }
 
     return output;
 }
+
+Json::Value data::network(virt::network &network)
+{
+    pugi::xml_document xml = network.xml_document();
+    return json::xml_to_json(xml.child("network"));
+}
@@ -44,6 +44,13 @@ Json::Value host(virt::connection &);
  **/
 Json::Value networks(virt::connection &);
 
+/** Produce JSON data for a single libvirt network
+ *
+ * @param network libvirt network
+ * @returns JSON object for the libvirt network
+ **/
+Json::Value network(virt::network &);
+
 }; // namespace webvirt::data
 
 #endif /* DATA_HOST_HPP */
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <http/cache.hpp>
+
+using namespace webvirt;
+
+http::cache::cache(std::chrono::milliseconds ttl)
+    : ttl_(ttl)
+{
+}
+
+std::chrono::milliseconds http::cache::ttl() const
+{
+    return ttl_;
+}
+
+std::optional<http::response> http::cache::get(const std::string &user,
+                                               const std::string &key)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    auto user_it = users_.find(user);
+    if (user_it != users_.end()) {
+        auto &entries = user_it->second;
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            if (clock::now() < it->second.expires) {
+                ++hits_;
+                return it->second.response;
+            }
+            entries.erase(it);
+            if (entries.empty()) {
+                users_.erase(user_it);
+            }
+        }
+    }
+
+    ++misses_;
+    return std::nullopt;
+}
+
+std::uint64_t http::cache::version(const std::string &user)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = versions_.find(user);
+    return it != versions_.end() ? it->second : forgotten_;
+}
+
+void http::cache::put(const std::string &user, const std::string &key,
+                      const http::response &response, std::uint64_t version)
+{
+    if (ttl_.count() <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    auto version_it = versions_.find(user);
+    auto current =
+        version_it != versions_.end() ? version_it->second : forgotten_;
+    if (current != version) {
+        // Invalidated while the response was being produced.
+        return;
+    }
+
+    auto now = clock::now();
+    auto &entries = users_[user];
+    if (entries.size() >= max_entries && !entries.count(key)) {
+        // Make room, preferably by dropping expired responses.
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->second.expires <= now) {
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (entries.size() >= max_entries) {
+            entries.erase(entries.begin());
+        }
+    }
+
+    entries[key] = entry { response, now + ttl_ };
+}
+
+void http::cache::invalidate(const std::string &user)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    users_.erase(user);
+    if (versions_.size() >= max_versions && !versions_.count(user)) {
+        forgotten_ = generation_;
+        versions_.clear();
+    }
+    versions_[user] = ++generation_;
+}
+
+std::uint64_t http::cache::hits() const
+{
+    return hits_;
+}
+
+std::uint64_t http::cache::misses() const
+{
+    return misses_;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef HTTP_CACHE_HPP
+#define HTTP_CACHE_HPP
+
+#include <http/types.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace webvirt::http
+{
+
+/** A cache of fully serialized HTTP responses
+ *
+ * Responses are kept per user, so that everything cached for a user can
+ * be dropped at once when one of their domains changes. Entries which
+ * are never invalidated expire once the cache's TTL elapses.
+ **/
+class cache
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /** Maximum number of responses cached for a single user */
+    static constexpr std::size_t max_entries = 256;
+
+    /** Maximum number of users whose invalidations are remembered */
+    static constexpr std::size_t max_versions = 4096;
+
+private:
+    struct entry {
+        http::response response;
+        clock::time_point expires;
+    };
+
+    std::chrono::milliseconds ttl_;
+
+    std::mutex mutex_;
+    // user -> key -> entry
+    std::map<std::string, std::map<std::string, entry>> users_;
+    // user -> generation of their latest invalidation. Past
+    // max_versions users, every entry is forgotten at once; forgotten_
+    // then stands in for all of them.
+    std::map<std::string, std::uint64_t> versions_;
+    std::uint64_t generation_ { 0 };
+    std::uint64_t forgotten_ { 0 };
+
+    std::atomic<std::uint64_t> hits_ { 0 };
+    std::atomic<std::uint64_t> misses_ { 0 };
+
+public:
+    /** Construct a cache
+     *
+     * @param ttl Lifetime of cached responses; zero disables the cache
+     **/
+    explicit cache(std::chrono::milliseconds ttl);
+
+    /** Return the lifetime of cached responses
+     *
+     * @returns Lifetime of cached responses
+     **/
+    std::chrono::milliseconds ttl() const;
+
+    /** Look up a cached response
+     *
+     * @param user libvirt user the response belongs to
+     * @param key Cache key
+     * @returns Cached response, if one is present and fresh
+     **/
+    std::optional<http::response> get(const std::string &user,
+                                      const std::string &key);
+
+    /** Return a user's cache version
+     *
+     * The version changes every time the user's cache is invalidated.
+     * Taking it before producing a response lets put() refuse responses
+     * which may have been produced from data invalidated meanwhile.
+     * Once the invalidations of many users have been forgotten, put()
+     * may also refuse some responses which were not.
+     *
+     * @param user libvirt user
+     * @returns Current cache version of `user`
+     **/
+    std::uint64_t version(const std::string &user);
+
+    /** Cache a response
+     *
+     * @param user libvirt user the response belongs to
+     * @param key Cache key
+     * @param response Fully serialized response
+     * @param version User's cache version taken before producing `response`
+     **/
+    void put(const std::string &user, const std::string &key,
+             const http::response &response, std::uint64_t version);
+
+    /** Drop every response cached for a user
+     *
+     * @param user libvirt user
+     **/
+    void invalidate(const std::string &user);
+
+    /** Return the number of lookups answered from the cache
+     *
+     * @returns Number of cache hits
+     **/
+    std::uint64_t hits() const;
+
+    /** Return the number of lookups which were not
+     *
+     * @returns Number of cache misses
+     **/
+    std::uint64_t misses() const;
+};
+
+}; // namespace webvirt::http
+
+#endif /* HTTP_CACHE_HPP */
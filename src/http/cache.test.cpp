@@ -0,0 +1,194 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <http/cache.hpp>
+#include <http/middleware.hpp>
+
+#include <gtest/gtest.h>
+
+#include <regex>
+#include <thread>
+
+using namespace webvirt;
+using namespace std::chrono_literals;
+
+static http::response make_response(const std::string &body)
+{
+    http::response response;
+    response.result(beast::http::status::ok);
+    response.body() = body;
+    return response;
+}
+
+TEST(cache, get_put)
+{
+    http::cache cache(1min);
+    EXPECT_FALSE(cache.get("test", "/a/"));
+    EXPECT_EQ(cache.misses(), 1);
+
+    cache.put("test", "/a/", make_response("a"), cache.version("test"));
+    auto response = cache.get("test", "/a/");
+    ASSERT_TRUE(response);
+    EXPECT_EQ(response->body(), "a");
+    EXPECT_EQ(cache.hits(), 1);
+
+    // Entries are kept per user
+    EXPECT_FALSE(cache.get("other", "/a/"));
+    EXPECT_EQ(cache.misses(), 2);
+}
+
+TEST(cache, invalidate)
+{
+    http::cache cache(1min);
+    cache.put("test", "/a/", make_response("a"), cache.version("test"));
+    cache.put("other", "/a/", make_response("a"), cache.version("other"));
+
+    cache.invalidate("test");
+    EXPECT_FALSE(cache.get("test", "/a/"));
+    EXPECT_TRUE(cache.get("other", "/a/"));
+}
+
+TEST(cache, stale_version)
+{
+    http::cache cache(1min);
+    auto version = cache.version("test");
+    cache.invalidate("test");
+
+    // Produced before the invalidation; not cached
+    cache.put("test", "/a/", make_response("a"), version);
+    EXPECT_FALSE(cache.get("test", "/a/"));
+}
+
+TEST(cache, max_versions)
+{
+    http::cache cache(1min);
+    auto version = cache.version("test");
+    for (std::size_t i = 0; i <= http::cache::max_versions; ++i) {
+        cache.invalidate(std::to_string(i));
+    }
+
+    // "test" may have been among the forgotten users; not cached
+    cache.put("test", "/a/", make_response("a"), version);
+    EXPECT_FALSE(cache.get("test", "/a/"));
+
+    cache.put("test", "/a/", make_response("a"), cache.version("test"));
+    EXPECT_TRUE(cache.get("test", "/a/"));
+}
+
+TEST(cache, ttl)
+{
+    http::cache cache(1ms);
+    cache.put("test", "/a/", make_response("a"), cache.version("test"));
+    std::this_thread::sleep_for(5ms);
+    EXPECT_FALSE(cache.get("test", "/a/"));
+
+    http::cache disabled(0ms);
+    disabled.put("test", "/a/", make_response("a"), 0);
+    EXPECT_FALSE(disabled.get("test", "/a/"));
+}
+
+TEST(cache, max_entries)
+{
+    http::cache cache(1min);
+    for (std::size_t i = 0; i <= http::cache::max_entries; ++i) {
+        auto key = std::to_string(i);
+        cache.put("test", key, make_response(key), 0);
+    }
+
+    std::size_t cached = 0;
+    for (std::size_t i = 0; i <= http::cache::max_entries; ++i) {
+        cached += cache.get("test", std::to_string(i)).has_value();
+    }
+    EXPECT_EQ(cached, http::cache::max_entries);
+}
+
+class with_cache_test : public testing::Test
+{
+protected:
+    http::cache cache_ { 1min };
+    int calls_ = 0;
+    http::connection::route_function route_fn_;
+
+    const std::string path_ = "/users/test/domains/";
+    std::smatch match_;
+
+public:
+    void SetUp() override
+    {
+        route_fn_ = http::middleware::with_cache(
+            cache_, [this](http::connection_ptr, const std::smatch &,
+                           const http::request &, http::response &response) {
+                ++calls_;
+                response.result(beast::http::status::ok);
+                response.body() = std::to_string(calls_);
+            });
+        std::regex_match(path_, match_, std::regex(R"(^/users/([^/]+)/.*$)"));
+    }
+
+    http::response run(const http::request &request)
+    {
+        http::response response;
+        route_fn_(nullptr, match_, request, response);
+        return response;
+    }
+};
+
+TEST_F(with_cache_test, hit)
+{
+    http::request request;
+    request.method(beast::http::verb::get);
+    request.target(path_);
+
+    auto response = run(request);
+    EXPECT_EQ(response["X-Cache"], "MISS");
+    EXPECT_EQ(response.body(), "1");
+
+    response = run(request);
+    EXPECT_EQ(response["X-Cache"], "HIT");
+    EXPECT_EQ(response.body(), "1");
+    EXPECT_EQ(calls_, 1);
+
+    // The query string is part of the key
+    request.target(path_ + "?sort=name");
+    response = run(request);
+    EXPECT_EQ(response["X-Cache"], "MISS");
+    EXPECT_EQ(response.body(), "2");
+
+    cache_.invalidate("test");
+    request.target(path_);
+    response = run(request);
+    EXPECT_EQ(response["X-Cache"], "MISS");
+    EXPECT_EQ(response.body(), "3");
+}
+
+TEST_F(with_cache_test, bypass)
+{
+    http::request request;
+    request.method(beast::http::verb::post);
+    request.target(path_);
+
+    run(request);
+    auto response = run(request);
+    EXPECT_EQ(response["X-Cache"], "");
+    EXPECT_EQ(calls_, 2);
+
+    // Streamed listings are not cached
+    request.method(beast::http::verb::get);
+    request.target(path_ + "?stream=true");
+    run(request);
+    response = run(request);
+    EXPECT_EQ(response["X-Cache"], "");
+    EXPECT_EQ(calls_, 4);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <http/chunk_queue.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+using namespace webvirt;
+
+http::chunk_queue::chunk_queue(std::size_t capacity)
+    : capacity_(std::max<std::size_t>(capacity, 1))
+{
+}
+
+bool http::chunk_queue::push(std::string chunk)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] {
+        return cancelled_ || chunks_.size() < capacity_;
+    });
+    if (cancelled_) {
+        return false;
+    }
+
+    chunks_.emplace_back(std::move(chunk));
+    wake(lock);
+    return true;
+}
+
+void http::chunk_queue::close()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    closed_ = true;
+    wake(lock);
+}
+
+void http::chunk_queue::fail(const std::string &what)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    error_ = what;
+    closed_ = true;
+    wake(lock);
+}
+
+http::chunk_queue::status
+http::chunk_queue::pop(std::string &chunk, std::function<void()> waiter)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!chunks_.empty()) {
+        chunk = std::move(chunks_.front());
+        chunks_.pop_front();
+        lock.unlock();
+        cv_.notify_one();
+        return status::ready;
+    }
+
+    if (error_) {
+        throw std::runtime_error(*error_);
+    }
+
+    if (closed_) {
+        return status::done;
+    }
+
+    waiter_ = std::move(waiter);
+    return status::pending;
+}
+
+void http::chunk_queue::cancel()
+{
+    std::function<void()> waiter;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        cancelled_ = true;
+        chunks_.clear();
+        // The waiter may hold the consumer alive; let it go.
+        waiter.swap(waiter_);
+    }
+    cv_.notify_all();
+}
+
+void http::chunk_queue::unbound()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    capacity_ = std::numeric_limits<std::size_t>::max();
+}
+
+void http::chunk_queue::wake(std::unique_lock<std::mutex> &lock)
+{
+    std::function<void()> waiter;
+    waiter.swap(waiter_);
+    lock.unlock();
+
+    if (waiter) {
+        waiter();
+    }
+}
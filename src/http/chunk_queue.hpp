@@ -0,0 +1,110 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef HTTP_CHUNK_QUEUE_HPP
+#define HTTP_CHUNK_QUEUE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace webvirt::http
+{
+
+/** A bounded queue of response body chunks
+ *
+ * Hands chunks from a producer thread, which serializes them, to a
+ * connection's strand, which writes them out. The producer blocks while
+ * `capacity` chunks are waiting to be written; the strand never blocks,
+ * and is instead called back once the next chunk has been pushed.
+ **/
+class chunk_queue
+{
+public:
+    /** Default number of chunks waiting to be written */
+    static constexpr std::size_t default_capacity = 16;
+
+    /** Result of pop() */
+    enum class status {
+        ready,   // A chunk was popped
+        pending, // The queue is empty; the waiter will be called
+        done,    // The body is complete
+    };
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::string> chunks_;
+    std::size_t capacity_;
+    std::function<void()> waiter_;
+    std::optional<std::string> error_;
+    bool closed_ { false };
+    bool cancelled_ { false };
+
+public:
+    /** Construct a chunk_queue
+     *
+     * @param capacity Maximum number of chunks waiting to be written
+     **/
+    explicit chunk_queue(std::size_t capacity = default_capacity);
+
+    /** Push the next chunk, waiting for room in the queue
+     *
+     * @param chunk Chunk of the response body
+     * @returns False if the consumer has gone and nothing more should
+     *          be produced
+     **/
+    bool push(std::string chunk);
+
+    /** Complete the body once the pushed chunks are written */
+    void close();
+
+    /** Cut the body short once the pushed chunks are written
+     *
+     * @param what Description of the failure
+     **/
+    void fail(const std::string &what);
+
+    /** Pop the next chunk
+     *
+     * If no chunk is ready yet, `waiter` is kept and called, on the
+     * producer's thread, once one is or the body ends.
+     *
+     * @param chunk Output chunk
+     * @param waiter Function called when the queue is no longer empty
+     * @returns Status of the queue
+     * @throws std::runtime_error if the producer failed
+     **/
+    status pop(std::string &chunk, std::function<void()> waiter);
+
+    /** Stop consuming; pending and future pushes return false */
+    void cancel();
+
+    /** Remove the bound on the queue, so that push() never waits
+     *
+     * Used when the whole body is produced before any of it is written.
+     **/
+    void unbound();
+
+private:
+    void wake(std::unique_lock<std::mutex> &lock);
+};
+
+}; // namespace webvirt::http
+
+#endif /* HTTP_CHUNK_QUEUE_HPP */
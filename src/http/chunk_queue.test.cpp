@@ -0,0 +1,129 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <http/chunk_queue.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace webvirt;
+
+using status = http::chunk_queue::status;
+
+TEST(chunk_queue, pop)
+{
+    http::chunk_queue queue;
+    std::string chunk;
+    EXPECT_EQ(queue.pop(chunk, nullptr), status::pending);
+
+    EXPECT_TRUE(queue.push("a"));
+    EXPECT_TRUE(queue.push("b"));
+    queue.close();
+
+    EXPECT_EQ(queue.pop(chunk, nullptr), status::ready);
+    EXPECT_EQ(chunk, "a");
+    EXPECT_EQ(queue.pop(chunk, nullptr), status::ready);
+    EXPECT_EQ(chunk, "b");
+    EXPECT_EQ(queue.pop(chunk, nullptr), status::done);
+}
+
+TEST(chunk_queue, waiter)
+{
+    http::chunk_queue queue;
+    std::string chunk;
+    int woken = 0;
+    EXPECT_EQ(queue.pop(chunk, [&woken] { ++woken; }), status::pending);
+
+    queue.push("a");
+    EXPECT_EQ(woken, 1);
+
+    // The waiter is called once per pending pop()
+    queue.push("b");
+    EXPECT_EQ(woken, 1);
+}
+
+TEST(chunk_queue, bounded)
+{
+    http::chunk_queue queue(1);
+    std::atomic<int> pushed { 0 };
+    std::thread producer([&] {
+        for (auto chunk : { "a", "b", "c" }) {
+            queue.push(chunk);
+            ++pushed;
+        }
+        queue.close();
+    });
+
+    // The producer waits for room once a chunk is waiting
+    while (pushed < 1) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(pushed, 1);
+
+    std::string body, chunk;
+    while (true) {
+        auto result = queue.pop(chunk, nullptr);
+        if (result == status::done) {
+            break;
+        } else if (result == status::ready) {
+            body.append(chunk);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    EXPECT_EQ(body, "abc");
+}
+
+TEST(chunk_queue, fail)
+{
+    http::chunk_queue queue;
+    queue.push("a");
+    queue.fail("oops");
+
+    // Chunks pushed before the failure are still written
+    std::string chunk;
+    EXPECT_EQ(queue.pop(chunk, nullptr), status::ready);
+    EXPECT_THROW(queue.pop(chunk, nullptr), std::runtime_error);
+}
+
+TEST(chunk_queue, cancel)
+{
+    http::chunk_queue queue(1);
+    queue.push("a");
+
+    std::thread producer([&] {
+        EXPECT_FALSE(queue.push("b"));
+    });
+    queue.cancel();
+    producer.join();
+
+    EXPECT_FALSE(queue.push("c"));
+}
+
+TEST(chunk_queue, unbound)
+{
+    http::chunk_queue queue(1);
+    queue.unbound();
+    for (int i = 0; i < 64; ++i) {
+        EXPECT_TRUE(queue.push("a"));
+    }
+}
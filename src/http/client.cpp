@@ -49,6 +49,22 @@ int client::version() const
     return version_;
 }
 
+client &client::keep_alive(bool enabled)
+{
+    keep_alive_ = enabled;
+    return *this;
+}
+
+bool client::keep_alive() const
+{
+    return keep_alive_;
+}
+
+bool client::connected() const
+{
+    return connected_;
+}
+
 client &client::async_options(const char *target)
 {
     init_request(target);
@@ -96,6 +112,10 @@ void client::init_request(const char *target)
 {
     request_.version(version_);
     request_.target(target);
+    request_.body().clear();
+    if (keep_alive_) {
+        request_.keep_alive(true);
+    }
     request_.set(beast::http::field::host, host_);
     request_.set(beast::http::field::user_agent, BOOST_BEAST_VERSION_STRING);
     request_.set(beast::http::field::accept, "*/*");
@@ -103,7 +123,17 @@ void client::init_request(const char *target)
 
 void client::async_connect()
 {
-    io_.restart();
+    if (connected_) {
+        // Reuse the persistent connection.
+        return boost::asio::post(
+            socket_.get_executor(),
+            boost::beast::bind_front_handler(&client::async_write_request,
+                                             this->shared_from_this()));
+    }
+
+    if (io_.stopped()) {
+        io_.restart();
+    }
     socket_.async_connect(
         socket_path_,
         boost::beast::bind_front_handler(&client::client_on_connect,
@@ -118,8 +148,14 @@ void client::client_on_connect(boost::beast::error_code ec)
         CLASS_ETRACE(ec.message());
         return on_error_(__func__, ec);
     }
+    connected_ = true;
     on_connect_(*this);
 
+    async_write_request();
+}
+
+void client::async_write_request()
+{
     beast::http::async_write(
         socket_,
         request_,
@@ -133,9 +169,11 @@ void client::client_on_write(boost::beast::error_code ec, std::size_t bytes)
 
     if (ec) {
         CLASS_ETRACE(ec.message());
+        connected_ = false;
         return on_error_(__func__, ec);
     }
 
+    response_ = {};
     beast::http::async_read(
         socket_,
         buffer_,
@@ -150,9 +188,16 @@ void client::client_on_read(boost::beast::error_code ec, std::size_t bytes)
 
     if (ec) {
         CLASS_ETRACE(ec.message());
+        connected_ = false;
         return on_error_(__func__, ec);
     }
+
+    // Decided before on_response_, which may issue the next request.
+    connected_ = keep_alive_ && response_.keep_alive();
     on_response_(response_);
+    if (connected_) {
+        return;
+    }
 
     socket_.shutdown(net::unix::socket::shutdown_both, ec);
     on_close_();
@@ -42,6 +42,8 @@ protected:
 
     std::string host_;
     int version_;
+    bool keep_alive_ { false };
+    bool connected_ { false };
 
     handler<client &> on_connect_;
     handler<const http::response &> on_response_;
@@ -86,6 +88,28 @@ public:
      **/
     int version() const;
 
+    /** Ask to keep the connection open for further requests
+     *
+     * The connection is only reused when the server agrees to keep it
+     * alive; otherwise it is shut down after the response as usual.
+     *
+     * @param enabled Whether to request a persistent connection
+     * @returns Reference to this
+     **/
+    client &keep_alive(bool enabled);
+
+    /** Returns whether a persistent connection is requested
+     *
+     * @returns Whether keep-alive is enabled
+     **/
+    bool keep_alive() const;
+
+    /** Returns whether the next request reuses an open connection
+     *
+     * @returns True if connected and the server kept the connection alive
+     **/
+    bool connected() const;
+
     /** Begin an OPTIONS request toward `target`
      *
      * @param target Target request URI
@@ -132,6 +156,7 @@ public:
 private:
     void init_request(const char *target);
     void async_connect();
+    void async_write_request();
 
     void client_on_connect(boost::beast::error_code ec);
     void client_on_write(boost::beast::error_code ec, std::size_t bytes);
@@ -14,6 +14,10 @@
  * permissions and limitations under the License.
  */
 #include <http/connection.hpp>
+#include <http/util.hpp>
+#include <util/json.hpp>
+
+#include <utility>
 
 using namespace webvirt;
 using namespace http;
@@ -28,6 +32,18 @@ connection::connection(http::io_context &io, net::unix::socket socket,
 {
 }
 
+connection::~connection()
+{
+    if (queue_) {
+        queue_->cancel();
+    }
+}
+
+std::chrono::steady_clock::time_point connection::deadline() const
+{
+    return deadline_.expiry();
+}
+
 void connection::start()
 {
     read_request();
@@ -60,6 +76,44 @@ std::shared_ptr<websocket::connection> connection::upgrade()
     return websock();
 }
 
+void connection::stream(chunk_producer producer)
+{
+    producer_ = std::move(producer);
+}
+
+void connection::stream(std::shared_ptr<chunk_queue> queue,
+                        std::function<void()> fill)
+{
+    queue_ = std::move(queue);
+    fill_ = std::move(fill);
+}
+
+std::function<void()> connection::defer()
+{
+    deferred_ = true;
+    return [self = shared_from_this()]() mutable {
+        if (self->request_.version() < http::version::http_1_1) {
+            self->fill_stream();
+        }
+
+        auto fill = std::move(self->fill_);
+        self->strand_.post([self] {
+            // Past the deadline, a 504 was written in its place.
+            if (self->deferred_) {
+                self->deferred_ = false;
+                self->write_response();
+            }
+        });
+
+        // Produce the body while the strand writes it. Only the strand
+        // keeps the connection now, so that it is cancelled if closed.
+        self.reset();
+        if (fill) {
+            fill();
+        }
+    };
+}
+
 void connection::read_request()
 {
     beast::http::async_read(
@@ -91,13 +145,60 @@ void connection::process_request()
     response_.set(beast::http::field::server, BOOST_BEAST_VERSION_STRING);
 
     on_request_(shared_from_this(), request_, response_);
-    response_.content_length(response_.body().size());
+    if (!deferred_) {
+        fill_stream();
+        write_response();
+    }
+}
+
+void connection::write_response()
+{
+    responded_ = true;
+
+    // Handlers may replace the response wholesale; announce that the
+    // connection is closed after writing it, whatever they set.
+    response_.version(request_.version());
+    response_.keep_alive(false);
+
+    if (producer_ && request_.version() < http::version::http_1_1) {
+        // Chunked transfer coding requires HTTP/1.1; buffer the body.
+        while (producer_(chunk_)) {
+            response_.body().append(chunk_);
+            chunk_.clear();
+        }
+        producer_ = nullptr;
+    }
+
+    if (queue_ && request_.version() < http::version::http_1_1) {
+        // Filled in full by fill_stream(); collect it into the body.
+        try {
+            while (queue_->pop(chunk_, nullptr) ==
+                   chunk_queue::status::ready) {
+                response_.body().append(chunk_);
+            }
+        } catch (const std::exception &exc) {
+            logger::error(fmt::format("Streamed response aborted: {}",
+                                      exc.what()));
+            http::set_response(response_,
+                               json::error("Internal Server Error"),
+                               beast::http::status::internal_server_error);
+        }
+        queue_ = nullptr;
+    }
+
+    if (!producer_ && !queue_) {
+        response_.content_length(response_.body().size());
+    }
 
     CLASS_TRACE("Processed request");
-    if (beast::websocket::is_upgrade(request_)) {
+    // An upgrade whose handler failed before upgrade() is answered
+    // with the handler's error response.
+    if (beast::websocket::is_upgrade(request_) && websock_) {
         CLASS_TRACE("Running websocket");
         deadline_.cancel();
         websock_->run();
+    } else if (producer_ || queue_) {
+        write_stream();
     } else {
         beast::http::async_write(
             socket_,
@@ -113,6 +214,57 @@ void connection::check_deadline()
         std::bind(&connection::async_deadline, shared_from_this(), _1)));
 }
 
+void connection::write_stream()
+{
+    CLASS_TRACE("Streaming response");
+    response_.body().clear();
+    response_.chunked(true);
+    serializer_ = std::make_unique<
+        beast::http::response_serializer<beast::http::string_body>>(
+        response_);
+
+    beast::http::async_write_header(
+        socket_,
+        *serializer_,
+        strand_.wrap(std::bind(
+            &connection::async_write_chunk, shared_from_this(), _1, _2)));
+}
+
+void connection::fill_stream()
+{
+    // Nothing is written until the body is complete, so nothing would
+    // make room in a bounded queue.
+    if (fill_) {
+        queue_->unbound();
+        std::exchange(fill_, nullptr)();
+    }
+}
+
+bool connection::next_chunk()
+{
+    if (!queue_) {
+        // Skip over empty chunks; an empty HTTP chunk terminates the
+        // body.
+        bool more = false;
+        while ((more = producer_(chunk_)) && chunk_.empty()) {
+        }
+        return more;
+    }
+
+    // Pending leaves chunk_ empty; the waiter writes the next chunk.
+    auto waiter = [self = shared_from_this()] {
+        self->strand_.post([self] {
+            self->async_write_chunk({}, 0);
+        });
+    };
+    auto status = chunk_queue::status::ready;
+    while ((status = queue_->pop(chunk_, waiter)) ==
+               chunk_queue::status::ready &&
+           chunk_.empty()) {
+    }
+    return status != chunk_queue::status::done;
+}
+
 void connection::async_read(beast::error_code ec, std::size_t bytes)
 {
     boost::ignore_unused(bytes);
@@ -140,6 +292,48 @@ void connection::async_write(beast::error_code ec, std::size_t)
     on_close_();
 }
 
+void connection::async_write_chunk(beast::error_code ec, std::size_t)
+{
+    if (ec) {
+        CLASS_ETRACE(ec.message());
+        const std::string func = __func__;
+        return on_error_(func.c_str(), ec);
+    }
+
+    bool more = false;
+    chunk_.clear();
+    try {
+        more = next_chunk();
+    } catch (const std::exception &exc) {
+        // The status line has already been sent, so the best we can do
+        // is to cut the response short.
+        logger::error(fmt::format("Streamed response aborted: {}",
+                                  exc.what()));
+        socket_.close(ec);
+        return on_close_();
+    }
+
+    if (more && chunk_.empty()) {
+        // Called back once the queue has the next chunk.
+        return;
+    }
+
+    if (!more) {
+        producer_ = nullptr;
+        return boost::asio::async_write(
+            socket_,
+            beast::http::make_chunk_last(),
+            strand_.wrap(std::bind(
+                &connection::async_write, shared_from_this(), _1, _2)));
+    }
+
+    boost::asio::async_write(
+        socket_,
+        beast::http::make_chunk(boost::asio::buffer(chunk_)),
+        strand_.wrap(std::bind(
+            &connection::async_write_chunk, shared_from_this(), _1, _2)));
+}
+
 void connection::async_deadline(beast::error_code ec)
 {
     if (ec == boost::asio::error::operation_aborted) {
@@ -147,6 +341,31 @@ void connection::async_deadline(beast::error_code ec)
         return;
     }
 
+    if (responded_) {
+        // The response is being written; let it complete.
+        return;
+    }
+
+    if (deferred_) {
+        // The handler is still working on a response; answer in its
+        // place, rather than leave the client with a closed socket.
+        CLASS_TRACE("Deadline exceeded; writing 504");
+        deferred_ = false;
+        responded_ = true;
+        timeout_.version(request_.version());
+        timeout_.keep_alive(false);
+        timeout_.set(beast::http::field::server, BOOST_BEAST_VERSION_STRING);
+        timeout_.set(beast::http::field::content_type, "application/json");
+        http::set_response(timeout_,
+                           json::error("Gateway Timeout"),
+                           beast::http::status::gateway_timeout);
+        return beast::http::async_write(
+            socket_,
+            timeout_,
+            strand_.wrap(std::bind(
+                &connection::async_write, shared_from_this(), _1, _2)));
+    }
+
     socket_.close(ec);
     on_close_();
 }
@@ -18,6 +18,7 @@
 
 #include <boost/beast/core/bind_handler.hpp>
 #include <boost/core/ignore_unused.hpp>
+#include <http/chunk_queue.hpp>
 #include <http/handlers.hpp>
 #include <http/io_context.hpp>
 #include <http/types.hpp>
@@ -27,9 +28,11 @@
 #include <boost/asio.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <regex>
+#include <string>
 
 namespace webvirt::http
 {
@@ -37,6 +40,15 @@ namespace webvirt::http
 /** HTTP server-side connection */
 class connection : public std::enable_shared_from_this<connection>
 {
+public:
+    /** Produces chunks of a streamed response body
+     *
+     * A chunk_producer appends the next chunk to its argument and
+     * returns true, or returns false once the body is exhausted.
+     **/
+    using chunk_producer = std::function<bool(std::string &)>;
+
+private:
     http::io_context::strand strand_;
 
     net::unix::socket socket_;
@@ -46,6 +58,17 @@ class connection : public std::enable_shared_from_this<connection>
 
     beast::http::request<beast::http::dynamic_body> request_;
     beast::http::response<beast::http::string_body> response_;
+    // Written in place of a deferred response past the deadline
+    beast::http::response<beast::http::string_body> timeout_;
+
+    // Streamed response state; see stream().
+    chunk_producer producer_;
+    std::shared_ptr<chunk_queue> queue_;
+    std::function<void()> fill_;
+    std::string chunk_;
+    std::unique_ptr<
+        beast::http::response_serializer<beast::http::string_body>>
+        serializer_;
 
     boost::asio::steady_timer deadline_;
 
@@ -60,6 +83,8 @@ class connection : public std::enable_shared_from_this<connection>
     handler<> on_close_;
 
     bool upgrade_ { false };
+    bool deferred_ { false };
+    bool responded_ { false };
 
 public:
     /** HTTP route function signature */
@@ -78,6 +103,19 @@ public:
     explicit connection(http::io_context &io, net::unix::socket socket,
                         std::chrono::milliseconds ms);
 
+    /** Stop the producer of a streamed response, if any */
+    ~connection();
+
+    /** Return the deadline of this connection's request
+     *
+     * Past the deadline, a request still waiting for its response is
+     * answered with 504 Gateway Timeout, or closed if it was never read
+     * in full. Handlers should not start blocking work past it.
+     *
+     * @returns Deadline of the request
+     **/
+    std::chrono::steady_clock::time_point deadline() const;
+
     /** Start the connection */
     void start();
 
@@ -99,6 +137,56 @@ public:
      **/
     std::shared_ptr<websocket::connection> upgrade();
 
+    /** Stream the response body of the current request
+     *
+     * Once the request handler returns, the response header is written
+     * with chunked transfer coding, followed by one HTTP chunk for every
+     * chunk `producer` appends. The producer is invoked on this
+     * connection's strand, one chunk at a time, as previous chunks are
+     * written; anything it captures must outlive the request handler.
+     *
+     * HTTP/1.0 has no chunked transfer coding, so for HTTP/1.0 requests
+     * the produced chunks are collected into the response body instead.
+     *
+     * @param producer Producer of response body chunks
+     **/
+    void stream(chunk_producer producer);
+
+    /** Stream the response body of the current request from a queue
+     *
+     * As stream(chunk_producer), but chunks are produced off the strand:
+     * `fill` pushes them to `queue` and closes it. When the response is
+     * deferred, `fill` is run by the function returned from defer(),
+     * after the response header has been handed to the strand, so that
+     * chunks are written while later ones are still being produced.
+     * Otherwise, or for HTTP/1.0 requests, `fill` runs before anything
+     * is written and the queue is unbounded.
+     *
+     * If the connection goes away first, the queue is cancelled and
+     * `fill` should return once push() fails.
+     *
+     * @param queue Queue of response body chunks
+     * @param fill Function producing the body into `queue`
+     **/
+    void stream(std::shared_ptr<chunk_queue> queue,
+                std::function<void()> fill);
+
+    /** Defer the response to the current request
+     *
+     * Lets a request handler complete the response on another thread.
+     * Once the handler returns, nothing is written until the returned
+     * function is called; it may be called from any thread, once the
+     * response is complete. The function keeps this connection, and
+     * so the request and response, alive until it is called. A body
+     * streamed from a queue is produced within the call.
+     *
+     * If the deadline passes first, 504 Gateway Timeout is written
+     * instead and the completed response is discarded.
+     *
+     * @returns Function writing the completed response
+     **/
+    std::function<void()> defer();
+
     handler_setter(on_accept, on_accept_);
     handler_setter(on_request, on_request_);
     handler_setter(on_websock_accept, on_websock_accept_);
@@ -110,10 +198,15 @@ public:
 private:
     void read_request();
     void process_request();
+    void write_response();
     void check_deadline();
+    void write_stream();
+    void fill_stream();
+    bool next_chunk();
 
     void async_read(beast::error_code, std::size_t);
     void async_write(beast::error_code, std::size_t);
+    void async_write_chunk(beast::error_code, std::size_t);
     void async_deadline(beast::error_code);
 };
 
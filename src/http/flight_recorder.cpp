@@ -0,0 +1,122 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <http/flight_recorder.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+using namespace webvirt;
+using namespace webvirt::http;
+
+flight_recorder::flight_recorder(std::size_t capacity)
+{
+    resize(capacity);
+}
+
+void flight_recorder::resize(std::size_t capacity)
+{
+    capacity_ = capacity;
+    slots_ = capacity ? std::make_unique<slot[]>(capacity) : nullptr;
+    next_ = 0;
+}
+
+std::size_t flight_recorder::capacity() const
+{
+    return capacity_;
+}
+
+void flight_recorder::add(record rec)
+{
+    if (!capacity_) {
+        return;
+    }
+
+    auto sequence = next_++;
+    auto &s = slots_[sequence % capacity_];
+    std::lock_guard<std::mutex> guard(s.mutex);
+
+    // A request which took a long time to store itself may find its slot
+    // already reused by a more recent one.
+    if (s.sequence > sequence) {
+        return;
+    }
+    s.sequence = sequence + 1;
+    s.rec = std::move(rec);
+}
+
+std::vector<flight_recorder::record> flight_recorder::records() const
+{
+    std::vector<std::pair<std::uint64_t, record>> stored;
+    stored.reserve(capacity_);
+    for (std::size_t i = 0; i < capacity_; ++i) {
+        auto &s = slots_[i];
+        std::lock_guard<std::mutex> guard(s.mutex);
+        if (s.sequence) {
+            stored.emplace_back(s.sequence, s.rec);
+        }
+    }
+
+    std::sort(stored.begin(), stored.end(), [](auto &a, auto &b) {
+        return a.first > b.first;
+    });
+
+    std::vector<record> output;
+    output.reserve(stored.size());
+    for (auto &pair : stored) {
+        output.emplace_back(std::move(pair.second));
+    }
+    return output;
+}
+
+Json::Value flight_recorder::serialize() const
+{
+    Json::Value data(Json::arrayValue);
+    for (const auto &rec : records()) {
+        std::chrono::duration<double> since_epoch =
+            rec.time.time_since_epoch();
+        std::ostringstream thread;
+        thread << rec.thread;
+
+        Json::Value item(Json::objectValue);
+        item["time"] = since_epoch.count();
+        item["method"] = rec.method;
+        item["target"] = rec.target;
+        item["route"] = rec.route;
+        item["user"] = rec.user;
+        item["status"] = rec.status;
+        item["duration_ms"] = rec.seconds * 1000;
+        item["thread"] = thread.str();
+
+        Json::UInt64 libvirt_calls = 0;
+        Json::Value spans(Json::arrayValue);
+        for (const auto &entry : rec.spans) {
+            Json::Value span(Json::objectValue);
+            span["name"] = entry.name;
+            span["duration_ms"] = entry.seconds * 1000;
+            span["count"] = Json::UInt64(entry.count);
+            spans.append(std::move(span));
+
+            if (entry.name.rfind("libvirt.", 0) == 0) {
+                libvirt_calls += entry.count;
+            }
+        }
+        item["libvirt_calls"] = libvirt_calls;
+        item["spans"] = std::move(spans);
+
+        data.append(std::move(item));
+    }
+    return data;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef HTTP_FLIGHT_RECORDER_HPP
+#define HTTP_FLIGHT_RECORDER_HPP
+
+#include <util/trace.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <json/json.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace webvirt::http
+{
+
+/** A fixed-size ring of the most recently handled requests
+ *
+ * Requests claim a slot with a single atomic increment and only lock
+ * that slot, so concurrent requests rarely contend.
+ **/
+class flight_recorder
+{
+public:
+    /** A handled request */
+    struct record {
+        std::chrono::system_clock::time_point time;
+        std::string method;
+        std::string target;
+        std::string route;
+        std::string user;
+        int status { 0 };
+        double seconds { 0 };
+        std::thread::id thread;
+        std::vector<trace::context::entry> spans;
+    };
+
+private:
+    struct slot {
+        std::mutex mutex;
+        // Sequence number of the stored record plus one; 0 when empty
+        std::uint64_t sequence { 0 };
+        record rec;
+    };
+
+    std::size_t capacity_ { 0 };
+    std::unique_ptr<slot[]> slots_;
+    std::atomic<std::uint64_t> next_ { 0 };
+
+public:
+    /** Construct a flight_recorder
+     *
+     * @param capacity Number of requests kept; 0 disables recording
+     **/
+    explicit flight_recorder(std::size_t capacity = 256);
+
+    /** Change the number of requests kept, discarding all records
+     *
+     * Not thread-safe; call before requests are recorded.
+     *
+     * @param capacity Number of requests kept; 0 disables recording
+     **/
+    void resize(std::size_t capacity);
+
+    std::size_t capacity() const;
+
+    /** Record a request, replacing the oldest record when full
+     *
+     * @param rec Request record
+     **/
+    void add(record rec);
+
+    /** Return recorded requests
+     *
+     * @returns Recorded requests, most recent first
+     **/
+    std::vector<record> records() const;
+
+    /** Serialize recorded requests
+     *
+     * @returns JSON array of recorded requests, most recent first
+     **/
+    Json::Value serialize() const;
+};
+
+}; // namespace webvirt::http
+
+#endif /* HTTP_FLIGHT_RECORDER_HPP */
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <http/flight_recorder.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace webvirt;
+
+static http::flight_recorder::record make_record(const std::string &target)
+{
+    http::flight_recorder::record rec;
+    rec.time = std::chrono::system_clock::now();
+    rec.method = "GET";
+    rec.target = target;
+    rec.status = 200;
+    rec.thread = std::this_thread::get_id();
+    return rec;
+}
+
+TEST(flight_recorder, wraps)
+{
+    http::flight_recorder recorder(3);
+    EXPECT_TRUE(recorder.records().empty());
+
+    for (int i = 0; i < 5; ++i) {
+        recorder.add(make_record("/" + std::to_string(i) + "/"));
+    }
+
+    // Only the most recent records are kept, most recent first.
+    auto records = recorder.records();
+    ASSERT_EQ(records.size(), 3);
+    EXPECT_EQ(records[0].target, "/4/");
+    EXPECT_EQ(records[1].target, "/3/");
+    EXPECT_EQ(records[2].target, "/2/");
+}
+
+TEST(flight_recorder, disabled)
+{
+    http::flight_recorder recorder(0);
+    recorder.add(make_record("/"));
+    EXPECT_TRUE(recorder.records().empty());
+
+    recorder.resize(1);
+    recorder.add(make_record("/"));
+    EXPECT_EQ(recorder.records().size(), 1);
+}
+
+TEST(flight_recorder, serialize)
+{
+    http::flight_recorder recorder;
+
+    auto rec = make_record("/users/test/domains/");
+    rec.route = "/users/*/domains/";
+    rec.user = "test";
+    rec.seconds = 0.002;
+    rec.spans = { { "libvirt.virConnectListAllDomains", 0.0005, 1 },
+                  { "libvirt.virDomainGetXMLDesc", 0.001, 2 },
+                  { "serialize", 0.0001, 1 } };
+    recorder.add(std::move(rec));
+
+    auto data = recorder.serialize();
+    ASSERT_EQ(data.size(), 1);
+    auto &item = data[0];
+    EXPECT_EQ(item["method"], "GET");
+    EXPECT_EQ(item["target"], "/users/test/domains/");
+    EXPECT_EQ(item["route"], "/users/*/domains/");
+    EXPECT_EQ(item["user"], "test");
+    EXPECT_EQ(item["status"], 200);
+    EXPECT_DOUBLE_EQ(item["duration_ms"].asDouble(), 2.0);
+    EXPECT_EQ(item["libvirt_calls"].asUInt64(), 3);
+    EXPECT_EQ(item["spans"].size(), 3);
+    EXPECT_EQ(item["spans"][1]["name"], "libvirt.virDomainGetXMLDesc");
+    EXPECT_EQ(item["spans"][1]["count"].asUInt64(), 2);
+    EXPECT_FALSE(item["thread"].asString().empty());
+}
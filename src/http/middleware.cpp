@@ -17,6 +17,8 @@
 #include <http/util.hpp>
 #include <syscall.hpp>
 #include <util/json.hpp>
+#include <util/trace.hpp>
+#include <virt/instrumented.hpp>
 #include <virt/util.hpp>
 
 #include <chrono>
@@ -79,11 +81,13 @@ http_route_function middleware::with_libvirt_domain(
                    const std::smatch &match,
                    const http::request &request,
                    http::response &response) {
-            const std::string name(match[2]);
+            // Domains are addressed by name or UUID.
+            const std::string key(match[2]);
 
             virt::domain domain;
             try {
-                domain = conn.domain(name);
+                trace::span span("lookup");
+                domain = conn.lookup(key);
             } catch (const std::domain_error &) {
                 auto error = json::error("Domain not found");
                 return http::set_response(response,
@@ -108,9 +112,11 @@ http_route_function middleware::with_libvirt(
                                        const http::request &request,
                                        http::response &response) {
         const std::string user(match[1]);
+        virt::instrumented_libvirt::scope scope(user);
 
         virt::connection *conn = nullptr;
         try {
+            trace::span span("connect");
             conn = &pool.get(user);
         } catch (const std::runtime_error &e) {
             auto error = json::error("Unable to connect to libvirt");
@@ -144,3 +150,164 @@ http_route_function middleware::with_user(http_route_function route_fn)
         return route_fn(std::move(conn), match, request, response);
     };
 }
+
+/** Whether request's response can be served to other, identical requests
+ *
+ * @param request HTTP request
+ * @returns True if the request is a GET whose response is not streamed
+ **/
+static bool shareable(const http::request &request)
+{
+    return request.method() == beast::http::verb::get &&
+           parse_stream_format(request) == stream_format::none;
+}
+
+/** Key identifying requests with identical responses
+ *
+ * @param request HTTP request
+ * @returns Request target and Accept header
+ **/
+static std::string request_key(const http::request &request)
+{
+    std::string key(request.target());
+    key.push_back('\n');
+    key.append(std::string(request[beast::http::field::accept]));
+    return key;
+}
+
+http_route_function middleware::with_cache(http::cache &cache,
+                                           http_route_function route_fn)
+{
+    return [&cache, route_fn](http::connection_ptr conn,
+                              const std::smatch &match,
+                              const http::request &request,
+                              http::response &response) {
+        if (!shareable(request)) {
+            return route_fn(std::move(conn), match, request, response);
+        }
+
+        const std::string user(match[1]);
+        const auto key = request_key(request);
+        if (auto cached = cache.get(user, key)) {
+            response = std::move(*cached);
+            response.set("X-Cache", "HIT");
+            return;
+        }
+
+        const auto version = cache.version(user);
+        route_fn(std::move(conn), match, request, response);
+        response.set("X-Cache", "MISS");
+        if (response.result() == beast::http::status::ok) {
+            cache.put(user, key, response, version);
+        }
+    };
+}
+
+http_route_function
+middleware::with_single_flight(http::single_flight &flights,
+                               http_route_function route_fn)
+{
+    return [&flights, route_fn](http::connection_ptr conn,
+                                const std::smatch &match,
+                                const http::request &request,
+                                http::response &response) {
+        if (!shareable(request)) {
+            return route_fn(std::move(conn), match, request, response);
+        }
+
+        // Conditional requests may be answered with 304 Not Modified,
+        // which is only shared with requests carrying the same condition.
+        auto key = request_key(request);
+        key.push_back('\n');
+        key.append(std::string(request[beast::http::field::if_none_match]));
+
+        flights.run(
+            key,
+            [&](http::response &output) {
+                route_fn(conn, match, request, output);
+            },
+            response);
+    };
+}
+
+http_route_function
+middleware::with_etag(virt::generations &generations,
+                      std::function<bool(const std::string &)> track,
+                      std::function<bool(const http::request &)> tagged,
+                      http_route_function route_fn)
+{
+    return [&generations, track, tagged, route_fn](
+               http::connection_ptr conn,
+               const std::smatch &match,
+               const http::request &request,
+               http::response &response) {
+        if (!shareable(request) || !tagged(request)) {
+            return route_fn(std::move(conn), match, request, response);
+        }
+
+        // The tag is taken before the route produces its response, so a
+        // concurrent change can only leave the tag older than the body.
+        const std::string user(match[1]);
+        std::string etag;
+        if (track(user)) {
+            etag = match.size() > 2 ? generations.etag(user, match[2])
+                                    : generations.etag(user);
+        }
+
+        route_fn(std::move(conn), match, request, response);
+        if (etag.empty() || response.result() != beast::http::status::ok) {
+            return;
+        }
+
+        response.set(beast::http::field::etag, etag);
+        response.set(beast::http::field::vary, "Accept");
+        if (http::if_none_match(request, etag)) {
+            response.result(beast::http::status::not_modified);
+            response.body().clear();
+        }
+    };
+}
+
+http_route_function
+middleware::with_bump(virt::connection_pool &pool,
+                      std::function<void(const std::string &,
+                                         const std::string &,
+                                         const std::string &)>
+                          changed,
+                      http_route_function route_fn)
+{
+    return [&pool, changed, route_fn](http::connection_ptr conn,
+                                      const std::smatch &match,
+                                      const http::request &request,
+                                      http::response &response) {
+        route_fn(std::move(conn), match, request, response);
+        if (response.result_int() >= 400) {
+            return;
+        }
+
+        // Bump both the name and UUID the domain may be addressed by.
+        const std::string user(match[1]), key(match[2]);
+        auto *virt_conn = pool.find(user);
+        auto handle =
+            virt_conn ? virt_conn->handles().find(key) : std::nullopt;
+        if (handle) {
+            changed(user, handle->name, handle->uuid);
+        } else {
+            changed(user, key, std::string());
+        }
+    };
+}
+
+http_route_function middleware::with_invalidation(http::cache &cache,
+                                                  http_route_function route_fn)
+{
+    return [&cache, route_fn](http::connection_ptr conn,
+                              const std::smatch &match,
+                              const http::request &request,
+                              http::response &response) {
+        route_fn(std::move(conn), match, request, response);
+        if (response.result_int() < 400) {
+            cache.invalidate(match[1]);
+        }
+    };
+}
@@ -16,15 +16,20 @@
 #ifndef HTTP_MIDDLEWARE_HPP
 #define HTTP_MIDDLEWARE_HPP
 
+#include <http/cache.hpp>
 #include <http/connection.hpp>
 #include <http/handlers.hpp>
+#include <http/single_flight.hpp>
 #include <http/types.hpp>
 #include <virt/connection.hpp>
 #include <virt/connection_pool.hpp>
 #include <virt/domain.hpp>
+#include <virt/generations.hpp>
 #include <ws/connection.hpp>
 
+#include <functional>
 #include <regex>
+#include <string>
 
 namespace webvirt::http
 {
@@ -51,6 +56,88 @@ with_libvirt(virt::connection_pool &,
 
 http_route_function with_user(http_route_function);
 
+/** Serve GET responses out of an http::cache
+ *
+ * Responses are cached per user, request target and Accept header. On a
+ * hit, the cached response is returned without calling `route_fn`, and
+ * so without looking up a libvirt connection. Only complete 200 OK
+ * responses are cached; streamed listings bypass the cache.
+ *
+ * Responses carry an X-Cache header of HIT or MISS.
+ *
+ * @param cache Response cache
+ * @param route_fn Route function producing responses on a miss
+ * @returns Route function
+ **/
+http_route_function with_cache(http::cache &, http_route_function);
+
+/** Coalesce identical concurrent GET requests
+ *
+ * GET requests for the same target, Accept and If-None-Match headers
+ * which arrive while one of them is being served share that request's
+ * response instead of running `route_fn` themselves. Since the target
+ * carries the user and query, only requests which would produce the
+ * same response are coalesced. Streamed listings are never coalesced.
+ *
+ * @param flights Requests in flight
+ * @param route_fn Route function producing a flight's response
+ * @returns Route function
+ **/
+http_route_function with_single_flight(http::single_flight &,
+                                       http_route_function);
+
+/** Tag GET responses with entity tags of domain generations
+ *
+ * The tag of the user's domain set, or of the domain matched by the
+ * second group of the route, is taken before `route_fn` runs; a
+ * concurrent change can only leave it older than the body. It is only
+ * attached to 200 OK responses produced by `route_fn`, which are turned
+ * into 304 Not Modified when the request's If-None-Match matches it, so
+ * a missing domain is answered with 404 Not Found whatever its tag.
+ *
+ * Streamed listings and representations `tagged` rejects, which change
+ * without bumping a generation, are never tagged.
+ *
+ * @param generations Domain generations
+ * @param track Function making sure a user's generations are tracked
+ * @param tagged Function testing whether a request's representation
+ *               only changes along with generations
+ * @param route_fn Route function producing responses
+ * @returns Route function
+ **/
+http_route_function
+with_etag(virt::generations &generations,
+          std::function<bool(const std::string &)> track,
+          std::function<bool(const http::request &)> tagged,
+          http_route_function route_fn);
+
+/** Record a change to the domain matched by a mutating route
+ *
+ * Once `route_fn` succeeds, `changed` is called with the user and the
+ * name and UUID of the domain, resolved through the connection's kept
+ * handles; or with the route's key alone when no handle is kept.
+ *
+ * @param pool libvirt connection pool
+ * @param changed Function recording a change: user, name and UUID
+ * @param route_fn Route function changing a domain
+ * @returns Route function
+ **/
+http_route_function
+with_bump(virt::connection_pool &pool,
+          std::function<void(const std::string &, const std::string &,
+                             const std::string &)>
+              changed,
+          http_route_function route_fn);
+
+/** Invalidate a user's cached responses once `route_fn` succeeds
+ *
+ * @param cache Response cache
+ * @param route_fn Route function changing the user's resources
+ * @returns Route function
+ **/
+http_route_function with_invalidation(http::cache &cache,
+                                      http_route_function route_fn);
+
 }; // namespace middleware
 
 }; // namespace webvirt::http
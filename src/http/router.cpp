@@ -16,34 +16,128 @@
 #include <http/middleware.hpp>
 #include <http/router.hpp>
 #include <http/util.hpp>
+#include <state.hpp>
 #include <syscall.hpp>
 #include <util/bench.hpp>
+#include <util/deadline.hpp>
 #include <util/json.hpp>
 #include <util/logging.hpp>
+#include <util/metrics.hpp>
 #include <util/retry.hpp>
+#include <util/trace.hpp>
 #include <virt/util.hpp>
 
 #include <chrono>
 #include <fmt/format.h>
 #include <iostream>
+#include <memory>
 #include <regex>
+#include <thread>
 #include <vector>
 
 using namespace webvirt;
 
+// Turn a route expression into a metric label, e.g.
+// ^/users/([^/]+)/domains/$ into /users/*/domains/
+static std::string route_label(std::string expr)
+{
+    static const std::regex group(R"(\([^)]*\))");
+    expr = std::regex_replace(expr, group, "*");
+    if (!expr.empty() && expr.front() == '^') {
+        expr.erase(0, 1);
+    }
+    if (!expr.empty() && expr.back() == '$') {
+        expr.pop_back();
+    }
+    return expr;
+}
+
+http::route_metrics::route_metrics(std::string label,
+                                   metrics::registry &registry)
+    : registry_(registry)
+    , label_(std::move(label))
+{
+}
+
+http::route_metrics::~route_metrics()
+{
+    for (auto &slot : tables_) {
+        delete slot.load();
+    }
+}
+
+const std::string &http::route_metrics::label() const
+{
+    return label_;
+}
+
+metrics::histogram &http::route_metrics::duration(const http::request &request,
+                                                  int status)
+{
+    // Methods beast doesn't know have no slot, as they all share
+    // verb::unknown; neither do nonstandard statuses.
+    const auto method = static_cast<std::size_t>(request.method());
+    if (request.method() == beast::http::verb::unknown || status < 100 ||
+        status - 100 >= static_cast<int>(num_statuses)) {
+        return resolve(request, status);
+    }
+
+    auto *statuses = tables_[method].load(std::memory_order_acquire);
+    if (!statuses) {
+        auto fresh = std::make_unique<table>();
+        if (tables_[method].compare_exchange_strong(
+                statuses, fresh.get(), std::memory_order_acq_rel)) {
+            statuses = fresh.release();
+        }
+    }
+
+    // Racing threads resolve the same histogram, so either store wins.
+    auto &slot = (*statuses)[status - 100];
+    auto *histogram = slot.load(std::memory_order_acquire);
+    if (!histogram) {
+        histogram = &resolve(request, status);
+        slot.store(histogram, std::memory_order_release);
+    }
+    return *histogram;
+}
+
+metrics::histogram &http::route_metrics::resolve(const http::request &request,
+                                                 int status)
+{
+    return registry_.histogram(
+        "webvirtd_http_request_duration_seconds",
+        "Time taken to produce HTTP responses",
+        { { "method", std::string(request.method_string()) },
+          { "route", label_ },
+          { "status", std::to_string(status) } });
+}
+
+http::router::router()
+    : unmatched_(std::make_unique<route_metrics>("none"))
+    , in_flight_(&metrics::registry::ref().gauge(
+          "webvirtd_http_requests_in_flight", "HTTP requests being processed"))
+{
+}
+
 void http::router::run(http::connection_ptr http_conn,
                        const http::request &request, http::response &response)
 {
     const auto request_uri = std::string(request.target());
+    // Shared with queued routes, as their matches point into it.
+    const auto request_path =
+        std::make_shared<const std::string>(http::target_path(request_uri));
     const auto method = std::string(request.method_string());
 
     response.set(beast::http::field::content_type, "application/json");
     response.result(beast::http::status::ok);
 
-    std::function<void(const std::string &)> log([](const auto &message) {
-        logger::info(message);
-    });
+    auto &in_flight = *in_flight_;
+    in_flight.inc();
 
+    auto *durations = unmatched_.get();
+    std::string label = durations->label();
+    std::string user;
+    thread::fair_executor *executor = nullptr;
     std::function<void()> next = [&request, &response] {
         Json::Value data(Json::objectValue);
         data["detail"] = "Not Found";
@@ -57,54 +151,151 @@ void http::router::run(http::connection_ptr http_conn,
     for (auto &route : routes_) {
         const std::regex &re = regex_.at(route.first);
         std::smatch match;
-        if (std::regex_match(request_uri, match, re)) {
-            next = [&, match] {
+        if (std::regex_match(*request_path, match, re)) {
+            durations = metrics_.at(route.first).get();
+            label = durations->label();
+            if (label.rfind("/users/*", 0) == 0) {
+                user = match[1];
+            }
+            executor = executors_.at(route.first);
+            // request_path outlives match, which points into it.
+            next = [&request, &response, &route, http_conn, request_path,
+                    match] {
                 try {
-                    // Try route.second five times.
-                    retry([&, match] {
+                    // Try route.second five times, within the deadline.
+                    retry([&] {
+                        deadline::check();
                         response = http::response();
-                        route.second(
-                            std::move(http_conn), match, request, response);
+                        route.second(http_conn, match, request, response);
                     }).retries(5)();
+                } catch (const deadline::exceeded &) {
+                    response = http::response();
+                    http::set_response(response,
+                                       json::error("Gateway Timeout"),
+                                       beast::http::status::gateway_timeout);
                 } catch (const std::exception &exc) {
                     // If it fails the sixth time, catch its std::domain_error.
                     http::set_response(
                         response,
                         json::error(exc.what()),
                         beast::http::status::internal_server_error);
+                } catch (...) {
+                    response = http::response();
+                    http::set_response(
+                        response,
+                        json::error("Internal Server Error"),
+                        beast::http::status::internal_server_error);
                 }
             };
             break;
         }
     }
 
+    // Runs `next` and accounts for the request. Queued routes run it on
+    // the route's executor after run() returns, so it holds copies of
+    // what it needs; request and response belong to http_conn.
+    const auto started = std::chrono::system_clock::now();
     bench<double> bench_;
-    next();
-    bench_.end();
-
-    int status_code = response.result_int();
-    if (status_code >= 400) {
-        log = [](const auto &message) {
-            logger::error(message);
-        };
+    const auto request_deadline =
+        http_conn ? http_conn->deadline() : deadline::clock::time_point::max();
+    auto process = [&request, &response, &in_flight, durations, method,
+                    request_uri, label, user, started, request_deadline,
+                    bench_](const std::function<void()> &next) mutable {
+        trace::context trace_context;
+        {
+            trace::scope scope(&trace_context);
+            deadline::scope deadline_scope(request_deadline);
+            next();
+        }
+        bench_.end();
+        in_flight.dec();
+
+        trace_context.add("total", bench_.elapsed());
+        const auto timing = trace_context.server_timing();
+        response.set("Server-Timing", timing);
+
+        std::function<void(const std::string &)> log(
+            [](const auto &message) {
+                logger::info(message);
+            });
+
+        int status_code = response.result_int();
+        durations->duration(request, status_code).observe(bench_.elapsed());
+        if (status_code >= 400) {
+            log = [](const auto &message) {
+                logger::error(message);
+            };
+        }
+
+        double elapsed = bench_.elapsed() * 1000;
+        auto major = response.version() / 10;
+        auto minor = response.version() % 10;
+        log(fmt::format("\"{} {} HTTP/{}.{}\" {} {} (took {:.1f}ms)",
+                        method,
+                        request_uri,
+                        major,
+                        minor,
+                        response.result_int(),
+                        response.body().size(),
+                        elapsed));
+        logger::debug([&] {
+            return fmt::format(
+                "Timing of \"{} {}\": {}", method, request_uri, timing);
+        });
+
+        auto &recorder = state::ref().recorder;
+        if (recorder.capacity()) {
+            recorder.add({ started,
+                           method,
+                           request_uri,
+                           label,
+                           user,
+                           status_code,
+                           bench_.elapsed(),
+                           std::this_thread::get_id(),
+                           trace_context.entries() });
+        }
+    };
+
+    // Without a connection to defer, queued routes run in place.
+    if (!executor || !http_conn) {
+        return process(next);
     }
 
-    double elapsed = bench_.elapsed() * 1000;
-    auto major = response.version() / 10;
-    auto minor = response.version() % 10;
-    log(fmt::format("\"{} {} HTTP/{}.{}\" {} {} (took {:.1f}ms)",
-                    method,
-                    request_uri,
-                    major,
-                    minor,
-                    response.result_int(),
-                    response.body().size(),
-                    elapsed));
+    // A request which waited past its deadline is answered with 504
+    // by next() before its route runs.
+    auto resume = http_conn->defer();
+    if (!executor->post(user, [process, next, resume]() mutable {
+            // However process() ends, the connection must be resumed,
+            // or it waits for its deadline.
+            try {
+                process(next);
+            } catch (...) {
+                resume();
+                throw;
+            }
+            resume();
+        })) {
+        // The user's queue is full; fail fast rather than queue more.
+        const auto retry_after = executor->retry_after(user);
+        process([&response, &retry_after] {
+            http::set_response(response,
+                               json::error("Too Many Requests"),
+                               beast::http::status::too_many_requests);
+            response.set(beast::http::field::retry_after,
+                         std::to_string(retry_after.count()));
+        });
+        resume();
+    }
 }
 
 void http::router::route(const std::string &request_uri,
-                         http::connection::route_function fn)
+                         http::connection::route_function fn,
+                         thread::fair_executor *executor)
 {
     routes_[request_uri] = fn;
+    executors_[request_uri] = executor;
+    metrics_[request_uri] =
+        std::make_unique<route_metrics>(route_label(request_uri));
     regex_[request_uri] = request_uri;
 }
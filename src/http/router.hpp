@@ -18,23 +18,110 @@
 
 #include <http/connection.hpp>
 #include <http/types.hpp>
+#include <thread/fair_executor.hpp>
+#include <util/metrics.hpp>
 
+#include <array>
+#include <atomic>
 #include <map>
+#include <memory>
 #include <regex>
 #include <string>
 
 namespace webvirt::http
 {
 
+/** Request duration histograms of a route
+ *
+ * A route's histograms are labelled by method and status, which are only
+ * known once a request has been answered. Each is resolved from the
+ * registry the first time it is needed and kept in a slot after that,
+ * so accounting for a request takes no lock.
+ **/
+class route_metrics
+{
+private:
+    // One slot per status from 100 through 599.
+    static constexpr std::size_t num_statuses = 500;
+    static constexpr std::size_t num_methods =
+        static_cast<std::size_t>(beast::http::verb::unlink) + 1;
+    using table =
+        std::array<std::atomic<metrics::histogram *>, num_statuses>;
+
+    metrics::registry &registry_;
+    std::string label_;
+    // Allocated on a method's first request
+    std::array<std::atomic<table *>, num_methods> tables_ {};
+
+public:
+    /** Construct a route_metrics
+     *
+     * @param label Route label of the histograms
+     * @param registry Registry to resolve histograms from
+     **/
+    route_metrics(std::string label,
+                  metrics::registry &registry = metrics::registry::ref());
+    ~route_metrics();
+
+    route_metrics(const route_metrics &) = delete;
+    route_metrics &operator=(const route_metrics &) = delete;
+
+    const std::string &label() const;
+
+    /** Return the duration histogram of a response
+     *
+     * @param request Request answered
+     * @param status Status code of the response
+     * @returns Reference to the histogram
+     **/
+    metrics::histogram &duration(const http::request &request, int status);
+
+private:
+    metrics::histogram &resolve(const http::request &request, int status);
+};
+
 class router
 {
 private:
     std::map<std::string, http::connection::route_function> routes_;
     std::map<std::string, std::regex> regex_;
+    // route expression -> metrics of the route
+    std::map<std::string, std::unique_ptr<route_metrics>> metrics_;
+    // route expression -> executor running it, or nullptr
+    std::map<std::string, thread::fair_executor *> executors_;
+
+    // Metrics of requests which match no route
+    std::unique_ptr<route_metrics> unmatched_;
+    metrics::gauge *in_flight_;
 
 public:
+    router();
+
+    /** Run the route matching a request
+     *
+     * Routes added with an executor are queued on it for the request's
+     * user and answered once they finish; when the user's queue is
+     * full, the request is answered with 429 Too Many Requests and a
+     * Retry-After header instead.
+     *
+     * @param http_conn Connection owning request and response
+     * @param request HTTP request
+     * @param response HTTP response
+     **/
     void run(http::connection_ptr, const http::request &, http::response &);
-    void route(const std::string &, http::connection::route_function);
+
+    /** Add a route
+     *
+     * Routes of different priority classes are given separate executors,
+     * each with threads of its own.
+     *
+     * @param expr Regular expression matching request paths
+     * @param fn Route function
+     * @param executor Executor to run fn on, or nullptr to run it in
+     *                 place
+     **/
+    void route(const std::string &, http::connection::route_function,
+               thread::fair_executor *executor = nullptr);
 };
 
 }; // namespace webvirt::http
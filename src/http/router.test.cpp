@@ -16,8 +16,11 @@
 #include <http/middleware.hpp>
 #include <http/router.hpp>
 #include <mocks/syscall.hpp>
+#include <state.hpp>
 #include <util/json.hpp>
+#include <util/metrics.hpp>
 #include <util/retry.hpp>
+#include <util/trace.hpp>
 
 #include <gtest/gtest.h>
 
@@ -101,6 +104,18 @@ TEST_F(router_test, with_user_unknown_user)
     EXPECT_EQ(data["detail"], "Unable to locate user");
 }
 
+TEST_F(router_test, query_string)
+{
+    router_.route(R"(^/query/$)", noop);
+
+    http::request request;
+    request.target("/query/?fields=name");
+    http::response response;
+    router_.run(conn_, request, response);
+
+    EXPECT_EQ(response.result(), beast::http::status::ok);
+}
+
 TEST_F(router_test, retry_until_fatal)
 {
     router_.route(R"(^/retry/$)", [](auto, auto &, const auto &, auto &) {
@@ -114,3 +129,205 @@ TEST_F(router_test, retry_until_fatal)
 
     EXPECT_EQ(response.result(), beast::http::status::internal_server_error);
 }
+
+TEST_F(router_test, server_timing)
+{
+    router_.route(R"(^/timing/$)", [](auto, auto &, const auto &, auto &) {
+        trace::span span("work");
+    });
+
+    http::request request;
+    request.target("/timing/");
+    http::response response;
+    router_.run(conn_, request, response);
+
+    std::string timing(response.at("Server-Timing"));
+    std::regex re(R"(^work;dur=[0-9.]+, total;dur=[0-9.]+$)");
+    EXPECT_TRUE(std::regex_match(timing, re));
+}
+
+TEST_F(router_test, flight_recorder)
+{
+    router_.route(R"(^/users/([^/]+)/record/$)", noop);
+
+    http::request request;
+    request.method(beast::http::verb::get);
+    request.target("/users/test/record/?fields=name");
+    http::response response;
+    router_.run(conn_, request, response);
+
+    auto records = state::ref().recorder.records();
+    ASSERT_FALSE(records.empty());
+    const auto &record = records.front();
+    EXPECT_EQ(record.method, "GET");
+    EXPECT_EQ(record.target, "/users/test/record/?fields=name");
+    EXPECT_EQ(record.route, "/users/*/record/");
+    EXPECT_EQ(record.user, "test");
+    EXPECT_EQ(record.status, 200);
+    EXPECT_EQ(record.thread, std::this_thread::get_id());
+}
+
+TEST_F(router_test, duration_metrics)
+{
+    // A router resolves its metrics from the registry it was made with.
+    metrics::registry registry;
+    metrics::registry::change(registry);
+    http::router router;
+    router.route(R"(^/users/([^/]+)/ok/$)", noop);
+    router.route(R"(^/gone/$)", [](auto, auto &, const auto &, auto &res) {
+        res.result(beast::http::status::gone);
+    });
+
+    auto run = [&router, this](beast::http::verb method,
+                               const std::string &target) {
+        http::request request;
+        request.method(method);
+        request.target(target);
+        http::response response;
+        router.run(conn_, request, response);
+    };
+    run(beast::http::verb::get, "/users/a/ok/");
+    run(beast::http::verb::get, "/users/b/ok/");
+    run(beast::http::verb::post, "/users/a/ok/");
+    run(beast::http::verb::get, "/gone/");
+    run(beast::http::verb::get, "/nowhere/");
+
+    auto count = [&registry](const std::string &method,
+                             const std::string &route,
+                             const std::string &status) {
+        return registry
+            .histogram("webvirtd_http_request_duration_seconds",
+                       "Time taken to produce HTTP responses",
+                       { { "method", method },
+                         { "route", route },
+                         { "status", status } })
+            .count();
+    };
+    EXPECT_EQ(count("GET", "/users/*/ok/", "200"), 2);
+    EXPECT_EQ(count("POST", "/users/*/ok/", "200"), 1);
+    EXPECT_EQ(count("GET", "/gone/", "410"), 1);
+    EXPECT_EQ(count("GET", "none", "404"), 1);
+    EXPECT_EQ(registry
+                  .gauge("webvirtd_http_requests_in_flight",
+                         "HTTP requests being processed")
+                  .value(),
+              0);
+
+    metrics::registry::reset();
+}
+
+TEST_F(router_test, executor)
+{
+    thread::fair_executor executor;
+    router_.route(
+        R"(^/users/([^/]+)/queued/$)",
+        [](auto, auto &, const auto &, auto &response) {
+            response.body().append("queued");
+        },
+        &executor);
+
+    http::request request;
+    request.target("/users/test/queued/");
+    http::response response;
+    router_.run(conn_, request, response);
+
+    // The response is written once the route ran on the executor.
+    auto work = boost::asio::make_work_guard(io_);
+    io_.run_one_for(std::chrono::seconds(5));
+
+    EXPECT_EQ(response.result(), beast::http::status::ok);
+    EXPECT_EQ(response.body(), "queued");
+    EXPECT_NO_THROW(response.at("Server-Timing"));
+}
+
+TEST_F(router_test, executor_unknown_exception)
+{
+    thread::fair_executor executor;
+    router_.route(
+        R"(^/users/([^/]+)/queued/$)",
+        [](auto, auto &, const auto &, auto &) {
+            throw 42;
+        },
+        &executor);
+
+    http::request request;
+    request.target("/users/test/queued/");
+    http::response response;
+    router_.run(conn_, request, response);
+
+    // Still resumed, with an error in place of the route's response.
+    auto work = boost::asio::make_work_guard(io_);
+    io_.run_one_for(std::chrono::seconds(5));
+
+    EXPECT_EQ(response.result(),
+              beast::http::status::internal_server_error);
+}
+
+TEST_F(router_test, executor_queue_full)
+{
+    thread::fair_executor::options opts;
+    opts.user_queue = 0;
+    thread::fair_executor executor(opts);
+
+    bool ran = false;
+    router_.route(
+        R"(^/users/([^/]+)/queued/$)",
+        [&ran](auto, auto &, const auto &, auto &) {
+            ran = true;
+        },
+        &executor);
+
+    http::request request;
+    request.target("/users/test/queued/");
+    http::response response;
+    router_.run(conn_, request, response);
+
+    EXPECT_FALSE(ran);
+    EXPECT_EQ(response.result(), beast::http::status::too_many_requests);
+    EXPECT_EQ(response.at(beast::http::field::retry_after), "1");
+    auto data = json::parse(response.body());
+    EXPECT_EQ(data["detail"], "Too Many Requests");
+}
+
+TEST_F(router_test, deadline_exceeded)
+{
+    // A connection whose deadline has passed before its route ran
+    auto conn = std::make_shared<http::connection>(
+        io_, net::unix::socket { io_ }, std::chrono::milliseconds(0));
+
+    bool ran = false;
+    router_.route(R"(^/late/$)", [&ran](auto, auto &, const auto &, auto &) {
+        ran = true;
+    });
+
+    http::request request;
+    request.target("/late/");
+    http::response response;
+    router_.run(conn, request, response);
+
+    EXPECT_FALSE(ran);
+    EXPECT_EQ(response.result(), beast::http::status::gateway_timeout);
+    auto data = json::parse(response.body());
+    EXPECT_EQ(data["detail"], "Gateway Timeout");
+}
+
+TEST_F(router_test, deadline_no_retry)
+{
+    int attempts = 0;
+    router_.route(R"(^/retry/$)",
+                  [&attempts](auto, auto &, const auto &, auto &) {
+                      ++attempts;
+                      std::this_thread::sleep_for(
+                          std::chrono::milliseconds(60));
+                      throw webvirt::retry_error("Retry!");
+                  });
+
+    http::request request;
+    request.target("/retry/");
+    http::response response;
+    router_.run(conn_, request, response);
+
+    // The fixture's 50ms deadline passes during the first attempt.
+    EXPECT_EQ(attempts, 1);
+    EXPECT_EQ(response.result(), beast::http::status::gateway_timeout);
+}
@@ -15,12 +15,15 @@
  */
 #include <http/server.hpp>
 
+#include <algorithm>
+
 using namespace webvirt;
 using namespace http;
 
 server::server(std::filesystem::path socket_path)
     : socket_path_(std::move(socket_path))
-    , io_(new io_context())
+    , owned_io_(std::make_unique<io_context>())
+    , io_(owned_io_.get())
     , acceptor_(*io_, socket_path_.string())
     , socket_(*io_)
     , pool_(*io_)
@@ -29,7 +32,6 @@ server::server(std::filesystem::path socket_path)
 
 server::server(io_context &io, std::filesystem::path socket_path)
     : socket_path_(std::move(socket_path))
-    , io_owned_(false)
     , io_(&io)
     , acceptor_(*io_, socket_path_.string())
     , socket_(*io_)
@@ -40,9 +42,6 @@ server::server(io_context &io, std::filesystem::path socket_path)
 server::~server()
 {
     pool_.join();
-
-    if (io_owned_)
-        delete io_;
 }
 
 server &server::timeout(std::chrono::milliseconds ms)
@@ -60,37 +59,101 @@ std::size_t server::run()
 {
     logger::info(fmt::format("Listening on '{}'", socket_path_.c_str()));
 
+    auto &conf = config::ref();
+    std::size_t reactors = 0;
+    if (conf.has("reactors")) {
+        reactors = conf.get<unsigned>("reactors");
+    }
+
+    const std::size_t cpus = std::max(std::thread::hardware_concurrency(), 1u);
+    for (std::size_t i = 0; i < reactors; ++i) {
+        reactors_.emplace_back(std::make_unique<thread::reactor>());
+        reactors_.back()->start(i % cpus);
+        logger::debug(fmt::format("Reactor {} launched", i + 1));
+    }
+
     // Begin async calls
     async_accept();
 
     // Start up internal worker_pool
-    const auto threads = config::ref().get<unsigned>("threads");
-    pool_.start(threads);
+    if (reactors_.empty()) {
+        const auto threads = conf.get<unsigned>("threads");
+        pool_.start(threads);
+    }
 
     // Run the io_context on the main thread
-    return io_->run();
+    auto count = io_->run();
+
+    for (auto &reactor : reactors_) {
+        reactor->stop();
+    }
+    return count;
+}
+
+std::size_t server::connections() const
+{
+    std::size_t count = 0;
+    for (const auto &reactor : reactors_) {
+        count += reactor->connections();
+    }
+    return count;
 }
 
 void server::async_accept()
 {
-    acceptor_.async_accept(socket_, [this](boost::beast::error_code) {
-        // Here, we don't handle beast::error_code; we let that
-        // job fall through to the connection we make. If there's
-        // a problem with the socket, operations will fails within
-        // the connection immediately, which calls on_error_.
-        auto conn =
-            std::make_shared<connection>(*io_, std::move(socket_), timeout());
-
-        on_accept_(conn);
-        conn->on_accept(on_accept_);
-        conn->on_request(on_request_);
-        conn->on_websock_accept(on_websock_accept_);
-        conn->on_handshake(on_handshake_);
-        conn->on_websock_read(on_websock_read_);
-        conn->on_error(on_error_);
-        conn->on_close(on_close_);
-        conn->start();
+    if (!reactors_.empty()) {
+        auto &reactor = next_reactor();
+        return acceptor_.async_accept(
+            reactor.io(),
+            [this, &reactor](boost::beast::error_code,
+                             net::unix::socket socket) {
+                accept(reactor.io(), std::move(socket), reactor.lease());
+                async_accept();
+            });
+    }
 
+    acceptor_.async_accept(socket_, [this](boost::beast::error_code) {
+        accept(*io_, std::move(socket_), nullptr);
         async_accept();
     });
 }
+
+void server::accept(io_context &io, net::unix::socket socket,
+                    std::shared_ptr<void> lease)
+{
+    // Here, we don't handle beast::error_code; we let that
+    // job fall through to the connection we make. If there's
+    // a problem with the socket, operations will fails within
+    // the connection immediately, which calls on_error_.
+    auto conn = std::make_shared<connection>(io, std::move(socket), timeout());
+
+    on_accept_(conn);
+    conn->on_accept(on_accept_);
+    conn->on_request(on_request_);
+    conn->on_websock_accept(on_websock_accept_);
+    conn->on_handshake(on_handshake_);
+    conn->on_websock_read(on_websock_read_);
+    conn->on_error(on_error_);
+    conn->on_close(on_close_);
+    if (lease) {
+        // Held by the connection, and any websocket it upgrades to, for
+        // as long as it lives.
+        conn->on_close([lease] {
+        });
+    }
+    conn->start();
+}
+
+thread::reactor &server::next_reactor()
+{
+    // The reactor with the fewest connections; ties go round-robin.
+    const auto size = reactors_.size();
+    auto *best = reactors_[next_reactor_++ % size].get();
+    for (std::size_t i = 1; i < size; ++i) {
+        auto *reactor = reactors_[(next_reactor_ + i - 1) % size].get();
+        if (reactor->connections() < best->connections()) {
+            best = reactor;
+        }
+    }
+    return *best;
+}
@@ -19,6 +19,7 @@
 #include <http/connection.hpp>
 #include <http/handlers.hpp>
 #include <http/io_context.hpp>
+#include <thread/reactor.hpp>
 #include <thread/worker_pool.hpp>
 #include <util/config.hpp>
 #include <util/logging.hpp>
@@ -29,6 +30,8 @@
 #include <chrono>
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <vector>
 
 namespace webvirt::net
 {
@@ -44,7 +47,9 @@ class server
 private:
     std::filesystem::path socket_path_;
 
-    bool io_owned_ = true;
+    // Declared ahead of acceptor_ and socket_, which must be destroyed
+    // before the io_context they were created with.
+    std::unique_ptr<io_context> owned_io_;
     io_context *io_ = nullptr;
     net::unix::stream_protocol::acceptor acceptor_;
     net::unix::socket socket_;
@@ -62,6 +67,11 @@ private:
 
     thread::worker_pool pool_;
 
+    // Multi-reactor mode; see run(). Declared last, so that connections
+    // on them are destroyed before the rest of the server.
+    std::vector<std::unique_ptr<thread::reactor>> reactors_;
+    std::size_t next_reactor_ { 0 };
+
 public:
     /** Construct a server without a webvirt::http::io_context
      *
@@ -93,11 +103,26 @@ public:
     std::chrono::milliseconds timeout() const;
 
     /** Run the server's io_context
+     *
+     * By default, the io_context is run by the calling thread and
+     * "threads" worker threads. If the "reactors" option is set, the
+     * calling thread only accepts connections, handing each of them to
+     * the least loaded of that many reactors, each an io_context of its
+     * own run by a thread pinned to a CPU.
      *
      * @returns Number of handlers processed
      **/
     std::size_t run();
 
+    /** Return the number of connections leased by reactors
+     *
+     * A connection, and any websocket it upgrades to, is counted until
+     * it is destroyed; without reactors, this is always 0.
+     *
+     * @returns Number of live connections on reactors
+     **/
+    std::size_t connections() const;
+
     handler_setter(on_accept, on_accept_);
     handler_setter(on_request, on_request_);
     handler_setter(on_websock_accept, on_websock_accept_);
@@ -108,6 +133,9 @@ public:
 
 private:
     void async_accept();
+    void accept(io_context &io, net::unix::socket socket,
+                std::shared_ptr<void> lease);
+    thread::reactor &next_reactor();
 };
 
 }; // namespace webvirt::http
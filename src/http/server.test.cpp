@@ -15,13 +15,20 @@
  */
 #include <http/client.hpp>
 #include <http/server.hpp>
+#include <http/util.hpp>
 #include <syscall.hpp>
 #include <util/config.hpp>
 #include <util/util.hpp>
 
+#include <atomic>
 #include <boost/beast/http/status.hpp>
+#include <functional>
 #include <gtest/gtest.h>
+#include <map>
+#include <mutex>
+#include <numeric>
 #include <thread>
+#include <vector>
 
 using namespace webvirt;
 
@@ -168,6 +175,306 @@ TEST_F(server_test, post)
     EXPECT_EQ(response.at("server"), BOOST_BEAST_VERSION_STRING);
 }
 
+TEST_F(server_test, replaced_response_closes)
+{
+    auto server_thread = std::thread([&] {
+        server->on_close([&] {
+            io.stop();
+        });
+        server->on_request([](auto, const auto &, auto &response) {
+            response = http::response();
+            response.body() = "replaced";
+        });
+        server->run();
+    });
+
+    http::response response;
+    client->keep_alive(true);
+    client->on_response([&response](const auto &response_) {
+        response = response_;
+    });
+    client->async_get("/").run();
+
+    server_thread.join();
+
+    // The server closes the connection, so the client must not reuse it.
+    EXPECT_TRUE(client->request().keep_alive());
+    EXPECT_EQ(response.at("connection"), "close");
+    EXPECT_EQ(response.body(), "replaced");
+    EXPECT_FALSE(client->connected());
+}
+
+TEST_F(server_test, deferred_deadline)
+{
+    auto server_thread = std::thread([&] {
+        server->timeout(std::chrono::milliseconds(10));
+        server->on_close([&] {
+            io.stop();
+        });
+        server->on_request([](auto conn, const auto &, auto &response) {
+            // A response which is never completed
+            conn->defer();
+            response.body() = "late";
+        });
+        server->run();
+    });
+
+    http::response response;
+    client->on_response([&response](const auto &response_) {
+        response = response_;
+    });
+    client->async_get("/").run();
+
+    server_thread.join();
+
+    EXPECT_EQ(response.result(), beast::http::status::gateway_timeout);
+    EXPECT_EQ(response.at("connection"), "close");
+    auto data = json::parse(response.body());
+    EXPECT_EQ(data["detail"], "Gateway Timeout");
+}
+
+TEST_F(server_test, reactors)
+{
+    conf.add_option("reactors",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(2)
+                        ->multitoken(),
+                    "number of reactors");
+    const char *argv[] = { "webvirtd" };
+    conf.parse(1, argv);
+
+    std::thread::id server_id, request_id;
+    auto server_thread = std::thread([&] {
+        server_id = std::this_thread::get_id();
+        server->on_close([&] {
+            io.stop();
+        });
+        server->on_request([&request_id](auto, const auto &, auto &) {
+            request_id = std::this_thread::get_id();
+        });
+        server->run();
+    });
+
+    http::response response;
+    client->on_response([&response](const auto &response_) {
+        response = response_;
+    });
+    client->async_get("/").run();
+
+    server_thread.join();
+
+    // The connection was handled by a reactor, not the accepting thread.
+    EXPECT_EQ(response.result(), beast::http::status::ok);
+    EXPECT_NE(request_id, std::thread::id());
+    EXPECT_NE(request_id, server_id);
+}
+
+TEST_F(server_test, reactors_spread)
+{
+    conf.add_option("reactors",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(2)
+                        ->multitoken(),
+                    "number of reactors");
+    const char *argv[] = { "webvirtd" };
+    conf.parse(1, argv);
+
+    // Connections open at once are spread over the reactors. Responses
+    // are held until every connection is in, so that none closes before
+    // the last is placed.
+    constexpr int connections = 4;
+    std::mutex mutex;
+    std::map<std::thread::id, int> requests;
+    std::vector<std::function<void()>> resumes;
+    std::atomic<int> closed { 0 };
+    auto server_thread = std::thread([&] {
+        server->on_close([&] {
+            if (++closed == connections) {
+                io.stop();
+            }
+        });
+        server->on_request([&](auto conn, const auto &, auto &) {
+            std::lock_guard<std::mutex> guard(mutex);
+            ++requests[std::this_thread::get_id()];
+            resumes.emplace_back(conn->defer());
+            if (resumes.size() == connections) {
+                for (auto &resume : resumes) {
+                    resume();
+                }
+            }
+        });
+        server->run();
+    });
+
+    std::vector<std::shared_ptr<http::client>> clients;
+    int responses = 0;
+    for (int i = 0; i < connections; ++i) {
+        auto c = std::make_shared<http::client>(client_io,
+                                                socket_path.string());
+        c->keep_alive(true);
+        c->on_response([&responses](const auto &) {
+            ++responses;
+        });
+        c->async_get("/");
+        clients.emplace_back(std::move(c));
+    }
+    client_io.run();
+    clients.clear();
+
+    server_thread.join();
+
+    EXPECT_EQ(responses, connections);
+    ASSERT_EQ(requests.size(), 2u);
+    for (const auto &[id, count] : requests) {
+        EXPECT_EQ(count, connections / 2);
+    }
+}
+
+TEST_F(server_test, stream)
+{
+    auto server_thread = std::thread([&] {
+        server->on_close([&] {
+            io.stop();
+        });
+        server->on_request([](auto conn, const auto &, auto &) {
+            std::vector<std::string> chunks { "first,", "", "second" };
+            conn->stream([chunks, i = std::size_t(0)](
+                             std::string &chunk) mutable {
+                if (i == chunks.size()) {
+                    return false;
+                }
+                chunk.append(chunks[i++]);
+                return true;
+            });
+        });
+        server->run();
+    });
+
+    http::response response;
+    client->on_response([&response](const auto &response_) {
+        response = response_;
+    });
+    client->async_get("/").run();
+
+    server_thread.join();
+
+    EXPECT_EQ(response.result(), boost::beast::http::status::ok);
+    EXPECT_TRUE(response.chunked());
+    EXPECT_EQ(response.has_content_length(), false);
+    EXPECT_EQ(response.body(), "first,second");
+}
+
+TEST_F(server_test, stream_http_1)
+{
+    auto server_thread = std::thread([&] {
+        server->on_close([&] {
+            io.stop();
+        });
+        server->on_request([](auto conn, const auto &, auto &) {
+            conn->stream([i = 0](std::string &chunk) mutable {
+                if (i++ == 2) {
+                    return false;
+                }
+                chunk.append("chunk");
+                return true;
+            });
+        });
+        server->run();
+    });
+
+    http::response response;
+    client->on_response([&response](const auto &response_) {
+        response = response_;
+    });
+    client->version(webvirt::http::version::http_1).async_get("/").run();
+
+    server_thread.join();
+
+    EXPECT_FALSE(response.chunked());
+    EXPECT_EQ(response.has_content_length(), true);
+    EXPECT_EQ(response.body(), "chunkchunk");
+}
+
+TEST_F(server_test, stream_listing)
+{
+    auto serialized = std::make_shared<std::atomic<int>>(0);
+    auto server_thread = std::thread([&] {
+        server->on_close([&] {
+            io.stop();
+        });
+        server->on_request(
+            [serialized](auto conn, const auto &request, auto &response) {
+                std::vector<int> items { 1, 2, 3 };
+                http::set_listing(
+                    conn, request, response, items, [serialized](int i) {
+                        ++*serialized;
+                        Json::Value object(Json::objectValue);
+                        object["id"] = i;
+                        return object;
+                    });
+
+                // Items are serialized once the handler returns.
+                EXPECT_EQ(*serialized, 0);
+            });
+        server->run();
+    });
+
+    http::response response;
+    client->on_response([&response](const auto &response_) {
+        response = response_;
+    });
+    client->async_get("/?stream=true").run();
+
+    server_thread.join();
+
+    EXPECT_EQ(*serialized, 3);
+    EXPECT_TRUE(response.chunked());
+    EXPECT_EQ(response.at("content-type"), "application/json");
+
+    auto data = json::parse(response.body());
+    ASSERT_EQ(data.size(), 3);
+    EXPECT_EQ(data[2]["id"], 3);
+}
+
+TEST_F(server_test, stream_listing_deferred)
+{
+    // More items than a chunk_queue holds, produced while written
+    constexpr int count = http::chunk_queue::default_capacity * 4;
+
+    std::thread worker;
+    auto server_thread = std::thread([&] {
+        server->on_close([&] {
+            io.stop();
+        });
+        server->on_request([&worker](auto conn, const auto &request,
+                                     auto &response) {
+            std::vector<int> items(count);
+            std::iota(items.begin(), items.end(), 0);
+            http::set_listing(conn, request, response, items, [](int i) {
+                return Json::Value(i);
+            });
+
+            // The body is produced by the thread resuming the response.
+            worker = std::thread(conn->defer());
+        });
+        server->run();
+    });
+
+    http::response response;
+    client->on_response([&response](const auto &response_) {
+        response = response_;
+    });
+    client->async_get("/?stream=true").run();
+
+    server_thread.join();
+    worker.join();
+
+    EXPECT_TRUE(response.chunked());
+    auto data = json::parse(response.body());
+    ASSERT_EQ(data.size(), count);
+    EXPECT_EQ(data[count - 1], count - 1);
+}
+
 TEST_F(server_test, client_connect_error)
 {
     auto server_thread = std::thread([&] {
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <http/single_flight.hpp>
+#include <util/deadline.hpp>
+
+using namespace webvirt;
+
+void http::single_flight::run(const std::string &key, const function &fn,
+                              http::response &response)
+{
+    while (!attempt(key, fn, response)) {
+        // The leader ran out of its own time; this caller may have more
+        // left, so it takes off again.
+    }
+}
+
+bool http::single_flight::attempt(const std::string &key, const function &fn,
+                                  http::response &response)
+{
+    std::promise<http::response> promise;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = flights_.find(key);
+        if (it != flights_.end()) {
+            auto flight = it->second;
+            lock.unlock();
+
+            ++shared_;
+            return follow(flight, response);
+        }
+        flights_.emplace(key, promise.get_future().share());
+    }
+
+    // Callers arriving once the flight has landed start a new one.
+    auto land = [this, &key] {
+        std::lock_guard<std::mutex> guard(mutex_);
+        flights_.erase(key);
+    };
+
+    try {
+        fn(response);
+    } catch (...) {
+        land();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    land();
+    promise.set_value(response);
+    return true;
+}
+
+bool http::single_flight::follow(
+    const std::shared_future<http::response> &flight,
+    http::response &response)
+{
+    // Wait no longer than this caller's own deadline.
+    const auto until = deadline::current();
+    if (until == deadline::clock::time_point::max()) {
+        flight.wait();
+    } else {
+        while (flight.wait_until(until) != std::future_status::ready) {
+            deadline::check();
+        }
+    }
+
+    try {
+        response = flight.get();
+    } catch (const deadline::exceeded &) {
+        deadline::check();
+        return false;
+    }
+    return true;
+}
+
+std::uint64_t http::single_flight::shared() const
+{
+    return shared_;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef HTTP_SINGLE_FLIGHT_HPP
+#define HTTP_SINGLE_FLIGHT_HPP
+
+#include <http/types.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace webvirt::http
+{
+
+/** Coalesces identical concurrent requests
+ *
+ * The first caller for a key becomes the flight's leader and produces
+ * the response; callers arriving with the same key while it is still
+ * in flight block until it is done and receive a copy of the leader's
+ * response, or the exception it threw.
+ *
+ * Followers wait no longer than their own deadline::current(). When the
+ * leader fails because its own deadline passed, followers with time
+ * left start a new flight instead.
+ **/
+class single_flight
+{
+public:
+    using function = std::function<void(http::response &)>;
+
+private:
+    std::mutex mutex_;
+    // key -> leader's eventual response
+    std::map<std::string, std::shared_future<http::response>> flights_;
+
+    std::atomic<std::uint64_t> shared_ { 0 };
+
+public:
+    /** Produce a response, sharing it with concurrent callers
+     *
+     * @param key Flight key
+     * @param fn Function producing the response when leading a flight
+     * @param response Output response
+     * @throws deadline::exceeded If the caller's deadline passes while
+     *         waiting on another caller's flight
+     **/
+    void run(const std::string &key, const function &fn,
+             http::response &response);
+
+    /** Return the number of responses received from another caller
+     *
+     * @returns Number of coalesced calls
+     **/
+    std::uint64_t shared() const;
+
+private:
+    // Lead or follow a flight; false if it has to be run again.
+    bool attempt(const std::string &key, const function &fn,
+                 http::response &response);
+    bool follow(const std::shared_future<http::response> &flight,
+                http::response &response);
+};
+
+}; // namespace webvirt::http
+
+#endif /* HTTP_SINGLE_FLIGHT_HPP */
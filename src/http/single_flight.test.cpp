@@ -0,0 +1,194 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <http/single_flight.hpp>
+#include <util/deadline.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace webvirt;
+
+class single_flight_test : public testing::Test
+{
+protected:
+    http::single_flight flights_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool landed_ = false;
+    int calls_ = 0;
+
+public:
+    // Block the flight's leader until land() is called
+    void lead(http::response &response)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++calls_;
+        cv_.wait(lock, [this] { return landed_; });
+        response.result(beast::http::status::ok);
+        response.body() = "shared";
+    }
+
+    void land(std::uint64_t followers)
+    {
+        while (flights_.shared() < followers) {
+            std::this_thread::yield();
+        }
+
+        std::lock_guard<std::mutex> guard(mutex_);
+        landed_ = true;
+        cv_.notify_all();
+    }
+};
+
+TEST_F(single_flight_test, coalesces)
+{
+    constexpr std::size_t callers = 4;
+    std::vector<http::response> responses(callers);
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([this, &responses] {
+        flights_.run(
+            "key", [this](auto &response) { lead(response); }, responses[0]);
+    });
+
+    // Wait for the leader to take off before the rest arrive
+    while (true) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (calls_) {
+            break;
+        }
+    }
+
+    for (std::size_t i = 1; i < callers; ++i) {
+        threads.emplace_back([this, &responses, i] {
+            flights_.run(
+                "key", [this](auto &response) { lead(response); },
+                responses[i]);
+        });
+    }
+
+    land(callers - 1);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(calls_, 1);
+    EXPECT_EQ(flights_.shared(), callers - 1);
+    for (auto &response : responses) {
+        EXPECT_EQ(response.result(), beast::http::status::ok);
+        EXPECT_EQ(response.body(), "shared");
+    }
+
+    // The flight has landed; the next call starts a new one
+    http::response response;
+    flights_.run(
+        "key", [this](auto &output) { lead(output); }, response);
+    EXPECT_EQ(calls_, 2);
+}
+
+TEST_F(single_flight_test, distinct_keys)
+{
+    int calls = 0;
+    http::response response;
+    flights_.run(
+        "a", [&](auto &) { ++calls; }, response);
+    flights_.run(
+        "b", [&](auto &) { ++calls; }, response);
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(flights_.shared(), 0);
+}
+
+TEST_F(single_flight_test, exception)
+{
+    http::response response;
+    EXPECT_THROW(flights_.run(
+                     "key",
+                     [](auto &) { throw std::runtime_error("error"); },
+                     response),
+                 std::runtime_error);
+
+    // A failed flight does not stick around
+    flights_.run(
+        "key", [](auto &output) { output.body() = "ok"; }, response);
+    EXPECT_EQ(response.body(), "ok");
+}
+
+TEST_F(single_flight_test, follower_deadline)
+{
+    http::response leader;
+    std::thread thread([this, &leader] {
+        flights_.run(
+            "key", [this](auto &response) { lead(response); }, leader);
+    });
+    while (true) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (calls_) {
+            break;
+        }
+    }
+
+    // The follower gives up at its own deadline; the leader carries on.
+    {
+        deadline::scope scope(deadline::clock::now() +
+                              std::chrono::milliseconds(10));
+        http::response response;
+        EXPECT_THROW(flights_.run(
+                         "key",
+                         [this](auto &output) { lead(output); },
+                         response),
+                     deadline::exceeded);
+    }
+
+    land(1);
+    thread.join();
+    EXPECT_EQ(calls_, 1);
+    EXPECT_EQ(leader.body(), "shared");
+}
+
+TEST_F(single_flight_test, leader_deadline)
+{
+    std::atomic<bool> leading { false };
+    std::thread thread([this, &leading] {
+        http::response response;
+        EXPECT_THROW(flights_.run(
+                         "key",
+                         [this, &leading](auto &) {
+                             leading = true;
+                             while (flights_.shared() < 1) {
+                                 std::this_thread::yield();
+                             }
+                             throw deadline::exceeded("leader");
+                         },
+                         response),
+                     deadline::exceeded);
+    });
+    while (!leading) {
+        std::this_thread::yield();
+    }
+
+    // The leader's own deadline passed; the follower takes off itself.
+    http::response response;
+    flights_.run(
+        "key", [](auto &output) { output.body() = "follower"; }, response);
+    thread.join();
+    EXPECT_EQ(response.body(), "follower");
+}
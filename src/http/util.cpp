@@ -15,6 +15,10 @@
  */
 #include <http/util.hpp>
 #include <util/json.hpp>
+#include <util/trace.hpp>
+
+#include <algorithm>
+#include <cctype>
 
 using namespace webvirt;
 
@@ -29,5 +33,132 @@ void http::set_response(http::response &response, const std::string &data,
 void http::set_response(http::response &response, const Json::Value &data,
                         beast::http::status status_code)
 {
-    return set_response(response, json::stringify(data), status_code);
+    std::string body;
+    {
+        trace::span span("serialize");
+        body = json::stringify(data);
+    }
+    return set_response(response, body, status_code);
+}
+
+// Strip the weakness indicator from an entity tag
+static std::string opaque_tag(std::string tag)
+{
+    auto begin = tag.find_first_not_of(" \t");
+    auto end = tag.find_last_not_of(" \t");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    tag = tag.substr(begin, end - begin + 1);
+
+    if (tag.compare(0, 2, "W/") == 0) {
+        tag.erase(0, 2);
+    }
+    return tag;
+}
+
+bool http::if_none_match(const http::request &request,
+                         const std::string &etag)
+{
+    auto header = request.find(beast::http::field::if_none_match);
+    if (header == request.end()) {
+        return false;
+    }
+
+    const std::string value(header->value());
+    const auto current = opaque_tag(etag);
+
+    std::size_t begin = 0;
+    while (begin <= value.size()) {
+        auto end = std::min(value.find(',', begin), value.size());
+        auto tag = opaque_tag(value.substr(begin, end - begin));
+        if (tag == "*" || (!tag.empty() && tag == current)) {
+            return true;
+        }
+        begin = end + 1;
+    }
+
+    return false;
+}
+
+http::stream_format http::parse_stream_format(const http::request &request)
+{
+    auto accept = request.find(beast::http::field::accept);
+    if (accept != request.end() &&
+        accept->value().find("application/x-ndjson") !=
+            beast::string_view::npos) {
+        return stream_format::ndjson;
+    }
+
+    auto query = parse_query(request);
+    const auto &stream = query["stream"];
+    if (stream == "true" || stream == "1") {
+        return stream_format::json_array;
+    }
+
+    return stream_format::none;
+}
+
+std::string http::target_path(const std::string &target)
+{
+    return target.substr(0, target.find('?'));
+}
+
+std::string http::target_query(const std::string &target)
+{
+    auto pos = target.find('?');
+    if (pos == std::string::npos) {
+        return std::string();
+    }
+    return target.substr(pos);
+}
+
+static std::string percent_decode(const std::string &str)
+{
+    std::string output;
+    output.reserve(str.size());
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        if (str[i] == '+') {
+            output.push_back(' ');
+        } else if (str[i] == '%' && i + 2 < str.size() &&
+                   std::isxdigit(static_cast<unsigned char>(str[i + 1])) &&
+                   std::isxdigit(static_cast<unsigned char>(str[i + 2]))) {
+            output.push_back(static_cast<char>(
+                std::stoi(str.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        } else {
+            output.push_back(str[i]);
+        }
+    }
+    return output;
+}
+
+http::query http::parse_query(const http::request &request)
+{
+    http::query output;
+
+    const std::string target(request.target());
+    auto query = target_query(target);
+    std::size_t start = 1;
+    while (start < query.size()) {
+        auto end = query.find('&', start);
+        if (end == std::string::npos) {
+            end = query.size();
+        }
+
+        auto param = query.substr(start, end - start);
+        if (param.size()) {
+            auto eq = param.find('=');
+            auto key = percent_decode(param.substr(0, eq));
+            std::string value;
+            if (eq != std::string::npos) {
+                value = percent_decode(param.substr(eq + 1));
+            }
+            output[key] = std::move(value);
+        }
+
+        start = end + 1;
+    }
+
+    return output;
 }
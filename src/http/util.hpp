@@ -16,16 +16,206 @@
 #ifndef HTTP_UTIL_HPP
 #define HTTP_UTIL_HPP
 
+#include <http/chunk_queue.hpp>
+#include <http/connection.hpp>
 #include <http/types.hpp>
+#include <thread/parallel.hpp>
+#include <util/deadline.hpp>
+#include <util/json.hpp>
+#include <util/trace.hpp>
 
+#include <algorithm>
 #include <json/json.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace webvirt::http
 {
 
+/** Decoded query string parameters */
+using query = std::map<std::string, std::string>;
+
 void set_response(http::response &, const std::string &, beast::http::status);
 void set_response(http::response &, const Json::Value &, beast::http::status);
 
+/** Strip the query string from a request target
+ *
+ * @param target Request target
+ * @returns Path component of `target`
+ **/
+std::string target_path(const std::string &target);
+
+/** Return the query string of a request target
+ *
+ * @param target Request target
+ * @returns Query component of `target`, including its leading '?'
+ **/
+std::string target_query(const std::string &target);
+
+/** Parse query string parameters from a request target
+ *
+ * Keys and values are percent-decoded; when a key is repeated, the last
+ * value wins.
+ *
+ * @param request HTTP request
+ * @returns Decoded query parameters
+ **/
+http::query parse_query(const http::request &request);
+
+/** Test a request's If-None-Match header against an entity tag
+ *
+ * Tags are compared weakly, as RFC 9110 requires for If-None-Match.
+ *
+ * @param request HTTP request
+ * @param etag Current entity tag of the requested resource
+ * @returns True if the client's representation is still current
+ **/
+bool if_none_match(const http::request &request, const std::string &etag);
+
+/** Formats in which a JSON listing can be streamed */
+enum class stream_format {
+    none,       // A JSON array in a single response body
+    ndjson,     // Newline-delimited JSON, one chunk per element
+    json_array, // A JSON array, one chunk per element
+};
+
+/** Determine how a client would like a JSON listing to be delivered
+ *
+ * NDJSON is selected by an Accept header containing application/x-ndjson
+ * and a streamed JSON array by the ?stream=true query parameter.
+ *
+ * @param request HTTP request
+ * @returns Requested stream_format
+ **/
+http::stream_format parse_stream_format(const http::request &request);
+
+namespace detail
+{
+
+// Serialize items a window of `concurrency` at a time, charged to
+// `user` and within trace `context`, handing each value to `sink` in
+// order; false once `sink` has returned false.
+template <typename T, typename Function, typename Sink>
+bool serialize_listing(const std::vector<T> &items, const Function &serialize,
+                       std::size_t concurrency, const std::string &user,
+                       trace::context *context, Sink sink)
+{
+    auto fn = [serialize, context](const T &item) {
+        trace::scope scope(context);
+        return serialize(item);
+    };
+
+    auto &executor = thread::executor::ref();
+    concurrency = std::max<std::size_t>(concurrency, 1);
+    for (std::size_t i = 0; i < items.size(); i += concurrency) {
+        auto end = std::min(i + concurrency, items.size());
+        std::vector<T> window(items.begin() + i, items.begin() + end);
+        for (auto &value : thread::parallel_map(
+                 executor, user, window, fn, concurrency)) {
+            if (!sink(std::move(value))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}; // namespace detail
+
+/** Respond with a JSON array produced from a list of items
+ *
+ * Items are serialized up to `concurrency` at a time, on the calling
+ * thread and thread::executor helpers charged to `user`, under the
+ * caller's deadline and trace context; see thread::parallel_map.
+ *
+ * When the client asked for a streamed listing, the body is produced
+ * after the request handler returns: for a deferred response, on the
+ * thread resuming it, while the connection writes out one chunk per
+ * element as each is serialized, through a bounded http::chunk_queue.
+ * `serialize` must then hold nothing of the handler's by reference, and
+ * set up any per-request context of its own; its spans are no longer
+ * traced. Otherwise, the whole array is built in the response body.
+ *
+ * @param conn HTTP connection
+ * @param request HTTP request
+ * @param response HTTP response
+ * @param items Items to serialize
+ * @param serialize Function producing a Json::Value from an item
+ * @param concurrency Maximum number of items serialized at once
+ * @param user Name of the user helpers are charged to
+ * @throws deadline::exceeded if the request's deadline passes
+ **/
+template <typename T, typename Function>
+void set_listing(http::connection_ptr conn, const http::request &request,
+                 http::response &response, std::vector<T> items,
+                 Function serialize, std::size_t concurrency = 1,
+                 const std::string &user = std::string())
+{
+    auto format = parse_stream_format(request);
+    if (!conn || format == stream_format::none) {
+        Json::Value data(Json::arrayValue);
+        detail::serialize_listing(items,
+                                  serialize,
+                                  concurrency,
+                                  user,
+                                  trace::current(),
+                                  [&data](Json::Value value) {
+                                      data.append(std::move(value));
+                                      return true;
+                                  });
+        return set_response(response, data, beast::http::status::ok);
+    }
+
+    response.result(beast::http::status::ok);
+    response.set(beast::http::field::content_type,
+                 format == stream_format::ndjson ? "application/x-ndjson"
+                                                 : "application/json");
+
+    bool array = format == stream_format::json_array;
+    auto queue = std::make_shared<chunk_queue>();
+    conn->stream(queue,
+                 [queue,
+                  items = std::move(items),
+                  serialize = std::move(serialize),
+                  concurrency,
+                  user,
+                  array,
+                  time = deadline::current()] {
+                     deadline::scope scope(time);
+                     try {
+                         bool first = true;
+                         auto sink = [&](Json::Value value) {
+                             std::string chunk;
+                             if (array) {
+                                 chunk.append(first ? "[" : ",");
+                             }
+                             first = false;
+                             chunk.append(json::stringify(value));
+                             return queue->push(std::move(chunk));
+                         };
+                         // The request's trace context is gone.
+                         if (!detail::serialize_listing(items,
+                                                        serialize,
+                                                        concurrency,
+                                                        user,
+                                                        nullptr,
+                                                        sink)) {
+                             return;
+                         }
+                         if (array) {
+                             queue->push(first ? "[]" : "]");
+                         }
+                         queue->close();
+                     } catch (const std::exception &exc) {
+                         queue->fail(exc.what());
+                     } catch (...) {
+                         queue->fail("unknown error");
+                     }
+                 });
+}
+
 }; // namespace webvirt::http
 
 #endif /* HTTP_UTIL_HPP */
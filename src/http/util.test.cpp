@@ -0,0 +1,81 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <http/util.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace webvirt;
+
+TEST(util, target)
+{
+    EXPECT_EQ(http::target_path("/domains/?a=b"), "/domains/");
+    EXPECT_EQ(http::target_query("/domains/?a=b"), "?a=b");
+    EXPECT_EQ(http::target_path("/domains/"), "/domains/");
+    EXPECT_EQ(http::target_query("/domains/"), "");
+}
+
+TEST(util, parse_query)
+{
+    http::request request;
+    request.target("/?fields=name%2Cstate&title=a+b&empty&fields=id");
+
+    auto query = http::parse_query(request);
+    EXPECT_EQ(query["fields"], "id");
+    EXPECT_EQ(query["title"], "a b");
+    EXPECT_EQ(query.count("empty"), 1);
+    EXPECT_EQ(query["empty"], "");
+}
+
+TEST(util, if_none_match)
+{
+    const std::string etag = "W/\"a.1.2\"";
+
+    http::request request;
+    EXPECT_FALSE(http::if_none_match(request, etag));
+
+    request.set(beast::http::field::if_none_match, "W/\"a.1.2\"");
+    EXPECT_TRUE(http::if_none_match(request, etag));
+
+    // Weak comparison ignores the W/ prefix
+    request.set(beast::http::field::if_none_match, "\"a.1.2\"");
+    EXPECT_TRUE(http::if_none_match(request, etag));
+
+    request.set(beast::http::field::if_none_match,
+                "\"a.1.1\", W/\"a.1.2\"");
+    EXPECT_TRUE(http::if_none_match(request, etag));
+
+    request.set(beast::http::field::if_none_match, "\"a.1.1\"");
+    EXPECT_FALSE(http::if_none_match(request, etag));
+
+    request.set(beast::http::field::if_none_match, "*");
+    EXPECT_TRUE(http::if_none_match(request, etag));
+}
+
+TEST(util, parse_stream_format)
+{
+    http::request request;
+    request.target("/");
+    EXPECT_EQ(http::parse_stream_format(request), http::stream_format::none);
+
+    request.set(beast::http::field::accept, "application/x-ndjson");
+    EXPECT_EQ(http::parse_stream_format(request),
+              http::stream_format::ndjson);
+
+    request.erase(beast::http::field::accept);
+    request.target("/?stream=true");
+    EXPECT_EQ(http::parse_stream_format(request),
+              http::stream_format::json_array);
+}
@@ -16,8 +16,61 @@
 #include <libvirt.hpp>
 #include <util/logging.hpp>
 
+#include <cstdlib>
+#include <cstring>
+
 using namespace webvirt;
 
+void c_string::free_c_string::operator()(char *ptr) const
+{
+    free(ptr);
+}
+
+c_string::c_string(const char *str)
+{
+    if (str) {
+        size_ = strlen(str);
+        ptr_.reset(reinterpret_cast<char *>(malloc(size_ + 1)));
+        memcpy(ptr_.get(), str, size_ + 1);
+    }
+}
+
+c_string::c_string(const std::string &str)
+    : size_(str.size())
+{
+    ptr_.reset(reinterpret_cast<char *>(malloc(size_ + 1)));
+    memcpy(ptr_.get(), str.c_str(), size_ + 1);
+}
+
+c_string c_string::adopt(char *ptr)
+{
+    c_string output;
+    output.ptr_.reset(ptr);
+    output.size_ = ptr ? strlen(ptr) : 0;
+    return output;
+}
+
+const char *c_string::c_str() const
+{
+    return ptr_ ? ptr_.get() : "";
+}
+
+std::size_t c_string::size() const
+{
+    return size_;
+}
+
+char *c_string::release()
+{
+    size_ = 0;
+    return ptr_.release();
+}
+
+c_string::operator bool() const
+{
+    return ptr_ != nullptr;
+}
+
 void libvirt::free_connect_ptr::operator()(connect *ptr)
 {
     if (ptr) {
@@ -27,8 +80,9 @@ void libvirt::free_connect_ptr::operator()(connect *ptr)
 
 void libvirt::free_domain_ptr::operator()(domain *ptr)
 {
+    // Go through the installed libvirt, which may own the handle.
     if (ptr) {
-        ::virDomainFree(ptr);
+        libvirt::ref().virDomainFree(ptr);
     }
 }
 
@@ -144,6 +198,13 @@ domain_ptr libvirt::virDomainLookupByName(connect_ptr conn, const char *name)
                       free_domain_ptr());
 }
 
+domain_ptr libvirt::virDomainLookupByUUIDString(connect_ptr conn,
+                                                const char *uuid)
+{
+    return domain_ptr(::virDomainLookupByUUIDString(conn.get(), uuid),
+                      free_domain_ptr());
+}
+
 int libvirt::virDomainCreate(domain_ptr domain)
 {
     return ::virDomainCreate(domain.get());
@@ -154,6 +215,11 @@ int libvirt::virDomainRef(webvirt::domain *domain)
     return ::virDomainRef(domain);
 }
 
+int libvirt::virDomainFree(webvirt::domain *domain)
+{
+    return ::virDomainFree(domain);
+}
+
 int libvirt::virConnectDomainEventRegisterAny(
     connect *conn, domain *domain, int event_id,
     void (*cb)(webvirt::connect *, webvirt::domain *, void *), void *opaque,
@@ -185,6 +251,15 @@ const char *libvirt::virDomainGetName(domain_ptr domain)
     return ::virDomainGetName(domain.get());
 }
 
+std::string libvirt::virDomainGetUUIDString(domain_ptr domain)
+{
+    char uuid[VIR_UUID_STRING_BUFLEN];
+    if (::virDomainGetUUIDString(domain.get(), uuid) == -1) {
+        return std::string();
+    }
+    return uuid;
+}
+
 int libvirt::virDomainGetAutostart(domain_ptr domain, int *autostart)
 {
     return ::virDomainGetAutostart(domain.get(), autostart);
@@ -215,12 +290,9 @@ int libvirt::virDomainSetMetadata(domain_ptr domain, int type,
         domain.get(), type, metadata, key, uri, flags);
 }
 
-std::string libvirt::virDomainGetXMLDesc(domain_ptr domain, int flags)
+c_string libvirt::virDomainGetXMLDesc(domain_ptr domain, int flags)
 {
-    auto *buffer = ::virDomainGetXMLDesc(domain.get(), flags);
-    std::string s(buffer);
-    free(buffer);
-    return s;
+    return c_string::adopt(::virDomainGetXMLDesc(domain.get(), flags));
 }
 
 domain_ptr libvirt::virDomainDefineXML(connect_ptr conn, const char *xml)
@@ -243,13 +315,15 @@ int libvirt::virDomainShutdown(domain_ptr domain)
 }
 
 /* virNetwork definitions */
-std::string libvirt::virNetworkGetXMLDesc(network_ptr network,
-                                          unsigned int flags)
+const char *libvirt::virNetworkGetName(network_ptr network)
 {
-    char *buffer = ::virNetworkGetXMLDesc(network.get(), flags);
-    std::string s(buffer);
-    free(buffer);
-    return s;
+    return ::virNetworkGetName(network.get());
+}
+
+c_string libvirt::virNetworkGetXMLDesc(network_ptr network,
+                                       unsigned int flags)
+{
+    return c_string::adopt(::virNetworkGetXMLDesc(network.get(), flags));
 }
 
 /* virEvent definitions */
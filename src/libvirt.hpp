@@ -31,6 +31,60 @@
 namespace webvirt
 {
 
+/** An owned, malloc'd C string
+ *
+ * libvirt hands back descriptions as malloc'd C strings which the caller
+ * must free(). A c_string holds on to that allocation so it can be passed
+ * along to a consumer which adopts it, such as
+ * pugi::xml_document::load_buffer_inplace_own, without first copying it
+ * into a std::string.
+ **/
+class c_string
+{
+private:
+    struct free_c_string {
+        void operator()(char *) const;
+    };
+
+    std::unique_ptr<char, free_c_string> ptr_;
+    std::size_t size_ { 0 };
+
+public:
+    c_string() = default;
+
+    /** Construct a c_string holding a copy of `str`
+     *
+     * @param str NUL-terminated string to copy
+     **/
+    c_string(const char *str);
+
+    /** Construct a c_string holding a copy of `str`
+     *
+     * @param str String to copy
+     **/
+    c_string(const std::string &str);
+
+    /** Take ownership of a malloc'd C string
+     *
+     * @param ptr malloc'd C string, or nullptr
+     * @returns c_string owning `ptr`
+     **/
+    static c_string adopt(char *ptr);
+
+    const char *c_str() const;
+    std::size_t size() const;
+
+    /** Release ownership of the internal buffer
+     *
+     * The caller becomes responsible for free()ing the returned pointer.
+     *
+     * @returns Internal buffer, or nullptr if empty
+     **/
+    char *release();
+
+    operator bool() const;
+};
+
 /** A libvirt library call wrapper */
 class libvirt : public singleton<libvirt>
 {
@@ -76,8 +130,10 @@ public:
 
     // virDomain
     virtual domain_ptr virDomainLookupByName(connect_ptr, const char *);
+    virtual domain_ptr virDomainLookupByUUIDString(connect_ptr, const char *);
     virtual int virDomainCreate(domain_ptr);
     virtual int virDomainRef(webvirt::domain *);
+    virtual int virDomainFree(webvirt::domain *);
     virtual int virConnectDomainEventRegisterAny(
         webvirt::connect *, webvirt::domain *, int,
         void (*)(webvirt::connect *, webvirt::domain *, void *), void *,
@@ -86,20 +142,22 @@ public:
     virtual int virDomainGetState(domain_ptr, int *, int *, int);
     virtual int virDomainGetID(domain_ptr);
     virtual const char *virDomainGetName(domain_ptr);
+    virtual std::string virDomainGetUUIDString(domain_ptr);
     virtual int virDomainGetAutostart(domain_ptr, int *);
     virtual int virDomainSetAutostart(domain_ptr, int);
     virtual std::string virDomainGetMetadata(domain_ptr, int, const char *,
                                              unsigned int);
     virtual int virDomainSetMetadata(domain_ptr, int, const char *,
                                      const char *, const char *, unsigned int);
-    virtual std::string virDomainGetXMLDesc(domain_ptr, int);
+    virtual c_string virDomainGetXMLDesc(domain_ptr, int);
     virtual domain_ptr virDomainDefineXML(connect_ptr, const char *);
     virtual block_info_ptr virDomainGetBlockInfo(domain_ptr, const char *,
                                                  int);
     virtual int virDomainShutdown(domain_ptr);
 
     // virNetwork
-    virtual std::string virNetworkGetXMLDesc(network_ptr, unsigned int);
+    virtual const char *virNetworkGetName(network_ptr);
+    virtual c_string virNetworkGetXMLDesc(network_ptr, unsigned int);
 
     // virEvent
     virtual int virEventRegisterDefaultImpl();
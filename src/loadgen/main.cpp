@@ -0,0 +1,98 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <loadgen/runner.hpp>
+
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace webvirt;
+namespace po = boost::program_options;
+
+int main(int argc, const char *argv[])
+{
+    po::options_description desc("usage: webvirtd-bench [options]");
+    desc.add_options()("help,h", "produce help message")(
+        "socket,s",
+        po::value<std::string>()->default_value(
+            "/var/run/webvirtd/webvirtd.sock"),
+        "unix socket path of a running webvirtd")(
+        "concurrency,c",
+        po::value<unsigned>()->default_value(8),
+        "number of requests kept in flight")(
+        "threads,t",
+        po::value<unsigned>()->default_value(1),
+        "number of client threads")(
+        "duration,d",
+        po::value<double>()->default_value(10.0),
+        "seconds to generate load for")(
+        "keep-alive", "reuse connections the daemon keeps open")(
+        "mix,m",
+        po::value<std::vector<std::string>>()->multitoken(),
+        "request mix entries, as [weight:]target (e.g. 9:/users/alice/)")(
+        "subscribers",
+        po::value<unsigned>()->default_value(0),
+        "number of websocket subscribers")(
+        "websocket",
+        po::value<std::string>()->default_value(""),
+        "websocket target subscribers connect to");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch (const po::error &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (vm.count("help")) {
+        std::cout << desc;
+        return 0;
+    }
+
+    loadgen::options opts;
+    opts.socket = vm["socket"].as<std::string>();
+    opts.concurrency = vm["concurrency"].as<unsigned>();
+    opts.threads = vm["threads"].as<unsigned>();
+    opts.duration = vm["duration"].as<double>();
+    opts.keep_alive = vm.count("keep-alive") > 0;
+    opts.subscribers = vm["subscribers"].as<unsigned>();
+    opts.websocket = vm["websocket"].as<std::string>();
+
+    if (!vm.count("mix")) {
+        std::cerr << "error: at least one --mix entry is required"
+                  << std::endl;
+        return 1;
+    }
+    if (opts.subscribers && opts.websocket.empty()) {
+        std::cerr << "error: --subscribers requires --websocket"
+                  << std::endl;
+        return 1;
+    }
+
+    try {
+        opts.mix = loadgen::mix::parse(
+            vm["mix"].as<std::vector<std::string>>());
+    } catch (const std::invalid_argument &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << loadgen::run(opts);
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <loadgen/mix.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace webvirt::loadgen;
+
+void mix::add(double weight, std::string target)
+{
+    if (!(weight > 0)) {
+        throw std::invalid_argument("weight must be positive");
+    }
+    if (target.empty() || target.front() != '/') {
+        throw std::invalid_argument("target must start with '/'");
+    }
+
+    double total = cumulative_.empty() ? 0 : cumulative_.back();
+    targets_.emplace_back(std::move(target));
+    cumulative_.emplace_back(total + weight);
+}
+
+mix mix::parse(const std::vector<std::string> &entries)
+{
+    mix output;
+    for (const auto &entry : entries) {
+        auto pos = entry.find(':');
+        if (pos == std::string::npos) {
+            output.add(1, entry);
+            continue;
+        }
+
+        double weight;
+        try {
+            std::size_t end;
+            weight = std::stod(entry.substr(0, pos), &end);
+            if (end != pos) {
+                throw std::invalid_argument(entry);
+            }
+        } catch (const std::logic_error &) {
+            throw std::invalid_argument("invalid weight in '" + entry + "'");
+        }
+        output.add(weight, entry.substr(pos + 1));
+    }
+    return output;
+}
+
+bool mix::empty() const
+{
+    return targets_.empty();
+}
+
+const std::vector<std::string> &mix::targets() const
+{
+    return targets_;
+}
+
+const std::string &mix::pick(std::mt19937 &rng) const
+{
+    std::uniform_real_distribution<double> dist(0, cumulative_.back());
+    auto it = std::upper_bound(cumulative_.begin(), cumulative_.end(),
+                               dist(rng));
+    auto index = std::min<std::size_t>(it - cumulative_.begin(),
+                                       targets_.size() - 1);
+    return targets_[index];
+}
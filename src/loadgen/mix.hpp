@@ -0,0 +1,63 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef LOADGEN_MIX_HPP
+#define LOADGEN_MIX_HPP
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace webvirt::loadgen
+{
+
+/** A weighted mix of request targets */
+class mix
+{
+private:
+    std::vector<std::string> targets_;
+    // Running sum of weights, one per target
+    std::vector<double> cumulative_;
+
+public:
+    /** Add a target
+     *
+     * @param weight Relative weight of the target; must be positive
+     * @param target Request target, e.g. /users/test/domains/
+     **/
+    void add(double weight, std::string target);
+
+    /** Parse a mix from WEIGHT:TARGET or TARGET (weight 1) entries
+     *
+     * @param entries Mix entries, e.g. { "9:/users/test/domains/" }
+     * @returns Parsed mix
+     * @throws std::invalid_argument if an entry is malformed
+     **/
+    static mix parse(const std::vector<std::string> &entries);
+
+    bool empty() const;
+    const std::vector<std::string> &targets() const;
+
+    /** Pick a target, proportionally to its weight
+     *
+     * @param rng Random number generator
+     * @returns Picked target
+     **/
+    const std::string &pick(std::mt19937 &rng) const;
+};
+
+}; // namespace webvirt::loadgen
+
+#endif /* LOADGEN_MIX_HPP */
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <loadgen/mix.hpp>
+
+#include <gtest/gtest.h>
+#include <map>
+
+using namespace webvirt;
+
+TEST(mix, parse)
+{
+    auto m = loadgen::mix::parse({ "3:/users/test/", "/users/test/domains/" });
+    ASSERT_EQ(m.targets().size(), 2);
+    EXPECT_EQ(m.targets()[0], "/users/test/");
+    EXPECT_EQ(m.targets()[1], "/users/test/domains/");
+}
+
+TEST(mix, parse_invalid)
+{
+    EXPECT_THROW(loadgen::mix::parse({ "x:/users/test/" }),
+                 std::invalid_argument);
+    EXPECT_THROW(loadgen::mix::parse({ "0:/users/test/" }),
+                 std::invalid_argument);
+    EXPECT_THROW(loadgen::mix::parse({ "1:" }), std::invalid_argument);
+}
+
+TEST(mix, pick)
+{
+    auto m = loadgen::mix::parse({ "3:/a", "1:/b" });
+
+    std::mt19937 rng(0);
+    std::map<std::string, int> picks;
+    for (int i = 0; i < 4000; ++i) {
+        ++picks[m.pick(rng)];
+    }
+
+    // Picks follow weights, give or take.
+    EXPECT_NEAR(picks["/a"], 3000, 150);
+    EXPECT_NEAR(picks["/b"], 1000, 150);
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <http/client.hpp>
+#include <http/io_context.hpp>
+#include <loadgen/runner.hpp>
+#include <ws/client.hpp>
+
+#include <atomic>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <fmt/format.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace webvirt;
+using namespace webvirt::loadgen;
+
+namespace
+{
+
+using clock_type = std::chrono::steady_clock;
+
+/** A virtual client, keeping a single request in flight */
+class worker
+{
+private:
+    http::io_context &io_;
+    const options &opts_;
+    const std::atomic<bool> &stopping_;
+    std::atomic<unsigned> &active_;
+
+    std::mt19937 rng_;
+    std::shared_ptr<http::client> client_;
+    clock_type::time_point sent_;
+    boost::asio::steady_timer backoff_;
+
+public:
+    // Only touched by this worker's handlers, which run one at a time.
+    report rep;
+
+public:
+    worker(http::io_context &io, const options &opts,
+           const std::atomic<bool> &stopping, std::atomic<unsigned> &active,
+           std::mt19937::result_type seed)
+        : io_(io)
+        , opts_(opts)
+        , stopping_(stopping)
+        , active_(active)
+        , rng_(seed)
+        , backoff_(io)
+    {
+    }
+
+    void start()
+    {
+        ++active_;
+        next();
+    }
+
+private:
+    void next()
+    {
+        if (stopping_) {
+            client_.reset();
+            --active_;
+            return;
+        }
+
+        if (!client_ || !client_->connected()) {
+            client_ = std::make_shared<http::client>(io_, opts_.socket);
+            client_->keep_alive(opts_.keep_alive);
+            client_->on_connect([this](auto &) {
+                ++rep.connections;
+            });
+            client_->on_response([this](const http::response &response) {
+                on_response(response);
+            });
+            client_->on_error([this](const char *, beast::error_code) {
+                on_error();
+            });
+        }
+
+        sent_ = clock_type::now();
+        client_->async_get(opts_.mix.pick(rng_).c_str());
+    }
+
+    void on_response(const http::response &response)
+    {
+        if (!stopping_) {
+            std::chrono::duration<double> elapsed = clock_type::now() - sent_;
+            rep.latency.add(elapsed.count());
+            ++rep.statuses[response.result_int()];
+            ++rep.requests;
+        }
+        next();
+    }
+
+    void on_error()
+    {
+        if (!stopping_) {
+            ++rep.errors;
+        }
+        client_.reset();
+
+        // Don't spin on a daemon which refuses connections.
+        backoff_.expires_after(std::chrono::milliseconds(10));
+        backoff_.async_wait([this](boost::system::error_code) {
+            next();
+        });
+    }
+};
+
+}; // namespace
+
+report loadgen::run(const options &opts)
+{
+    std::atomic<bool> stopping { false };
+    std::atomic<unsigned> active { 0 };
+    std::atomic<unsigned> subscribed { 0 };
+    std::atomic<std::uint64_t> messages { 0 };
+
+    http::io_context io;
+    auto guard = boost::asio::make_work_guard(io);
+
+    std::vector<std::shared_ptr<websocket::client>> subscribers;
+    for (unsigned i = 0; i < opts.subscribers; ++i) {
+        auto ws = std::make_shared<websocket::client>(io, opts.socket);
+        ws->on_handshake([&subscribed](auto, auto) {
+            ++subscribed;
+        });
+        ws->on_read([&messages](auto, const std::string &) {
+            ++messages;
+        });
+        ws->async_connect(opts.websocket);
+        subscribers.emplace_back(std::move(ws));
+    }
+
+    std::random_device seeds;
+    std::vector<std::unique_ptr<worker>> workers;
+    for (unsigned i = 0; i < opts.concurrency; ++i) {
+        workers.emplace_back(
+            std::make_unique<worker>(io, opts, stopping, active, seeds()));
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < std::max(opts.threads, 1u); ++i) {
+        threads.emplace_back([&io] {
+            io.run();
+        });
+    }
+
+    auto start = clock_type::now();
+    for (auto &w : workers) {
+        boost::asio::post(io, [&w] {
+            w->start();
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(opts.duration));
+    stopping = true;
+    std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+    // Let requests in flight finish, but don't wait on a stuck daemon.
+    auto deadline = clock_type::now() + std::chrono::seconds(5);
+    while (active && clock_type::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    guard.reset();
+    io.stop();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    report output;
+    output.seconds = elapsed.count();
+    for (auto &w : workers) {
+        output.requests += w->rep.requests;
+        output.errors += w->rep.errors;
+        output.connections += w->rep.connections;
+        for (const auto &[status, count] : w->rep.statuses) {
+            output.statuses[status] += count;
+        }
+        output.latency.merge(w->rep.latency);
+    }
+    output.subscribed = subscribed;
+    output.messages = messages;
+    return output;
+}
+
+std::ostream &loadgen::operator<<(std::ostream &os, const report &rep)
+{
+    auto ms = [&rep](double p) {
+        return rep.latency.percentile(p) * 1000;
+    };
+    double throughput = rep.seconds > 0 ? rep.requests / rep.seconds : 0;
+
+    os << fmt::format("requests:    {} ({} errors)\n", rep.requests,
+                      rep.errors)
+       << fmt::format("duration:    {:.2f}s\n", rep.seconds)
+       << fmt::format("throughput:  {:.1f} req/s\n", throughput)
+       << fmt::format("connections: {}\n", rep.connections)
+       << fmt::format("latency:     mean {:.3f}ms, p50 {:.3f}ms, "
+                      "p99 {:.3f}ms, p999 {:.3f}ms, max {:.3f}ms\n",
+                      rep.latency.mean() * 1000,
+                      ms(50),
+                      ms(99),
+                      ms(99.9),
+                      rep.latency.max() * 1000);
+
+    os << "statuses:   ";
+    for (const auto &[status, count] : rep.statuses) {
+        os << fmt::format(" {}: {}", status, count);
+    }
+    os << "\n";
+
+    if (rep.subscribed) {
+        os << fmt::format("websockets:  {} subscribed, {} messages\n",
+                          rep.subscribed,
+                          rep.messages);
+    }
+    return os;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef LOADGEN_RUNNER_HPP
+#define LOADGEN_RUNNER_HPP
+
+#include <loadgen/mix.hpp>
+#include <loadgen/samples.hpp>
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace webvirt::loadgen
+{
+
+/** Load to generate */
+struct options {
+    /** Path to the daemon's unix socket */
+    std::string socket;
+
+    /** Request targets to pick from */
+    loadgen::mix mix;
+
+    /** Number of requests kept in flight */
+    unsigned concurrency { 8 };
+
+    /** Number of threads running the client io_context */
+    unsigned threads { 1 };
+
+    /** Seconds to generate load for */
+    double duration { 10 };
+
+    /** Reuse connections, when the daemon allows it */
+    bool keep_alive { false };
+
+    /** Number of websocket clients subscribed during the run */
+    unsigned subscribers { 0 };
+
+    /** Request target websocket clients subscribe to */
+    std::string websocket;
+};
+
+/** Outcome of a run */
+struct report {
+    double seconds { 0 };
+    std::uint64_t requests { 0 };
+    std::uint64_t errors { 0 };
+    std::uint64_t connections { 0 };
+    std::map<int, std::uint64_t> statuses;
+    loadgen::samples latency;
+
+    unsigned subscribed { 0 };
+    std::uint64_t messages { 0 };
+};
+
+/** Generate load against a running webvirtd
+ *
+ * Each of `concurrency` virtual clients repeatedly picks a target from
+ * the mix, sends a GET request and waits for its response, until
+ * `duration` has elapsed. Requests in flight at that point are waited
+ * for, but not counted.
+ *
+ * @param opts Load to generate
+ * @returns Report of the run
+ **/
+report run(const options &opts);
+
+/** Write a human-readable report
+ *
+ * @param os Output stream
+ * @param rep Report
+ * @returns Reference to `os`
+ **/
+std::ostream &operator<<(std::ostream &os, const report &rep);
+
+}; // namespace webvirt::loadgen
+
+#endif /* LOADGEN_RUNNER_HPP */
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <loadgen/samples.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace webvirt::loadgen;
+
+void samples::add(double seconds)
+{
+    if (!values_.empty() && seconds < values_.back()) {
+        sorted_ = false;
+    }
+    values_.push_back(seconds);
+}
+
+void samples::merge(const samples &other)
+{
+    for (auto value : other.values_) {
+        add(value);
+    }
+}
+
+std::size_t samples::size() const
+{
+    return values_.size();
+}
+
+bool samples::empty() const
+{
+    return values_.empty();
+}
+
+double samples::percentile(double p) const
+{
+    if (values_.empty()) {
+        return 0;
+    }
+
+    if (!sorted_) {
+        std::sort(values_.begin(), values_.end());
+        sorted_ = true;
+    }
+
+    // Nudge the rank down so that e.g. p99.9 of 1000 samples isn't
+    // rounded up to the maximum by floating point error.
+    p = std::clamp(p, 0.0, 100.0);
+    auto rank = static_cast<std::size_t>(std::ceil(
+        p * static_cast<double>(values_.size()) / 100 - 1e-9));
+    return values_[rank ? rank - 1 : 0];
+}
+
+double samples::mean() const
+{
+    if (values_.empty()) {
+        return 0;
+    }
+    return std::accumulate(values_.begin(), values_.end(), 0.0) /
+           static_cast<double>(values_.size());
+}
+
+double samples::max() const
+{
+    return percentile(100);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef LOADGEN_SAMPLES_HPP
+#define LOADGEN_SAMPLES_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace webvirt::loadgen
+{
+
+/** Latency samples, kept exactly so that tail percentiles are exact */
+class samples
+{
+private:
+    // Sorted lazily, when a percentile is asked for
+    mutable std::vector<double> values_;
+    mutable bool sorted_ { true };
+
+public:
+    /** Add a sample
+     *
+     * @param seconds Latency, in seconds
+     **/
+    void add(double seconds);
+
+    /** Add all samples of another set
+     *
+     * @param other Samples to add
+     **/
+    void merge(const samples &other);
+
+    std::size_t size() const;
+    bool empty() const;
+
+    /** Return a percentile, using the nearest-rank method
+     *
+     * @param p Percentile, within [0, 100]
+     * @returns Latency at the percentile, in seconds; 0 if empty
+     **/
+    double percentile(double p) const;
+
+    /** Return the mean latency
+     *
+     * @returns Mean latency, in seconds; 0 if empty
+     **/
+    double mean() const;
+
+    /** Return the highest latency
+     *
+     * @returns Highest latency, in seconds; 0 if empty
+     **/
+    double max() const;
+};
+
+}; // namespace webvirt::loadgen
+
+#endif /* LOADGEN_SAMPLES_HPP */
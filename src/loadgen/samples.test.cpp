@@ -0,0 +1,63 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <loadgen/samples.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace webvirt;
+
+TEST(samples, empty)
+{
+    loadgen::samples s;
+    EXPECT_TRUE(s.empty());
+    EXPECT_EQ(s.percentile(50), 0);
+    EXPECT_EQ(s.mean(), 0);
+    EXPECT_EQ(s.max(), 0);
+}
+
+TEST(samples, percentile)
+{
+    loadgen::samples s;
+    for (int i = 1000; i > 0; --i) {
+        s.add(i);
+    }
+    EXPECT_EQ(s.size(), 1000);
+
+    EXPECT_EQ(s.percentile(0), 1);
+    EXPECT_EQ(s.percentile(50), 500);
+    EXPECT_EQ(s.percentile(99), 990);
+    EXPECT_EQ(s.percentile(99.9), 999);
+    EXPECT_EQ(s.percentile(100), 1000);
+    EXPECT_EQ(s.max(), 1000);
+    EXPECT_DOUBLE_EQ(s.mean(), 500.5);
+
+    // Samples added after a percentile was taken are sorted in again.
+    s.add(0);
+    EXPECT_EQ(s.percentile(0), 0);
+}
+
+TEST(samples, merge)
+{
+    loadgen::samples a, b;
+    a.add(1);
+    a.add(3);
+    b.add(2);
+
+    a.merge(b);
+    EXPECT_EQ(a.size(), 3);
+    EXPECT_EQ(a.percentile(50), 2);
+    EXPECT_EQ(b.size(), 1);
+}
@@ -19,21 +19,33 @@
 #include <http/server.hpp>
 #include <state.hpp>
 #include <syscall.hpp>
+#include <thread/fair_executor.hpp>
 #include <util/config.hpp>
 #include <util/signal.hpp>
 #include <util/util.hpp>
 #include <version.hpp>
+#include <virt/backend.hpp>
+#include <virt/instrumented.hpp>
 
+#include <boost/asio/signal_set.hpp>
+#include <boost/core/ignore_unused.hpp>
 #include <boost/program_options/errors.hpp>
 #include <csignal>
+#include <cstring>
 #include <filesystem>
 #include <fmt/format.h>
 #include <functional>
 #include <grp.h>
 #include <iostream>
+#include <stdexcept>
+#include <system_error>
 #include <thread>
 #include <unistd.h>
 
+#ifdef BOOST_ASIO_HAS_IO_URING
+#include <liburing.h>
+#endif
+
 using namespace webvirt;
 
 int setup_socket(webvirt::syscall &sys,
@@ -60,7 +72,46 @@ int setup_socket(webvirt::syscall &sys,
     return 0;
 }
 
-int webvirt_main(http::io_context &io, const std::string &socket_path)
+// Asio picks its reactor at build time. An io_uring build running on a
+// kernel which refuses io_uring (too old, or disabled by sysctl or
+// seccomp) falls back to epoll by executing the epoll build installed
+// beside it with the same arguments; see -Dio_uring.
+int select_reactor(const char *argv[])
+{
+#ifdef BOOST_ASIO_HAS_IO_URING
+    struct io_uring ring;
+    if (auto rc = io_uring_queue_init(1, &ring, 0); rc < 0) {
+        std::error_code ec;
+        auto epoll = std::filesystem::read_symlink("/proc/self/exe", ec);
+        if (ec) {
+            return errorln(fmt::format("io_uring unavailable ({}) and "
+                                       "/proc/self/exe unreadable ({})",
+                                       std::strerror(-rc),
+                                       ec.message()),
+                           1);
+        }
+
+        epoll.replace_filename("webvirtd-epoll");
+        logger::error(fmt::format("io_uring unavailable ({}), falling back "
+                                  "to {}",
+                                  std::strerror(-rc),
+                                  epoll.string()));
+        ::execv(epoll.c_str(), const_cast<char *const *>(argv));
+        return errorln(fmt::format("execv of {} failed ({})",
+                                   epoll.string(),
+                                   std::strerror(errno)),
+                       1);
+    }
+    io_uring_queue_exit(&ring);
+    logger::info("Using the io_uring reactor");
+#else
+    boost::ignore_unused(argv);
+    logger::info("Using the epoll reactor");
+#endif
+    return 0;
+}
+
+int run_app(http::io_context &io, const std::string &socket_path)
 {
     auto &sys = syscall::ref();
 
@@ -74,6 +125,25 @@ int webvirt_main(http::io_context &io, const std::string &socket_path)
     return 0;
 }
 
+int webvirt_main(http::io_context &io, const std::string &socket_path)
+{
+    // Record per-API metrics for every libvirt call.
+    auto &lv = libvirt::ref();
+    virt::instrumented_libvirt instrumented(lv);
+    libvirt::change(instrumented);
+
+    int rc;
+    try {
+        rc = run_app(io, socket_path);
+    } catch (...) {
+        libvirt::change(lv);
+        throw;
+    }
+
+    libvirt::change(lv);
+    return rc;
+}
+
 int main(int argc, const char *argv[])
 {
     FILE *files_[2] = { stdout, stderr };
@@ -97,6 +167,13 @@ int main(int argc, const char *argv[])
                         ->default_value(std::thread::hardware_concurrency())
                         ->multitoken(),
                     "number of worker threads");
+    conf.add_option("reactors",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(0)
+                        ->multitoken(),
+                    "number of io_contexts, each run by a thread pinned "
+                    "to a CPU, to spread connections over; 0 shares one "
+                    "io_context between --threads threads");
 
     auto gid = sys.getgid();
     auto *default_group = sys.getgrgid(gid);
@@ -115,6 +192,70 @@ int main(int argc, const char *argv[])
                         ->default_value(15.0)
                         ->multitoken(),
                     "timeout in seconds for domain shutoff state to react");
+    conf.add_option("fan-out",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(8)
+                        ->multitoken(),
+                    "maximum concurrent libvirt calls within a request; "
+                    "also the share of fan-out threads a user holds");
+    conf.add_option("fan-out-threads",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(32)
+                        ->multitoken(),
+                    "number of threads issuing concurrent libvirt calls");
+    conf.add_option("read-threads",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(16)
+                        ->multitoken(),
+                    "number of threads running libvirt-bound reads");
+    conf.add_option("write-threads",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(4)
+                        ->multitoken(),
+                    "number of threads running libvirt mutations");
+    conf.add_option("user-concurrency",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(4)
+                        ->multitoken(),
+                    "maximum libvirt-bound requests running per user");
+    conf.add_option("user-queue",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(64)
+                        ->multitoken(),
+                    "maximum libvirt-bound requests waiting per user; "
+                    "further requests are answered with 429");
+    conf.add_option("user-weight",
+                    boost::program_options::value<std::vector<std::string>>()
+                        ->multitoken(),
+                    "user=weight pairs; a user with weight 2 is served "
+                    "twice as often as one with the default weight 1");
+    conf.add_option("cache-ttl",
+                    boost::program_options::value<double>()
+                        ->default_value(5.0)
+                        ->multitoken(),
+                    "seconds to cache GET responses for; 0 disables");
+    conf.add_option("log-buffer",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(8192)
+                        ->multitoken(),
+                    "log records buffered for a background writer; "
+                    "0 logs synchronously");
+    conf.add_option("log-json", "log one JSON object per line");
+    conf.add_option("flight-recorder",
+                    boost::program_options::value<unsigned>()
+                        ->default_value(256)
+                        ->multitoken(),
+                    "recent requests kept for GET /debug/requests/ and "
+                    "SIGUSR1; 0 disables");
+    conf.add_option("libvirt-backend",
+                    boost::program_options::value<std::string>()
+                        ->default_value("libvirt")
+                        ->multitoken(),
+                    "libvirt backend: 'libvirt'; 'sim[:options]' for a "
+                    "simulated hypervisor, e.g. "
+                    "sim:domains=2000,latency=2ms,jitter=500us,events=5; "
+                    "'record:PATH' to record libvirt calls to PATH; or "
+                    "'replay:PATH' or 'replay-timed:PATH' to serve them");
 
     // Bind process signals
     ::signal(SIGPIPE, webvirt::signal::pipe);
@@ -144,8 +285,40 @@ int main(int argc, const char *argv[])
     // Parse command-line again; those options are prioritized over config
     conf.parse(argc, argv);
 
+    logger::enable_json(conf.has("log-json"));
+    if (auto rc = select_reactor(argv); rc != 0) {
+        return rc;
+    }
+
+    std::unique_ptr<libvirt> backend;
+    try {
+        backend = virt::make_backend(conf.get<std::string>("libvirt-backend"));
+    } catch (const std::exception &exc) {
+        return errorln(exc.what(), 1);
+    }
+    if (backend) {
+        libvirt::change(*backend);
+    }
+
     const auto socket_path = conf.get<std::string>("socket");
     config::change(conf);
+    try {
+        for (const char *lane : { "read", "write" }) {
+            thread::fair_executor::options::configured(lane);
+        }
+    } catch (const std::exception &exc) {
+        return errorln(exc.what(), 1);
+    }
     auto &io_context = state::ref().io;
-    return webvirt_main(io_context, socket_path);
+    state::ref().recorder.resize(conf.get<unsigned>("flight-recorder"));
+    boost::asio::signal_set usr1_signals(io_context, SIGUSR1);
+    webvirt::signal::usr1(usr1_signals);
+
+    logger::start(conf.get<unsigned>("log-buffer"));
+    auto rc = webvirt_main(io_context, socket_path);
+    logger::stop();
+    if (backend) {
+        libvirt::reset();
+    }
+    return rc;
 }
@@ -52,6 +52,8 @@ public:
                 (connect_ptr, int));
     MOCK_METHOD(domain_ptr, virDomainLookupByName,
                 (connect_ptr, const char *));
+    MOCK_METHOD(domain_ptr, virDomainLookupByUUIDString,
+                (connect_ptr, const char *));
     MOCK_METHOD(int, virDomainCreate, (domain_ptr));
     MOCK_METHOD(int, virConnectDomainEventRegisterAny,
                 (webvirt::connect *, webvirt::domain *, int,
@@ -67,14 +69,15 @@ public:
                 (domain_ptr, int, const char *, const char *, const char *,
                  unsigned int));
     MOCK_METHOD(int, virDomainShutdown, (domain_ptr));
-    MOCK_METHOD(std::string, virDomainGetXMLDesc, (domain_ptr, int));
+    MOCK_METHOD(c_string, virDomainGetXMLDesc, (domain_ptr, int));
     MOCK_METHOD(int, virDomainGetState, (domain_ptr, int *, int *, int));
     MOCK_METHOD(int, virDomainGetID, (domain_ptr));
     MOCK_METHOD(const char *, virDomainGetName, (domain_ptr));
+    MOCK_METHOD(std::string, virDomainGetUUIDString, (domain_ptr));
     MOCK_METHOD(domain_ptr, virDomainDefineXML, (connect_ptr, const char *));
 
-    MOCK_METHOD(std::string, virNetworkGetXMLDesc,
-                (network_ptr, unsigned int));
+    MOCK_METHOD(const char *, virNetworkGetName, (network_ptr));
+    MOCK_METHOD(c_string, virNetworkGetXMLDesc, (network_ptr, unsigned int));
 
     MOCK_METHOD(int, virEventRegisterDefaultImpl, ());
     MOCK_METHOD(int, virEventRunDefaultImpl, ());
@@ -16,6 +16,7 @@
 #ifndef STATE_HPP
 #define STATE_HPP
 
+#include <http/flight_recorder.hpp>
 #include <http/io_context.hpp>
 #include <singleton.hpp>
 
@@ -28,6 +29,9 @@ class state : public singleton<state>
 public:
     /** Priamry io_context used for socket processing */
     http::io_context io;
+
+    /** Recently handled requests */
+    http::flight_recorder recorder;
 };
 
 }; // namespace webvirt
@@ -51,6 +51,13 @@ char *virConnectGetHostname(webvirt::connect *)
     return make_cstring("test");
 }
 
+int virDomainGetUUIDString(domain *, char *buf)
+{
+    strncpy(buf, "00000000-0000-0000-0000-000000000000",
+            VIR_UUID_STRING_BUFLEN);
+    return 0;
+}
+
 int virConnectGetLibVersion(webvirt::connect *, unsigned long *version)
 {
     *version = 0;
@@ -114,6 +121,11 @@ domain *virDomainLookupByName(connect *, const char *)
     return nullptr;
 }
 
+domain *virDomainLookupByUUIDString(connect *, const char *)
+{
+    return nullptr;
+}
+
 int virDomainCreate(domain *)
 {
     return 0;
@@ -200,6 +212,11 @@ int virDomainShutdown(domain *)
     return 0;
 }
 
+const char *virNetworkGetName(webvirt::network *)
+{
+    return "test";
+}
+
 char *virNetworkGetXMLDesc(webvirt::network *, unsigned int)
 {
     return make_cstring("");
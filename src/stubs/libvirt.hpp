@@ -35,6 +35,19 @@ enum virDomainEventType : int {
     VIR_DOMAIN_EVENT_CRASHED,
 };
 
+enum virDomainEventDefinedDetailType : int {
+    VIR_DOMAIN_EVENT_DEFINED_ADDED,
+    VIR_DOMAIN_EVENT_DEFINED_UPDATED,
+};
+
+enum virDomainEventStartedDetailType : int {
+    VIR_DOMAIN_EVENT_STARTED_BOOTED,
+};
+
+enum virDomainEventStoppedDetailType : int {
+    VIR_DOMAIN_EVENT_STOPPED_SHUTDOWN,
+};
+
 enum virDomainEventID : int {
     VIR_DOMAIN_EVENT_ID_LIFECYCLE,
     VIR_DOMAIN_EVENT_ID_REBOOT,
@@ -65,6 +78,8 @@ enum virDomainEventID : int {
     VIR_DOMAIN_EVENT_ID_MEMORY_DEVICE_SIZE_CHANGE,
 };
 
+#define VIR_UUID_STRING_BUFLEN 37
+
 #define VIR_DOMAIN_EVENT_CALLBACK(callback)                                   \
     reinterpret_cast<void (*)(                                                \
         webvirt::connect *, webvirt::domain *, void *)>(callback)
@@ -80,6 +95,21 @@ enum virDomainState : int {
     VIR_DOMAIN_PMSUSPENDED,
 };
 
+enum virConnectListAllDomainsFlags : unsigned int {
+    VIR_CONNECT_LIST_DOMAINS_ACTIVE = 1 << 0,
+    VIR_CONNECT_LIST_DOMAINS_INACTIVE = 1 << 1,
+    VIR_CONNECT_LIST_DOMAINS_PERSISTENT = 1 << 2,
+    VIR_CONNECT_LIST_DOMAINS_TRANSIENT = 1 << 3,
+    VIR_CONNECT_LIST_DOMAINS_RUNNING = 1 << 4,
+    VIR_CONNECT_LIST_DOMAINS_PAUSED = 1 << 5,
+    VIR_CONNECT_LIST_DOMAINS_SHUTOFF = 1 << 6,
+    VIR_CONNECT_LIST_DOMAINS_OTHER = 1 << 7,
+    VIR_CONNECT_LIST_DOMAINS_MANAGEDSAVE = 1 << 8,
+    VIR_CONNECT_LIST_DOMAINS_NO_MANAGEDSAVE = 1 << 9,
+    VIR_CONNECT_LIST_DOMAINS_AUTOSTART = 1 << 10,
+    VIR_CONNECT_LIST_DOMAINS_NO_AUTOSTART = 1 << 11,
+};
+
 enum metadataType : int {
     VIR_DOMAIN_METADATA_TITLE,
     VIR_DOMAIN_METADATA_DESCRIPTION,
@@ -110,6 +140,8 @@ int virConnectClose(webvirt::connect *);
 
 // virDomain
 webvirt::domain *virDomainLookupByName(webvirt::connect *, const char *);
+webvirt::domain *virDomainLookupByUUIDString(webvirt::connect *,
+                                             const char *);
 int virDomainCreate(webvirt::domain *);
 int virDomainRef(webvirt::domain *);
 int virConnectDomainEventRegisterAny(webvirt::connect *, webvirt::domain *,
@@ -122,6 +154,7 @@ int virConnectDomainEventDeregisterAny(webvirt::connect *, int);
 int virDomainGetState(webvirt::domain *, int *, int *, int);
 int virDomainGetID(webvirt::domain *);
 char *virDomainGetName(webvirt::domain *);
+int virDomainGetUUIDString(webvirt::domain *, char *);
 int virDomainGetAutostart(webvirt::domain *, int *);
 int virDomainSetAutostart(webvirt::domain *, int);
 char *virDomainGetMetadata(webvirt::domain *, int, const char *, unsigned int);
@@ -135,6 +168,7 @@ int virDomainShutdown(webvirt::domain *);
 int virDomainFree(webvirt::domain *);
 
 // virNetwork
+const char *virNetworkGetName(webvirt::network *);
 char *virNetworkGetXMLDesc(webvirt::network *, unsigned int);
 int virNetworkFree(webvirt::network *);
 
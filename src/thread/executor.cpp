@@ -0,0 +1,127 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <thread/executor.hpp>
+#include <util/config.hpp>
+#include <util/logging.hpp>
+
+#include <algorithm>
+
+using namespace webvirt::thread;
+
+static std::size_t configured_size()
+{
+    auto &conf = webvirt::config::ref();
+    if (conf.has("fan-out-threads")) {
+        return std::max(conf.get<unsigned>("fan-out-threads"), 1u);
+    }
+    return executor::default_threads;
+}
+
+executor::executor(std::size_t size, std::size_t share)
+    : size_(size)
+    , share_(share)
+{
+}
+
+executor::~executor()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &thread : threads_) {
+        thread.join();
+    }
+}
+
+std::size_t executor::size() const
+{
+    const std::size_t size = size_;
+    return size ? size : configured_size();
+}
+
+std::size_t executor::fan_out()
+{
+    auto &conf = webvirt::config::ref();
+    if (conf.has("fan-out")) {
+        return std::max(conf.get<unsigned>("fan-out"), 1u);
+    }
+    return default_fan_out;
+}
+
+std::size_t executor::acquire(const std::string &user, std::size_t wanted)
+{
+    // Like size_, the share may be configured after construction.
+    const auto share = share_ ? share_ : fan_out() - 1;
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &held = held_[user];
+    auto granted = std::min(wanted, share - std::min(held, share));
+    held += granted;
+    if (!held) {
+        held_.erase(user);
+    }
+    return granted;
+}
+
+void executor::release(const std::string &user)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = held_.find(user);
+    if (it != held_.end() && !--it->second) {
+        held_.erase(it);
+    }
+}
+
+void executor::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (threads_.empty()) {
+            const std::size_t threads = size();
+            size_ = threads;
+            for (std::size_t i = 0; i < threads; ++i) {
+                threads_.emplace_back(std::bind(&executor::loop, this));
+            }
+        }
+        tasks_.emplace(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void executor::loop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopped_ || !tasks_.empty(); });
+            if (stopped_) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+
+        try {
+            task();
+        } catch (const std::exception &exc) {
+            logger::error(fmt::format("Executor task failed: {}", exc.what()));
+        }
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef THREAD_EXECUTOR_HPP
+#define THREAD_EXECUTOR_HPP
+
+#include <singleton.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace webvirt::thread
+{
+
+/** A fixed-size pool of threads running posted tasks
+ *
+ * Used to issue independent, blocking libvirt calls concurrently; see
+ * thread::parallel_map. Threads are started on the first post().
+ *
+ * Helper threads are charged to the user whose request they work for:
+ * a user holds at most `share` of them at once, across all of their
+ * requests, so that one user's fan-out cannot take every thread.
+ **/
+class executor : public singleton<executor>
+{
+public:
+    /** Default number of threads */
+    static constexpr std::size_t default_threads = 32;
+
+    /** Default number of concurrent calls within a request */
+    static constexpr std::size_t default_fan_out = 8;
+
+private:
+    // Fixed by the first post(); read by size() without the lock.
+    std::atomic<std::size_t> size_;
+    const std::size_t share_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::queue<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    // user -> helpers held
+    std::map<std::string, std::size_t> held_;
+    bool stopped_ { false };
+
+public:
+    /** Construct an executor
+     *
+     * @param size Number of threads; 0 reads the "fan-out-threads" option
+     * @param share Helpers held by a user at once; 0 uses fan_out() - 1
+     **/
+    executor(std::size_t size = 0, std::size_t share = 0);
+
+    /** Stop and join all threads; tasks still queued are dropped */
+    ~executor();
+
+    /** Return the number of threads
+     *
+     * @returns Number of threads
+     **/
+    std::size_t size() const;
+
+    /** Return the configured number of concurrent calls within a request
+     *
+     * Read from the "fan-out" option.
+     *
+     * @returns Maximum number of items a request processes at once
+     **/
+    static std::size_t fan_out();
+
+    /** Acquire helper threads for one of a user's requests
+     *
+     * @param user Name of the user
+     * @param wanted Number of helpers wanted
+     * @returns Number of helpers granted, at most `wanted`; each must be
+     *          given back with release()
+     **/
+    std::size_t acquire(const std::string &user, std::size_t wanted);
+
+    /** Give back a helper acquired for a user
+     *
+     * @param user Name of the user
+     **/
+    void release(const std::string &user);
+
+    /** Queue a task
+     *
+     * @param task Function run on one of the executor's threads
+     **/
+    void post(std::function<void()> task);
+
+private:
+    void loop();
+};
+
+}; // namespace webvirt::thread
+
+#endif /* THREAD_EXECUTOR_HPP */
@@ -0,0 +1,279 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <thread/fair_executor.hpp>
+#include <util/config.hpp>
+#include <util/logging.hpp>
+#include <util/metrics.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace webvirt;
+using namespace webvirt::thread;
+
+// Weight of the latest run time in fair_executor::service_
+static constexpr double service_alpha = 0.2;
+
+static metrics::gauge &queue_gauge(const std::string &lane,
+                                   const std::string &user)
+{
+    return metrics::registry::ref().gauge(
+        "webvirtd_user_queue_depth",
+        "Requests waiting for a libvirt thread",
+        { { "lane", lane }, { "user", user } });
+}
+
+static metrics::gauge &running_gauge(const std::string &lane,
+                                     const std::string &user)
+{
+    return metrics::registry::ref().gauge(
+        "webvirtd_user_requests_running",
+        "Requests running on a libvirt thread",
+        { { "lane", lane }, { "user", user } });
+}
+
+fair_executor::options
+fair_executor::options::configured(const std::string &lane)
+{
+    options opts;
+    opts.lane = lane;
+
+    auto &conf = config::ref();
+    const auto threads = lane + "-threads";
+    if (conf.has(threads.c_str())) {
+        opts.threads = std::max(conf.get<unsigned>(threads.c_str()), 1u);
+    }
+    if (conf.has("user-concurrency")) {
+        opts.user_concurrency =
+            std::max(conf.get<unsigned>("user-concurrency"), 1u);
+    }
+    if (conf.has("user-queue")) {
+        opts.user_queue = conf.get<unsigned>("user-queue");
+        if (!opts.user_queue) {
+            // A queue of zero would refuse every request.
+            throw std::invalid_argument("user-queue must be at least 1");
+        }
+    }
+    if (conf.has("user-weight")) {
+        for (const auto &pair :
+             conf.get<std::vector<std::string>>("user-weight")) {
+            auto pos = pair.find('=');
+            if (pos == std::string::npos || pos == 0) {
+                throw std::invalid_argument(fmt::format(
+                    "invalid user weight '{}'; expected user=weight", pair));
+            }
+
+            double weight = 0;
+            try {
+                std::size_t end = 0;
+                const auto value = pair.substr(pos + 1);
+                weight = std::stod(value, &end);
+                if (end != value.size()) {
+                    weight = 0;
+                }
+            } catch (const std::logic_error &) {
+            }
+            if (!(weight > 0)) {
+                throw std::invalid_argument(fmt::format(
+                    "invalid user weight '{}'; weights must be positive",
+                    pair));
+            }
+            opts.weights[pair.substr(0, pos)] = weight;
+        }
+    }
+
+    return opts;
+}
+
+fair_executor::fair_executor()
+    : fair_executor(options())
+{
+}
+
+fair_executor::fair_executor(const options &opts)
+    : options_(opts)
+{
+    options_.threads = std::max<std::size_t>(options_.threads, 1);
+    options_.user_concurrency =
+        std::max<std::size_t>(options_.user_concurrency, 1);
+}
+
+fair_executor::~fair_executor()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &thread : threads_) {
+        thread.join();
+    }
+}
+
+std::size_t fair_executor::size() const
+{
+    return options_.threads;
+}
+
+const std::string &fair_executor::lane() const
+{
+    return options_.lane;
+}
+
+bool fair_executor::post(const std::string &user, std::function<void()> fn)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (threads_.empty()) {
+            for (std::size_t i = 0; i < options_.threads; ++i) {
+                threads_.emplace_back(std::bind(&fair_executor::loop, this));
+            }
+        }
+
+        auto &flow = flows_[user];
+        if (flow.queue.size() >= options_.user_queue) {
+            metrics::registry::ref()
+                .counter("webvirtd_user_requests_rejected_total",
+                         "Requests refused because the user's queue was "
+                         "full",
+                         { { "lane", options_.lane }, { "user", user } })
+                .inc();
+            if (flow.queue.empty() && !flow.running) {
+                flows_.erase(user);
+            }
+            return false;
+        }
+
+        const double tag = std::max(vtime_, flow.finish);
+        flow.finish = tag + 1.0 / weight(user);
+        flow.queue.push_back(
+            { std::move(fn), tag, std::chrono::steady_clock::now() });
+        queue_gauge(options_.lane, user).set(flow.queue.size());
+    }
+    cv_.notify_one();
+    return true;
+}
+
+std::chrono::seconds fair_executor::retry_after(const std::string &user)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    std::size_t queued = 0;
+    if (auto it = flows_.find(user); it != flows_.end()) {
+        queued = it->second.queue.size();
+    }
+
+    // Every user_concurrency tasks drain in about one run time.
+    const double rounds =
+        static_cast<double>(queued) / options_.user_concurrency + 1;
+    const auto seconds = static_cast<long>(std::ceil(rounds * service_));
+    return std::chrono::seconds(std::max(seconds, 1l));
+}
+
+std::size_t fair_executor::queued(const std::string &user)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = flows_.find(user);
+    return it != flows_.end() ? it->second.queue.size() : 0;
+}
+
+double fair_executor::weight(const std::string &user) const
+{
+    auto it = options_.weights.find(user);
+    return it != options_.weights.end() ? it->second : 1.0;
+}
+
+std::map<std::string, fair_executor::flow>::iterator fair_executor::next()
+{
+    auto best = flows_.end();
+    for (auto it = flows_.begin(); it != flows_.end(); ++it) {
+        auto &flow = it->second;
+        if (flow.queue.empty() ||
+            flow.running >= options_.user_concurrency) {
+            continue;
+        }
+        if (best == flows_.end() ||
+            flow.queue.front().tag < best->second.queue.front().tag) {
+            best = it;
+        }
+    }
+    return best;
+}
+
+void fair_executor::loop()
+{
+    while (true) {
+        std::map<std::string, flow>::iterator it;
+        task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this, &it] {
+                return stopped_ || (it = next()) != flows_.end();
+            });
+            if (stopped_) {
+                return;
+            }
+
+            auto &flow = it->second;
+            task = std::move(flow.queue.front());
+            flow.queue.pop_front();
+            ++flow.running;
+            vtime_ = task.tag;
+
+            queue_gauge(options_.lane, it->first).set(flow.queue.size());
+            running_gauge(options_.lane, it->first).set(flow.running);
+        }
+
+        const auto started = std::chrono::steady_clock::now();
+        metrics::registry::ref()
+            .histogram("webvirtd_user_queue_wait_seconds",
+                       "Time requests waited for a libvirt thread",
+                       { { "lane", options_.lane }, { "user", it->first } })
+            .observe(std::chrono::duration<double>(started - task.queued)
+                         .count());
+
+        try {
+            task.fn();
+        } catch (const std::exception &exc) {
+            logger::error(
+                fmt::format("Fair executor task failed: {}", exc.what()));
+        } catch (...) {
+            logger::error("Fair executor task failed: unknown exception");
+        }
+        task.fn = nullptr;
+
+        const double elapsed = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - started)
+                                   .count();
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            service_ = service_
+                           ? service_ + service_alpha * (elapsed - service_)
+                           : elapsed;
+
+            auto &flow = it->second;
+            running_gauge(options_.lane, it->first).set(--flow.running);
+            if (flow.queue.empty() && !flow.running) {
+                flows_.erase(it);
+            }
+        }
+        // A slot of this user's concurrency may be all another thread
+        // was waiting for.
+        cv_.notify_all();
+    }
+}
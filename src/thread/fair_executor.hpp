@@ -0,0 +1,161 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef THREAD_FAIR_EXECUTOR_HPP
+#define THREAD_FAIR_EXECUTOR_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace webvirt::thread
+{
+
+/** A pool of threads running tasks fairly across users
+ *
+ * Tasks are posted on behalf of a user. Each user may have at most
+ * `user_concurrency` tasks running and `user_queue` tasks waiting;
+ * post() refuses tasks beyond that, so one user cannot fill the pool
+ * for everyone else.
+ *
+ * Waiting tasks are dispatched by start-time fair queuing: a task is
+ * tagged with the virtual time its user's previous task finishes, plus
+ * 1 / weight of its user, and the lowest tag runs first. Users with a
+ * higher weight are therefore served proportionally more often.
+ *
+ * Threads are started on the first post().
+ **/
+class fair_executor
+{
+public:
+    /** Default number of threads */
+    static constexpr std::size_t default_threads = 16;
+
+    /** Default number of tasks run concurrently for a user */
+    static constexpr std::size_t default_user_concurrency = 4;
+
+    /** Default number of tasks waiting for a user */
+    static constexpr std::size_t default_user_queue = 64;
+
+    /** fair_executor options */
+    struct options {
+        // Name labelling this executor's metrics
+        std::string lane { "default" };
+        std::size_t threads { default_threads };
+        std::size_t user_concurrency { default_user_concurrency };
+        std::size_t user_queue { default_user_queue };
+        // user -> weight; users not listed weigh 1
+        std::map<std::string, double> weights;
+
+        /** Read options of a lane from config
+         *
+         * Reads "<lane>-threads", "user-concurrency", "user-queue" and
+         * "user-weight", whose values are "user=weight" pairs.
+         *
+         * @param lane Lane name
+         * @throws std::invalid_argument When a user weight is invalid, or
+         * the user queue is 0
+         * @returns Configured options
+         **/
+        static options configured(const std::string &lane);
+    };
+
+private:
+    struct task {
+        std::function<void()> fn;
+        double tag;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    struct flow {
+        std::deque<task> queue;
+        std::size_t running { 0 };
+        // Virtual finish time of the last task queued
+        double finish { 0 };
+    };
+
+    options options_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::string, flow> flows_;
+    double vtime_ { 0 };
+    // Moving average of task run time in seconds
+    double service_ { 0 };
+    std::vector<std::thread> threads_;
+    bool stopped_ { false };
+
+public:
+    /** Construct a fair_executor with default options */
+    fair_executor();
+
+    /** Construct a fair_executor
+     *
+     * @param opts Options
+     **/
+    explicit fair_executor(const options &opts);
+
+    /** Stop and join all threads; tasks still queued are dropped */
+    ~fair_executor();
+
+    /** Return the number of threads
+     *
+     * @returns Number of threads
+     **/
+    std::size_t size() const;
+
+    /** Return the lane name
+     *
+     * @returns Lane name
+     **/
+    const std::string &lane() const;
+
+    /** Queue a task on behalf of a user
+     *
+     * @param user Name of the user the task runs for
+     * @param task Function run on one of the executor's threads
+     * @returns False if the user's queue is full and task was dropped
+     **/
+    bool post(const std::string &user, std::function<void()> task);
+
+    /** Estimate how long until a user's queue has room again
+     *
+     * @param user Name of the user
+     * @returns Estimated delay, at least one second
+     **/
+    std::chrono::seconds retry_after(const std::string &user);
+
+    /** Return the number of tasks waiting for a user
+     *
+     * @param user Name of the user
+     * @returns Number of tasks waiting
+     **/
+    std::size_t queued(const std::string &user);
+
+private:
+    double weight(const std::string &user) const;
+    std::map<std::string, flow>::iterator next();
+    void loop();
+};
+
+}; // namespace webvirt::thread
+
+#endif /* THREAD_FAIR_EXECUTOR_HPP */
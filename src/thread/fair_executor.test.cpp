@@ -0,0 +1,266 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <thread/fair_executor.hpp>
+#include <util/config.hpp>
+#include <util/metrics.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace webvirt;
+
+namespace
+{
+
+// Holds a fair_executor's only thread until released, so that tasks
+// posted meanwhile are queued.
+struct blocker {
+    std::promise<void> started, released;
+    std::shared_future<void> release { released.get_future() };
+
+    void block(thread::fair_executor &executor, const std::string &user)
+    {
+        executor.post(user, [this, release = release] {
+            started.set_value();
+            release.wait();
+        });
+        started.get_future().wait();
+    }
+};
+
+thread::fair_executor::options single_thread()
+{
+    thread::fair_executor::options opts;
+    opts.threads = 1;
+    opts.user_concurrency = 1;
+    return opts;
+}
+
+}; // namespace
+
+TEST(fair_executor, post)
+{
+    thread::fair_executor executor;
+    EXPECT_EQ(executor.size(), thread::fair_executor::default_threads);
+
+    std::atomic<int> ran { 0 };
+    std::promise<void> done;
+    for (int i = 0; i < 50; ++i) {
+        executor.post(i % 2 ? "a" : "b", [&] {
+            if (++ran == 50) {
+                done.set_value();
+            }
+        });
+    }
+    done.get_future().wait();
+    EXPECT_EQ(ran, 50);
+}
+
+TEST(fair_executor, user_concurrency)
+{
+    thread::fair_executor::options opts;
+    opts.threads = 8;
+    opts.user_concurrency = 2;
+    thread::fair_executor executor(opts);
+
+    std::atomic<int> running { 0 }, most { 0 }, ran { 0 };
+    std::promise<void> done;
+    for (int i = 0; i < 20; ++i) {
+        executor.post("a", [&] {
+            int now = ++running;
+            int prev = most;
+            while (now > prev && !most.compare_exchange_weak(prev, now)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            --running;
+            if (++ran == 20) {
+                done.set_value();
+            }
+        });
+    }
+    done.get_future().wait();
+    EXPECT_LE(most, 2);
+}
+
+TEST(fair_executor, user_queue)
+{
+    auto opts = single_thread();
+    opts.user_queue = 2;
+    thread::fair_executor executor(opts);
+
+    blocker blocker;
+    blocker.block(executor, "a");
+
+    EXPECT_TRUE(executor.post("a", [] {}));
+    EXPECT_TRUE(executor.post("a", [] {}));
+    EXPECT_FALSE(executor.post("a", [] {}));
+    EXPECT_EQ(executor.queued("a"), 2);
+    EXPECT_GE(executor.retry_after("a"), std::chrono::seconds(1));
+
+    // Other users have queues of their own.
+    EXPECT_TRUE(executor.post("b", [] {}));
+
+    blocker.released.set_value();
+}
+
+TEST(fair_executor, fairness)
+{
+    thread::fair_executor executor(single_thread());
+
+    blocker blocker;
+    blocker.block(executor, "a");
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+    std::promise<void> done;
+    auto task = [&](const std::string &user) {
+        return [&, user] {
+            std::lock_guard<std::mutex> guard(mutex);
+            order.emplace_back(user);
+            if (order.size() == 20) {
+                done.set_value();
+            }
+        };
+    };
+
+    // "a" queues all of its work before "b" queues any.
+    for (int i = 0; i < 10; ++i) {
+        executor.post("a", task("a"));
+    }
+    for (int i = 0; i < 10; ++i) {
+        executor.post("b", task("b"));
+    }
+
+    blocker.released.set_value();
+    done.get_future().wait();
+
+    // "b" is not starved behind "a"; the two take turns.
+    auto half = order.begin() + 10;
+    EXPECT_EQ(std::count(order.begin(), half, "b"), 5);
+}
+
+TEST(fair_executor, weights)
+{
+    auto opts = single_thread();
+    opts.weights["a"] = 3;
+    thread::fair_executor executor(opts);
+
+    blocker blocker;
+    blocker.block(executor, "c");
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+    std::promise<void> done;
+    auto task = [&](const std::string &user) {
+        return [&, user] {
+            std::lock_guard<std::mutex> guard(mutex);
+            order.emplace_back(user);
+            if (order.size() == 24) {
+                done.set_value();
+            }
+        };
+    };
+
+    for (int i = 0; i < 12; ++i) {
+        executor.post("a", task("a"));
+        executor.post("b", task("b"));
+    }
+
+    blocker.released.set_value();
+    done.get_future().wait();
+
+    auto first = order.begin() + 8;
+    EXPECT_EQ(std::count(order.begin(), first, "a"), 6);
+}
+
+TEST(fair_executor, lanes)
+{
+    auto opts = single_thread();
+    opts.lane = "write";
+    thread::fair_executor write(opts);
+    opts.lane = "read";
+    thread::fair_executor read(opts);
+
+    // A busy write lane does not hold up reads.
+    blocker blocker;
+    blocker.block(write, "a");
+    std::promise<void> done;
+    read.post("a", [&done] { done.set_value(); });
+    EXPECT_EQ(done.get_future().wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+    blocker.released.set_value();
+
+    EXPECT_EQ(read.lane(), "read");
+    auto text = metrics::registry::ref().serialize();
+    EXPECT_NE(text.find(R"(lane="write",user="a")"), std::string::npos);
+}
+
+TEST(fair_executor, configured)
+{
+    config conf;
+    conf.add_option("write-threads",
+                    boost::program_options::value<unsigned>(),
+                    "threads");
+    conf.add_option("user-weight",
+                    boost::program_options::value<std::vector<std::string>>()
+                        ->multitoken(),
+                    "weights");
+    config::change(conf);
+
+    const char *argv[] = { "webvirtd",        "--write-threads",
+                           "4",               "--user-weight",
+                           "alice=2",         "bob=0.5" };
+    conf.parse(6, argv);
+    auto opts = thread::fair_executor::options::configured("write");
+    EXPECT_EQ(opts.lane, "write");
+    EXPECT_EQ(opts.threads, 4);
+    EXPECT_EQ(opts.user_concurrency,
+              thread::fair_executor::default_user_concurrency);
+    EXPECT_EQ(opts.weights.at("alice"), 2);
+    EXPECT_EQ(opts.weights.at("bob"), 0.5);
+
+    for (const char *weight : { "alice", "=2", "alice=0", "alice=x" }) {
+        config bad;
+        bad.add_option(
+            "user-weight",
+            boost::program_options::value<std::vector<std::string>>()
+                ->multitoken(),
+            "weights");
+        config::change(bad);
+        const char *args[] = { "webvirtd", "--user-weight", weight };
+        bad.parse(3, args);
+        EXPECT_THROW(thread::fair_executor::options::configured("read"),
+                     std::invalid_argument);
+    }
+
+    config zero;
+    zero.add_option(
+        "user-queue", boost::program_options::value<unsigned>(), "queue");
+    config::change(zero);
+    const char *args[] = { "webvirtd", "--user-queue", "0" };
+    zero.parse(3, args);
+    EXPECT_THROW(thread::fair_executor::options::configured("read"),
+                 std::invalid_argument);
+
+    config::reset();
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef THREAD_PARALLEL_HPP
+#define THREAD_PARALLEL_HPP
+
+#include <thread/executor.hpp>
+#include <util/deadline.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace webvirt::thread
+{
+
+/** Map a function over items concurrently, keeping their order
+ *
+ * At most `limit` items are processed at once: the calling thread and
+ * up to `limit - 1` tasks posted to `executor` take turns claiming the
+ * next unprocessed item. Helper tasks are charged to `user`, and only
+ * as many are posted as executor::acquire() grants; with none, the
+ * caller processes every item itself. Since the caller claims items
+ * too, this never waits on the executor to pick up a task, and nesting
+ * it within an executor task cannot deadlock.
+ *
+ * If `fn` throws, the remaining items are still processed and the first
+ * exception is rethrown once all claimed items are done.
+ *
+ * Helpers work within the caller's deadline. Once it passes, remaining
+ * items are skipped and deadline::exceeded is thrown.
+ *
+ * @param executor Executor running helper tasks
+ * @param user Name of the user helper tasks are charged to
+ * @param items Items to map
+ * @param fn Function mapping an item to its result
+ * @param limit Maximum number of concurrently processed items
+ * @returns Results of `fn`, in the order of `items`
+ **/
+template <typename T, typename Func>
+auto parallel_map(executor &executor, const std::string &user,
+                  const std::vector<T> &items, Func fn, std::size_t limit)
+    -> std::vector<decltype(fn(std::declval<const T &>()))>
+{
+    using result_type = decltype(fn(std::declval<const T &>()));
+
+    // Helpers may outlive this call; everything they touch is shared.
+    struct state {
+        const std::vector<T> items;
+        Func fn;
+        std::vector<result_type> results;
+        std::atomic<std::size_t> next { 0 };
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::size_t done { 0 };
+        std::exception_ptr error;
+
+        const deadline::clock::time_point time { deadline::current() };
+
+        state(const std::vector<T> &items, Func fn)
+            : items(items)
+            , fn(std::move(fn))
+            , results(items.size())
+        {
+        }
+
+        void work()
+        {
+            deadline::scope scope(time);
+
+            std::size_t i;
+            while ((i = next++) < items.size()) {
+                std::exception_ptr exc;
+                try {
+                    deadline::check();
+                    results[i] = fn(items[i]);
+                } catch (...) {
+                    exc = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> guard(mutex);
+                if (exc && !error) {
+                    error = exc;
+                }
+                if (++done == items.size()) {
+                    cv.notify_all();
+                }
+            }
+        }
+    };
+
+    std::size_t helpers = 0;
+    if (items.size() > 1 && limit > 1) {
+        helpers = executor.acquire(user, std::min(limit, items.size()) - 1);
+    }
+
+    if (!helpers) {
+        std::vector<result_type> results;
+        results.reserve(items.size());
+        for (const auto &item : items) {
+            deadline::check();
+            results.emplace_back(fn(item));
+        }
+        return results;
+    }
+
+    auto shared = std::make_shared<state>(items, std::move(fn));
+    for (std::size_t i = 0; i < helpers; ++i) {
+        executor.post([shared, &executor, user] {
+            shared->work();
+            executor.release(user);
+        });
+    }
+    shared->work();
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->cv.wait(lock, [&shared] {
+        return shared->done == shared->items.size();
+    });
+    if (shared->error) {
+        std::rethrow_exception(shared->error);
+    }
+    return std::move(shared->results);
+}
+
+}; // namespace webvirt::thread
+
+#endif /* THREAD_PARALLEL_HPP */
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <thread/parallel.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace webvirt;
+
+TEST(parallel, map)
+{
+    thread::executor executor(4);
+
+    std::vector<int> items;
+    for (int i = 0; i < 100; ++i) {
+        items.emplace_back(i);
+    }
+
+    std::atomic<int> running { 0 }, most { 0 };
+    auto results = thread::parallel_map(
+        executor,
+        "test",
+        items,
+        [&](int item) {
+            int now = ++running;
+            int prev = most;
+            while (now > prev && !most.compare_exchange_weak(prev, now)) {
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            --running;
+            return std::to_string(item * 2);
+        },
+        3);
+
+    ASSERT_EQ(results.size(), items.size());
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        EXPECT_EQ(results[i], std::to_string(items[i] * 2));
+    }
+    EXPECT_LE(most, 3);
+}
+
+TEST(parallel, sequential)
+{
+    thread::executor executor(4);
+    std::vector<int> items { 1, 2, 3 };
+
+    auto caller = std::this_thread::get_id();
+    auto results = thread::parallel_map(
+        executor,
+        "test",
+        items,
+        [caller](int item) {
+            EXPECT_EQ(std::this_thread::get_id(), caller);
+            return item;
+        },
+        1);
+    EXPECT_EQ(results, items);
+}
+
+TEST(parallel, exception)
+{
+    thread::executor executor(2);
+    std::vector<int> items { 1, 2, 3, 4 };
+
+    std::atomic<int> calls { 0 };
+    EXPECT_THROW(thread::parallel_map(
+                     executor,
+                     "test",
+                     items,
+                     [&calls](int item) {
+                         ++calls;
+                         if (item == 2) {
+                             throw std::runtime_error("error");
+                         }
+                         return item;
+                     },
+                     2),
+                 std::runtime_error);
+    EXPECT_EQ(calls, 4);
+}
+
+TEST(parallel, deadline)
+{
+    thread::executor executor(2);
+    std::vector<int> items { 1, 2, 3, 4 };
+
+    std::atomic<int> calls { 0 };
+    deadline::scope scope(deadline::clock::now() - std::chrono::seconds(1));
+    for (std::size_t limit : { 1, 2 }) {
+        EXPECT_THROW(thread::parallel_map(
+                         executor,
+                         "test",
+                         items,
+                         [&calls](int item) {
+                             ++calls;
+                             return item;
+                         },
+                         limit),
+                     deadline::exceeded);
+    }
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(parallel, user_share)
+{
+    // Each user may hold one helper at a time
+    thread::executor executor(4, 1);
+    EXPECT_EQ(executor.acquire("test", 3), 1);
+    EXPECT_EQ(executor.acquire("test", 3), 0);
+    EXPECT_EQ(executor.acquire("other", 3), 1);
+
+    // With its share taken, a user's items are mapped by the caller
+    std::vector<int> items { 1, 2, 3 };
+    auto caller = std::this_thread::get_id();
+    auto results = thread::parallel_map(
+        executor,
+        "test",
+        items,
+        [caller](int item) {
+            EXPECT_EQ(std::this_thread::get_id(), caller);
+            return item;
+        },
+        3);
+    EXPECT_EQ(results, items);
+
+    executor.release("test");
+    EXPECT_EQ(executor.acquire("test", 3), 1);
+}
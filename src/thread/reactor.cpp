@@ -0,0 +1,79 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <thread/reactor.hpp>
+#include <util/logging.hpp>
+
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace webvirt::thread;
+
+reactor::reactor()
+    : work_(boost::asio::make_work_guard(io_))
+{
+}
+
+reactor::~reactor()
+{
+    stop();
+}
+
+webvirt::http::io_context &reactor::io()
+{
+    return io_;
+}
+
+void reactor::start(std::size_t cpu)
+{
+    thread_ = std::thread(std::bind(&reactor::loop, this, cpu));
+}
+
+void reactor::stop()
+{
+    work_.reset();
+    io_.boost::asio::io_context::stop();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::shared_ptr<void> reactor::lease()
+{
+    ++connections_;
+    // Points at the reactor rather than null, so the lease tests true.
+    return std::shared_ptr<void>(this, [this](void *) {
+        --connections_;
+    });
+}
+
+std::size_t reactor::connections() const
+{
+    return connections_;
+}
+
+void reactor::loop(std::size_t cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+        logger::error(fmt::format(
+            "Unable to pin reactor to CPU {}: {}", cpu, std::strerror(rc)));
+    }
+
+    io_.run();
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef THREAD_REACTOR_HPP
+#define THREAD_REACTOR_HPP
+
+#include <http/io_context.hpp>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace webvirt::thread
+{
+
+/** An io_context of its own, run by a single pinned thread
+ *
+ * In multi-reactor mode, http::server hands each accepted connection to
+ * one of several reactors, where it stays; its handlers then contend
+ * only with other connections of the same reactor.
+ **/
+class reactor
+{
+private:
+    http::io_context io_;
+    boost::asio::executor_work_guard<http::io_context::executor_type> work_;
+    std::thread thread_;
+    std::atomic<std::size_t> connections_ { 0 };
+
+public:
+    /** Construct a reactor */
+    reactor();
+
+    /** Stop and join the reactor's thread */
+    ~reactor();
+
+    /** Return the reactor's io_context
+     *
+     * @returns Reference to internal io_context
+     **/
+    http::io_context &io();
+
+    /** Start the reactor's thread
+     *
+     * @param cpu CPU to pin the thread to; pinning failures are logged
+     **/
+    void start(std::size_t cpu);
+
+    /** Stop the reactor's io_context and join its thread */
+    void stop();
+
+    /** Count a connection against this reactor
+     *
+     * @returns Lease; the connection is counted until it is released
+     **/
+    std::shared_ptr<void> lease();
+
+    /** Return the number of leased connections
+     *
+     * @returns Number of connections
+     **/
+    std::size_t connections() const;
+
+private:
+    void loop(std::size_t cpu);
+};
+
+}; // namespace webvirt::thread
+
+#endif /* THREAD_REACTOR_HPP */
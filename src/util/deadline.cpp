@@ -0,0 +1,51 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <util/deadline.hpp>
+
+using namespace webvirt;
+using namespace webvirt::deadline;
+
+static thread_local clock::time_point current_deadline =
+    clock::time_point::max();
+
+clock::time_point deadline::current()
+{
+    return current_deadline;
+}
+
+bool deadline::expired()
+{
+    return current_deadline != clock::time_point::max() &&
+           clock::now() >= current_deadline;
+}
+
+void deadline::check()
+{
+    if (expired()) {
+        throw exceeded("Request deadline exceeded");
+    }
+}
+
+scope::scope(clock::time_point time)
+    : previous_(current_deadline)
+{
+    current_deadline = time;
+}
+
+scope::~scope()
+{
+    current_deadline = previous_;
+}
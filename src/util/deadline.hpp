@@ -0,0 +1,70 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef UTIL_DEADLINE_HPP
+#define UTIL_DEADLINE_HPP
+
+#include <chrono>
+#include <stdexcept>
+
+namespace webvirt::deadline
+{
+
+using clock = std::chrono::steady_clock;
+
+/** Thrown by check() once the current deadline has passed */
+struct exceeded : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/** Return the deadline of the request this thread is working on
+ *
+ * @returns Current deadline, or clock::time_point::max() outside of any
+ *          deadline::scope
+ **/
+clock::time_point current();
+
+/** Return whether the current deadline has passed
+ *
+ * @returns True if the current deadline has passed
+ **/
+bool expired();
+
+/** Stop work on a request whose deadline has passed
+ *
+ * Called before each unit of blocking work, so that requests nobody is
+ * waiting for anymore stop consuming libvirt.
+ *
+ * @throws deadline::exceeded When the current deadline has passed
+ **/
+void check();
+
+/** Make a deadline current for this thread
+ *
+ * Scopes nest; the previous deadline is restored on destruction.
+ **/
+class scope
+{
+private:
+    clock::time_point previous_;
+
+public:
+    scope(clock::time_point);
+    ~scope();
+};
+
+}; // namespace webvirt::deadline
+
+#endif /* UTIL_DEADLINE_HPP */
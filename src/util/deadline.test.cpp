@@ -0,0 +1,42 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <util/deadline.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace webvirt;
+
+TEST(deadline, scope)
+{
+    EXPECT_EQ(deadline::current(), deadline::clock::time_point::max());
+    EXPECT_FALSE(deadline::expired());
+    EXPECT_NO_THROW(deadline::check());
+
+    const auto later = deadline::clock::now() + std::chrono::hours(1);
+    const auto earlier = deadline::clock::now() - std::chrono::seconds(1);
+    {
+        deadline::scope outer(later);
+        EXPECT_EQ(deadline::current(), later);
+        EXPECT_FALSE(deadline::expired());
+        {
+            deadline::scope inner(earlier);
+            EXPECT_TRUE(deadline::expired());
+            EXPECT_THROW(deadline::check(), deadline::exceeded);
+        }
+        EXPECT_EQ(deadline::current(), later);
+    }
+    EXPECT_EQ(deadline::current(), deadline::clock::time_point::max());
+}
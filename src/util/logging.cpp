@@ -15,28 +15,69 @@
  */
 #include <util/config.hpp>
 #include <util/logging.hpp>
+#include <util/ring_buffer.hpp>
 
+#include <cctype>
+#include <condition_variable>
+#include <ctime>
 #include <fmt/format.h>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 using namespace webvirt;
 
 std::atomic<bool> logger::debug_ { false };
 std::atomic<bool> logger::time_ { true };
+std::atomic<bool> logger::json_ { false };
+
+struct logger::record {
+    std::ostream *os { nullptr };
+    const char *level { nullptr };
+    std::string message;
+    std::time_t time { 0 };
+};
+
+struct logger::async_state {
+    std::atomic<bool> enabled { false };
+    // Threads between checking `enabled` and finishing their push.
+    std::atomic<std::size_t> producers { 0 };
+
+    std::unique_ptr<ring_buffer<record>> buffer;
+    std::thread thread;
+    bool running { false };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<bool> sleeping { false };
+
+    std::atomic<std::uint64_t> pushed { 0 };
+    std::atomic<std::uint64_t> written { 0 };
+    std::atomic<std::uint64_t> dropped { 0 };
+    std::uint64_t reported { 0 };
+
+    ~async_state()
+    {
+        logger::stop();
+    }
+};
+
+logger::async_state logger::async_;
 
 void logger::info(const std::string &message)
 {
-    return print(std::cout, "[INFO]", message);
+    return print(std::cout, "info", message);
 }
 
 void logger::error(const std::string &message)
 {
-    return print(std::cerr, "[ERROR]", message);
+    return print(std::cerr, "error", message);
 }
 
 void logger::debug(const std::string &message)
 {
     if (debug_) {
-        print(std::cout, "[DEBUG]", message);
+        print(std::cout, "debug", message);
     }
 }
 
@@ -67,25 +108,211 @@ void logger::reset_debug()
     enable_debug(false);
 }
 
-std::string logger::timestamp()
+void logger::enable_json(bool enabled)
+{
+    json_ = enabled;
+}
+
+void logger::reset_json()
+{
+    enable_json(false);
+}
+
+namespace
+{
+
+/** Timestamps formatted for the current second, cached per thread */
+struct timestamps {
+    std::time_t time { -1 };
+    char text[std::size("dd/Mon/yyyy hh:mm:ss")];
+    char iso[std::size("yyyy-mm-ddThh:mm:ss+zzzz")];
+
+    void update(std::time_t now)
+    {
+        if (now == time) {
+            return;
+        }
+
+        std::tm tm;
+        localtime_r(&now, &tm);
+        std::strftime(text, std::size(text), "%d/%b/%Y %H:%M:%S", &tm);
+        std::strftime(iso, std::size(iso), "%Y-%m-%dT%H:%M:%S%z", &tm);
+        time = now;
+    }
+};
+
+thread_local timestamps cached_timestamps;
+
+void append_json_string(std::string &output, const std::string &str)
+{
+    output.push_back('"');
+    for (unsigned char c : str) {
+        switch (c) {
+        case '"':
+            output.append("\\\"");
+            break;
+        case '\\':
+            output.append("\\\\");
+            break;
+        case '\n':
+            output.append("\\n");
+            break;
+        case '\r':
+            output.append("\\r");
+            break;
+        case '\t':
+            output.append("\\t");
+            break;
+        default:
+            if (c < 0x20) {
+                output.append(fmt::format("\\u{:04x}", c));
+            } else {
+                output.push_back(c);
+            }
+        }
+    }
+    output.push_back('"');
+}
+
+}; // namespace
+
+void logger::start(std::size_t capacity)
+{
+    if (capacity == 0 || async_.enabled) {
+        return;
+    }
+
+    async_.buffer = std::make_unique<ring_buffer<record>>(capacity);
+    async_.running = true;
+    async_.thread = std::thread(&logger::drain);
+    async_.enabled = true;
+}
+
+void logger::stop()
 {
-    auto now = std::time({});
-    char format[std::size("dd/Mon/yyyy hh:mm:ss")];
-    std::strftime(std::data(format),
-                  std::size(format),
-                  "%d/%b/%Y %H:%M:%S",
-                  std::localtime(&now));
-    return format;
+    if (!async_.enabled) {
+        return;
+    }
+
+    async_.enabled = false;
+    while (async_.producers) {
+        std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(async_.mutex);
+        async_.running = false;
+    }
+    async_.cv.notify_one();
+    async_.thread.join();
+    async_.buffer.reset();
 }
 
-void logger::print(std::ostream &os, const std::string &prefix,
+void logger::flush()
+{
+    while (async_.written < async_.pushed) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+std::uint64_t logger::dropped()
+{
+    return async_.dropped;
+}
+
+void logger::print(std::ostream &os, const char *level,
                    const std::string &message)
 {
-    std::string ts;
+    record rec { &os, level, message, std::time(nullptr) };
+
+    if (async_.enabled) {
+        ++async_.producers;
+        if (async_.enabled) {
+            ++async_.pushed;
+            if (async_.buffer->push(rec)) {
+                if (async_.sleeping) {
+                    async_.cv.notify_one();
+                }
+            } else {
+                --async_.pushed;
+                ++async_.dropped;
+            }
+            --async_.producers;
+            return;
+        }
+        --async_.producers;
+    }
+
+    write(rec);
+}
+
+void logger::write(const record &rec)
+{
+    auto &ts = cached_timestamps;
     if (time_) {
-        ts = "[" + timestamp() + "] ";
+        ts.update(rec.time);
+    }
+
+    std::string line;
+    if (json_) {
+        line.append("{");
+        if (time_) {
+            line.append(fmt::format("\"time\":\"{}\",", ts.iso));
+        }
+        line.append(fmt::format("\"level\":\"{}\",\"message\":",
+                                rec.level));
+        append_json_string(line, rec.message);
+        line.append("}\n");
+    } else {
+        if (time_) {
+            line.append(fmt::format("[{}] ", ts.text));
+        }
+        line.push_back('[');
+        for (const char *c = rec.level; *c; ++c) {
+            line.push_back(std::toupper(static_cast<unsigned char>(*c)));
+        }
+        line.append(fmt::format("] {}\n", rec.message));
+    }
+    *rec.os << line;
+}
+
+void logger::drain()
+{
+    for (;;) {
+        bool wrote = false;
+        while (auto rec = async_.buffer->pop()) {
+            write(*rec);
+            ++async_.written;
+            wrote = true;
+        }
+
+        if (wrote) {
+            if (auto dropped = async_.dropped.load();
+                dropped != async_.reported) {
+                write({ &std::cerr,
+                        "error",
+                        fmt::format("{} log records dropped",
+                                    dropped - async_.reported),
+                        std::time(nullptr) });
+                async_.reported = dropped;
+            }
+            std::cout.flush();
+            std::cerr.flush();
+        }
+
+        std::unique_lock<std::mutex> lock(async_.mutex);
+        if (!async_.running && async_.written == async_.pushed) {
+            break;
+        }
+
+        // Producers only notify while the writer sleeps; the timeout
+        // bounds the delay of a notification racing with this wait.
+        async_.sleeping = true;
+        async_.cv.wait_for(lock, std::chrono::milliseconds(50), [] {
+            return !async_.running || async_.written != async_.pushed;
+        });
+        async_.sleeping = false;
     }
-    os << fmt::format("{}{} {}\n", ts, prefix, message);
 }
 
 std::string webvirt::pretty_function_prefix(const std::string &pretty_function)
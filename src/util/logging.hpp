@@ -18,6 +18,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <fmt/format.h>
 #include <functional>
 #include <iostream>
@@ -31,6 +32,7 @@ class logger
 private:
     static std::atomic<bool> debug_;
     static std::atomic<bool> time_;
+    static std::atomic<bool> json_;
 
 public:
     static void info(const std::string &);
@@ -44,10 +46,44 @@ public:
     static void enable_debug(bool);
     static void reset_debug();
 
+    /** Log one JSON object per line instead of plain text
+     *
+     * @param enabled Whether to log JSON
+     **/
+    static void enable_json(bool);
+    static void reset_json();
+
+    /** Write log records from a background thread
+     *
+     * Records are pushed into a lock-free ring buffer of `capacity`
+     * records, which a background thread drains to stdout and stderr.
+     * When the buffer is full, records are dropped and counted rather
+     * than blocking the caller.
+     *
+     * @param capacity Ring buffer capacity; 0 keeps logging synchronous
+     **/
+    static void start(std::size_t capacity);
+
+    /** Write out queued records and return to synchronous logging */
+    static void stop();
+
+    /** Wait until all queued records have been written */
+    static void flush();
+
+    /** Return the number of records dropped because the buffer was full
+     *
+     * @returns Dropped record count
+     **/
+    static std::uint64_t dropped();
+
 private:
-    static std::string timestamp();
-    static void print(std::ostream &, const std::string &,
-                      const std::string &);
+    struct record;
+    struct async_state;
+    static async_state async_;
+
+    static void print(std::ostream &, const char *, const std::string &);
+    static void write(const record &);
+    static void drain();
 };
 
 /** Extract 'namespace::classname' from __PRETTY_FUNCTION__ text
@@ -77,3 +77,75 @@ TEST_F(logger_test, enable_timestamp)
     output = testing::internal::GetCapturedStdout();
     EXPECT_TRUE(std::regex_search(output, re));
 }
+
+TEST_F(logger_test, json)
+{
+    logger::enable_json(true);
+    logger::enable_timestamp(false);
+
+    testing::internal::CaptureStdout();
+    logger::info("Test \"quoted\"\n");
+    std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(output,
+              "{\"level\":\"info\",\"message\":\"Test \\\"quoted\\\"\\n\"}\n");
+
+    logger::reset_timestamp();
+    testing::internal::CaptureStdout();
+    logger::info("Test");
+    output = testing::internal::GetCapturedStdout();
+    std::regex re(
+        R"(^\{"time":"[0-9]{4}-[0-9]{2}-[0-9]{2}T[0-9:]{8}[+-][0-9]{4}",)");
+    EXPECT_TRUE(std::regex_search(output, re));
+
+    logger::reset_json();
+}
+
+TEST_F(logger_test, async)
+{
+    logger::start(64);
+
+    testing::internal::CaptureStdout();
+    logger::info("First");
+    logger::debug("Second");
+    logger::flush();
+    std::string output = testing::internal::GetCapturedStdout();
+    auto first = output.find("[INFO] First");
+    auto second = output.find("[DEBUG] Second");
+    EXPECT_NE(first, std::string::npos);
+    EXPECT_NE(second, std::string::npos);
+    EXPECT_LT(first, second);
+
+    logger::stop();
+}
+
+TEST_F(logger_test, async_drops)
+{
+    logger::enable_timestamp(false);
+    logger::start(2);
+
+    // A full buffer drops records instead of blocking; every record is
+    // either written or counted as dropped.
+    constexpr std::size_t count = 10000;
+    auto dropped = logger::dropped();
+    testing::internal::CaptureStdout();
+    for (std::size_t i = 0; i < count; ++i) {
+        logger::info("Test");
+    }
+    logger::stop();
+    std::string output = testing::internal::GetCapturedStdout();
+
+    std::size_t lines = 0;
+    for (auto pos = output.find("[INFO] Test\n"); pos != std::string::npos;
+         pos = output.find("[INFO] Test\n", pos + 1)) {
+        ++lines;
+    }
+    EXPECT_EQ(lines + (logger::dropped() - dropped), count);
+
+    // Synchronous logging resumes once stopped.
+    testing::internal::CaptureStdout();
+    logger::info("Test");
+    output = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(output, "[INFO] Test\n");
+
+    logger::reset_timestamp();
+}
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <util/metrics.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include <stdexcept>
+
+using namespace webvirt::metrics;
+
+static std::string format_labels(const std::string &labels,
+                                 const std::string &extra = std::string())
+{
+    if (labels.empty() && extra.empty()) {
+        return std::string();
+    }
+    if (labels.empty() || extra.empty()) {
+        return fmt::format("{{{}{}}}", labels, extra);
+    }
+    return fmt::format("{{{},{}}}", labels, extra);
+}
+
+void counter::inc(std::uint64_t n)
+{
+    value_.fetch_add(n, std::memory_order_relaxed);
+}
+
+void counter::set(std::uint64_t value)
+{
+    value_.store(value, std::memory_order_relaxed);
+}
+
+std::uint64_t counter::value() const
+{
+    return value_.load(std::memory_order_relaxed);
+}
+
+void counter::serialize(std::string &output, const std::string &name,
+                        const std::string &labels) const
+{
+    output.append(
+        fmt::format("{}{} {}\n", name, format_labels(labels), value()));
+}
+
+void gauge::inc(std::int64_t n)
+{
+    value_.fetch_add(n, std::memory_order_relaxed);
+}
+
+void gauge::dec(std::int64_t n)
+{
+    value_.fetch_sub(n, std::memory_order_relaxed);
+}
+
+void gauge::set(std::int64_t value)
+{
+    value_.store(value, std::memory_order_relaxed);
+}
+
+std::int64_t gauge::value() const
+{
+    return value_.load(std::memory_order_relaxed);
+}
+
+void gauge::serialize(std::string &output, const std::string &name,
+                      const std::string &labels) const
+{
+    output.append(
+        fmt::format("{}{} {}\n", name, format_labels(labels), value()));
+}
+
+const std::array<double, histogram::num_buckets> &histogram::bounds()
+{
+    static const auto bounds_ = [] {
+        std::array<double, num_buckets> bounds;
+        for (std::size_t i = 0; i < num_buckets; ++i) {
+            bounds[i] = 50e-6 * std::pow(2.0, i / 2.0);
+        }
+        return bounds;
+    }();
+    return bounds_;
+}
+
+void histogram::observe(double seconds)
+{
+    const auto &bounds_ = bounds();
+    auto it = std::lower_bound(bounds_.begin(), bounds_.end(), seconds);
+    buckets_[it - bounds_.begin()].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    auto ns = static_cast<std::uint64_t>(std::max(seconds, 0.0) * 1e9);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+}
+
+std::uint64_t histogram::count() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+double histogram::sum() const
+{
+    return sum_ns_.load(std::memory_order_relaxed) / 1e9;
+}
+
+void histogram::serialize(std::string &output, const std::string &name,
+                          const std::string &labels) const
+{
+    const auto &bounds_ = bounds();
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < num_buckets; ++i) {
+        cumulative += buckets_[i].load(std::memory_order_relaxed);
+        output.append(fmt::format(
+            "{}_bucket{} {}\n",
+            name,
+            format_labels(labels, fmt::format("le=\"{:g}\"", bounds_[i])),
+            cumulative));
+    }
+    cumulative += buckets_[num_buckets].load(std::memory_order_relaxed);
+    output.append(fmt::format("{}_bucket{} {}\n",
+                              name,
+                              format_labels(labels, "le=\"+Inf\""),
+                              cumulative));
+    output.append(
+        fmt::format("{}_sum{} {:g}\n", name, format_labels(labels), sum()));
+    output.append(
+        fmt::format("{}_count{} {}\n", name, format_labels(labels), count()));
+}
+
+template <typename T>
+T &registry::get(const std::string &name, const std::string &help,
+                 const labels &labels)
+{
+    auto key = render(labels);
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &family = families_[name];
+    if (family.type.empty()) {
+        family.type = T::type;
+        family.help = help;
+    } else if (family.type != T::type) {
+        throw std::logic_error(fmt::format(
+            "metric {} is a {}, not a {}", name, family.type, T::type));
+    }
+
+    auto &metric = family.metrics[key];
+    if (!metric) {
+        metric = std::make_unique<T>();
+    }
+    return static_cast<T &>(*metric);
+}
+
+counter &registry::counter(const std::string &name, const std::string &help,
+                           const labels &labels)
+{
+    return get<metrics::counter>(name, help, labels);
+}
+
+gauge &registry::gauge(const std::string &name, const std::string &help,
+                       const labels &labels)
+{
+    return get<metrics::gauge>(name, help, labels);
+}
+
+histogram &registry::histogram(const std::string &name,
+                               const std::string &help, const labels &labels)
+{
+    return get<metrics::histogram>(name, help, labels);
+}
+
+std::size_t registry::add_collector(collector fn)
+{
+    std::lock_guard<std::mutex> guard(collectors_mutex_);
+    auto id = next_collector_++;
+    collectors_.emplace(id, std::move(fn));
+    return id;
+}
+
+void registry::remove_collector(std::size_t id)
+{
+    std::lock_guard<std::mutex> guard(collectors_mutex_);
+    collectors_.erase(id);
+}
+
+std::string registry::serialize()
+{
+    {
+        std::lock_guard<std::mutex> guard(collectors_mutex_);
+        for (auto &[_, collect] : collectors_) {
+            collect(*this);
+        }
+    }
+
+    std::string output;
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (const auto &[name, family] : families_) {
+        output.append(fmt::format("# HELP {} {}\n", name, family.help));
+        output.append(fmt::format("# TYPE {} {}\n", name, family.type));
+        for (const auto &[labels, metric] : family.metrics) {
+            metric->serialize(output, name, labels);
+        }
+    }
+    return output;
+}
+
+std::string webvirt::metrics::render(const labels &labels)
+{
+    std::string output;
+    for (const auto &[name, value] : labels) {
+        if (!output.empty()) {
+            output.push_back(',');
+        }
+        output.append(name);
+        output.append("=\"");
+        for (char c : value) {
+            switch (c) {
+            case '\\':
+                output.append("\\\\");
+                break;
+            case '"':
+                output.append("\\\"");
+                break;
+            case '\n':
+                output.append("\\n");
+                break;
+            default:
+                output.push_back(c);
+            }
+        }
+        output.push_back('"');
+    }
+    return output;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef UTIL_METRICS_HPP
+#define UTIL_METRICS_HPP
+
+#include <singleton.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace webvirt::metrics
+{
+
+/** Metric labels, as name/value pairs */
+using labels = std::vector<std::pair<std::string, std::string>>;
+
+/** Base of all metric types */
+class metric
+{
+public:
+    virtual ~metric() = default;
+
+    /** Append this metric's samples in Prometheus text format
+     *
+     * @param output Output string
+     * @param name Metric family name
+     * @param labels Rendered labels, without braces
+     **/
+    virtual void serialize(std::string &output, const std::string &name,
+                           const std::string &labels) const = 0;
+};
+
+/** A monotonically increasing count */
+class counter : public metric
+{
+private:
+    std::atomic<std::uint64_t> value_ { 0 };
+
+public:
+    static constexpr const char *type = "counter";
+
+    void inc(std::uint64_t n = 1);
+
+    /** Mirror a count which is kept elsewhere
+     *
+     * @param value Current count
+     **/
+    void set(std::uint64_t value);
+
+    std::uint64_t value() const;
+
+    void serialize(std::string &, const std::string &,
+                   const std::string &) const override;
+};
+
+/** A value which goes up and down */
+class gauge : public metric
+{
+private:
+    std::atomic<std::int64_t> value_ { 0 };
+
+public:
+    static constexpr const char *type = "gauge";
+
+    void inc(std::int64_t n = 1);
+    void dec(std::int64_t n = 1);
+    void set(std::int64_t value);
+    std::int64_t value() const;
+
+    void serialize(std::string &, const std::string &,
+                   const std::string &) const override;
+};
+
+/** A distribution of durations, in seconds
+ *
+ * Buckets are log-linear, two per power of two, from 50µs up to about
+ * 37s, so relative error stays bounded across the whole range. Every
+ * observation is a handful of relaxed atomic increments.
+ **/
+class histogram : public metric
+{
+public:
+    static constexpr const char *type = "histogram";
+    static constexpr std::size_t num_buckets = 40;
+
+    /** Return upper bounds of the histogram's buckets
+     *
+     * @returns Bucket upper bounds, in seconds
+     **/
+    static const std::array<double, num_buckets> &bounds();
+
+private:
+    // One extra bucket for observations above the last bound.
+    std::array<std::atomic<std::uint64_t>, num_buckets + 1> buckets_ {};
+    std::atomic<std::uint64_t> count_ { 0 };
+    std::atomic<std::uint64_t> sum_ns_ { 0 };
+
+public:
+    /** Record an observation
+     *
+     * @param seconds Observed duration, in seconds
+     **/
+    void observe(double seconds);
+
+    std::uint64_t count() const;
+    double sum() const;
+
+    void serialize(std::string &, const std::string &,
+                   const std::string &) const override;
+};
+
+/** A registry of metric families
+ *
+ * Metrics are created on first use and live as long as the registry,
+ * so references to them may be kept to skip later lookups.
+ **/
+class registry : public singleton<registry>
+{
+public:
+    using collector = std::function<void(registry &)>;
+
+private:
+    struct family {
+        std::string type;
+        std::string help;
+        // rendered labels -> metric
+        std::map<std::string, std::unique_ptr<metric>> metrics;
+    };
+
+    std::mutex mutex_;
+    std::map<std::string, family> families_;
+
+    std::mutex collectors_mutex_;
+    std::size_t next_collector_ { 0 };
+    std::map<std::size_t, collector> collectors_;
+
+public:
+    /** Find or create a metric
+     *
+     * @param name Metric family name
+     * @param help Description of the metric family
+     * @param labels Labels of the metric within its family
+     * @returns Reference to the metric
+     **/
+    metrics::counter &counter(const std::string &name,
+                              const std::string &help, const labels & = {});
+    metrics::gauge &gauge(const std::string &name, const std::string &help,
+                          const labels & = {});
+    metrics::histogram &histogram(const std::string &name,
+                                  const std::string &help,
+                                  const labels & = {});
+
+    /** Add a function updating metrics right before serialization
+     *
+     * @param fn Collector function
+     * @returns Collector id, to be passed to remove_collector
+     **/
+    std::size_t add_collector(collector fn);
+
+    /** Remove a collector
+     *
+     * @param id Collector id returned by add_collector
+     **/
+    void remove_collector(std::size_t id);
+
+    /** Serialize all metrics in Prometheus text exposition format
+     *
+     * @returns Prometheus text exposition
+     **/
+    std::string serialize();
+
+private:
+    template <typename T>
+    T &get(const std::string &name, const std::string &help,
+           const labels &labels);
+};
+
+/** Render labels in Prometheus text format, without braces
+ *
+ * @param labels Labels
+ * @returns Rendered labels, e.g. method="GET",status="200"
+ **/
+std::string render(const labels &);
+
+}; // namespace webvirt::metrics
+
+#endif /* UTIL_METRICS_HPP */
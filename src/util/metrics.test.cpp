@@ -0,0 +1,111 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <util/metrics.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace webvirt;
+
+class metrics_test : public testing::Test
+{
+protected:
+    metrics::registry registry_;
+
+public:
+    void SetUp() override
+    {
+        metrics::registry::change(registry_);
+    }
+
+    void TearDown() override
+    {
+        metrics::registry::reset();
+    }
+};
+
+TEST_F(metrics_test, counter)
+{
+    auto &counter = metrics::registry::ref().counter(
+        "requests_total", "Requests", { { "method", "GET" } });
+    counter.inc();
+    counter.inc(2);
+
+    // The same name and labels yield the same metric.
+    auto &same = registry_.counter(
+        "requests_total", "Requests", { { "method", "GET" } });
+    EXPECT_EQ(&same, &counter);
+    EXPECT_EQ(same.value(), 3);
+
+    auto output = registry_.serialize();
+    EXPECT_NE(output.find("# HELP requests_total Requests\n"),
+              std::string::npos);
+    EXPECT_NE(output.find("# TYPE requests_total counter\n"),
+              std::string::npos);
+    EXPECT_NE(output.find("requests_total{method=\"GET\"} 3\n"),
+              std::string::npos);
+
+    // A name belongs to a single metric type.
+    EXPECT_THROW(registry_.gauge("requests_total", "Requests"),
+                 std::logic_error);
+}
+
+TEST_F(metrics_test, gauge)
+{
+    auto &gauge = registry_.gauge("connections", "Connections");
+    gauge.inc(3);
+    gauge.dec();
+    EXPECT_EQ(gauge.value(), 2);
+    EXPECT_NE(registry_.serialize().find("connections 2\n"),
+              std::string::npos);
+}
+
+TEST_F(metrics_test, histogram)
+{
+    auto &histogram = registry_.histogram("duration_seconds", "Duration");
+    histogram.observe(0.00001);
+    histogram.observe(0.001);
+    histogram.observe(1000.0);
+    EXPECT_EQ(histogram.count(), 3);
+    EXPECT_DOUBLE_EQ(histogram.sum(), 1000.00101);
+
+    auto output = registry_.serialize();
+    EXPECT_NE(output.find("duration_seconds_bucket{le=\"5e-05\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(output.find("duration_seconds_bucket{le=\"0.0016\"} 2\n"),
+              std::string::npos);
+    EXPECT_NE(output.find("duration_seconds_bucket{le=\"+Inf\"} 3\n"),
+              std::string::npos);
+    EXPECT_NE(output.find("duration_seconds_count 3\n"), std::string::npos);
+}
+
+TEST_F(metrics_test, collector)
+{
+    auto id = registry_.add_collector([](auto &registry) {
+        registry.gauge("collected", "Collected").set(42);
+    });
+    EXPECT_NE(registry_.serialize().find("collected 42\n"), std::string::npos);
+
+    registry_.remove_collector(id);
+    registry_.gauge("collected", "Collected").set(0);
+    EXPECT_NE(registry_.serialize().find("collected 0\n"), std::string::npos);
+}
+
+TEST(metrics, render)
+{
+    EXPECT_EQ(metrics::render({}), "");
+    EXPECT_EQ(metrics::render({ { "a", "b" }, { "c", "\"\\\n" } }),
+              "a=\"b\",c=\"\\\"\\\\\\n\"");
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef UTIL_RING_BUFFER_HPP
+#define UTIL_RING_BUFFER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace webvirt
+{
+
+/** A bounded, lock-free multi-producer multi-consumer queue
+ *
+ * Each slot carries a sequence number telling producers and consumers
+ * whose turn it is, so neither side ever blocks: push() fails when the
+ * buffer is full and pop() fails when it is empty.
+ **/
+template <typename T>
+class ring_buffer
+{
+private:
+    struct slot {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    // Keep producer and consumer positions on separate cache lines.
+    static constexpr std::size_t cache_line = 64;
+
+    const std::size_t mask_;
+    std::unique_ptr<slot[]> slots_;
+    alignas(cache_line) std::atomic<std::size_t> head_ { 0 };
+    alignas(cache_line) std::atomic<std::size_t> tail_ { 0 };
+
+    static std::size_t round_up(std::size_t n)
+    {
+        std::size_t size = 2;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+public:
+    /** Construct a ring_buffer
+     *
+     * @param capacity Minimum number of items; rounded up to a power of 2
+     **/
+    explicit ring_buffer(std::size_t capacity)
+        : mask_(round_up(capacity) - 1)
+        , slots_(new slot[mask_ + 1])
+    {
+        for (std::size_t i = 0; i <= mask_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t capacity() const
+    {
+        return mask_ + 1;
+    }
+
+    /** Push an item, unless the buffer is full
+     *
+     * @param value Item to push; left untouched on failure
+     * @returns True if pushed
+     **/
+    bool push(T &value)
+    {
+        auto pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto &s = slots_[pos & mask_];
+            auto seq = s.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    s.value = std::move(value);
+                    s.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** Pop the oldest item, if any
+     *
+     * @returns Oldest item, or std::nullopt if empty
+     **/
+    std::optional<T> pop()
+    {
+        auto pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto &s = slots_[pos & mask_];
+            auto seq = s.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    std::optional<T> value(std::move(s.value));
+                    s.sequence.store(pos + mask_ + 1,
+                                     std::memory_order_release);
+                    return value;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+}; // namespace webvirt
+
+#endif /* UTIL_RING_BUFFER_HPP */
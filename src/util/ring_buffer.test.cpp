@@ -0,0 +1,83 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <util/ring_buffer.hpp>
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace webvirt;
+
+TEST(ring_buffer, push_pop)
+{
+    ring_buffer<int> buffer(3);
+    EXPECT_EQ(buffer.capacity(), 4);
+    EXPECT_FALSE(buffer.pop());
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(buffer.push(i));
+    }
+
+    // A full buffer refuses new items and leaves them untouched.
+    int value = 4;
+    EXPECT_FALSE(buffer.push(value));
+    EXPECT_EQ(value, 4);
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(buffer.pop(), i);
+    }
+    EXPECT_FALSE(buffer.pop());
+
+    // Positions wrap around.
+    EXPECT_TRUE(buffer.push(value));
+    EXPECT_EQ(buffer.pop(), 4);
+}
+
+TEST(ring_buffer, concurrent)
+{
+    constexpr int producers = 4;
+    constexpr int per_producer = 10000;
+    ring_buffer<int> buffer(64);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&buffer] {
+            for (int i = 1; i <= per_producer; ++i) {
+                int value = i;
+                while (!buffer.push(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    long long sum = 0;
+    int popped = 0;
+    while (popped < producers * per_producer) {
+        if (auto value = buffer.pop()) {
+            sum += *value;
+            ++popped;
+        }
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    long long expected = producers * (1LL * per_producer *
+                                      (per_producer + 1) / 2);
+    EXPECT_EQ(sum, expected);
+}
@@ -15,8 +15,11 @@
  */
 #include <state.hpp>
 #include <util/logging.hpp>
+#include <util/json.hpp>
 #include <util/signal.hpp>
 
+#include <fmt/format.h>
+
 using namespace webvirt;
 
 void signal::pipe(int)
@@ -31,3 +34,25 @@ void signal::int_(int)
     auto &io_context = state::ref().io;
     io_context.stop();
 }
+
+void signal::usr1(boost::asio::signal_set &set)
+{
+    set.async_wait([&set](const boost::system::error_code &ec, int) {
+        if (ec) {
+            return;
+        }
+
+        const auto records = state::ref().recorder.serialize();
+        logger::info(fmt::format("Caught SIGUSR1; dumping {} recent requests",
+                                 records.size()));
+        for (const auto &record : records) {
+            auto line = json::stringify(record);
+            if (!line.empty() && line.back() == '\n') {
+                line.pop_back();
+            }
+            logger::info(line);
+        }
+
+        usr1(set);
+    });
+}
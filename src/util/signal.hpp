@@ -16,12 +16,23 @@
 #ifndef UTIL_SIGNAL_HPP
 #define UTIL_SIGNAL_HPP
 
+#include <boost/asio/signal_set.hpp>
+
 namespace webvirt::signal
 {
 
 void pipe(int);
 void int_(int);
 
+/** Log recently handled requests each time SIGUSR1 is delivered
+ *
+ * Asio's signal handler only wakes the io_context owning `set`; the dump
+ * runs there as an ordinary handler, never within a signal handler.
+ *
+ * @param set Signal set registered for SIGUSR1; must outlive the wait
+ **/
+void usr1(boost::asio::signal_set &set);
+
 }; // namespace webvirt::signal
 
 #endif /* UTIL_SIGNAL_HPP */
@@ -13,9 +13,12 @@
  * implied. See the License for the specific language governing
  * permissions and limitations under the License.
  */
+#include <state.hpp>
 #include <util/logging.hpp>
 #include <util/signal.hpp>
 
+#include <chrono>
+#include <csignal>
 #include <gtest/gtest.h>
 
 using namespace webvirt;
@@ -51,3 +54,38 @@ TEST_F(signal_test, sigint)
     std::string output = testing::internal::GetCapturedStdout();
     EXPECT_NE(output.find("Caught SIGINT"), std::string::npos);
 }
+
+TEST_F(signal_test, sigusr1)
+{
+    webvirt::state state;
+    state::change(state);
+
+    auto &recorder = state.recorder;
+    http::flight_recorder::record rec;
+    rec.method = "GET";
+    rec.target = "/recorded/";
+    recorder.add(std::move(rec));
+
+    // The dump runs on the io_context, not in the signal handler.
+    boost::asio::signal_set signals(state.io, SIGUSR1);
+    signal::usr1(signals);
+
+    // Every set registered for a signal is notified of it; once this
+    // one is, the dump is ready to run too.
+    bool delivered = false;
+    boost::asio::signal_set probe(state.io, SIGUSR1);
+    probe.async_wait([&delivered](const auto &, int) {
+        delivered = true;
+    });
+
+    testing::internal::CaptureStdout();
+    std::raise(SIGUSR1);
+    while (!delivered && state.io.run_one_for(std::chrono::seconds(5))) {
+    }
+    state.io.poll();
+    std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_NE(output.find("Caught SIGUSR1"), std::string::npos);
+    EXPECT_NE(output.find("\"target\":\"/recorded/\""), std::string::npos);
+
+    state::reset();
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <util/trace.hpp>
+
+#include <fmt/format.h>
+
+using namespace webvirt;
+using namespace webvirt::trace;
+
+static thread_local context *current_context = nullptr;
+
+void context::add(const std::string &name, double seconds)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto &entry : entries_) {
+        if (entry.name == name) {
+            entry.seconds += seconds;
+            ++entry.count;
+            return;
+        }
+    }
+    entries_.push_back({ name, seconds, 1 });
+}
+
+std::vector<context::entry> context::entries() const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return entries_;
+}
+
+std::string context::server_timing() const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    std::string output;
+    for (const auto &entry : entries_) {
+        if (!output.empty()) {
+            output.append(", ");
+        }
+        output.append(
+            fmt::format("{};dur={:.3f}", entry.name, entry.seconds * 1000));
+        if (entry.count > 1) {
+            output.append(fmt::format(";desc=\"{} spans\"", entry.count));
+        }
+    }
+    return output;
+}
+
+context *trace::current()
+{
+    return current_context;
+}
+
+scope::scope(context *ctx)
+    : previous_(current_context)
+{
+    current_context = ctx;
+}
+
+scope::~scope()
+{
+    current_context = previous_;
+}
+
+span::span(const char *name)
+    : context_(current_context)
+    , name_(name)
+{
+    if (context_) {
+        start_ = std::chrono::steady_clock::now();
+    }
+}
+
+span::~span()
+{
+    if (context_) {
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start_;
+        context_->add(name_, elapsed.count());
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef UTIL_TRACE_HPP
+#define UTIL_TRACE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace webvirt::trace
+{
+
+/** Time spent within a request, broken down by named spans
+ *
+ * Spans of the same name are aggregated. A context may be shared by
+ * threads working on the same request.
+ **/
+class context
+{
+public:
+    /** Time spent in all spans of a name */
+    struct entry {
+        std::string name;
+        double seconds;
+        std::size_t count;
+    };
+
+private:
+    mutable std::mutex mutex_;
+    // In order of first appearance
+    std::vector<entry> entries_;
+
+public:
+    /** Record time spent in a span
+     *
+     * @param name Span name
+     * @param seconds Time spent, in seconds
+     **/
+    void add(const std::string &name, double seconds);
+
+    /** Return recorded spans
+     *
+     * @returns Spans, in order of first appearance
+     **/
+    std::vector<entry> entries() const;
+
+    /** Render spans as a Server-Timing header value
+     *
+     * @returns e.g. connect;dur=0.12, xml;dur=1.03;desc="2 spans"
+     **/
+    std::string server_timing() const;
+};
+
+/** Return the context of the request this thread is working on
+ *
+ * @returns Current context, or nullptr outside of any trace::scope
+ **/
+context *current();
+
+/** Make a context current for this thread
+ *
+ * Scopes nest; the previous context is restored on destruction.
+ **/
+class scope
+{
+private:
+    context *previous_;
+
+public:
+    scope(context *);
+    ~scope();
+};
+
+/** Record the lifetime of this object as a span of the current context */
+class span
+{
+private:
+    context *context_;
+    const char *name_;
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    /** Construct a span
+     *
+     * @param name Span name; must outlive the span
+     **/
+    span(const char *name);
+    ~span();
+};
+
+}; // namespace webvirt::trace
+
+#endif /* UTIL_TRACE_HPP */
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <util/trace.hpp>
+
+#include <gtest/gtest.h>
+#include <regex>
+
+using namespace webvirt;
+
+TEST(trace, server_timing)
+{
+    trace::context context;
+    EXPECT_EQ(context.server_timing(), "");
+
+    context.add("connect", 0.001);
+    context.add("xml", 0.002);
+    context.add("xml", 0.0005);
+    EXPECT_EQ(context.server_timing(),
+              "connect;dur=1.000, xml;dur=2.500;desc=\"2 spans\"");
+}
+
+TEST(trace, scope)
+{
+    EXPECT_EQ(trace::current(), nullptr);
+
+    trace::context outer, inner;
+    {
+        trace::scope outer_scope(&outer);
+        EXPECT_EQ(trace::current(), &outer);
+        {
+            trace::scope inner_scope(&inner);
+            EXPECT_EQ(trace::current(), &inner);
+            trace::span span("inner");
+        }
+        EXPECT_EQ(trace::current(), &outer);
+    }
+    EXPECT_EQ(trace::current(), nullptr);
+
+    EXPECT_EQ(outer.server_timing(), "");
+    std::regex re(R"(^inner;dur=[0-9.]+$)");
+    EXPECT_TRUE(std::regex_match(inner.server_timing(), re));
+
+    // Spans outside of any scope are discarded.
+    trace::span span("discarded");
+}
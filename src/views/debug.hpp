@@ -0,0 +1,44 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef VIEWS_DEBUG_HPP
+#define VIEWS_DEBUG_HPP
+
+#include <http/connection.hpp>
+#include <http/types.hpp>
+
+#include <regex>
+
+namespace webvirt::views
+{
+
+/** HTTP views for diagnosing webvirtd itself */
+class debug
+{
+public:
+    /** Show recently handled requests, most recent first
+     *
+     * @param http_conn HTTP connection
+     * @param location Request URI regex match
+     * @param request http::request
+     * @param response http::response
+     **/
+    void requests(http::connection_ptr, const std::smatch &,
+                  const http::request &, http::response &);
+};
+
+}; // namespace webvirt::views
+
+#endif /* VIEWS_DEBUG_HPP */
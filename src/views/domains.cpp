@@ -15,35 +15,305 @@
  */
 #include <data/domain.hpp>
 #include <http/util.hpp>
+#include <thread/executor.hpp>
 #include <util/json.hpp>
 #include <views/domains.hpp>
+#include <virt/instrumented.hpp>
 #include <virt/util.hpp>
 
+#include <algorithm>
 #include <boost/cast.hpp>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <stdexcept>
 
 using namespace webvirt::views;
 using namespace std::string_literals;
 
-void domains::index(virt::connection &conn, http::connection_ptr,
-                    const std::smatch &, const http::request &,
+// Build a domain field selection from ?fields=, ?include= and ?exclude=
+static webvirt::data::domain_fields
+parse_fields(const webvirt::http::request &request, unsigned int defaults)
+{
+    auto query = webvirt::http::parse_query(request);
+    webvirt::data::domain_fields fields(defaults);
+    fields.select(query["fields"])
+        .include(query["include"])
+        .exclude(query["exclude"]);
+    return fields;
+}
+
+// virConnectListAllDomains filters selected by ?state=
+static const std::map<std::string, unsigned int> STATE_FLAGS = {
+    { "active", VIR_CONNECT_LIST_DOMAINS_ACTIVE },
+    { "inactive", VIR_CONNECT_LIST_DOMAINS_INACTIVE },
+    { "running", VIR_CONNECT_LIST_DOMAINS_RUNNING },
+    { "paused", VIR_CONNECT_LIST_DOMAINS_PAUSED },
+    { "shutoff", VIR_CONNECT_LIST_DOMAINS_SHUTOFF },
+    { "other", VIR_CONNECT_LIST_DOMAINS_OTHER },
+};
+
+// Translate ?state= and ?autostart= into virConnectListAllDomains flags
+static unsigned int parse_list_flags(webvirt::http::query &query)
+{
+    unsigned int flags = 0;
+
+    std::size_t begin = 0;
+    const auto &states = query["state"];
+    while (begin < states.size()) {
+        auto end = std::min(states.find(',', begin), states.size());
+        auto state = states.substr(begin, end - begin);
+        begin = end + 1;
+        if (state.empty()) {
+            continue;
+        }
+
+        auto it = STATE_FLAGS.find(state);
+        if (it == STATE_FLAGS.end()) {
+            throw std::invalid_argument("Invalid state: " + state);
+        }
+        flags |= it->second;
+    }
+
+    const auto &autostart = query["autostart"];
+    if (autostart == "true" || autostart == "1") {
+        flags |= VIR_CONNECT_LIST_DOMAINS_AUTOSTART;
+    } else if (autostart == "false" || autostart == "0") {
+        flags |= VIR_CONNECT_LIST_DOMAINS_NO_AUTOSTART;
+    } else if (!autostart.empty()) {
+        throw std::invalid_argument("Invalid autostart: " + autostart);
+    }
+
+    return flags;
+}
+
+// Position of a domain within a sorted listing
+struct list_key {
+    int id { 0 };
+    std::string name;
+};
+
+// Ordering of domain listings selected by ?sort=
+struct list_order {
+    bool by_id { false };
+    bool descending { false };
+
+    bool operator()(const list_key &a, const list_key &b) const
+    {
+        const auto &lhs = descending ? b : a;
+        const auto &rhs = descending ? a : b;
+        if (by_id && lhs.id != rhs.id) {
+            return lhs.id < rhs.id;
+        }
+        return lhs.name < rhs.name;
+    }
+};
+
+static list_order parse_order(const std::string &sort)
+{
+    list_order order;
+    order.descending = !sort.empty() && sort[0] == '-';
+
+    auto key = sort.substr(order.descending ? 1 : 0);
+    if (key == "id") {
+        order.by_id = true;
+    } else if (!key.empty() && key != "name") {
+        throw std::invalid_argument("Invalid sort: " + sort);
+    }
+
+    return order;
+}
+
+static std::size_t parse_limit(const std::string &limit)
+{
+    if (limit.empty()) {
+        return std::string::npos;
+    }
+
+    std::size_t pos = 0;
+    unsigned long value = 0;
+    try {
+        value = std::stoul(limit, &pos);
+    } catch (const std::logic_error &) {
+    }
+
+    if (pos != limit.size() || limit[0] == '-' || value == 0) {
+        throw std::invalid_argument("Invalid limit: " + limit);
+    }
+    return value;
+}
+
+// Cursors are the hex-encoded key of the last domain in a page
+static std::string encode_cursor(const list_key &key)
+{
+    auto plain = std::to_string(key.id) + ":" + key.name;
+
+    std::string cursor;
+    char hex[3];
+    for (unsigned char c : plain) {
+        std::snprintf(hex, sizeof(hex), "%02x", c);
+        cursor.append(hex);
+    }
+    return cursor;
+}
+
+static list_key decode_cursor(const std::string &cursor)
+{
+    std::string plain;
+    try {
+        if (cursor.size() % 2) {
+            throw std::invalid_argument("odd length");
+        }
+        for (std::size_t i = 0; i < cursor.size(); i += 2) {
+            std::size_t pos = 0;
+            auto byte = std::stoul(cursor.substr(i, 2), &pos, 16);
+            if (pos != 2) {
+                throw std::invalid_argument("invalid digit");
+            }
+            plain.push_back(static_cast<char>(byte));
+        }
+
+        auto sep = plain.find(':');
+        if (sep == std::string::npos) {
+            throw std::invalid_argument("missing separator");
+        }
+
+        std::size_t pos = 0;
+        list_key key;
+        key.id = std::stoi(plain.substr(0, sep), &pos);
+        if (pos != sep) {
+            throw std::invalid_argument("invalid id");
+        }
+        key.name = plain.substr(sep + 1);
+        return key;
+    } catch (const std::logic_error &) {
+        throw std::invalid_argument("Invalid cursor");
+    }
+}
+
+// Respond with a listing of domains
+//
+// Domains are serialized concurrently, each costing a handful of
+// libvirt round trips, whether the listing is then buffered or streamed.
+static void list_domains(webvirt::http::connection_ptr http_conn,
+                         const webvirt::http::request &request,
+                         webvirt::http::response &response,
+                         std::vector<webvirt::virt::domain> domains,
+                         const webvirt::data::domain_fields &fields)
+{
+    using namespace webvirt;
+
+    // Items are serialized on other threads, and a streamed listing
+    // after this handler returns; attribute their libvirt calls and
+    // fan-out to the requesting user.
+    const auto user = virt::instrumented_libvirt::user();
+    http::set_listing(
+        std::move(http_conn),
+        request,
+        response,
+        std::move(domains),
+        [fields, user](const virt::domain &item) {
+            virt::instrumented_libvirt::scope scope(user);
+            virt::domain domain(item);
+            return data::domain(domain, fields);
+        },
+        thread::executor::fan_out(),
+        user);
+}
+
+void domains::index(virt::connection &conn, http::connection_ptr http_conn,
+                    const std::smatch &, const http::request &request,
                     http::response &response)
 {
-    auto domains = conn.domains();
+    auto fields = parse_fields(request, data::domain_fields::simple);
+    auto query = http::parse_query(request);
+
+    unsigned int flags = 0;
+    list_order order;
+    std::size_t limit = std::string::npos;
+    list_key cursor;
+    try {
+        flags = parse_list_flags(query);
+        order = parse_order(query["sort"]);
+        limit = parse_limit(query["limit"]);
+        if (!query["cursor"].empty()) {
+            cursor = decode_cursor(query["cursor"]);
+        }
+    } catch (const std::invalid_argument &exc) {
+        return http::set_response(response,
+                                  json::error(exc.what()),
+                                  beast::http::status::bad_request);
+    }
+
+    auto domains = conn.domains(flags);
 
-    Json::Value data(Json::arrayValue);
+    const auto &prefix = query["name_prefix"];
+    bool listing = !prefix.empty() || !query["sort"].empty() ||
+                   limit != std::string::npos || !query["cursor"].empty();
+    if (!listing) {
+        return list_domains(std::move(http_conn),
+                            request,
+                            response,
+                            std::move(domains),
+                            fields);
+    }
+
+    // Only names, and ids when sorting by them, are read to order the
+    // listing; libvirt caches both on the domain handle. Everything else
+    // is fetched for the returned page alone.
+    std::vector<std::pair<list_key, virt::domain *>> entries;
+    entries.reserve(domains.size());
     for (auto &domain : domains) {
-        data.append(data::simple_domain(domain));
+        list_key key;
+        key.name = domain.name();
+        if (key.name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        if (order.by_id) {
+            key.id = domain.id();
+        }
+        entries.emplace_back(std::move(key), &domain);
+    }
+
+    auto less = [&order](const auto &a, const auto &b) {
+        return order(a.first, b.first);
+    };
+    std::sort(entries.begin(), entries.end(), less);
+
+    auto it = entries.begin();
+    if (!query["cursor"].empty()) {
+        it = std::upper_bound(
+            entries.begin(),
+            entries.end(),
+            cursor,
+            [&order](const list_key &key, const auto &entry) {
+                return order(key, entry.first);
+            });
+    }
+
+    auto remaining = static_cast<std::size_t>(entries.end() - it);
+    auto end = it + std::min(limit, remaining);
+    std::vector<virt::domain> page;
+    page.reserve(end - it);
+    for (auto entry = it; entry != end; ++entry) {
+        page.emplace_back(*entry->second);
     }
 
-    return http::set_response(response, data, beast::http::status::ok);
+    if (end != entries.end() && end != it) {
+        response.set("X-Next-Cursor", encode_cursor(std::prev(end)->first));
+    }
+
+    return list_domains(
+        std::move(http_conn), request, response, std::move(page), fields);
 }
 
 void domains::show(virt::connection &, virt::domain domain,
                    http::connection_ptr, const std::smatch &,
-                   const http::request &, http::response &response)
+                   const http::request &request, http::response &response)
 {
+    auto fields = parse_fields(request, data::domain_fields::all);
     return http::set_response(
-        response, data::domain(domain), beast::http::status::ok);
+        response, data::domain(domain, fields), beast::http::status::ok);
 }
 
 void domains::autostart(virt::connection &, virt::domain domain,
@@ -166,3 +436,15 @@ void domains::shutdown(virt::connection &, virt::domain domain,
     return http::set_response(
         response, data::simple_domain(domain), beast::http::status::ok);
 }
+
+bool domains::index_tagged(const http::request &request)
+{
+    auto fields = parse_fields(request, data::domain_fields::simple);
+    return !fields.has(data::domain_fields::block_info);
+}
+
+bool domains::show_tagged(const http::request &request)
+{
+    auto fields = parse_fields(request, data::domain_fields::all);
+    return !fields.has(data::domain_fields::block_info);
+}
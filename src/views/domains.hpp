@@ -31,6 +31,19 @@ class domains
 {
 public:
     /** List domains
+     *
+     * Supports the following query parameters:
+     * - state: Comma-separated active, inactive, running, paused,
+     *   shutoff or other
+     * - autostart: true or false
+     * - name_prefix: Only list domains whose name starts with this
+     * - sort: name, id, -name or -id
+     * - limit: Maximum number of domains returned
+     * - cursor: X-Next-Cursor header of a previous page
+     *
+     * state and autostart are handed to libvirt as list filters.
+     *
+     * The listing may be streamed; see http::set_listing.
      *
      * @param conn libvirt connection
      * @param http_conn HTTP connection
@@ -116,6 +129,26 @@ public:
     void shutdown(virt::connection &, virt::domain, http::connection_ptr,
                   const std::smatch &, const http::request &,
                   http::response &);
+
+    /** Test whether an index request may be tagged by generation
+     *
+     * Block info reports disk allocation, which changes as guests write
+     * without raising a domain event; representations selecting it are
+     * left untagged. See http::middleware::with_etag.
+     *
+     * @param request http::request
+     * @returns True if the listing only changes along with generations
+     **/
+    static bool index_tagged(const http::request &);
+
+    /** Test whether a show request may be tagged by generation
+     *
+     * As index_tagged(), for the fields produced by show().
+     *
+     * @param request http::request
+     * @returns True if the domain only changes along with its generation
+     **/
+    static bool show_tagged(const http::request &);
 };
 
 }; // namespace webvirt::views
@@ -21,6 +21,7 @@
 #include <virt/domain.hpp>
 
 #include <gtest/gtest.h>
+#include <map>
 
 using namespace webvirt;
 using namespace std::string_literals;
@@ -288,6 +289,346 @@ TEST_F(domains_test, show_cdrom)
     EXPECT_EQ(response_.result(), beast::http::status::ok);
 }
 
+TEST_F(domains_test, show_fields)
+{
+    EXPECT_CALL(lv, virDomainGetName(_)).WillOnce(Return("test"));
+    EXPECT_CALL(lv, virDomainGetState(_, _, _, _))
+        .WillOnce(Invoke([](auto, int *state, int *, int) {
+            *state = VIR_DOMAIN_RUNNING;
+            return 0;
+        }));
+    EXPECT_CALL(lv, virDomainGetID(_)).Times(0);
+    EXPECT_CALL(lv, virDomainGetMetadata(_, _, _, _)).Times(0);
+    EXPECT_CALL(lv, virDomainGetAutostart(_, _)).Times(0);
+    EXPECT_CALL(lv, virDomainGetXMLDesc(_, _)).Times(0);
+    EXPECT_CALL(lv, virDomainGetBlockInfo(_, _, _)).Times(0);
+
+    request_.target("/users/test/domains/test/?fields=name,state");
+    auto location = make_location(R"(^/users/([^/]+)/domains/([^/]+)/$)",
+                                  "/users/test/domains/test/");
+    domain_ptr domain = std::make_shared<webvirt::domain>();
+    views_.show(conn_,
+                virt::domain(domain),
+                http_conn_,
+                location,
+                request_,
+                response_);
+
+    EXPECT_EQ(response_.result(), beast::http::status::ok);
+
+    auto data = json::parse(response_.body());
+    EXPECT_EQ(data.getMemberNames(),
+              std::vector<std::string>({ "name", "state" }));
+    EXPECT_EQ(data["name"]["text"], "test");
+    EXPECT_EQ(data["state"]["attrib"]["string"], "Running");
+}
+
+TEST_F(domains_test, show_xml_fields)
+{
+    EXPECT_CALL(lv, virDomainGetID(_)).Times(0);
+    EXPECT_CALL(lv, virDomainGetBlockInfo(_, _, _)).Times(0);
+
+    auto disk = std::make_tuple("disk"s,
+                                "test_driver"s,
+                                "sata"s,
+                                "/path/to/source.qcow"s,
+                                "vda"s,
+                                "virtio"s);
+    auto buffer = libvirt_domain_xml(1, 2, 1024, 1024, { disk });
+    EXPECT_CALL(lv, virDomainGetXMLDesc(_, _)).WillOnce(Return(buffer));
+
+    request_.target("/users/test/domains/test/?fields=vcpu%2Cdevices");
+    auto location = make_location(R"(^/users/([^/]+)/domains/([^/]+)/$)",
+                                  "/users/test/domains/test/");
+    domain_ptr domain = std::make_shared<webvirt::domain>();
+    views_.show(conn_,
+                virt::domain(domain),
+                http_conn_,
+                location,
+                request_,
+                response_);
+
+    auto data = json::parse(response_.body());
+    EXPECT_EQ(data.getMemberNames(),
+              std::vector<std::string>({ "devices", "vcpu" }));
+    EXPECT_EQ(data["vcpu"]["text"], "2");
+    EXPECT_TRUE(data["devices"]["disk"].isArray());
+    EXPECT_FALSE(data["devices"]["disk"][0].isMember("block_info"));
+}
+
+TEST_F(domains_test, show_exclude_block_info)
+{
+    EXPECT_CALL(lv, virDomainGetMetadata(_, _, _, _)).Times(2);
+    EXPECT_CALL(lv, virDomainGetAutostart(_, _))
+        .WillOnce(Invoke([](auto, int *autostart) {
+            *autostart = 1;
+            return 0;
+        }));
+    EXPECT_CALL(lv, virDomainGetID(_)).WillOnce(Return(1));
+    EXPECT_CALL(lv, virDomainGetName(_)).WillOnce(Return("test"));
+    EXPECT_CALL(lv, virDomainGetState(_, _, _, _))
+        .WillOnce(Invoke([](auto, int *state, int *, int) {
+            *state = VIR_DOMAIN_RUNNING;
+            return 0;
+        }));
+    EXPECT_CALL(lv, virDomainGetBlockInfo(_, _, _)).Times(0);
+
+    auto disk = std::make_tuple("disk"s,
+                                "test_driver"s,
+                                "sata"s,
+                                "/path/to/source.qcow"s,
+                                "vda"s,
+                                "virtio"s);
+    auto buffer = libvirt_domain_xml(1, 2, 1024, 1024, { disk });
+    EXPECT_CALL(lv, virDomainGetXMLDesc(_, _)).WillOnce(Return(buffer));
+
+    request_.target("/users/test/domains/test/?exclude=block_info");
+    auto location = make_location(R"(^/users/([^/]+)/domains/([^/]+)/$)",
+                                  "/users/test/domains/test/");
+    domain_ptr domain = std::make_shared<webvirt::domain>();
+    views_.show(conn_,
+                virt::domain(domain),
+                http_conn_,
+                location,
+                request_,
+                response_);
+
+    auto data = json::parse(response_.body());
+    EXPECT_EQ(data["autostart"].asBool(), true);
+    EXPECT_EQ(data["vcpu"]["text"], "2");
+    EXPECT_FALSE(data["devices"]["disk"][0].isMember("block_info"));
+}
+
+TEST_F(domains_test, index_include)
+{
+    std::vector<domain_ptr> domains;
+    domains.emplace_back(std::make_shared<webvirt::domain>());
+    EXPECT_CALL(lv, virConnectListAllDomains(_, _)).WillOnce(Return(domains));
+
+    EXPECT_CALL(lv, virDomainGetName(_)).WillOnce(Return("test"));
+    EXPECT_CALL(lv, virDomainGetAutostart(_, _))
+        .WillOnce(Invoke([](auto, int *autostart) {
+            *autostart = 1;
+            return 0;
+        }));
+    EXPECT_CALL(lv, virDomainGetID(_)).Times(0);
+    EXPECT_CALL(lv, virDomainGetState(_, _, _, _)).Times(0);
+    EXPECT_CALL(lv, virDomainGetMetadata(_, _, _, _)).Times(0);
+
+    request_.target("/users/test/domains/?fields=name&include=autostart");
+    auto location = make_location(R"(^/users/([^/]+)/domains/$)",
+                                  "/users/test/domains/");
+    views_.index(conn_, http_conn_, location, request_, response_);
+
+    auto array = json::parse(response_.body());
+    ASSERT_EQ(array.size(), 1);
+    EXPECT_EQ(array[0].getMemberNames(),
+              std::vector<std::string>({ "autostart", "name" }));
+    EXPECT_EQ(array[0]["autostart"].asBool(), true);
+}
+
+TEST_F(domains_test, index_include_xml_key)
+{
+    std::vector<domain_ptr> domains;
+    domains.emplace_back(std::make_shared<webvirt::domain>());
+    EXPECT_CALL(lv, virConnectListAllDomains(_, _)).WillOnce(Return(domains));
+    EXPECT_CALL(lv, virDomainGetName(_)).WillOnce(Return("test"));
+    EXPECT_CALL(lv, virDomainGetBlockInfo(_, _, _)).Times(0);
+
+    auto buffer = libvirt_domain_xml(1, 2, 1024, 1024, {});
+    EXPECT_CALL(lv, virDomainGetXMLDesc(_, _)).WillOnce(Return(buffer));
+
+    request_.target("/users/test/domains/?fields=name&include=os");
+    auto location = make_location(R"(^/users/([^/]+)/domains/$)",
+                                  "/users/test/domains/");
+    views_.index(conn_, http_conn_, location, request_, response_);
+
+    auto array = json::parse(response_.body());
+    ASSERT_EQ(array.size(), 1);
+    EXPECT_EQ(array[0].getMemberNames(),
+              std::vector<std::string>({ "name", "os" }));
+}
+
+TEST_F(domains_test, index_include_block_info)
+{
+    std::vector<domain_ptr> domains;
+    domains.emplace_back(std::make_shared<webvirt::domain>());
+    EXPECT_CALL(lv, virConnectListAllDomains(_, _)).WillOnce(Return(domains));
+    EXPECT_CALL(lv, virDomainGetName(_)).WillOnce(Return("test"));
+
+    auto disk = std::make_tuple("disk"s,
+                                "test_driver"s,
+                                "sata"s,
+                                "/path/to/source.qcow"s,
+                                "vda"s,
+                                "virtio"s);
+    auto buffer = libvirt_domain_xml(1, 2, 1024, 1024, { disk });
+    EXPECT_CALL(lv, virDomainGetXMLDesc(_, _)).WillOnce(Return(buffer));
+    auto block_info_ptr = std::make_shared<webvirt::block_info>();
+    EXPECT_CALL(lv, virDomainGetBlockInfo(_, _, _))
+        .WillOnce(Return(block_info_ptr));
+
+    request_.target("/users/test/domains/?fields=name&include=block_info");
+    auto location = make_location(R"(^/users/([^/]+)/domains/$)",
+                                  "/users/test/domains/");
+    views_.index(conn_, http_conn_, location, request_, response_);
+
+    auto array = json::parse(response_.body());
+    ASSERT_EQ(array.size(), 1);
+    EXPECT_EQ(array[0].getMemberNames(),
+              std::vector<std::string>({ "devices", "name" }));
+    EXPECT_TRUE(array[0]["devices"]["disk"][0].isMember("block_info"));
+}
+
+TEST_F(domains_test, index_filter_flags)
+{
+    unsigned int flags = VIR_CONNECT_LIST_DOMAINS_RUNNING |
+                         VIR_CONNECT_LIST_DOMAINS_PAUSED |
+                         VIR_CONNECT_LIST_DOMAINS_AUTOSTART;
+    EXPECT_CALL(lv, virConnectListAllDomains(_, flags))
+        .WillOnce(Return(std::vector<domain_ptr>()));
+
+    request_.target("/users/test/domains/?state=running,paused&autostart=1");
+    auto location = make_location(R"(^/users/([^/]+)/domains/$)",
+                                  "/users/test/domains/");
+    views_.index(conn_, http_conn_, location, request_, response_);
+
+    EXPECT_EQ(response_.result(), beast::http::status::ok);
+    EXPECT_EQ(json::parse(response_.body()).size(), 0);
+}
+
+TEST_F(domains_test, index_invalid_query)
+{
+    EXPECT_CALL(lv, virConnectListAllDomains(_, _)).Times(0);
+
+    auto location = make_location(R"(^/users/([^/]+)/domains/$)",
+                                  "/users/test/domains/");
+    for (auto query : { "state=bogus",
+                        "autostart=maybe",
+                        "sort=title",
+                        "limit=0",
+                        "limit=-1",
+                        "limit=ten",
+                        "cursor=zz" }) {
+        request_.target("/users/test/domains/?"s + query);
+        response_ = http::response();
+        views_.index(conn_, http_conn_, location, request_, response_);
+        EXPECT_EQ(response_.result(), beast::http::status::bad_request)
+            << query;
+    }
+}
+
+TEST_F(domains_test, index_pagination)
+{
+    std::map<webvirt::domain *, const char *> names;
+    std::vector<domain_ptr> domains;
+    for (auto name : { "charlie", "alpha", "bravo", "delta" }) {
+        domains.emplace_back(std::make_shared<webvirt::domain>());
+        names[domains.back().get()] = name;
+    }
+    EXPECT_CALL(lv, virConnectListAllDomains(_, 0))
+        .WillRepeatedly(Return(domains));
+    EXPECT_CALL(lv, virDomainGetName(_))
+        .WillRepeatedly(
+            Invoke([&names](domain_ptr ptr) { return names[ptr.get()]; }));
+    EXPECT_CALL(lv, virDomainGetID(_)).Times(0);
+
+    auto location = make_location(R"(^/users/([^/]+)/domains/$)",
+                                  "/users/test/domains/");
+    auto page = [&](const std::string &query) {
+        request_.target("/users/test/domains/?fields=name&" + query);
+        response_ = http::response();
+        views_.index(conn_, http_conn_, location, request_, response_);
+        EXPECT_EQ(response_.result(), beast::http::status::ok);
+
+        std::vector<std::string> output;
+        for (auto &object : json::parse(response_.body())) {
+            output.emplace_back(object["name"]["text"].asString());
+        }
+        return output;
+    };
+
+    auto output = page("limit=2");
+    EXPECT_EQ(output, std::vector<std::string>({ "alpha", "bravo" }));
+    std::string cursor(response_["X-Next-Cursor"]);
+    ASSERT_FALSE(cursor.empty());
+
+    output = page("limit=2&cursor=" + cursor);
+    EXPECT_EQ(output, std::vector<std::string>({ "charlie", "delta" }));
+    EXPECT_EQ(response_.count("X-Next-Cursor"), 0);
+
+    output = page("sort=-name&limit=3");
+    EXPECT_EQ(output,
+              std::vector<std::string>({ "delta", "charlie", "bravo" }));
+    cursor = std::string(response_["X-Next-Cursor"]);
+
+    output = page("sort=-name&limit=3&cursor=" + cursor);
+    EXPECT_EQ(output, std::vector<std::string>({ "alpha" }));
+
+    output = page("name_prefix=b");
+    EXPECT_EQ(output, std::vector<std::string>({ "bravo" }));
+}
+
+TEST_F(domains_test, index_sort_id)
+{
+    std::map<webvirt::domain *, std::pair<int, const char *>> keys;
+    std::vector<domain_ptr> domains;
+    for (auto key : { std::make_pair(2, "a"),
+                      std::make_pair(-1, "c"),
+                      std::make_pair(1, "b"),
+                      std::make_pair(-1, "b") }) {
+        domains.emplace_back(std::make_shared<webvirt::domain>());
+        keys[domains.back().get()] = key;
+    }
+    EXPECT_CALL(lv, virConnectListAllDomains(_, 0)).WillOnce(Return(domains));
+    EXPECT_CALL(lv, virDomainGetName(_))
+        .WillRepeatedly(Invoke(
+            [&keys](domain_ptr ptr) { return keys[ptr.get()].second; }));
+    EXPECT_CALL(lv, virDomainGetID(_))
+        .WillRepeatedly(Invoke(
+            [&keys](domain_ptr ptr) { return keys[ptr.get()].first; }));
+
+    request_.target("/users/test/domains/?fields=id,name&sort=id");
+    auto location = make_location(R"(^/users/([^/]+)/domains/$)",
+                                  "/users/test/domains/");
+    views_.index(conn_, http_conn_, location, request_, response_);
+
+    std::vector<std::string> output;
+    for (auto &object : json::parse(response_.body())) {
+        output.emplace_back(object["id"].asString() + ":" +
+                            object["name"]["text"].asString());
+    }
+    EXPECT_EQ(output,
+              std::vector<std::string>({ "-1:b", "-1:c", "1:b", "2:a" }));
+}
+
+TEST_F(domains_test, index_order)
+{
+    // Domains are serialized concurrently but listed in libvirt's order.
+    std::map<webvirt::domain *, int> ids;
+    std::vector<domain_ptr> domains;
+    for (int i = 0; i < 50; ++i) {
+        domains.emplace_back(std::make_shared<webvirt::domain>());
+        ids[domains.back().get()] = i;
+    }
+    EXPECT_CALL(lv, virConnectListAllDomains(_, 0)).WillOnce(Return(domains));
+    EXPECT_CALL(lv, virDomainGetID(_))
+        .Times(50)
+        .WillRepeatedly(
+            Invoke([&ids](domain_ptr ptr) { return ids.at(ptr.get()); }));
+
+    request_.target("/users/test/domains/?fields=id");
+    auto location = make_location(R"(^/users/([^/]+)/domains/$)",
+                                  "/users/test/domains/");
+    views_.index(conn_, http_conn_, location, request_, response_);
+
+    auto data = json::parse(response_.body());
+    ASSERT_EQ(data.size(), 50);
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_EQ(data[i]["id"].asInt(), i);
+    }
+}
+
 TEST_F(domains_test, domain_start)
 {
     EXPECT_CALL(lv, virDomainCreate(_)).WillOnce(Return(0));
@@ -18,6 +18,7 @@
 #include <util/json.hpp>
 #include <util/logging.hpp>
 #include <views/host.hpp>
+#include <virt/instrumented.hpp>
 
 using namespace webvirt::views;
 
@@ -26,13 +27,50 @@ void host::show(virt::connection &conn, http::connection_ptr,
                 http::response &response)
 {
     return http::set_response(
-        response, data::host(conn), beast::http::status::ok);
+        response, host_facts(conn), beast::http::status::ok);
 }
 
-void host::networks(virt::connection &conn, http::connection_ptr,
-                    const std::smatch &, const http::request &,
-                    http::response &response)
+void host::refresh(virt::connection &conn, http::connection_ptr,
+                   const std::smatch &, const http::request &,
+                   http::response &response)
 {
     return http::set_response(
-        response, data::networks(conn), beast::http::status::ok);
+        response, host_facts(conn, true), beast::http::status::ok);
+}
+
+void host::networks(virt::connection &conn, http::connection_ptr http_conn,
+                    const std::smatch &, const http::request &request,
+                    http::response &response)
+{
+    return http::set_listing(
+        std::move(http_conn),
+        request,
+        response,
+        conn.networks(),
+        [user = virt::instrumented_libvirt::user()](
+            const virt::network &item) {
+            virt::instrumented_libvirt::scope scope(user);
+            virt::network network(item);
+            return data::network(network);
+        });
+}
+
+std::string host::host_facts(virt::connection &conn, bool refresh)
+{
+    const auto &user = conn.user();
+    auto ptr = conn.get_ptr();
+    if (!refresh) {
+        std::lock_guard<std::mutex> guard(facts_mutex_);
+        auto it = facts_.find(user);
+        if (it != facts_.end() && it->second.conn.lock() == ptr) {
+            return it->second.json;
+        }
+    }
+
+    // Gathered without holding the lock; capabilities are large.
+    auto json = json::stringify(data::host(conn));
+
+    std::lock_guard<std::mutex> guard(facts_mutex_);
+    facts_[user] = facts { ptr, json };
+    return json;
 }
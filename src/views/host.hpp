@@ -20,7 +20,11 @@
 #include <http/types.hpp>
 #include <virt/connection.hpp>
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
+#include <string>
 
 namespace webvirt::views
 {
@@ -28,8 +32,23 @@ namespace webvirt::views
 /** HTTP views related to a libvirt host */
 class host
 {
+private:
+    /** Serialized host information of a libvirt connection */
+    struct facts {
+        std::weak_ptr<webvirt::connect> conn;
+        std::string json;
+    };
+
+    // username -> facts
+    std::mutex facts_mutex_;
+    std::map<std::string, facts> facts_;
+
 public:
     /** Show libvirt host information
+     *
+     * Host information hardly ever changes, so it is gathered once per
+     * libvirt connection and served from memory afterward, without any
+     * libvirt calls. A reconnect or refresh() gathers it again.
      *
      * @param conn libvirt connection
      * @param http_conn HTTP connection
@@ -40,7 +59,21 @@ public:
     void show(virt::connection &, http::connection_ptr, const std::smatch &,
               const http::request &, http::response &);
 
+    /** Gather libvirt host information again and show it
+     *
+     * @param conn libvirt connection
+     * @param http_conn HTTP connection
+     * @param location Request URI regex match
+     * @param request http::request
+     * @param response http::response
+     **/
+    void refresh(virt::connection &, http::connection_ptr,
+                 const std::smatch &, const http::request &,
+                 http::response &);
+
     /** List libvirt host networks
+     *
+     * The listing may be streamed; see http::set_listing.
      *
      * @param conn libvirt connection
      * @param http_conn HTTP connection
@@ -51,6 +84,15 @@ public:
     void networks(virt::connection &, http::connection_ptr,
                   const std::smatch &, const http::request &,
                   http::response &);
+
+private:
+    /** Return serialized host information of a libvirt connection
+     *
+     * @param conn libvirt connection
+     * @param refresh Gather host information even if it is known
+     * @returns Serialized JSON object produced by data::host
+     **/
+    std::string host_facts(virt::connection &, bool refresh = false);
 };
 
 }; // namespace webvirt::views
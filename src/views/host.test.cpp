@@ -142,6 +142,69 @@ TEST_F(host_test, show_as_root)
     EXPECT_EQ(data["max_vcpus"].asUInt(), 2);
 }
 
+TEST_F(host_test, show_cached)
+{
+    make_connection("test");
+
+    EXPECT_CALL(lv, virConnectGetCapabilities(_)).Times(2);
+    EXPECT_CALL(lv, virConnectGetHostname(_))
+        .Times(2)
+        .WillRepeatedly(Return("test"));
+    EXPECT_CALL(lv, virConnectGetLibVersion(_, _)).Times(2);
+    EXPECT_CALL(lv, virConnectGetMaxVcpus(_, _))
+        .Times(2)
+        .WillRepeatedly(Return(2));
+    EXPECT_CALL(lv, virConnectGetType(_))
+        .Times(2)
+        .WillRepeatedly(Return("QEMU"));
+    EXPECT_CALL(lv, virConnectGetURI(_))
+        .Times(2)
+        .WillRepeatedly(Return("qemu+ssh://test@localhost/session"));
+    EXPECT_CALL(lv, virConnectGetVersion(_, _)).Times(2);
+    EXPECT_CALL(lv, virConnectIsEncrypted(_)).Times(2);
+    EXPECT_CALL(lv, virConnectIsSecure(_)).Times(2);
+
+    std::string endpoint("/users/test/host/");
+    auto location = make_location(R"(^/users/([^/]+)/host/)", endpoint);
+
+    // Host information is gathered once per connection.
+    views_.show(conn_, http_conn_, location, request_, response_);
+    http::response response;
+    views_.show(conn_, http_conn_, location, request_, response);
+    EXPECT_EQ(response.body(), response_.body());
+
+    // Unless explicitly refreshed.
+    http::response refreshed;
+    views_.refresh(conn_, http_conn_, location, request_, refreshed);
+    EXPECT_EQ(refreshed.body(), response_.body());
+
+    views_.show(conn_, http_conn_, location, request_, response);
+}
+
+TEST_F(host_test, show_reconnect)
+{
+    make_connection("test");
+
+    EXPECT_CALL(lv, virConnectGetHostname(_))
+        .WillOnce(Return("test"))
+        .WillOnce(Return("test2"));
+    EXPECT_CALL(lv, virConnectGetType(_)).WillRepeatedly(Return("QEMU"));
+    EXPECT_CALL(lv, virConnectGetURI(_))
+        .WillRepeatedly(Return("qemu+ssh://test@localhost/session"));
+
+    std::string endpoint("/users/test/host/");
+    auto location = make_location(R"(^/users/([^/]+)/host/)", endpoint);
+    views_.show(conn_, http_conn_, location, request_, response_);
+    EXPECT_EQ(json::parse(response_.body())["hostname"], "test");
+
+    // A new connection gathers host information again.
+    conn_ = virt::connection();
+    make_connection("test");
+    http::response response;
+    views_.show(conn_, http_conn_, location, request_, response);
+    EXPECT_EQ(json::parse(response.body())["hostname"], "test2");
+}
+
 TEST_F(host_test, networks)
 {
     make_connection("test");
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <virt/backend.hpp>
+#include <virt/recorder.hpp>
+#include <virt/replay.hpp>
+#include <virt/simulated.hpp>
+
+#include <stdexcept>
+
+using namespace webvirt;
+
+std::unique_ptr<libvirt> virt::make_backend(const std::string &spec)
+{
+    auto colon = spec.find(':');
+    auto name = spec.substr(0, colon);
+    auto args = colon == std::string::npos ? std::string()
+                                           : spec.substr(colon + 1);
+
+    if (name == "libvirt" && args.empty()) {
+        return nullptr;
+    } else if (name == "sim") {
+        return std::make_unique<simulated_libvirt>(
+            simulated_libvirt::options::parse(args));
+    }
+
+    bool recording = name == "record" || name == "replay" ||
+                     name == "replay-timed";
+    if (recording && args.empty()) {
+        throw std::invalid_argument("libvirt backend '" + name +
+                                    "' requires a path");
+    } else if (name == "record") {
+        return std::make_unique<recording_libvirt>(libvirt::ref(), args);
+    } else if (recording) {
+        return std::make_unique<replay_libvirt>(args,
+                                                name == "replay-timed");
+    }
+
+    throw std::invalid_argument("unknown libvirt backend '" + spec + "'");
+}
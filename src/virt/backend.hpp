@@ -0,0 +1,48 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef VIRT_BACKEND_HPP
+#define VIRT_BACKEND_HPP
+
+#include <libvirt.hpp>
+
+#include <memory>
+#include <string>
+
+namespace webvirt::virt
+{
+
+/** Construct the libvirt backend named by a --libvirt-backend spec
+ *
+ * Specs take the form "name[:options]":
+ *
+ * - "libvirt": the system libvirt; no replacement is needed
+ * - "sim[:key=value,...]": a simulated_libvirt; see
+ *   simulated_libvirt::options::parse() for its options
+ * - "record:PATH": the system libvirt, recording every call to PATH
+ * - "replay:PATH": a replay_libvirt serving the recording at PATH
+ * - "replay-timed:PATH": as "replay", with the recorded latencies
+ *
+ * @param spec Backend spec
+ * @returns Backend to install with libvirt::change(), or nullptr if the
+ *          default libvirt should be kept
+ * @throws std::invalid_argument on an unknown backend or bad options
+ * @throws std::runtime_error if a recording cannot be opened
+ **/
+std::unique_ptr<libvirt> make_backend(const std::string &spec);
+
+}; // namespace webvirt::virt
+
+#endif /* VIRT_BACKEND_HPP */
@@ -18,6 +18,7 @@
 #include <virt/connection.hpp>
 #include <virt/util.hpp>
 
+#include <cctype>
 #include <list>
 
 using namespace webvirt;
@@ -39,6 +40,7 @@ virt::connection::connection(const connection &conn)
     , errno_(conn.errno_)
     , closed_(conn.closed_)
     , user_(conn.user_)
+    , handles_(conn.handles_)
 {
 }
 
@@ -68,6 +70,7 @@ virt::connection &virt::connection::operator=(const virt::connection &conn)
     errno_ = conn.errno_;
     closed_ = conn.closed_;
     user_ = conn.user_;
+    handles_ = conn.handles_;
     return *this;
 }
 
@@ -164,11 +167,11 @@ bool virt::connection::secure() const
     return libvirt::ref().virConnectIsSecure(conn_);
 }
 
-std::vector<virt::domain> virt::connection::domains()
+std::vector<virt::domain> virt::connection::domains(unsigned int flags)
 {
     auto &lv = libvirt::ref();
     std::vector<virt::domain> domains_;
-    auto domain_ptrs = lv.virConnectListAllDomains(conn_, 0);
+    auto domain_ptrs = lv.virConnectListAllDomains(conn_, flags);
     for (auto &domain_ptr : domain_ptrs) {
         domains_.emplace_back(domain_ptr);
     }
@@ -200,6 +203,70 @@ domain_ptr virt::connection::get_domain_ptr(const std::string &name)
     return domain;
 }
 
+domain_ptr virt::connection::get_domain_ptr_by_uuid(const std::string &uuid)
+{
+    auto &lv = libvirt::ref();
+    auto domain = lv.virDomainLookupByUUIDString(conn_, uuid.c_str());
+    if (!domain) {
+        throw std::domain_error("virDomainLookupByUUIDString error");
+    }
+    return domain;
+}
+
+// Test whether `key` is a UUID string, e.g.
+// 4dea22b3-1d52-d8f3-2516-782e98ab3fa0
+static bool is_uuid(const std::string &key)
+{
+    if (key.size() != VIR_UUID_STRING_BUFLEN - 1) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < key.size(); ++i) {
+        auto c = static_cast<unsigned char>(key[i]);
+        bool dash = i == 8 || i == 13 || i == 18 || i == 23;
+        if (dash ? c != '-' : !std::isxdigit(c)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+virt::domain virt::connection::lookup(const std::string &key)
+{
+    if (auto handle = handles_->find(key)) {
+        return virt::domain(handle->ptr);
+    }
+
+    // Taken first, so that an event dropping the domain while libvirt
+    // is being asked keeps insert() from caching what it returns.
+    const auto generation = handles_->generation(key);
+
+    domain_ptr ptr;
+    if (is_uuid(key)) {
+        try {
+            ptr = get_domain_ptr_by_uuid(key);
+        } catch (const std::domain_error &) {
+            // Names may look like UUIDs, too.
+        }
+    }
+    if (!ptr) {
+        ptr = get_domain_ptr(key);
+    }
+
+    virt::domain domain(ptr);
+    if (handles_->enabled()) {
+        handles_->insert({ ptr, domain.name(), domain.uuid() }, key,
+                         generation);
+    }
+    return domain;
+}
+
+virt::domain_handles &virt::connection::handles()
+{
+    return *handles_;
+}
+
 connect_ptr virt::connection::get_ptr()
 {
     return conn_;
@@ -20,6 +20,7 @@
 #include <util/json.hpp>
 #include <util/logging.hpp>
 #include <virt/domain.hpp>
+#include <virt/domain_handles.hpp>
 #include <virt/network.hpp>
 
 #include <atomic>
@@ -42,6 +43,11 @@ private:
     bool closed_ { true };
     std::string user_;
 
+    // Shared between copies; a reconnect starts out with no handles.
+    std::shared_ptr<domain_handles> handles_ {
+        std::make_shared<domain_handles>()
+    };
+
 public:
 #ifdef TEST_BUILD
     bool &closed();
@@ -74,9 +80,33 @@ public:
     bool encrypted() const;
     bool secure() const;
 
-    std::vector<virt::domain> domains();
+    /** List domains
+     *
+     * @param flags Bitwise OR of VIR_CONNECT_LIST_DOMAINS_* filters
+     * @returns Domains matching `flags`
+     **/
+    std::vector<virt::domain> domains(unsigned int flags = 0);
     virt::domain domain(const std::string &name);
     domain_ptr get_domain_ptr(const std::string &name);
+    domain_ptr get_domain_ptr_by_uuid(const std::string &uuid);
+
+    /** Look up a domain by name or UUID
+     *
+     * Kept handles are reused without asking libvirt; see handles().
+     * Keys which look like a UUID are looked up as one first, falling
+     * back to a name lookup.
+     *
+     * @param key Domain name or UUID string
+     * @returns Domain
+     * @throws std::domain_error if no such domain exists
+     **/
+    virt::domain lookup(const std::string &key);
+
+    /** Return the domain handles kept for this connection
+     *
+     * @returns Reference to the connection's domain handles
+     **/
+    domain_handles &handles();
 
     std::vector<virt::network> networks();
 
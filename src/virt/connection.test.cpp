@@ -67,6 +67,107 @@ TEST_F(connection_test, inequality)
     EXPECT_NE(v, virt::connection());
 }
 
+TEST_F(connection_test, lookup)
+{
+    virt::connection v("/path/to/socket.sock");
+    auto domain = std::make_shared<webvirt::domain>();
+    const std::string uuid("4dea22b3-1d52-d8f3-2516-782e98ab3fa0");
+
+    // Handles are not kept until enabled.
+    EXPECT_CALL(lv, virDomainLookupByName(_, _))
+        .Times(2)
+        .WillRepeatedly(Return(domain));
+    EXPECT_CALL(lv, virDomainGetName(_)).WillRepeatedly(Return("test"));
+    EXPECT_CALL(lv, virDomainGetUUIDString(_)).WillRepeatedly(Return(uuid));
+    v.lookup("test");
+    v.handles().enable(true);
+    EXPECT_EQ(v.lookup("test").get_ptr(), domain);
+
+    // Kept handles are shared by copies and found by name or UUID.
+    virt::connection v2(v);
+    EXPECT_EQ(v2.lookup("test").get_ptr(), domain);
+    EXPECT_EQ(v2.lookup(uuid).get_ptr(), domain);
+
+    // Undefining or renaming drops them.
+    v.handles().erase("test", uuid);
+    EXPECT_FALSE(v.handles().find("test"));
+    EXPECT_FALSE(v.handles().find(uuid));
+
+    v.handles().insert({ domain, "test", uuid });
+    v.handles().enable(false);
+    EXPECT_FALSE(v.handles().find("test"));
+}
+
+TEST(domain_handles, lifecycle)
+{
+    virt::domain_handles handles;
+    handles.enable(true);
+    const std::string uuid("4dea22b3-1d52-d8f3-2516-782e98ab3fa0");
+
+    // A transient domain stops and vanishes without being undefined...
+    auto stopped = std::make_shared<webvirt::domain>();
+    handles.insert({ stopped, "test", uuid });
+    handles.lifecycle(VIR_DOMAIN_EVENT_SUSPENDED, "test", uuid);
+    EXPECT_TRUE(handles.find("test"));
+    handles.lifecycle(VIR_DOMAIN_EVENT_STOPPED, "test", uuid);
+    EXPECT_FALSE(handles.find("test"));
+
+    // ...and a new one starting under its name replaces it.
+    handles.insert({ stopped, "test", uuid });
+    handles.lifecycle(VIR_DOMAIN_EVENT_STARTED, "test", "");
+    EXPECT_FALSE(handles.find("test"));
+    EXPECT_FALSE(handles.find(uuid));
+
+    handles.insert({ stopped, "test", uuid });
+    handles.lifecycle(VIR_DOMAIN_EVENT_UNDEFINED, "test", uuid);
+    EXPECT_FALSE(handles.find("test"));
+}
+
+TEST_F(connection_test, lookup_races_event)
+{
+    virt::connection v("/path/to/socket.sock");
+    v.handles().enable(true);
+    auto domain = std::make_shared<webvirt::domain>();
+    const std::string uuid("4dea22b3-1d52-d8f3-2516-782e98ab3fa0");
+
+    // The domain is undefined while libvirt is looking it up.
+    EXPECT_CALL(lv, virDomainLookupByName(_, _))
+        .WillOnce([&v, &domain, &uuid](auto, auto) {
+            v.handles().lifecycle(VIR_DOMAIN_EVENT_UNDEFINED, "test", uuid);
+            return domain;
+        })
+        .WillOnce(Return(domain));
+    EXPECT_CALL(lv, virDomainGetName(_)).WillRepeatedly(Return("test"));
+    EXPECT_CALL(lv, virDomainGetUUIDString(_)).WillRepeatedly(Return(uuid));
+
+    EXPECT_EQ(v.lookup("test").get_ptr(), domain);
+    EXPECT_FALSE(v.handles().find("test"));
+    EXPECT_FALSE(v.handles().find(uuid));
+
+    // Lookups starting after the event keep their handle again.
+    v.lookup("test");
+    EXPECT_TRUE(v.handles().find("test"));
+}
+
+TEST_F(connection_test, lookup_uuid)
+{
+    virt::connection v("/path/to/socket.sock");
+    auto domain = std::make_shared<webvirt::domain>();
+    const std::string uuid("4dea22b3-1d52-d8f3-2516-782e98ab3fa0");
+
+    EXPECT_CALL(lv, virDomainLookupByUUIDString(_, _))
+        .WillOnce(Return(domain))
+        .WillOnce(Return(nullptr));
+    EXPECT_EQ(v.lookup(uuid).get_ptr(), domain);
+
+    // Domain names may look like UUIDs, too.
+    EXPECT_CALL(lv, virDomainLookupByName(_, _)).WillOnce(Return(domain));
+    EXPECT_EQ(v.lookup(uuid).get_ptr(), domain);
+
+    EXPECT_CALL(lv, virDomainLookupByName(_, _)).WillOnce(Return(nullptr));
+    EXPECT_THROW(v.lookup("missing"), std::domain_error);
+}
+
 TEST(connection, on_libvirt_error)
 {
     testing::internal::CaptureStderr();
@@ -15,21 +15,40 @@
  */
 #include <util/bench.hpp>
 #include <util/logging.hpp>
+#include <util/metrics.hpp>
 #include <virt/connection_pool.hpp>
+#include <virt/instrumented.hpp>
 #include <virt/util.hpp>
 
+using namespace webvirt;
 using namespace webvirt::virt;
 
+static void record_connect(const char *kind, double seconds)
+{
+    auto &registry = metrics::registry::ref();
+    registry
+        .histogram("webvirtd_libvirt_connect_duration_seconds",
+                   "Time taken to open libvirt connections",
+                   { { "kind", kind } })
+        .observe(seconds);
+}
+
 connection &connection_pool::get(const std::string &user)
 {
     std::lock_guard<std::mutex> guard(connection_mutex_);
+    instrumented_libvirt::scope scope(user);
 
     bench<double> bench_;
     auto iter = connections_.find(user);
     if (iter == connections_.end()) {
         connections_[user] = virt::connection();
         connections_[user].connect(user);
-        auto ms = bench_.end() * 1000;
+        record_connect("connect", bench_.end());
+        metrics::registry::ref()
+            .gauge("webvirtd_libvirt_connections",
+                   "libvirt connections held by the connection pool")
+            .set(connections_.size());
+        auto ms = bench_.elapsed() * 1000;
         logger::debug(fmt::format("Connected to libvirt in {}ms", int(ms)));
         return connections_.at(user);
     }
@@ -38,9 +57,17 @@ connection &connection_pool::get(const std::string &user)
         // If connection is stale, try reconnecting.
         iter->second = virt::connection();
         iter->second.connect(user);
-        auto ms = bench_.end() * 1000;
+        record_connect("reconnect", bench_.end());
+        auto ms = bench_.elapsed() * 1000;
         logger::debug(fmt::format("Reconnected to libvirt in {}ms", int(ms)));
     }
 
     return iter->second;
 }
+
+connection *connection_pool::find(const std::string &user)
+{
+    std::lock_guard<std::mutex> guard(connection_mutex_);
+    auto iter = connections_.find(user);
+    return iter == connections_.end() ? nullptr : &iter->second;
+}
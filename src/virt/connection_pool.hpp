@@ -34,6 +34,14 @@ private:
 
 public:
     connection &get(const std::string &);
+
+    /** Find a user's connection without connecting
+     *
+     * @param user libvirt user
+     * @returns Pointer to the user's connection, or nullptr if the user
+     *          has never connected
+     **/
+    connection *find(const std::string &);
 };
 
 }; // namespace webvirt::virt
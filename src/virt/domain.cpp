@@ -36,6 +36,11 @@ std::string virt::domain::name() const
     return libvirt::ref().virDomainGetName(ptr_);
 }
 
+std::string virt::domain::uuid() const
+{
+    return libvirt::ref().virDomainGetUUIDString(ptr_);
+}
+
 int virt::domain::state() const
 {
     int state, reason;
@@ -78,7 +83,7 @@ std::string virt::domain::description() const
     return metadata(VIR_DOMAIN_METADATA_DESCRIPTION, nullptr, 0);
 }
 
-std::string virt::domain::xml_desc()
+c_string virt::domain::xml_desc()
 {
     bench<double> bench_;
     auto desc = libvirt::ref().virDomainGetXMLDesc(ptr_, 0);
@@ -90,16 +95,7 @@ std::string virt::domain::xml_desc()
 
 pugi::xml_document virt::domain::xml_document()
 {
-    auto desc = xml_desc();
-    pugi::xml_document doc;
-
-    // By not checking load results, we return a blank xml_document on failure.
-    // A blank xml_document will produce empty string values for
-    // children/attributes read, allowing XML routes to fall through
-    // gracefully.
-    doc.load_buffer(desc.c_str(), desc.size());
-
-    return doc;
+    return virt::parse_xml(xml_desc());
 }
 
 block_info_ptr virt::domain::block_info(const std::string &device)
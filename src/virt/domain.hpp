@@ -32,6 +32,7 @@ public:
 
     int id() const;
     std::string name() const;
+    std::string uuid() const;
     int state() const;
     bool autostart() const;
     void autostart(bool enabled);
@@ -42,7 +43,7 @@ public:
     std::string title() const;
     std::string description() const;
 
-    std::string xml_desc();
+    c_string xml_desc();
     pugi::xml_document xml_document();
 
     block_info_ptr block_info(const std::string &);
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <virt/domain_handles.hpp>
+
+using namespace webvirt::virt;
+
+void domain_handles::enable(bool enabled)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    enabled_ = enabled;
+    if (!enabled_) {
+        names_.clear();
+        uuids_.clear();
+    }
+
+    // Events may have gone unseen; lookups in flight are stale.
+    reset_ = ++counter_;
+    erased_.clear();
+}
+
+bool domain_handles::enabled() const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return enabled_;
+}
+
+std::optional<domain_handles::handle>
+domain_handles::find(const std::string &key) const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (auto it = names_.find(key); it != names_.end()) {
+        return it->second;
+    }
+    if (auto it = uuids_.find(key); it != uuids_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+std::uint64_t domain_handles::generation(const std::string &key) const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = erased_.find(key);
+    return it != erased_.end() ? it->second : reset_;
+}
+
+void domain_handles::insert(const handle &handle)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    keep(handle);
+}
+
+bool domain_handles::insert(const handle &handle, const std::string &key,
+                            std::uint64_t generation)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = erased_.find(key);
+    if (generation != (it != erased_.end() ? it->second : reset_)) {
+        return false;
+    }
+    return keep(handle);
+}
+
+bool domain_handles::keep(const handle &handle)
+{
+    if (!enabled_ || !handle.ptr) {
+        return false;
+    }
+
+    names_[handle.name] = handle;
+    if (!handle.uuid.empty()) {
+        uuids_[handle.uuid] = handle;
+    }
+    return true;
+}
+
+void domain_handles::erase(const std::string &name, const std::string &uuid)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    // Drop both aliases of either handle; after a rename, `name` and
+    // `uuid` may each belong to a different entry. Lookups of any of
+    // them still in flight must not keep what they find.
+    const auto generation = ++counter_;
+    for (const auto *key : { &name, &uuid }) {
+        if (enabled_ && !key->empty()) {
+            erased_[*key] = generation;
+        }
+        for (auto *map : { &names_, &uuids_ }) {
+            auto it = map->find(*key);
+            if (it == map->end()) {
+                continue;
+            }
+            auto handle = it->second;
+            names_.erase(handle.name);
+            uuids_.erase(handle.uuid);
+            if (enabled_) {
+                erased_[handle.name] = generation;
+                erased_[handle.uuid] = generation;
+            }
+        }
+    }
+}
+
+void domain_handles::lifecycle(int event, const std::string &name,
+                               const std::string &uuid)
+{
+    // Renames undefine the old name and define the new one. A transient
+    // domain is gone once stopped, without an undefined event, and
+    // another may start under its name. A persistent domain's handle
+    // outlives a stop, but telling the two apart would cost a libvirt
+    // call of its own.
+    switch (event) {
+    case VIR_DOMAIN_EVENT_DEFINED:
+    case VIR_DOMAIN_EVENT_UNDEFINED:
+    case VIR_DOMAIN_EVENT_STOPPED:
+    case VIR_DOMAIN_EVENT_STARTED:
+        erase(name, uuid);
+        break;
+    }
+}
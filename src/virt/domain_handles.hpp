@@ -0,0 +1,141 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef VIRT_DOMAIN_HANDLES_HPP
+#define VIRT_DOMAIN_HANDLES_HPP
+
+#include <libvirt.hpp>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace webvirt::virt
+{
+
+/** Domain handles of a libvirt connection, keyed by name and UUID
+ *
+ * Looking up a domain is a round-trip to libvirtd. Handles stay valid
+ * for as long as their domain stays defined under the same name, so
+ * they can be reused between requests as long as something tells us
+ * when that stops being the case. Handles are therefore only kept while
+ * enabled, which is done while the connection's lifecycle events are
+ * registered.
+ *
+ * A lookup races the events dropping its result: an event handled
+ * while libvirt is being asked would be undone by keeping the handle
+ * found. Lookups therefore take the generation of their key first and
+ * insert() refuses handles whose key has been erased since.
+ **/
+class domain_handles
+{
+public:
+    /** A cached domain handle */
+    struct handle {
+        domain_ptr ptr;
+        std::string name;
+        std::string uuid;
+    };
+
+private:
+    mutable std::mutex mutex_;
+    bool enabled_ { false };
+    std::map<std::string, handle> names_;
+    std::map<std::string, handle> uuids_;
+
+    // Generations are drawn from one counter, so that none repeats.
+    // Keys erased while enabled -> generation of their last erasure;
+    // keys not listed are at reset_, taken when last (dis)abled.
+    std::uint64_t counter_ { 0 };
+    std::uint64_t reset_ { 0 };
+    std::map<std::string, std::uint64_t> erased_;
+
+public:
+    /** Start or stop keeping handles
+     *
+     * Disabling drops all handles kept so far.
+     *
+     * @param enabled Whether handles should be kept
+     **/
+    void enable(bool enabled);
+
+    /** Return whether handles are kept
+     *
+     * @returns True if handles are kept
+     **/
+    bool enabled() const;
+
+    /** Find a handle by domain name or UUID
+     *
+     * @param key Domain name or UUID string
+     * @returns Handle, if one is kept
+     **/
+    std::optional<handle> find(const std::string &key) const;
+
+    /** Return the generation of a key
+     *
+     * Taken before looking the key up in libvirt; see insert().
+     *
+     * @param key Domain name or UUID string
+     * @returns Generation of `key`
+     **/
+    std::uint64_t generation(const std::string &key) const;
+
+    /** Keep a handle
+     *
+     * Does nothing unless enabled.
+     *
+     * @param handle Domain handle
+     **/
+    void insert(const handle &);
+
+    /** Keep a handle looked up by key, unless the key has been erased
+     *
+     * Does nothing unless enabled, or if `key` has been erased, or
+     * handles disabled, since `generation` was taken.
+     *
+     * @param handle Domain handle
+     * @param key Domain name or UUID string the handle was looked up by
+     * @param generation Generation of `key` before the lookup
+     * @returns True if the handle was kept
+     **/
+    bool insert(const handle &, const std::string &key,
+                std::uint64_t generation);
+
+    /** Drop the handles of a domain
+     *
+     * @param name Domain name
+     * @param uuid Domain UUID string
+     **/
+    void erase(const std::string &name, const std::string &uuid);
+
+    /** Drop the handles of a domain a lifecycle event may have replaced
+     *
+     * @param event virDomainEventType of the lifecycle event
+     * @param name Domain name
+     * @param uuid Domain UUID string
+     **/
+    void lifecycle(int event, const std::string &name,
+                   const std::string &uuid);
+
+private:
+    bool keep(const handle &);
+};
+
+}; // namespace webvirt::virt
+
+#endif /* VIRT_DOMAIN_HANDLES_HPP */
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <virt/events/callbacks/metadata.hpp>
+
+using namespace webvirt;
+using namespace virt;
+
+metadata_callback::metadata_callback(function fptr)
+    : metadata_callback(reinterpret_cast<void *>(fptr))
+{
+}
+
+metadata_callback::metadata_callback(void *fptr)
+    : event_callback(fptr)
+{
+}
+
+event_callback::function metadata_callback::function_ptr() const
+{
+    return add_event_callback(VIR_DOMAIN_EVENT_ID_METADATA_CHANGE,
+                              VIR_DOMAIN_EVENT_CALLBACK(real_function_ptr()));
+}
+
+metadata_callback::function metadata_callback::real_function_ptr() const
+{
+    return reinterpret_cast<function>(fptr_);
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <mocks/libvirt.hpp>
+#include <virt/events/metadata.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace webvirt;
+using namespace virt;
+
+using testing::_;
+using testing::Return;
+using testing::Test;
+
+class metadata_test : public Test
+{
+protected:
+    mocks::libvirt lv;
+
+    webvirt::connect_ptr ptr_;
+    virt::connection conn_;
+
+public:
+    void SetUp() override
+    {
+        libvirt::change(lv);
+
+        ptr_ = std::make_shared<webvirt::connect>();
+        EXPECT_CALL(lv, virConnectOpen(_)).WillOnce(Return(ptr_));
+
+        conn_.connect("qemu+ssh://test@localhost/session");
+    }
+
+    void TearDown() override
+    {
+        libvirt::reset();
+    }
+};
+
+TEST_F(metadata_test, register_fails)
+{
+    metadata_callback cb(metadata_event::on_event_handler);
+
+    EXPECT_CALL(lv, virConnectDomainEventRegisterAny(_, _, _, _, _, _))
+        .WillOnce(Return(-1));
+    EXPECT_THROW(
+        {
+            metadata_event(
+                conn_,
+                cb,
+                http::noop<virt::connection &, virt::domain &, int>());
+        },
+        std::runtime_error);
+}
+
+TEST_F(metadata_test, on_event)
+{
+    metadata_callback cb(metadata_event::on_event_handler);
+
+    EXPECT_CALL(lv,
+                virConnectDomainEventRegisterAny(
+                    _, _, VIR_DOMAIN_EVENT_ID_METADATA_CHANGE, _, _, _))
+        .WillOnce(Return(1));
+
+    int type = -1;
+    metadata_event ev(
+        conn_, cb, [&type](auto &, auto &, int type_) {
+            type = type_;
+        });
+
+    auto f = reinterpret_cast<metadata_function>(reinterpret_cast<void *>(
+        get_event_callback(VIR_DOMAIN_EVENT_ID_METADATA_CHANGE)));
+    auto domain = std::make_shared<webvirt::domain>();
+    f(ptr_.get(), domain.get(), VIR_DOMAIN_METADATA_TITLE, nullptr, &ev);
+
+    EXPECT_EQ(type, VIR_DOMAIN_METADATA_TITLE);
+}
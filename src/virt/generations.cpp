@@ -0,0 +1,98 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <virt/generations.hpp>
+
+#include <chrono>
+#include <fmt/format.h>
+
+using namespace webvirt::virt;
+
+generations::generations()
+{
+    // Tags must not survive a restart, when counters start over.
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    nonce_ = fmt::format(
+        "{:x}",
+        std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+void generations::track(const std::string &user, const void *conn)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &gens = users_[user];
+    gens.conn = conn;
+    gens.epoch = ++epochs_;
+    gens.set = 0;
+    gens.domains.clear();
+}
+
+void generations::untrack(const std::string &user)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    users_.erase(user);
+}
+
+bool generations::tracked(const std::string &user, const void *conn) const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = users_.find(user);
+    return it != users_.end() && it->second.conn == conn;
+}
+
+void generations::bump(const std::string &user, const std::string &domain)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = users_.find(user);
+    if (it == users_.end()) {
+        return;
+    }
+
+    // A domain's generation is the set generation it last changed in,
+    // which stays unique even if the domain is removed and redefined.
+    auto &gens = it->second;
+    gens.domains[domain] = ++gens.set;
+}
+
+std::string generations::etag(const std::string &user) const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = users_.find(user);
+    if (it == users_.end()) {
+        return std::string();
+    }
+    return make_etag(it->second, it->second.set);
+}
+
+std::string generations::etag(const std::string &user,
+                              const std::string &domain) const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = users_.find(user);
+    if (it == users_.end()) {
+        return std::string();
+    }
+
+    auto &domains = it->second.domains;
+    auto domain_it = domains.find(domain);
+    std::uint64_t gen = domain_it == domains.end() ? 0 : domain_it->second;
+    return make_etag(it->second, gen);
+}
+
+std::string generations::make_etag(const user_generations &gens,
+                                   std::uint64_t gen) const
+{
+    return fmt::format("W/\"{}.{}.{}\"", nonce_, gens.epoch, gen);
+}
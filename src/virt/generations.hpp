@@ -0,0 +1,108 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef VIRT_GENERATIONS_HPP
+#define VIRT_GENERATIONS_HPP
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace webvirt::virt
+{
+
+/** Generation counters for users' libvirt domains
+ *
+ * Each user has a generation for their set of domains, and each domain
+ * a generation of its own. bump() advances both whenever a domain
+ * changes, so entity tags derived from them change along with the
+ * resources they describe.
+ *
+ * Counters only reflect reality while every change is reported, i.e.
+ * while libvirt domain events are registered on the user's connection.
+ * A user is tracked against a particular connection via track(); no
+ * entity tags are produced for users who are not tracked, and tags
+ * produced before untrack() never match again.
+ **/
+class generations
+{
+private:
+    struct user_generations {
+        const void *conn { nullptr };
+        std::uint64_t epoch { 0 };
+        std::uint64_t set { 0 };
+        std::map<std::string, std::uint64_t> domains;
+    };
+
+    mutable std::mutex mutex_;
+    std::string nonce_;
+    std::uint64_t epochs_ { 0 };
+    std::map<std::string, user_generations> users_;
+
+public:
+    /** Construct generation counters unique to this process */
+    generations();
+
+    /** Start tracking a user's domains
+     *
+     * @param user libvirt user
+     * @param conn Identity of the connection events are registered on
+     **/
+    void track(const std::string &user, const void *conn);
+
+    /** Stop tracking a user's domains
+     *
+     * @param user libvirt user
+     **/
+    void untrack(const std::string &user);
+
+    /** Test whether a user is tracked on a particular connection
+     *
+     * @param user libvirt user
+     * @param conn Identity of the user's current connection
+     * @returns True if `user` is tracked on `conn`
+     **/
+    bool tracked(const std::string &user, const void *conn) const;
+
+    /** Record a change to one of a user's domains
+     *
+     * @param user libvirt user
+     * @param domain Name of the changed domain
+     **/
+    void bump(const std::string &user, const std::string &domain);
+
+    /** Produce an entity tag for a user's set of domains
+     *
+     * @param user libvirt user
+     * @returns Weak entity tag, or an empty string if `user` is untracked
+     **/
+    std::string etag(const std::string &user) const;
+
+    /** Produce an entity tag for one of a user's domains
+     *
+     * @param user libvirt user
+     * @param domain Domain name
+     * @returns Weak entity tag, or an empty string if `user` is untracked
+     **/
+    std::string etag(const std::string &user, const std::string &domain) const;
+
+private:
+    std::string make_etag(const user_generations &, std::uint64_t) const;
+};
+
+}; // namespace webvirt::virt
+
+#endif /* VIRT_GENERATIONS_HPP */
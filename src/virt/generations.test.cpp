@@ -0,0 +1,166 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <http/middleware.hpp>
+#include <virt/generations.hpp>
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <regex>
+#include <thread>
+
+using namespace webvirt;
+
+static const int conn = 0, other_conn = 0;
+
+TEST(generations, untracked)
+{
+    virt::generations gens;
+    EXPECT_FALSE(gens.tracked("test", &conn));
+    EXPECT_EQ(gens.etag("test"), "");
+    EXPECT_EQ(gens.etag("test", "domain"), "");
+
+    // Bumps for untracked users are ignored
+    gens.bump("test", "domain");
+    EXPECT_EQ(gens.etag("test"), "");
+}
+
+TEST(generations, bump)
+{
+    virt::generations gens;
+    gens.track("test", &conn);
+    EXPECT_TRUE(gens.tracked("test", &conn));
+    EXPECT_FALSE(gens.tracked("test", &other_conn));
+
+    auto set = gens.etag("test");
+    auto first = gens.etag("test", "first");
+    auto second = gens.etag("test", "second");
+    EXPECT_EQ(set.substr(0, 3), "W/\"");
+    EXPECT_EQ(first, second);
+
+    gens.bump("test", "first");
+    EXPECT_NE(gens.etag("test"), set);
+    EXPECT_NE(gens.etag("test", "first"), first);
+    EXPECT_EQ(gens.etag("test", "second"), second);
+}
+
+TEST(generations, retrack)
+{
+    virt::generations gens;
+    gens.track("test", &conn);
+    auto set = gens.etag("test");
+    auto domain = gens.etag("test", "domain");
+
+    gens.untrack("test");
+    EXPECT_EQ(gens.etag("test"), "");
+
+    // Tags from an earlier tracking period never come back
+    gens.track("test", &other_conn);
+    EXPECT_NE(gens.etag("test"), set);
+    EXPECT_NE(gens.etag("test", "domain"), domain);
+}
+
+TEST(generations, unique_per_process)
+{
+    virt::generations a;
+    a.track("test", &conn);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    virt::generations b;
+    b.track("test", &conn);
+
+    EXPECT_NE(a.etag("test"), b.etag("test"));
+}
+
+class with_etag_test : public testing::Test
+{
+protected:
+    virt::generations gens_;
+    bool tagged_ = true;
+    beast::http::status status_ = beast::http::status::ok;
+    http::connection::route_function route_fn_;
+
+    const std::string path_ = "/users/test/domains/test/";
+    std::smatch match_;
+
+public:
+    void SetUp() override
+    {
+        gens_.track("test", &conn);
+        route_fn_ = http::middleware::with_etag(
+            gens_,
+            [](const std::string &) {
+                return true;
+            },
+            [this](const http::request &) {
+                return tagged_;
+            },
+            [this](http::connection_ptr, const std::smatch &,
+                   const http::request &, http::response &response) {
+                response.result(status_);
+                response.body() = "domain";
+            });
+        std::regex_match(
+            path_, match_, std::regex(R"(^/users/([^/]+)/domains/([^/]+)/$)"));
+    }
+
+    http::response run(const std::string &etag = std::string())
+    {
+        http::request request;
+        request.method(beast::http::verb::get);
+        request.target(path_);
+        if (!etag.empty()) {
+            request.set(beast::http::field::if_none_match, etag);
+        }
+
+        http::response response;
+        route_fn_(nullptr, match_, request, response);
+        return response;
+    }
+};
+
+TEST_F(with_etag_test, not_modified)
+{
+    auto response = run();
+    EXPECT_EQ(response.result(), beast::http::status::ok);
+    auto etag = std::string(response[beast::http::field::etag]);
+    EXPECT_EQ(etag, gens_.etag("test", "test"));
+
+    response = run(etag);
+    EXPECT_EQ(response.result(), beast::http::status::not_modified);
+    EXPECT_EQ(response.body(), "");
+
+    gens_.bump("test", "test");
+    response = run(etag);
+    EXPECT_EQ(response.result(), beast::http::status::ok);
+    EXPECT_EQ(response.body(), "domain");
+}
+
+TEST_F(with_etag_test, not_found)
+{
+    // A domain which does not exist is never Not Modified
+    status_ = beast::http::status::not_found;
+    auto response = run(gens_.etag("test", "test"));
+    EXPECT_EQ(response.result(), beast::http::status::not_found);
+    EXPECT_EQ(response.count(beast::http::field::etag), 0);
+}
+
+TEST_F(with_etag_test, untagged)
+{
+    tagged_ = false;
+    auto response = run(gens_.etag("test", "test"));
+    EXPECT_EQ(response.result(), beast::http::status::ok);
+    EXPECT_EQ(response.count(beast::http::field::etag), 0);
+}
@@ -0,0 +1,453 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <util/trace.hpp>
+#include <virt/instrumented.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <type_traits>
+
+using namespace webvirt;
+using namespace webvirt::virt;
+
+static thread_local std::string current_user;
+
+thread_local instrumented_libvirt::thread_cache instrumented_libvirt::cache_;
+
+static std::atomic<std::uint64_t> next_id { 1 };
+
+instrumented_libvirt::scope::scope(const std::string &user)
+    : previous_(std::move(current_user))
+{
+    current_user = user;
+    cache_.user = nullptr;
+}
+
+instrumented_libvirt::scope::~scope()
+{
+    current_user = std::move(previous_);
+    cache_.user = nullptr;
+}
+
+const std::string &instrumented_libvirt::user()
+{
+    return current_user;
+}
+
+instrumented_libvirt::instrumented_libvirt(libvirt &lv,
+                                           metrics::registry &registry)
+    : lv_(lv)
+    , registry_(registry)
+    , id_(next_id++)
+{
+}
+
+// libvirt reports failure through its return values.
+static bool failed(int rc)
+{
+    return rc < 0;
+}
+
+static bool failed(const char *str)
+{
+    return str == nullptr;
+}
+
+static bool failed(const c_string &str)
+{
+    return !str;
+}
+
+template <typename T>
+static bool failed(const std::shared_ptr<T> &ptr)
+{
+    return ptr == nullptr;
+}
+
+template <typename T>
+static bool failed(const T &)
+{
+    return false;
+}
+
+instrumented_libvirt::stats &instrumented_libvirt::lookup(const char *api)
+{
+    // Ids are never reused, so stats cached for an instrumented_libvirt
+    // which has since been destroyed are never returned.
+    auto &cache = cache_;
+    if (cache.owner != id_) {
+        cache.users.clear();
+        cache.user = nullptr;
+        cache.owner = id_;
+    }
+    if (!cache.user) {
+        cache.user = &cache.users[current_user];
+    }
+
+    auto &entry = (*cache.user)[api];
+    if (!entry) {
+        entry = &resolve(api);
+    }
+    return *entry;
+}
+
+instrumented_libvirt::stats &instrumented_libvirt::resolve(const char *api)
+{
+    auto key = std::make_pair(api, current_user);
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (auto it = stats_.find(key); it != stats_.end()) {
+            return it->second;
+        }
+    }
+
+    // An unattributed call is one made outside of any user's request,
+    // such as from the libvirt event loop.
+    metrics::labels labels {
+        { "api", api },
+        { "user", current_user.empty() ? "-" : current_user },
+    };
+    stats entry {
+        &registry_.counter("webvirtd_libvirt_calls_total",
+                           "libvirt API calls made", labels),
+        &registry_.counter("webvirtd_libvirt_call_errors_total",
+                           "libvirt API calls which failed", labels),
+        &registry_.histogram("webvirtd_libvirt_call_duration_seconds",
+                             "Time taken by libvirt API calls", labels),
+    };
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    return stats_.emplace(std::move(key), entry).first->second;
+}
+
+template <typename Func>
+auto instrumented_libvirt::call(const char *api, Func fn, bool checked)
+    -> decltype(fn())
+{
+    auto &entry = lookup(api);
+    entry.calls->inc();
+
+    auto start = std::chrono::steady_clock::now();
+    auto observe = [api, &entry, &start] {
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        entry.duration->observe(elapsed.count());
+        if (auto *context = trace::current()) {
+            context->add(std::string("libvirt.") + api, elapsed.count());
+        }
+    };
+
+    try {
+        if constexpr (std::is_void_v<decltype(fn())>) {
+            fn();
+            observe();
+        } else {
+            auto result = fn();
+            observe();
+            if (checked && failed(result)) {
+                entry.errors->inc();
+            }
+            return result;
+        }
+    } catch (...) {
+        observe();
+        entry.errors->inc();
+        throw;
+    }
+}
+
+/* virConnect definitions */
+connect_ptr instrumented_libvirt::virConnectOpen(const char *uri)
+{
+    return call("virConnectOpen", [&] { return lv_.virConnectOpen(uri); });
+}
+
+int instrumented_libvirt::virConnectRegisterCloseCallback(
+    connect_ptr conn, void (*fn)(connect *, int, void *), void *data,
+    void (*free_data)(void *))
+{
+    return call("virConnectRegisterCloseCallback", [&] {
+        return lv_.virConnectRegisterCloseCallback(conn, fn, data, free_data);
+    });
+}
+
+std::string instrumented_libvirt::virConnectGetCapabilities(connect_ptr conn)
+{
+    return call("virConnectGetCapabilities",
+                [&] { return lv_.virConnectGetCapabilities(conn); });
+}
+
+std::string instrumented_libvirt::virConnectGetHostname(connect_ptr conn)
+{
+    return call("virConnectGetHostname",
+                [&] { return lv_.virConnectGetHostname(conn); });
+}
+
+int instrumented_libvirt::virConnectGetLibVersion(connect_ptr conn,
+                                                  unsigned long *version)
+{
+    return call("virConnectGetLibVersion",
+                [&] { return lv_.virConnectGetLibVersion(conn, version); });
+}
+
+int instrumented_libvirt::virConnectGetMaxVcpus(connect_ptr conn,
+                                                const char *type)
+{
+    return call("virConnectGetMaxVcpus",
+                [&] { return lv_.virConnectGetMaxVcpus(conn, type); });
+}
+
+std::string instrumented_libvirt::virConnectGetSysinfo(connect_ptr conn,
+                                                       unsigned int flags)
+{
+    return call("virConnectGetSysinfo",
+                [&] { return lv_.virConnectGetSysinfo(conn, flags); });
+}
+
+const char *instrumented_libvirt::virConnectGetType(connect_ptr conn)
+{
+    return call("virConnectGetType",
+                [&] { return lv_.virConnectGetType(conn); });
+}
+
+std::string instrumented_libvirt::virConnectGetURI(connect_ptr conn)
+{
+    return call("virConnectGetURI",
+                [&] { return lv_.virConnectGetURI(conn); });
+}
+
+int instrumented_libvirt::virConnectGetVersion(connect_ptr conn,
+                                               unsigned long *version)
+{
+    return call("virConnectGetVersion",
+                [&] { return lv_.virConnectGetVersion(conn, version); });
+}
+
+int instrumented_libvirt::virConnectIsEncrypted(connect_ptr conn)
+{
+    return call("virConnectIsEncrypted",
+                [&] { return lv_.virConnectIsEncrypted(conn); });
+}
+
+int instrumented_libvirt::virConnectIsSecure(connect_ptr conn)
+{
+    return call("virConnectIsSecure",
+                [&] { return lv_.virConnectIsSecure(conn); });
+}
+
+std::vector<domain_ptr>
+instrumented_libvirt::virConnectListAllDomains(connect_ptr conn, int flags)
+{
+    return call("virConnectListAllDomains",
+                [&] { return lv_.virConnectListAllDomains(conn, flags); });
+}
+
+std::vector<network_ptr>
+instrumented_libvirt::virConnectListAllNetworks(connect_ptr conn, int flags)
+{
+    return call("virConnectListAllNetworks",
+                [&] { return lv_.virConnectListAllNetworks(conn, flags); });
+}
+
+/* virDomain definitions */
+domain_ptr instrumented_libvirt::virDomainLookupByName(connect_ptr conn,
+                                                       const char *name)
+{
+    return call("virDomainLookupByName",
+                [&] { return lv_.virDomainLookupByName(conn, name); });
+}
+
+domain_ptr instrumented_libvirt::virDomainLookupByUUIDString(connect_ptr conn,
+                                                             const char *uuid)
+{
+    return call("virDomainLookupByUUIDString",
+                [&] { return lv_.virDomainLookupByUUIDString(conn, uuid); });
+}
+
+int instrumented_libvirt::virDomainCreate(domain_ptr domain)
+{
+    return call("virDomainCreate",
+                [&] { return lv_.virDomainCreate(domain); });
+}
+
+int instrumented_libvirt::virDomainRef(webvirt::domain *domain)
+{
+    return call("virDomainRef", [&] { return lv_.virDomainRef(domain); });
+}
+
+int instrumented_libvirt::virDomainFree(webvirt::domain *domain)
+{
+    // Releasing a handle is bookkeeping rather than a hypervisor call;
+    // it is forwarded without being measured.
+    return lv_.virDomainFree(domain);
+}
+
+int instrumented_libvirt::virConnectDomainEventRegisterAny(
+    connect *conn, domain *domain, int event_id,
+    void (*cb)(webvirt::connect *, webvirt::domain *, void *), void *opaque,
+    void (*free_cb)(void *))
+{
+    return call("virConnectDomainEventRegisterAny", [&] {
+        return lv_.virConnectDomainEventRegisterAny(
+            conn, domain, event_id, cb, opaque, free_cb);
+    });
+}
+
+int instrumented_libvirt::virConnectDomainEventDeregisterAny(connect_ptr conn,
+                                                             int callback_id)
+{
+    return call("virConnectDomainEventDeregisterAny", [&] {
+        return lv_.virConnectDomainEventDeregisterAny(conn, callback_id);
+    });
+}
+
+int instrumented_libvirt::virDomainGetState(domain_ptr domain, int *state,
+                                            int *reason, int flags)
+{
+    return call("virDomainGetState", [&] {
+        return lv_.virDomainGetState(domain, state, reason, flags);
+    });
+}
+
+int instrumented_libvirt::virDomainGetID(domain_ptr domain)
+{
+    // Inactive domains have an id of -1, which is not an error.
+    return call(
+        "virDomainGetID", [&] { return lv_.virDomainGetID(domain); }, false);
+}
+
+const char *instrumented_libvirt::virDomainGetName(domain_ptr domain)
+{
+    return call("virDomainGetName",
+                [&] { return lv_.virDomainGetName(domain); });
+}
+
+std::string instrumented_libvirt::virDomainGetUUIDString(domain_ptr domain)
+{
+    return call("virDomainGetUUIDString",
+                [&] { return lv_.virDomainGetUUIDString(domain); });
+}
+
+int instrumented_libvirt::virDomainGetAutostart(domain_ptr domain,
+                                                int *autostart)
+{
+    return call("virDomainGetAutostart",
+                [&] { return lv_.virDomainGetAutostart(domain, autostart); });
+}
+
+int instrumented_libvirt::virDomainSetAutostart(domain_ptr domain,
+                                                int autostart)
+{
+    return call("virDomainSetAutostart",
+                [&] { return lv_.virDomainSetAutostart(domain, autostart); });
+}
+
+std::string instrumented_libvirt::virDomainGetMetadata(domain_ptr domain,
+                                                       int type,
+                                                       const char *uri,
+                                                       unsigned int flags)
+{
+    return call("virDomainGetMetadata", [&] {
+        return lv_.virDomainGetMetadata(domain, type, uri, flags);
+    });
+}
+
+int instrumented_libvirt::virDomainSetMetadata(domain_ptr domain, int type,
+                                               const char *metadata,
+                                               const char *key,
+                                               const char *uri,
+                                               unsigned int flags)
+{
+    return call("virDomainSetMetadata", [&] {
+        return lv_.virDomainSetMetadata(
+            domain, type, metadata, key, uri, flags);
+    });
+}
+
+c_string instrumented_libvirt::virDomainGetXMLDesc(domain_ptr domain,
+                                                   int flags)
+{
+    return call("virDomainGetXMLDesc",
+                [&] { return lv_.virDomainGetXMLDesc(domain, flags); });
+}
+
+domain_ptr instrumented_libvirt::virDomainDefineXML(connect_ptr conn,
+                                                    const char *xml)
+{
+    return call("virDomainDefineXML",
+                [&] { return lv_.virDomainDefineXML(conn, xml); });
+}
+
+block_info_ptr instrumented_libvirt::virDomainGetBlockInfo(domain_ptr domain,
+                                                           const char *name,
+                                                           int flags)
+{
+    return call("virDomainGetBlockInfo", [&] {
+        return lv_.virDomainGetBlockInfo(domain, name, flags);
+    });
+}
+
+int instrumented_libvirt::virDomainShutdown(domain_ptr domain)
+{
+    return call("virDomainShutdown",
+                [&] { return lv_.virDomainShutdown(domain); });
+}
+
+/* virNetwork definitions */
+const char *instrumented_libvirt::virNetworkGetName(network_ptr network)
+{
+    return call("virNetworkGetName",
+                [&] { return lv_.virNetworkGetName(network); });
+}
+
+c_string instrumented_libvirt::virNetworkGetXMLDesc(network_ptr network,
+                                                    unsigned int flags)
+{
+    return call("virNetworkGetXMLDesc",
+                [&] { return lv_.virNetworkGetXMLDesc(network, flags); });
+}
+
+/* virEvent definitions */
+int instrumented_libvirt::virEventRegisterDefaultImpl()
+{
+    return call("virEventRegisterDefaultImpl",
+                [&] { return lv_.virEventRegisterDefaultImpl(); });
+}
+
+int instrumented_libvirt::virEventAddTimeout(int ms, void (*cb)(int, void *),
+                                             void *data,
+                                             void (*free_data)(void *))
+{
+    return call("virEventAddTimeout", [&] {
+        return lv_.virEventAddTimeout(ms, cb, data, free_data);
+    });
+}
+
+int instrumented_libvirt::virEventRunDefaultImpl()
+{
+    // This blocks until an event arrives; its duration says nothing
+    // about libvirt, so it is not recorded.
+    return lv_.virEventRunDefaultImpl();
+}
+
+/* virError definitions */
+void instrumented_libvirt::virConnSetErrorFunc(connect_ptr conn, void *data,
+                                               error_function fn)
+{
+    call("virConnSetErrorFunc",
+         [&] { lv_.virConnSetErrorFunc(conn, data, fn); });
+}
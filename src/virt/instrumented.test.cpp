@@ -0,0 +1,158 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <mocks/libvirt.hpp>
+#include <virt/instrumented.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace webvirt;
+
+using testing::_;
+using testing::Return;
+using testing::Test;
+using testing::Throw;
+
+class instrumented_test : public Test
+{
+protected:
+    mocks::libvirt lv;
+    metrics::registry registry;
+    virt::instrumented_libvirt instrumented { lv, registry };
+
+    connect_ptr conn = std::make_shared<webvirt::connect>();
+    domain_ptr domain = std::make_shared<webvirt::domain>();
+
+    metrics::counter &calls(const std::string &api, const std::string &user)
+    {
+        return registry.counter("webvirtd_libvirt_calls_total",
+                                "libvirt API calls made",
+                                { { "api", api }, { "user", user } });
+    }
+
+    metrics::counter &errors(const std::string &api, const std::string &user)
+    {
+        return registry.counter("webvirtd_libvirt_call_errors_total",
+                                "libvirt API calls which failed",
+                                { { "api", api }, { "user", user } });
+    }
+
+    metrics::histogram &duration(const std::string &api,
+                                 const std::string &user)
+    {
+        return registry.histogram("webvirtd_libvirt_call_duration_seconds",
+                                  "Time taken by libvirt API calls",
+                                  { { "api", api }, { "user", user } });
+    }
+};
+
+TEST_F(instrumented_test, forwards)
+{
+    EXPECT_CALL(lv, virConnectGetHostname(conn))
+        .WillOnce(Return("localhost"));
+    EXPECT_EQ(instrumented.virConnectGetHostname(conn), "localhost");
+
+    // Calls made outside of a scope are not attributed to a user.
+    EXPECT_EQ(calls("virConnectGetHostname", "-").value(), 1);
+    EXPECT_EQ(errors("virConnectGetHostname", "-").value(), 0);
+    EXPECT_EQ(duration("virConnectGetHostname", "-").count(), 1);
+}
+
+TEST_F(instrumented_test, scope)
+{
+    EXPECT_CALL(lv, virDomainGetState(domain, _, _, 0))
+        .WillRepeatedly(Return(0));
+
+    int state, reason;
+    {
+        virt::instrumented_libvirt::scope scope("test");
+        EXPECT_EQ(virt::instrumented_libvirt::user(), "test");
+        {
+            virt::instrumented_libvirt::scope inner("other");
+            instrumented.virDomainGetState(domain, &state, &reason, 0);
+        }
+        EXPECT_EQ(virt::instrumented_libvirt::user(), "test");
+        instrumented.virDomainGetState(domain, &state, &reason, 0);
+        instrumented.virDomainGetState(domain, &state, &reason, 0);
+    }
+    EXPECT_EQ(virt::instrumented_libvirt::user(), "");
+
+    EXPECT_EQ(calls("virDomainGetState", "test").value(), 2);
+    EXPECT_EQ(calls("virDomainGetState", "other").value(), 1);
+    EXPECT_EQ(duration("virDomainGetState", "test").count(), 2);
+}
+
+TEST_F(instrumented_test, instances)
+{
+    EXPECT_CALL(lv, virDomainGetID(domain)).WillRepeatedly(Return(1));
+
+    // Stats this thread cached for one instance aren't used by another.
+    virt::instrumented_libvirt::scope scope("test");
+    instrumented.virDomainGetID(domain);
+    {
+        metrics::registry other_registry;
+        virt::instrumented_libvirt other { lv, other_registry };
+        other.virDomainGetID(domain);
+        EXPECT_EQ(other_registry
+                      .counter("webvirtd_libvirt_calls_total",
+                               "libvirt API calls made",
+                               { { "api", "virDomainGetID" },
+                                 { "user", "test" } })
+                      .value(),
+                  1);
+    }
+    instrumented.virDomainGetID(domain);
+    EXPECT_EQ(calls("virDomainGetID", "test").value(), 2);
+}
+
+TEST_F(instrumented_test, errors)
+{
+    virt::instrumented_libvirt::scope scope("test");
+
+    EXPECT_CALL(lv, virDomainCreate(domain)).WillOnce(Return(-1));
+    EXPECT_EQ(instrumented.virDomainCreate(domain), -1);
+    EXPECT_EQ(errors("virDomainCreate", "test").value(), 1);
+
+    EXPECT_CALL(lv, virDomainLookupByName(conn, _))
+        .WillOnce(Return(nullptr));
+    EXPECT_EQ(instrumented.virDomainLookupByName(conn, "test"), nullptr);
+    EXPECT_EQ(errors("virDomainLookupByName", "test").value(), 1);
+
+    EXPECT_CALL(lv, virDomainGetXMLDesc(domain, 0))
+        .WillOnce(Throw(std::runtime_error("failed")));
+    EXPECT_THROW(instrumented.virDomainGetXMLDesc(domain, 0),
+                 std::runtime_error);
+    EXPECT_EQ(calls("virDomainGetXMLDesc", "test").value(), 1);
+    EXPECT_EQ(errors("virDomainGetXMLDesc", "test").value(), 1);
+    EXPECT_EQ(duration("virDomainGetXMLDesc", "test").count(), 1);
+
+    // Inactive domains have an id of -1.
+    EXPECT_CALL(lv, virDomainGetID(domain)).WillOnce(Return(-1));
+    EXPECT_EQ(instrumented.virDomainGetID(domain), -1);
+    EXPECT_EQ(calls("virDomainGetID", "test").value(), 1);
+    EXPECT_EQ(errors("virDomainGetID", "test").value(), 0);
+}
+
+TEST_F(instrumented_test, serialize)
+{
+    virt::instrumented_libvirt::scope scope("test");
+    EXPECT_CALL(lv, virDomainShutdown(domain)).WillOnce(Return(0));
+    instrumented.virDomainShutdown(domain);
+
+    auto output = registry.serialize();
+    EXPECT_NE(output.find("webvirtd_libvirt_calls_total{"
+                          "api=\"virDomainShutdown\",user=\"test\"} 1\n"),
+              std::string::npos);
+}
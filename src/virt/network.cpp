@@ -14,18 +14,16 @@
  * permissions and limitations under the License.
  */
 #include <virt/network.hpp>
+#include <virt/util.hpp>
 
 using namespace webvirt::virt;
 
-std::string network::xml_desc()
+webvirt::c_string network::xml_desc()
 {
     return libvirt::ref().virNetworkGetXMLDesc(ptr_, 0);
 }
 
 pugi::xml_document network::xml_document()
 {
-    pugi::xml_document doc;
-    auto desc = xml_desc();
-    doc.load_string(desc.c_str());
-    return doc;
+    return parse_xml(xml_desc());
 }
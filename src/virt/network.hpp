@@ -29,7 +29,7 @@ class network : public ptr_type<network_ptr>
 public:
     using ptr_type::ptr_type;
 
-    std::string xml_desc();
+    c_string xml_desc();
     pugi::xml_document xml_document();
 };
 
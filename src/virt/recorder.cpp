@@ -0,0 +1,594 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <virt/recorder.hpp>
+
+using namespace webvirt;
+using namespace webvirt::virt;
+
+using recording::api;
+using recording::encoder;
+
+// Result encoders shared by APIs returning the same type
+static void encode_int(encoder &out, int rc)
+{
+    out.i64(rc);
+}
+
+static void encode_string(encoder &out, const std::string &str)
+{
+    out.str(str);
+}
+
+static void encode_c_string(encoder &out, const c_string &str)
+{
+    out.opt_str(str ? str.c_str() : nullptr);
+}
+
+recording_libvirt::recording_libvirt(libvirt &lv, const std::string &path)
+    : lv_(lv)
+    , writer_(path)
+    , epoch_(std::chrono::steady_clock::now())
+{
+}
+
+recording_libvirt::~recording_libvirt()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    writer_.flush();
+}
+
+const char *recording_libvirt::name(const domain_ptr &domain)
+{
+    return domain ? lv_.virDomainGetName(domain) : nullptr;
+}
+
+const char *recording_libvirt::name(const network_ptr &network)
+{
+    return network ? lv_.virNetworkGetName(network) : nullptr;
+}
+
+std::string recording_libvirt::connection(const connect_ptr &conn)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = connections_.find(conn.get());
+    return it != connections_.end() ? it->second : std::string();
+}
+
+std::string recording_libvirt::connection(const domain_ptr &domain)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = domains_.find(domain.get());
+    return it != domains_.end() ? it->second.connection : std::string();
+}
+
+std::string recording_libvirt::connection(const network_ptr &network)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = networks_.find(network.get());
+    return it != networks_.end() ? it->second : std::string();
+}
+
+domain_ptr recording_libvirt::adopt(domain_ptr domain,
+                                    const std::string &connection)
+{
+    if (domain) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto &handle = domains_[domain.get()];
+        handle.connection = connection;
+        ++handle.refs;
+    }
+    return domain;
+}
+
+std::vector<domain_ptr>
+recording_libvirt::adopt(std::vector<domain_ptr> domains,
+                         const std::string &connection)
+{
+    for (auto &domain : domains) {
+        adopt(domain, connection);
+    }
+    return domains;
+}
+
+std::vector<network_ptr>
+recording_libvirt::adopt(std::vector<network_ptr> networks,
+                         const std::string &connection)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    // Networks are freed without passing through here, so their
+    // addresses are forgotten wholesale instead.
+    if (networks_.size() + networks.size() > max_networks) {
+        networks_.clear();
+    }
+    for (const auto &network : networks) {
+        networks_[network.get()] = connection;
+    }
+    return networks;
+}
+
+template <typename Func, typename Encode>
+auto recording_libvirt::call(api id, const std::string &connection,
+                             const encoder &args, Func fn, Encode encode)
+    -> decltype(fn())
+{
+    auto start = std::chrono::steady_clock::now();
+    auto result = fn();
+    auto end = std::chrono::steady_clock::now();
+
+    encoder out;
+    encode(out, result);
+
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    recording::entry entry {
+        id,
+        duration_cast<microseconds>(start - epoch_),
+        duration_cast<microseconds>(end - start),
+        args.data(),
+        out.data(),
+        connection,
+    };
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    writer_.write(entry);
+    return result;
+}
+
+/* virConnect definitions */
+connect_ptr recording_libvirt::virConnectOpen(const char *uri)
+{
+    return call(
+        api::virConnectOpen,
+        uri ? uri : "",
+        encoder().opt_str(uri),
+        [&] {
+            auto conn = lv_.virConnectOpen(uri);
+            if (conn) {
+                std::lock_guard<std::mutex> guard(mutex_);
+                connections_[conn.get()] = uri ? uri : "";
+            }
+            return conn;
+        },
+        [](encoder &out, const connect_ptr &conn) {
+            out.u64(conn != nullptr);
+        });
+}
+
+int recording_libvirt::virConnectRegisterCloseCallback(
+    connect_ptr conn, void (*cb)(connect *, int, void *), void *opaque,
+    void (*free_opaque)(void *))
+{
+    return lv_.virConnectRegisterCloseCallback(
+        conn, cb, opaque, free_opaque);
+}
+
+std::string recording_libvirt::virConnectGetCapabilities(connect_ptr conn)
+{
+    return call(
+        api::virConnectGetCapabilities,
+        connection(conn),
+        encoder(),
+        [&] { return lv_.virConnectGetCapabilities(conn); },
+        encode_string);
+}
+
+std::string recording_libvirt::virConnectGetHostname(connect_ptr conn)
+{
+    return call(
+        api::virConnectGetHostname,
+        connection(conn),
+        encoder(),
+        [&] { return lv_.virConnectGetHostname(conn); },
+        encode_string);
+}
+
+int recording_libvirt::virConnectGetLibVersion(connect_ptr conn,
+                                               unsigned long *version)
+{
+    return call(
+        api::virConnectGetLibVersion,
+        connection(conn),
+        encoder(),
+        [&] { return lv_.virConnectGetLibVersion(conn, version); },
+        [version](encoder &out, int rc) {
+            out.i64(rc).u64(rc < 0 ? 0 : *version);
+        });
+}
+
+int recording_libvirt::virConnectGetMaxVcpus(connect_ptr conn,
+                                             const char *type)
+{
+    return call(
+        api::virConnectGetMaxVcpus,
+        connection(conn),
+        encoder().opt_str(type),
+        [&] { return lv_.virConnectGetMaxVcpus(conn, type); },
+        encode_int);
+}
+
+std::string recording_libvirt::virConnectGetSysinfo(connect_ptr conn,
+                                                    unsigned int flags)
+{
+    return call(
+        api::virConnectGetSysinfo,
+        connection(conn),
+        encoder().u64(flags),
+        [&] { return lv_.virConnectGetSysinfo(conn, flags); },
+        encode_string);
+}
+
+const char *recording_libvirt::virConnectGetType(connect_ptr conn)
+{
+    return call(
+        api::virConnectGetType,
+        connection(conn),
+        encoder(),
+        [&] { return lv_.virConnectGetType(conn); },
+        [](encoder &out, const char *type) { out.opt_str(type); });
+}
+
+std::string recording_libvirt::virConnectGetURI(connect_ptr conn)
+{
+    return call(
+        api::virConnectGetURI,
+        connection(conn),
+        encoder(),
+        [&] { return lv_.virConnectGetURI(conn); },
+        encode_string);
+}
+
+int recording_libvirt::virConnectGetVersion(connect_ptr conn,
+                                            unsigned long *version)
+{
+    return call(
+        api::virConnectGetVersion,
+        connection(conn),
+        encoder(),
+        [&] { return lv_.virConnectGetVersion(conn, version); },
+        [version](encoder &out, int rc) {
+            out.i64(rc).u64(rc < 0 ? 0 : *version);
+        });
+}
+
+int recording_libvirt::virConnectIsEncrypted(connect_ptr conn)
+{
+    return call(
+        api::virConnectIsEncrypted,
+        connection(conn),
+        encoder(),
+        [&] { return lv_.virConnectIsEncrypted(conn); },
+        encode_int);
+}
+
+int recording_libvirt::virConnectIsSecure(connect_ptr conn)
+{
+    return call(
+        api::virConnectIsSecure,
+        connection(conn),
+        encoder(),
+        [&] { return lv_.virConnectIsSecure(conn); },
+        encode_int);
+}
+
+std::vector<domain_ptr>
+recording_libvirt::virConnectListAllDomains(connect_ptr conn, int flags)
+{
+    auto uri = connection(conn);
+    return call(
+        api::virConnectListAllDomains,
+        uri,
+        encoder().i64(flags),
+        [&] { return adopt(lv_.virConnectListAllDomains(conn, flags), uri); },
+        [this](encoder &out, const std::vector<domain_ptr> &domains) {
+            out.u64(domains.size());
+            for (const auto &domain : domains) {
+                out.opt_str(name(domain));
+            }
+        });
+}
+
+std::vector<network_ptr>
+recording_libvirt::virConnectListAllNetworks(connect_ptr conn, int flags)
+{
+    auto uri = connection(conn);
+    return call(
+        api::virConnectListAllNetworks,
+        uri,
+        encoder().i64(flags),
+        [&] { return adopt(lv_.virConnectListAllNetworks(conn, flags), uri); },
+        [this](encoder &out, const std::vector<network_ptr> &networks) {
+            out.u64(networks.size());
+            for (const auto &network : networks) {
+                out.opt_str(name(network));
+            }
+        });
+}
+
+/* virDomain definitions */
+domain_ptr recording_libvirt::virDomainLookupByName(connect_ptr conn,
+                                                    const char *domain)
+{
+    auto uri = connection(conn);
+    return call(
+        api::virDomainLookupByName,
+        uri,
+        encoder().opt_str(domain),
+        [&] { return adopt(lv_.virDomainLookupByName(conn, domain), uri); },
+        [this](encoder &out, const domain_ptr &result) {
+            out.opt_str(name(result));
+        });
+}
+
+domain_ptr recording_libvirt::virDomainLookupByUUIDString(connect_ptr conn,
+                                                          const char *uuid)
+{
+    auto uri = connection(conn);
+    return call(
+        api::virDomainLookupByUUIDString,
+        uri,
+        encoder().opt_str(uuid),
+        [&] {
+            return adopt(lv_.virDomainLookupByUUIDString(conn, uuid), uri);
+        },
+        [this](encoder &out, const domain_ptr &result) {
+            out.opt_str(name(result));
+        });
+}
+
+int recording_libvirt::virDomainCreate(domain_ptr domain)
+{
+    return call(
+        api::virDomainCreate,
+        connection(domain),
+        encoder().opt_str(name(domain)),
+        [&] { return lv_.virDomainCreate(domain); },
+        encode_int);
+}
+
+int recording_libvirt::virDomainRef(webvirt::domain *domain)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (auto it = domains_.find(domain); it != domains_.end()) {
+            ++it->second.refs;
+        }
+    }
+    return lv_.virDomainRef(domain);
+}
+
+int recording_libvirt::virDomainFree(webvirt::domain *domain)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (auto it = domains_.find(domain);
+            it != domains_.end() && !--it->second.refs) {
+            domains_.erase(it);
+        }
+    }
+    return lv_.virDomainFree(domain);
+}
+
+int recording_libvirt::virConnectDomainEventRegisterAny(
+    connect *conn, domain *domain, int event_id,
+    void (*cb)(webvirt::connect *, webvirt::domain *, void *), void *opaque,
+    void (*free_cb)(void *))
+{
+    return lv_.virConnectDomainEventRegisterAny(
+        conn, domain, event_id, cb, opaque, free_cb);
+}
+
+int recording_libvirt::virConnectDomainEventDeregisterAny(connect_ptr conn,
+                                                          int callback_id)
+{
+    return lv_.virConnectDomainEventDeregisterAny(conn, callback_id);
+}
+
+int recording_libvirt::virDomainGetState(domain_ptr domain, int *state,
+                                         int *reason, int flags)
+{
+    return call(
+        api::virDomainGetState,
+        connection(domain),
+        encoder().opt_str(name(domain)).i64(flags),
+        [&] { return lv_.virDomainGetState(domain, state, reason, flags); },
+        [state, reason](encoder &out, int rc) {
+            out.i64(rc);
+            out.i64(rc < 0 ? 0 : *state);
+            out.i64(rc < 0 || !reason ? 0 : *reason);
+        });
+}
+
+int recording_libvirt::virDomainGetID(domain_ptr domain)
+{
+    return call(
+        api::virDomainGetID,
+        connection(domain),
+        encoder().opt_str(name(domain)),
+        [&] { return lv_.virDomainGetID(domain); },
+        encode_int);
+}
+
+const char *recording_libvirt::virDomainGetName(domain_ptr domain)
+{
+    // Names identify handles in the recording; a replay knows them.
+    return lv_.virDomainGetName(domain);
+}
+
+std::string recording_libvirt::virDomainGetUUIDString(domain_ptr domain)
+{
+    return call(
+        api::virDomainGetUUIDString,
+        connection(domain),
+        encoder().opt_str(name(domain)),
+        [&] { return lv_.virDomainGetUUIDString(domain); },
+        encode_string);
+}
+
+int recording_libvirt::virDomainGetAutostart(domain_ptr domain,
+                                             int *autostart)
+{
+    return call(
+        api::virDomainGetAutostart,
+        connection(domain),
+        encoder().opt_str(name(domain)),
+        [&] { return lv_.virDomainGetAutostart(domain, autostart); },
+        [autostart](encoder &out, int rc) {
+            out.i64(rc).i64(rc < 0 ? 0 : *autostart);
+        });
+}
+
+int recording_libvirt::virDomainSetAutostart(domain_ptr domain,
+                                             int autostart)
+{
+    return call(
+        api::virDomainSetAutostart,
+        connection(domain),
+        encoder().opt_str(name(domain)).i64(autostart),
+        [&] { return lv_.virDomainSetAutostart(domain, autostart); },
+        encode_int);
+}
+
+std::string recording_libvirt::virDomainGetMetadata(domain_ptr domain,
+                                                    int type,
+                                                    const char *uri,
+                                                    unsigned int flags)
+{
+    return call(
+        api::virDomainGetMetadata,
+        connection(domain),
+        encoder().opt_str(name(domain)).i64(type).opt_str(uri).u64(flags),
+        [&] { return lv_.virDomainGetMetadata(domain, type, uri, flags); },
+        encode_string);
+}
+
+int recording_libvirt::virDomainSetMetadata(domain_ptr domain, int type,
+                                            const char *metadata,
+                                            const char *key, const char *uri,
+                                            unsigned int flags)
+{
+    return call(
+        api::virDomainSetMetadata,
+        connection(domain),
+        encoder()
+            .opt_str(name(domain))
+            .i64(type)
+            .opt_str(metadata)
+            .opt_str(key)
+            .opt_str(uri)
+            .u64(flags),
+        [&] {
+            return lv_.virDomainSetMetadata(
+                domain, type, metadata, key, uri, flags);
+        },
+        encode_int);
+}
+
+c_string recording_libvirt::virDomainGetXMLDesc(domain_ptr domain,
+                                                int flags)
+{
+    return call(
+        api::virDomainGetXMLDesc,
+        connection(domain),
+        encoder().opt_str(name(domain)).i64(flags),
+        [&] { return lv_.virDomainGetXMLDesc(domain, flags); },
+        encode_c_string);
+}
+
+domain_ptr recording_libvirt::virDomainDefineXML(connect_ptr conn,
+                                                 const char *xml)
+{
+    auto uri = connection(conn);
+    return call(
+        api::virDomainDefineXML,
+        uri,
+        encoder().opt_str(xml),
+        [&] { return adopt(lv_.virDomainDefineXML(conn, xml), uri); },
+        [this](encoder &out, const domain_ptr &result) {
+            out.opt_str(name(result));
+        });
+}
+
+block_info_ptr recording_libvirt::virDomainGetBlockInfo(domain_ptr domain,
+                                                        const char *disk,
+                                                        int flags)
+{
+    return call(
+        api::virDomainGetBlockInfo,
+        connection(domain),
+        encoder().opt_str(name(domain)).opt_str(disk).i64(flags),
+        [&] { return lv_.virDomainGetBlockInfo(domain, disk, flags); },
+        [](encoder &out, const block_info_ptr &info) {
+            out.u64(info != nullptr);
+            if (info) {
+                out.u64(info->capacity)
+                    .u64(info->allocation)
+                    .u64(info->physical);
+            }
+        });
+}
+
+int recording_libvirt::virDomainShutdown(domain_ptr domain)
+{
+    return call(
+        api::virDomainShutdown,
+        connection(domain),
+        encoder().opt_str(name(domain)),
+        [&] { return lv_.virDomainShutdown(domain); },
+        encode_int);
+}
+
+/* virNetwork definitions */
+const char *recording_libvirt::virNetworkGetName(network_ptr network)
+{
+    return lv_.virNetworkGetName(network);
+}
+
+c_string recording_libvirt::virNetworkGetXMLDesc(network_ptr network,
+                                                 unsigned int flags)
+{
+    return call(
+        api::virNetworkGetXMLDesc,
+        connection(network),
+        encoder().opt_str(name(network)).u64(flags),
+        [&] { return lv_.virNetworkGetXMLDesc(network, flags); },
+        encode_c_string);
+}
+
+/* virEvent definitions */
+int recording_libvirt::virEventRegisterDefaultImpl()
+{
+    return lv_.virEventRegisterDefaultImpl();
+}
+
+int recording_libvirt::virEventAddTimeout(int timeout,
+                                          void (*cb)(int, void *),
+                                          void *opaque,
+                                          void (*free_cb)(void *))
+{
+    return lv_.virEventAddTimeout(timeout, cb, opaque, free_cb);
+}
+
+int recording_libvirt::virEventRunDefaultImpl()
+{
+    return lv_.virEventRunDefaultImpl();
+}
+
+/* virError definitions */
+void recording_libvirt::virConnSetErrorFunc(connect_ptr conn, void *data,
+                                            error_function fn)
+{
+    lv_.virConnSetErrorFunc(conn, data, fn);
+}
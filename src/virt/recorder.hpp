@@ -0,0 +1,166 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef VIRT_RECORDER_HPP
+#define VIRT_RECORDER_HPP
+
+#include <libvirt.hpp>
+#include <virt/recording.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace webvirt::virt
+{
+
+/** A libvirt decorator recording every call to a file
+ *
+ * Calls are forwarded to the wrapped libvirt; their API, arguments,
+ * results, start time and duration are then appended to a recording
+ * which replay_libvirt can serve without a hypervisor. See
+ * recording.hpp for the format.
+ *
+ * Each call is recorded with the URI of its connection, as every user
+ * has a session connection of their own. Domains and networks are
+ * attributed to the connection which returned them; handles the
+ * recorder never returned, such as those passed to event callbacks, are
+ * recorded without a connection.
+ *
+ * Handle bookkeeping (virDomainRef, virDomainFree, names), event
+ * registration and the event loop are forwarded without being recorded.
+ **/
+class recording_libvirt : public libvirt
+{
+public:
+    /** Network handles remembered before they are forgotten at once */
+    static constexpr std::size_t max_networks = 4096;
+
+private:
+    struct handle {
+        std::string connection;
+        std::size_t refs { 0 };
+    };
+
+    libvirt &lv_;
+
+    std::mutex mutex_;
+    recording::writer writer_;
+    std::chrono::steady_clock::time_point epoch_;
+
+    // Connection URIs by handle
+    std::unordered_map<webvirt::connect *, std::string> connections_;
+    std::unordered_map<webvirt::domain *, handle> domains_;
+    std::unordered_map<webvirt::network *, std::string> networks_;
+
+public:
+    /** Construct a recording_libvirt
+     *
+     * @param lv libvirt to forward calls to
+     * @param path Recording path; truncated if it exists
+     * @throws std::runtime_error if the recording cannot be opened
+     **/
+    recording_libvirt(libvirt &lv, const std::string &path);
+
+    /** Flush and close the recording */
+    ~recording_libvirt();
+
+    // virConnect
+    connect_ptr virConnectOpen(const char *) override;
+    int virConnectRegisterCloseCallback(connect_ptr,
+                                        void (*)(connect *, int, void *),
+                                        void *, void (*)(void *)) override;
+    std::string virConnectGetCapabilities(connect_ptr) override;
+    std::string virConnectGetHostname(connect_ptr) override;
+    int virConnectGetLibVersion(connect_ptr, unsigned long *) override;
+    int virConnectGetMaxVcpus(connect_ptr, const char *) override;
+    std::string virConnectGetSysinfo(connect_ptr, unsigned int) override;
+    const char *virConnectGetType(connect_ptr) override;
+    std::string virConnectGetURI(connect_ptr) override;
+    int virConnectGetVersion(connect_ptr, unsigned long *) override;
+    int virConnectIsEncrypted(connect_ptr) override;
+    int virConnectIsSecure(connect_ptr) override;
+    std::vector<domain_ptr> virConnectListAllDomains(connect_ptr,
+                                                     int) override;
+    std::vector<network_ptr> virConnectListAllNetworks(connect_ptr,
+                                                       int) override;
+
+    // virDomain
+    domain_ptr virDomainLookupByName(connect_ptr, const char *) override;
+    domain_ptr virDomainLookupByUUIDString(connect_ptr,
+                                           const char *) override;
+    int virDomainCreate(domain_ptr) override;
+    int virDomainRef(webvirt::domain *) override;
+    int virDomainFree(webvirt::domain *) override;
+    int virConnectDomainEventRegisterAny(
+        webvirt::connect *, webvirt::domain *, int,
+        void (*)(webvirt::connect *, webvirt::domain *, void *), void *,
+        void (*)(void *)) override;
+    int virConnectDomainEventDeregisterAny(connect_ptr, int) override;
+    int virDomainGetState(domain_ptr, int *, int *, int) override;
+    int virDomainGetID(domain_ptr) override;
+    const char *virDomainGetName(domain_ptr) override;
+    std::string virDomainGetUUIDString(domain_ptr) override;
+    int virDomainGetAutostart(domain_ptr, int *) override;
+    int virDomainSetAutostart(domain_ptr, int) override;
+    std::string virDomainGetMetadata(domain_ptr, int, const char *,
+                                     unsigned int) override;
+    int virDomainSetMetadata(domain_ptr, int, const char *, const char *,
+                             const char *, unsigned int) override;
+    c_string virDomainGetXMLDesc(domain_ptr, int) override;
+    domain_ptr virDomainDefineXML(connect_ptr, const char *) override;
+    block_info_ptr virDomainGetBlockInfo(domain_ptr, const char *,
+                                         int) override;
+    int virDomainShutdown(domain_ptr) override;
+
+    // virNetwork
+    const char *virNetworkGetName(network_ptr) override;
+    c_string virNetworkGetXMLDesc(network_ptr, unsigned int) override;
+
+    // virEvent
+    int virEventRegisterDefaultImpl() override;
+    int virEventAddTimeout(int, void (*)(int, void *), void *,
+                           void (*)(void *)) override;
+    int virEventRunDefaultImpl() override;
+
+    // virterror
+    void virConnSetErrorFunc(connect_ptr, void *,
+                             webvirt::error_function) override;
+
+private:
+    const char *name(const domain_ptr &domain);
+    const char *name(const network_ptr &network);
+
+    std::string connection(const connect_ptr &conn);
+    std::string connection(const domain_ptr &domain);
+    std::string connection(const network_ptr &network);
+
+    domain_ptr adopt(domain_ptr domain, const std::string &connection);
+    std::vector<domain_ptr> adopt(std::vector<domain_ptr> domains,
+                                  const std::string &connection);
+    std::vector<network_ptr> adopt(std::vector<network_ptr> networks,
+                                   const std::string &connection);
+
+    template <typename Func, typename Encode>
+    auto call(recording::api id, const std::string &connection,
+              const recording::encoder &args, Func fn, Encode encode)
+        -> decltype(fn());
+};
+
+}; // namespace webvirt::virt
+
+#endif /* VIRT_RECORDER_HPP */
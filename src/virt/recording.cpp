@@ -0,0 +1,276 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <virt/recording.hpp>
+
+#include <stdexcept>
+
+using namespace webvirt::virt::recording;
+
+static constexpr char magic[] = "WVREC";
+static constexpr char version = 2;
+
+static std::uint64_t zigzag(std::int64_t value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^
+           static_cast<std::uint64_t>(value >> 63);
+}
+
+static std::int64_t unzigzag(std::uint64_t value)
+{
+    return static_cast<std::int64_t>(value >> 1) ^
+           -static_cast<std::int64_t>(value & 1);
+}
+
+/* encoder definitions */
+encoder &encoder::u64(std::uint64_t value)
+{
+    while (value >= 0x80) {
+        data_.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    data_.push_back(static_cast<char>(value));
+    return *this;
+}
+
+encoder &encoder::i64(std::int64_t value)
+{
+    return u64(zigzag(value));
+}
+
+encoder &encoder::str(const std::string &value)
+{
+    u64(value.size());
+    data_.append(value);
+    return *this;
+}
+
+encoder &encoder::opt_str(const char *value)
+{
+    // Lengths are written plus one, leaving zero for null.
+    if (!value) {
+        return u64(0);
+    }
+    std::string s(value);
+    u64(s.size() + 1);
+    data_.append(s);
+    return *this;
+}
+
+const std::string &encoder::data() const
+{
+    return data_;
+}
+
+/* decoder definitions */
+decoder::decoder(const std::string &data)
+    : data_(data)
+{
+}
+
+std::uint64_t decoder::u64()
+{
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (pos_ >= data_.size()) {
+            throw std::runtime_error("truncated recording value");
+        }
+        auto byte = static_cast<unsigned char>(data_[pos_++]);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw std::runtime_error("malformed recording value");
+}
+
+std::int64_t decoder::i64()
+{
+    return unzigzag(u64());
+}
+
+std::string decoder::str()
+{
+    auto size = u64();
+    if (size > data_.size() - pos_) {
+        throw std::runtime_error("truncated recording string");
+    }
+    std::string value = data_.substr(pos_, size);
+    pos_ += size;
+    return value;
+}
+
+std::optional<std::string> decoder::opt_str()
+{
+    auto size = u64();
+    if (!size--) {
+        return std::nullopt;
+    }
+    if (size > data_.size() - pos_) {
+        throw std::runtime_error("truncated recording string");
+    }
+    std::string value = data_.substr(pos_, size);
+    pos_ += size;
+    return value;
+}
+
+bool decoder::done() const
+{
+    return pos_ == data_.size();
+}
+
+/* writer definitions */
+writer::writer(const std::string &path)
+    : file_(path, std::ios::binary | std::ios::trunc)
+{
+    if (!file_) {
+        throw std::runtime_error("unable to open '" + path +
+                                 "' for recording");
+    }
+    file_.write(magic, sizeof(magic) - 1);
+    file_.put(version);
+}
+
+void writer::write(const entry &e)
+{
+    put(static_cast<std::uint64_t>(e.api));
+    put(e.connection);
+    put(zigzag((e.start - last_).count()));
+    put(static_cast<std::uint64_t>(e.duration.count()));
+    put(e.args);
+    put(e.result);
+    last_ = e.start;
+}
+
+void writer::flush()
+{
+    file_.flush();
+}
+
+void writer::put(std::uint64_t value)
+{
+    char buffer[10];
+    std::size_t n = 0;
+    while (value >= 0x80) {
+        buffer[n++] = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    buffer[n++] = static_cast<char>(value);
+    file_.write(buffer, n);
+}
+
+void writer::put(const std::string &value)
+{
+    if (auto it = strings_.find(value); it != strings_.end()) {
+        return put(it->second);
+    }
+
+    put(0);
+    put(value.size());
+    file_.write(value.data(), value.size());
+
+    // The reader interns under the same rule.
+    if (value.size() <= max_interned - interned_) {
+        interned_ += value.size();
+        strings_.emplace(value, strings_.size() + 1);
+    }
+}
+
+/* reader definitions */
+reader::reader(const std::string &path)
+    : file_(path, std::ios::binary)
+{
+    if (!file_) {
+        throw std::runtime_error("unable to open recording '" + path + "'");
+    }
+
+    char header[sizeof(magic)] = {};
+    file_.read(header, sizeof(header));
+    if (!file_ || std::string(header, sizeof(magic) - 1) != magic ||
+        header[sizeof(magic) - 1] != version) {
+        throw std::runtime_error("'" + path + "' is not a recording");
+    }
+}
+
+bool reader::read(entry &e)
+{
+    std::uint64_t api;
+    if (!get(api)) {
+        return false;
+    }
+    if (api >= static_cast<std::uint64_t>(recording::api::count)) {
+        throw std::runtime_error("unknown api in recording");
+    }
+
+    e.api = static_cast<recording::api>(api);
+    e.connection = get_str();
+    e.start = last_ + std::chrono::microseconds(unzigzag(get()));
+    e.duration = std::chrono::microseconds(get());
+    e.args = get_str();
+    e.result = get_str();
+    last_ = e.start;
+    return true;
+}
+
+bool reader::get(std::uint64_t &value)
+{
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        int byte = file_.get();
+        if (byte == std::ifstream::traits_type::eof()) {
+            if (shift) {
+                throw std::runtime_error("truncated recording");
+            }
+            return false;
+        }
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    throw std::runtime_error("malformed recording value");
+}
+
+std::uint64_t reader::get()
+{
+    std::uint64_t value;
+    if (!get(value)) {
+        throw std::runtime_error("truncated recording");
+    }
+    return value;
+}
+
+std::string reader::get_str()
+{
+    auto index = get();
+    if (index) {
+        if (index > strings_.size()) {
+            throw std::runtime_error("bad string reference in recording");
+        }
+        return strings_[index - 1];
+    }
+
+    auto size = get();
+    std::string value(size, '\0');
+    file_.read(value.data(), size);
+    if (static_cast<std::uint64_t>(file_.gcount()) != size) {
+        throw std::runtime_error("truncated recording");
+    }
+    if (value.size() <= max_interned - interned_) {
+        interned_ += value.size();
+        strings_.push_back(value);
+    }
+    return value;
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef VIRT_RECORDING_HPP
+#define VIRT_RECORDING_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** Recorded libvirt traffic
+ *
+ * A recording is a header followed by one entry per libvirt call:
+ *
+ *     magic "WVREC" and a format version byte
+ *     entry*: api (varint)
+ *             connection (string)
+ *             start (zigzag varint, microseconds since the previous entry)
+ *             duration (varint, microseconds)
+ *             args (string)
+ *             result (string)
+ *
+ * Strings are interned: a string is written as varint 0, its length and
+ * its bytes the first time it occurs, and as varint n to repeat the
+ * n-th interned string after that. Domain XML and listings repeat
+ * constantly, so a recording costs little more than its distinct
+ * responses. Once max_interned bytes have been interned, new strings
+ * are written in full each time and take no index, bounding the table
+ * kept by both the writer and the reader.
+ *
+ * Arguments and results are themselves serialized with an encoder, and
+ * domain and network handles are written by name, so that a replay can
+ * look up responses by connection, API and arguments. Connections are
+ * recorded by URI, since each user has a session connection of their
+ * own.
+ **/
+namespace webvirt::virt::recording
+{
+
+/** Bytes of distinct strings interned by a writer or reader */
+static constexpr std::size_t max_interned = 16 << 20;
+
+/** Recorded libvirt APIs; values are part of the file format */
+enum class api : std::uint8_t {
+    virConnectOpen,
+    virConnectGetCapabilities,
+    virConnectGetHostname,
+    virConnectGetLibVersion,
+    virConnectGetMaxVcpus,
+    virConnectGetSysinfo,
+    virConnectGetType,
+    virConnectGetURI,
+    virConnectGetVersion,
+    virConnectIsEncrypted,
+    virConnectIsSecure,
+    virConnectListAllDomains,
+    virConnectListAllNetworks,
+    virDomainLookupByName,
+    virDomainLookupByUUIDString,
+    virDomainCreate,
+    virDomainGetState,
+    virDomainGetID,
+    virDomainGetUUIDString,
+    virDomainGetAutostart,
+    virDomainSetAutostart,
+    virDomainGetMetadata,
+    virDomainSetMetadata,
+    virDomainGetXMLDesc,
+    virDomainDefineXML,
+    virDomainGetBlockInfo,
+    virDomainShutdown,
+    virNetworkGetXMLDesc,
+    count,
+};
+
+/** A recorded libvirt call */
+struct entry {
+    recording::api api;
+    /** Time since the recording started */
+    std::chrono::microseconds start;
+    std::chrono::microseconds duration;
+    /** Serialized arguments */
+    std::string args;
+    /** Serialized results */
+    std::string result;
+    /** URI of the connection the call was made on; empty if unknown */
+    std::string connection;
+};
+
+/** Serializes values into a byte string */
+class encoder
+{
+private:
+    std::string data_;
+
+public:
+    encoder &u64(std::uint64_t value);
+    encoder &i64(std::int64_t value);
+    encoder &str(const std::string &value);
+
+    /** Encode a string which may be null
+     *
+     * @param value String or nullptr
+     * @returns Reference to this
+     **/
+    encoder &opt_str(const char *value);
+
+    const std::string &data() const;
+};
+
+/** Deserializes values written by an encoder
+ *
+ * Reading past the end of the data throws std::runtime_error.
+ **/
+class decoder
+{
+private:
+    const std::string &data_;
+    std::size_t pos_ = 0;
+
+public:
+    decoder(const std::string &data);
+
+    std::uint64_t u64();
+    std::int64_t i64();
+    std::string str();
+
+    /** Decode a string written by encoder::str(const char *)
+     *
+     * @returns String, or std::nullopt if null was written
+     **/
+    std::optional<std::string> opt_str();
+
+    /** @returns True if all data has been read */
+    bool done() const;
+};
+
+/** Writes a recording to a file */
+class writer
+{
+private:
+    std::ofstream file_;
+    std::unordered_map<std::string, std::uint64_t> strings_;
+    std::size_t interned_ { 0 };
+    std::chrono::microseconds last_ { 0 };
+
+public:
+    /** Open a file for recording, truncating it
+     *
+     * @param path Recording path
+     * @throws std::runtime_error if the file cannot be opened
+     **/
+    writer(const std::string &path);
+
+    void write(const entry &e);
+    void flush();
+
+private:
+    void put(std::uint64_t value);
+    void put(const std::string &value);
+};
+
+/** Reads a recording from a file */
+class reader
+{
+private:
+    std::ifstream file_;
+    std::vector<std::string> strings_;
+    std::size_t interned_ { 0 };
+    std::chrono::microseconds last_ { 0 };
+
+public:
+    /** Open a recording
+     *
+     * @param path Recording path
+     * @throws std::runtime_error if the file cannot be opened or is not
+     *         a recording
+     **/
+    reader(const std::string &path);
+
+    /** Read the next entry
+     *
+     * @param e Entry to read into
+     * @returns True if an entry was read, false at the end of the file
+     * @throws std::runtime_error on a truncated or corrupt entry
+     **/
+    bool read(entry &e);
+
+private:
+    bool get(std::uint64_t &value);
+    std::uint64_t get();
+    std::string get_str();
+};
+
+}; // namespace webvirt::virt::recording
+
+#endif /* VIRT_RECORDING_HPP */
@@ -0,0 +1,327 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <mocks/libvirt.hpp>
+#include <util/util.hpp>
+#include <virt/backend.hpp>
+#include <virt/recorder.hpp>
+#include <virt/replay.hpp>
+
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+using namespace webvirt;
+using namespace std::chrono_literals;
+
+using testing::_;
+using testing::DoAll;
+using testing::Return;
+using testing::SetArgPointee;
+using testing::Test;
+
+class recording_test : public Test
+{
+protected:
+    std::filesystem::path tmpdir;
+    std::string path;
+
+    mocks::libvirt lv;
+    connect_ptr conn = std::make_shared<webvirt::connect>();
+    domain_ptr domain = std::make_shared<webvirt::domain>();
+    network_ptr network = std::make_shared<webvirt::network>();
+
+public:
+    void SetUp() override
+    {
+        tmpdir = make_tmpdir();
+        path = tmpdir / "libvirt.rec";
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(tmpdir);
+    }
+};
+
+TEST(recording, encoding)
+{
+    using virt::recording::decoder;
+    using virt::recording::encoder;
+
+    auto data = encoder()
+                    .u64(300)
+                    .i64(-5)
+                    .str("abc")
+                    .opt_str(nullptr)
+                    .opt_str("")
+                    .data();
+    decoder d(data);
+    EXPECT_EQ(d.u64(), 300u);
+    EXPECT_EQ(d.i64(), -5);
+    EXPECT_EQ(d.str(), "abc");
+    EXPECT_EQ(d.opt_str(), std::nullopt);
+    EXPECT_EQ(d.opt_str(), "");
+    EXPECT_TRUE(d.done());
+    EXPECT_THROW(d.u64(), std::runtime_error);
+}
+
+TEST_F(recording_test, file)
+{
+    std::string xml(4096, 'x');
+    {
+        virt::recording::writer writer(path);
+        for (int i = 0; i < 100; ++i) {
+            writer.write({ virt::recording::api::virDomainGetXMLDesc,
+                           std::chrono::microseconds(i * 10),
+                           250us,
+                           "args",
+                           xml,
+                           "qemu:///system" });
+        }
+    }
+
+    // Repeated strings are written once.
+    EXPECT_LT(std::filesystem::file_size(path), 2 * xml.size());
+
+    virt::recording::reader reader(path);
+    virt::recording::entry entry;
+    int count = 0;
+    while (reader.read(entry)) {
+        EXPECT_EQ(entry.api, virt::recording::api::virDomainGetXMLDesc);
+        EXPECT_EQ(entry.start, std::chrono::microseconds(count * 10));
+        EXPECT_EQ(entry.duration, 250us);
+        EXPECT_EQ(entry.args, "args");
+        EXPECT_EQ(entry.result, xml);
+        EXPECT_EQ(entry.connection, "qemu:///system");
+        ++count;
+    }
+    EXPECT_EQ(count, 100);
+
+    EXPECT_THROW(virt::recording::reader("/nonexistent/libvirt.rec"),
+                 std::runtime_error);
+    EXPECT_THROW(virt::recording::writer("/nonexistent/libvirt.rec"),
+                 std::runtime_error);
+}
+
+TEST_F(recording_test, max_interned)
+{
+    // Strings past the interning budget are written in full each time.
+    constexpr std::size_t size = 1 << 20;
+    constexpr std::size_t count = virt::recording::max_interned / size + 1;
+    {
+        virt::recording::writer writer(path);
+        for (int pass = 0; pass < 2; ++pass) {
+            for (std::size_t i = 0; i < count; ++i) {
+                writer.write({ virt::recording::api::virDomainGetXMLDesc,
+                               0us,
+                               0us,
+                               "",
+                               std::string(size, 'a' + i),
+                               "" });
+            }
+        }
+    }
+    EXPECT_GT(std::filesystem::file_size(path), (count + 1) * size);
+    EXPECT_LT(std::filesystem::file_size(path), (count + 2) * size);
+
+    virt::recording::reader reader(path);
+    virt::recording::entry entry;
+    std::size_t n = 0;
+    while (reader.read(entry)) {
+        EXPECT_EQ(entry.result, std::string(size, 'a' + n % count));
+        ++n;
+    }
+    EXPECT_EQ(n, 2 * count);
+}
+
+TEST_F(recording_test, record_replay)
+{
+    EXPECT_CALL(lv, virConnectOpen(_)).WillOnce(Return(conn));
+    EXPECT_CALL(lv, virConnectGetHostname(conn)).WillOnce(Return("host"));
+    EXPECT_CALL(lv, virConnectListAllDomains(conn, 0))
+        .WillOnce(Return(std::vector<domain_ptr> { domain }));
+    EXPECT_CALL(lv, virConnectListAllNetworks(conn, 0))
+        .WillOnce(Return(std::vector<network_ptr> { network }));
+    EXPECT_CALL(lv, virDomainGetName(domain))
+        .WillRepeatedly(Return("test"));
+    EXPECT_CALL(lv, virNetworkGetName(network))
+        .WillRepeatedly(Return("default"));
+    EXPECT_CALL(lv, virDomainGetXMLDesc(domain, 0))
+        .WillOnce(Return(c_string("<domain/>")));
+    EXPECT_CALL(lv, virNetworkGetXMLDesc(network, 0))
+        .WillOnce(Return(c_string("<network/>")));
+    EXPECT_CALL(lv, virDomainGetState(domain, _, _, 0))
+        .WillOnce(DoAll(SetArgPointee<1>(VIR_DOMAIN_RUNNING),
+                        SetArgPointee<2>(1),
+                        Return(0)))
+        .WillOnce(DoAll(SetArgPointee<1>(VIR_DOMAIN_SHUTOFF),
+                        SetArgPointee<2>(2),
+                        Return(0)));
+    EXPECT_CALL(lv, virDomainLookupByName(conn, _))
+        .WillOnce(Return(domain))
+        .WillOnce(Return(nullptr));
+    EXPECT_CALL(lv, virDomainGetBlockInfo(domain, "vda", 0))
+        .WillOnce(Return(std::make_shared<block_info>(
+            block_info { 1024, 512, 256 })));
+
+    {
+        virt::recording_libvirt recorder(lv, path);
+        auto c = recorder.virConnectOpen("qemu:///system");
+        EXPECT_EQ(recorder.virConnectGetHostname(c), "host");
+        auto domains = recorder.virConnectListAllDomains(c, 0);
+        ASSERT_EQ(domains.size(), 1u);
+        EXPECT_STREQ(recorder.virDomainGetXMLDesc(domains[0], 0).c_str(),
+                     "<domain/>");
+        auto networks = recorder.virConnectListAllNetworks(c, 0);
+        EXPECT_STREQ(recorder.virNetworkGetXMLDesc(networks[0], 0).c_str(),
+                     "<network/>");
+        int state, reason;
+        recorder.virDomainGetState(domain, &state, &reason, 0);
+        recorder.virDomainGetState(domain, &state, &reason, 0);
+        EXPECT_EQ(recorder.virDomainLookupByName(c, "test"), domain);
+        EXPECT_EQ(recorder.virDomainLookupByName(c, "missing"), nullptr);
+        recorder.virDomainGetBlockInfo(domain, "vda", 0);
+    }
+
+    virt::replay_libvirt replay(path);
+    EXPECT_EQ(replay.size(), 11u);
+
+    auto c = replay.virConnectOpen("qemu:///system");
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(replay.virConnectGetHostname(c), "host");
+
+    auto domains = replay.virConnectListAllDomains(c, 0);
+    ASSERT_EQ(domains.size(), 1u);
+    EXPECT_STREQ(replay.virDomainGetName(domains[0]), "test");
+    EXPECT_STREQ(replay.virDomainGetXMLDesc(domains[0], 0).c_str(),
+                 "<domain/>");
+
+    auto networks = replay.virConnectListAllNetworks(c, 0);
+    ASSERT_EQ(networks.size(), 1u);
+    EXPECT_STREQ(replay.virNetworkGetName(networks[0]), "default");
+    EXPECT_STREQ(replay.virNetworkGetXMLDesc(networks[0], 0).c_str(),
+                 "<network/>");
+
+    // Responses are served in recorded order, then from the start again.
+    int state, reason;
+    for (int expected : { VIR_DOMAIN_RUNNING,
+                          VIR_DOMAIN_SHUTOFF,
+                          VIR_DOMAIN_RUNNING }) {
+        EXPECT_EQ(replay.virDomainGetState(domains[0], &state, &reason, 0),
+                  0);
+        EXPECT_EQ(state, expected);
+    }
+
+    auto found = replay.virDomainLookupByName(c, "test");
+    EXPECT_EQ(found.get(), domains[0].get());
+    EXPECT_EQ(replay.virDomainLookupByName(c, "missing"), nullptr);
+
+    auto info = replay.virDomainGetBlockInfo(found, "vda", 0);
+    ASSERT_NE(info, nullptr);
+    EXPECT_EQ(info->capacity, 1024u);
+    EXPECT_EQ(info->allocation, 512u);
+    EXPECT_EQ(info->physical, 256u);
+
+    // Calls which were never recorded fail.
+    EXPECT_EQ(replay.misses(), 0u);
+    EXPECT_EQ(replay.virDomainGetXMLDesc(domains[0], 1), false);
+    EXPECT_EQ(replay.virDomainShutdown(domains[0]), -1);
+    EXPECT_EQ(replay.misses(), 2u);
+}
+
+TEST_F(recording_test, connections)
+{
+    // Each user has a session connection of their own.
+    connect_ptr other = std::make_shared<webvirt::connect>();
+    domain_ptr other_domain = std::make_shared<webvirt::domain>();
+    EXPECT_CALL(lv, virConnectOpen(_))
+        .WillOnce(Return(conn))
+        .WillOnce(Return(other));
+    EXPECT_CALL(lv, virConnectGetHostname(conn)).WillOnce(Return("a"));
+    EXPECT_CALL(lv, virConnectGetHostname(other)).WillOnce(Return("b"));
+    EXPECT_CALL(lv, virDomainLookupByName(conn, _)).WillOnce(Return(domain));
+    EXPECT_CALL(lv, virDomainLookupByName(other, _))
+        .WillOnce(Return(other_domain));
+    EXPECT_CALL(lv, virDomainGetName(_)).WillRepeatedly(Return("test"));
+    EXPECT_CALL(lv, virDomainGetXMLDesc(domain, 0))
+        .WillOnce(Return(c_string("<a/>")));
+    EXPECT_CALL(lv, virDomainGetXMLDesc(other_domain, 0))
+        .WillOnce(Return(c_string("<b/>")));
+
+    const char *uri_a = "qemu+ssh://a@localhost/session";
+    const char *uri_b = "qemu+ssh://b@localhost/session";
+    {
+        virt::recording_libvirt recorder(lv, path);
+        auto a = recorder.virConnectOpen(uri_a);
+        auto b = recorder.virConnectOpen(uri_b);
+        recorder.virConnectGetHostname(a);
+        recorder.virConnectGetHostname(b);
+        recorder.virDomainGetXMLDesc(recorder.virDomainLookupByName(a, "test"),
+                                     0);
+        recorder.virDomainGetXMLDesc(recorder.virDomainLookupByName(b, "test"),
+                                     0);
+    }
+
+    virt::replay_libvirt replay(path);
+    auto b = replay.virConnectOpen(uri_b);
+    auto a = replay.virConnectOpen(uri_a);
+    EXPECT_EQ(replay.virConnectGetHostname(b), "b");
+    EXPECT_EQ(replay.virConnectGetHostname(a), "a");
+    auto domain_b = replay.virDomainLookupByName(b, "test");
+    auto domain_a = replay.virDomainLookupByName(a, "test");
+    EXPECT_NE(domain_a.get(), domain_b.get());
+    EXPECT_STREQ(replay.virDomainGetXMLDesc(domain_b, 0).c_str(), "<b/>");
+    EXPECT_STREQ(replay.virDomainGetXMLDesc(domain_a, 0).c_str(), "<a/>");
+    EXPECT_EQ(replay.misses(), 0u);
+}
+
+TEST_F(recording_test, timed)
+{
+    {
+        virt::recording::writer writer(path);
+        writer.write({ virt::recording::api::virConnectGetHostname,
+                       0us,
+                       20ms,
+                       "",
+                       virt::recording::encoder().str("host").data(),
+                       "" });
+    }
+
+    virt::replay_libvirt replay(path);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(replay.virConnectGetHostname(nullptr), "host");
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 20ms);
+
+    virt::replay_libvirt timed(path, true);
+    start = std::chrono::steady_clock::now();
+    EXPECT_EQ(timed.virConnectGetHostname(nullptr), "host");
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+}
+
+TEST_F(recording_test, backend)
+{
+    EXPECT_THROW(virt::make_backend("record"), std::invalid_argument);
+    EXPECT_THROW(virt::make_backend("replay:/nonexistent/libvirt.rec"),
+                 std::runtime_error);
+
+    auto recorder = virt::make_backend("record:" + path);
+    ASSERT_NE(dynamic_cast<virt::recording_libvirt *>(recorder.get()),
+              nullptr);
+    recorder.reset();
+
+    auto replay = virt::make_backend("replay-timed:" + path);
+    ASSERT_NE(dynamic_cast<virt::replay_libvirt *>(replay.get()), nullptr);
+}
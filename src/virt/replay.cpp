@@ -0,0 +1,574 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <util/logging.hpp>
+#include <virt/replay.hpp>
+
+#include <fmt/format.h>
+#include <thread>
+
+using namespace webvirt;
+using namespace webvirt::virt;
+
+using recording::api;
+using recording::decoder;
+using recording::encoder;
+
+static std::string key(api api, const std::string &connection,
+                       const std::string &args)
+{
+    // URIs hold no NUL, which ends the connection.
+    return static_cast<char>(api) + connection + '\0' + args;
+}
+
+replay_libvirt::replay_libvirt(const std::string &path, bool timed)
+    : timed_(timed)
+{
+    recording::reader reader(path);
+    recording::entry entry;
+    while (reader.read(entry)) {
+        auto &responses =
+            responses_[key(entry.api, entry.connection, entry.args)];
+        responses.recorded.push_back(
+            { std::move(entry.result), entry.duration });
+        ++size_;
+    }
+}
+
+replay_libvirt::~replay_libvirt()
+{
+    for (auto &[id, cb] : callbacks_) {
+        if (cb.first) {
+            cb.first(cb.second);
+        }
+    }
+}
+
+std::size_t replay_libvirt::size() const
+{
+    return size_;
+}
+
+std::size_t replay_libvirt::misses() const
+{
+    return misses_;
+}
+
+std::optional<std::string>
+replay_libvirt::serve(api api, const std::string &connection,
+                      const encoder &args)
+{
+    response r;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = responses_.find(key(api, connection, args.data()));
+        if (it == responses_.end()) {
+            ++misses_;
+            logger::debug([api] {
+                return fmt::format("Replay has no response for api {}",
+                                   static_cast<int>(api));
+            });
+            return std::nullopt;
+        }
+
+        auto &entry = it->second;
+        r = entry.recorded[entry.next];
+        entry.next = (entry.next + 1) % entry.recorded.size();
+    }
+
+    if (timed_) {
+        std::this_thread::sleep_for(r.duration);
+    }
+    return std::move(r.result);
+}
+
+domain_ptr replay_libvirt::domain(const std::string &connection,
+                                  const std::optional<std::string> &name)
+{
+    if (!name) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &h = *domains_.emplace(connection, *name).first;
+    return domain_ptr(
+        reinterpret_cast<webvirt::domain *>(const_cast<handle *>(&h)),
+        [](webvirt::domain *) {});
+}
+
+network_ptr replay_libvirt::network(const std::string &connection,
+                                    const std::optional<std::string> &name)
+{
+    if (!name) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &h = *networks_.emplace(connection, *name).first;
+    return network_ptr(
+        reinterpret_cast<webvirt::network *>(const_cast<handle *>(&h)),
+        [](webvirt::network *) {});
+}
+
+const char *replay_libvirt::name(const domain_ptr &domain)
+{
+    return domain ? reinterpret_cast<handle *>(domain.get())->second.c_str()
+                  : nullptr;
+}
+
+const char *replay_libvirt::name(const network_ptr &network)
+{
+    return network ? reinterpret_cast<handle *>(network.get())->second.c_str()
+                   : nullptr;
+}
+
+const std::string &replay_libvirt::connection(const connect_ptr &conn)
+{
+    static const std::string unknown;
+    return conn ? *reinterpret_cast<std::string *>(conn.get()) : unknown;
+}
+
+const std::string &replay_libvirt::connection(const domain_ptr &domain)
+{
+    static const std::string unknown;
+    return domain ? reinterpret_cast<handle *>(domain.get())->first
+                  : unknown;
+}
+
+const std::string &replay_libvirt::connection(const network_ptr &network)
+{
+    static const std::string unknown;
+    return network ? reinterpret_cast<handle *>(network.get())->first
+                   : unknown;
+}
+
+const char *replay_libvirt::intern(const std::optional<std::string> &str)
+{
+    if (!str) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    return strings_.insert(*str).first->c_str();
+}
+
+// Decoders for APIs returning a single value; a miss fails.
+static int int_result(const std::optional<std::string> &result)
+{
+    return result ? static_cast<int>(decoder(*result).i64()) : -1;
+}
+
+static std::string string_result(const std::optional<std::string> &result)
+{
+    return result ? decoder(*result).str() : std::string();
+}
+
+static c_string c_string_result(const std::optional<std::string> &result)
+{
+    if (!result) {
+        return c_string();
+    }
+    auto str = decoder(*result).opt_str();
+    return str ? c_string(*str) : c_string();
+}
+
+/* virConnect definitions */
+connect_ptr replay_libvirt::virConnectOpen(const char *uri)
+{
+    // A connection is its interned URI; only a recorded failure fails.
+    std::string connection(uri ? uri : "");
+    auto result =
+        serve(api::virConnectOpen, connection, encoder().opt_str(uri));
+    if (result && !decoder(*result).u64()) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &str = *connections_.insert(connection).first;
+    return connect_ptr(
+        reinterpret_cast<webvirt::connect *>(const_cast<std::string *>(&str)),
+        [](webvirt::connect *) {});
+}
+
+int replay_libvirt::virConnectRegisterCloseCallback(
+    connect_ptr, void (*)(connect *, int, void *), void *, void (*)(void *))
+{
+    return 0;
+}
+
+std::string replay_libvirt::virConnectGetCapabilities(connect_ptr conn)
+{
+    return string_result(
+        serve(api::virConnectGetCapabilities, connection(conn), encoder()));
+}
+
+std::string replay_libvirt::virConnectGetHostname(connect_ptr conn)
+{
+    return string_result(
+        serve(api::virConnectGetHostname, connection(conn), encoder()));
+}
+
+int replay_libvirt::virConnectGetLibVersion(connect_ptr conn,
+                                            unsigned long *version)
+{
+    auto result =
+        serve(api::virConnectGetLibVersion, connection(conn), encoder());
+    if (!result) {
+        return -1;
+    }
+    decoder d(*result);
+    int rc = d.i64();
+    *version = d.u64();
+    return rc;
+}
+
+int replay_libvirt::virConnectGetMaxVcpus(connect_ptr conn,
+                                          const char *type)
+{
+    return int_result(serve(api::virConnectGetMaxVcpus,
+                            connection(conn),
+                            encoder().opt_str(type)));
+}
+
+std::string replay_libvirt::virConnectGetSysinfo(connect_ptr conn,
+                                                 unsigned int flags)
+{
+    return string_result(serve(
+        api::virConnectGetSysinfo, connection(conn), encoder().u64(flags)));
+}
+
+const char *replay_libvirt::virConnectGetType(connect_ptr conn)
+{
+    auto result = serve(api::virConnectGetType, connection(conn), encoder());
+    return result ? intern(decoder(*result).opt_str()) : nullptr;
+}
+
+std::string replay_libvirt::virConnectGetURI(connect_ptr conn)
+{
+    return string_result(
+        serve(api::virConnectGetURI, connection(conn), encoder()));
+}
+
+int replay_libvirt::virConnectGetVersion(connect_ptr conn,
+                                         unsigned long *version)
+{
+    auto result =
+        serve(api::virConnectGetVersion, connection(conn), encoder());
+    if (!result) {
+        return -1;
+    }
+    decoder d(*result);
+    int rc = d.i64();
+    *version = d.u64();
+    return rc;
+}
+
+int replay_libvirt::virConnectIsEncrypted(connect_ptr conn)
+{
+    return int_result(
+        serve(api::virConnectIsEncrypted, connection(conn), encoder()));
+}
+
+int replay_libvirt::virConnectIsSecure(connect_ptr conn)
+{
+    return int_result(
+        serve(api::virConnectIsSecure, connection(conn), encoder()));
+}
+
+std::vector<domain_ptr>
+replay_libvirt::virConnectListAllDomains(connect_ptr conn, int flags)
+{
+    const auto &uri = connection(conn);
+    std::vector<domain_ptr> output;
+    if (auto result =
+            serve(api::virConnectListAllDomains, uri, encoder().i64(flags))) {
+        decoder d(*result);
+        for (auto n = d.u64(); n; --n) {
+            output.emplace_back(domain(uri, d.opt_str()));
+        }
+    }
+    return output;
+}
+
+std::vector<network_ptr>
+replay_libvirt::virConnectListAllNetworks(connect_ptr conn, int flags)
+{
+    const auto &uri = connection(conn);
+    std::vector<network_ptr> output;
+    if (auto result =
+            serve(api::virConnectListAllNetworks, uri, encoder().i64(flags))) {
+        decoder d(*result);
+        for (auto n = d.u64(); n; --n) {
+            output.emplace_back(network(uri, d.opt_str()));
+        }
+    }
+    return output;
+}
+
+/* virDomain definitions */
+domain_ptr replay_libvirt::virDomainLookupByName(connect_ptr conn,
+                                                 const char *name)
+{
+    const auto &uri = connection(conn);
+    auto result =
+        serve(api::virDomainLookupByName, uri, encoder().opt_str(name));
+    return result ? domain(uri, decoder(*result).opt_str()) : nullptr;
+}
+
+domain_ptr replay_libvirt::virDomainLookupByUUIDString(connect_ptr conn,
+                                                       const char *uuid)
+{
+    const auto &uri = connection(conn);
+    auto result =
+        serve(api::virDomainLookupByUUIDString, uri, encoder().opt_str(uuid));
+    return result ? domain(uri, decoder(*result).opt_str()) : nullptr;
+}
+
+int replay_libvirt::virDomainCreate(domain_ptr dom)
+{
+    return int_result(serve(api::virDomainCreate,
+                            connection(dom),
+                            encoder().opt_str(name(dom))));
+}
+
+int replay_libvirt::virDomainRef(webvirt::domain *)
+{
+    // Handles stay valid for the replay's lifetime.
+    return 0;
+}
+
+int replay_libvirt::virDomainFree(webvirt::domain *)
+{
+    return 0;
+}
+
+int replay_libvirt::virConnectDomainEventRegisterAny(
+    webvirt::connect *, webvirt::domain *, int,
+    void (*)(webvirt::connect *, webvirt::domain *, void *), void *opaque,
+    void (*free_opaque)(void *))
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    int id = next_callback_++;
+    callbacks_[id] = { free_opaque, opaque };
+    return id;
+}
+
+int replay_libvirt::virConnectDomainEventDeregisterAny(connect_ptr,
+                                                       int callback_id)
+{
+    std::pair<void (*)(void *), void *> cb;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = callbacks_.find(callback_id);
+        if (it == callbacks_.end()) {
+            return -1;
+        }
+        cb = it->second;
+        callbacks_.erase(it);
+    }
+
+    if (cb.first) {
+        cb.first(cb.second);
+    }
+    return 0;
+}
+
+int replay_libvirt::virDomainGetState(domain_ptr dom, int *state,
+                                      int *reason, int flags)
+{
+    auto result = serve(api::virDomainGetState,
+                        connection(dom),
+                        encoder().opt_str(name(dom)).i64(flags));
+    if (!result) {
+        return -1;
+    }
+
+    decoder d(*result);
+    int rc = d.i64();
+    *state = d.i64();
+    int r = d.i64();
+    if (reason) {
+        *reason = r;
+    }
+    return rc;
+}
+
+int replay_libvirt::virDomainGetID(domain_ptr dom)
+{
+    return int_result(serve(api::virDomainGetID,
+                            connection(dom),
+                            encoder().opt_str(name(dom))));
+}
+
+const char *replay_libvirt::virDomainGetName(domain_ptr dom)
+{
+    return name(dom);
+}
+
+std::string replay_libvirt::virDomainGetUUIDString(domain_ptr dom)
+{
+    return string_result(serve(api::virDomainGetUUIDString,
+                               connection(dom),
+                               encoder().opt_str(name(dom))));
+}
+
+int replay_libvirt::virDomainGetAutostart(domain_ptr dom, int *autostart)
+{
+    auto result = serve(api::virDomainGetAutostart,
+                        connection(dom),
+                        encoder().opt_str(name(dom)));
+    if (!result) {
+        return -1;
+    }
+
+    decoder d(*result);
+    int rc = d.i64();
+    *autostart = d.i64();
+    return rc;
+}
+
+int replay_libvirt::virDomainSetAutostart(domain_ptr dom, int autostart)
+{
+    return int_result(serve(api::virDomainSetAutostart,
+                            connection(dom),
+                            encoder().opt_str(name(dom)).i64(autostart)));
+}
+
+std::string replay_libvirt::virDomainGetMetadata(domain_ptr dom, int type,
+                                                 const char *uri,
+                                                 unsigned int flags)
+{
+    return string_result(
+        serve(api::virDomainGetMetadata,
+              connection(dom),
+              encoder().opt_str(name(dom)).i64(type).opt_str(uri).u64(flags)));
+}
+
+int replay_libvirt::virDomainSetMetadata(domain_ptr dom, int type,
+                                         const char *metadata,
+                                         const char *key, const char *uri,
+                                         unsigned int flags)
+{
+    return int_result(serve(api::virDomainSetMetadata,
+                            connection(dom),
+                            encoder()
+                                .opt_str(name(dom))
+                                .i64(type)
+                                .opt_str(metadata)
+                                .opt_str(key)
+                                .opt_str(uri)
+                                .u64(flags)));
+}
+
+c_string replay_libvirt::virDomainGetXMLDesc(domain_ptr dom, int flags)
+{
+    return c_string_result(serve(api::virDomainGetXMLDesc,
+                                 connection(dom),
+                                 encoder().opt_str(name(dom)).i64(flags)));
+}
+
+domain_ptr replay_libvirt::virDomainDefineXML(connect_ptr conn,
+                                              const char *xml)
+{
+    const auto &uri = connection(conn);
+    auto result =
+        serve(api::virDomainDefineXML, uri, encoder().opt_str(xml));
+    return result ? domain(uri, decoder(*result).opt_str()) : nullptr;
+}
+
+block_info_ptr replay_libvirt::virDomainGetBlockInfo(domain_ptr dom,
+                                                     const char *disk,
+                                                     int flags)
+{
+    auto result = serve(api::virDomainGetBlockInfo,
+                        connection(dom),
+                        encoder().opt_str(name(dom)).opt_str(disk).i64(flags));
+    if (!result) {
+        return nullptr;
+    }
+
+    decoder d(*result);
+    if (!d.u64()) {
+        return nullptr;
+    }
+    auto info = std::make_shared<block_info>();
+    info->capacity = d.u64();
+    info->allocation = d.u64();
+    info->physical = d.u64();
+    return info;
+}
+
+int replay_libvirt::virDomainShutdown(domain_ptr dom)
+{
+    return int_result(serve(api::virDomainShutdown,
+                            connection(dom),
+                            encoder().opt_str(name(dom))));
+}
+
+/* virNetwork definitions */
+const char *replay_libvirt::virNetworkGetName(network_ptr net)
+{
+    return name(net);
+}
+
+c_string replay_libvirt::virNetworkGetXMLDesc(network_ptr net,
+                                              unsigned int flags)
+{
+    return c_string_result(serve(api::virNetworkGetXMLDesc,
+                                 connection(net),
+                                 encoder().opt_str(name(net)).u64(flags)));
+}
+
+/* virEvent definitions */
+int replay_libvirt::virEventRegisterDefaultImpl()
+{
+    return 0;
+}
+
+int replay_libvirt::virEventAddTimeout(int ms, void (*fn)(int, void *),
+                                       void *opaque, void (*)(void *))
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    timeout_ms_ = ms;
+    timeout_fn_ = fn;
+    timeout_opaque_ = opaque;
+    return 1;
+}
+
+int replay_libvirt::virEventRunDefaultImpl()
+{
+    int ms;
+    void (*fn)(int, void *);
+    void *opaque;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        ms = timeout_ms_;
+        fn = timeout_fn_;
+        opaque = timeout_opaque_;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms > 0 ? ms : 20));
+    if (fn) {
+        fn(1, opaque);
+    }
+    return 0;
+}
+
+/* virError definitions */
+void replay_libvirt::virConnSetErrorFunc(connect_ptr, void *,
+                                         error_function)
+{
+    // Replayed failures carry no error details.
+}
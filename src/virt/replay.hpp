@@ -0,0 +1,182 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef VIRT_REPLAY_HPP
+#define VIRT_REPLAY_HPP
+
+#include <libvirt.hpp>
+#include <virt/recording.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace webvirt::virt
+{
+
+/** A libvirt backend serving a recording made by recording_libvirt
+ *
+ * Calls are answered with the responses recorded for the same
+ * connection URI, API and arguments, in recorded order; once those run
+ * out, they are served again from the start. A call which was never
+ * recorded fails the way libvirt would, and is counted in misses().
+ *
+ * With `timed`, each response is delayed by the duration of the call it
+ * was recorded from, reproducing the recorded host's latency.
+ *
+ * Events are not recorded; the event loop only runs its timeout.
+ **/
+class replay_libvirt : public libvirt
+{
+private:
+    struct response {
+        std::string result;
+        std::chrono::microseconds duration;
+    };
+
+    struct responses {
+        std::vector<response> recorded;
+        std::size_t next { 0 };
+    };
+
+    // A domain or network handle: connection URI and name
+    using handle = std::pair<std::string, std::string>;
+
+    bool timed_;
+
+    std::mutex mutex_;
+    // Keyed by API, connection and serialized arguments
+    std::unordered_map<std::string, responses> responses_;
+    std::size_t size_ { 0 };
+    std::atomic<std::size_t> misses_ { 0 };
+
+    // Handles point into these sets; connections at their URI.
+    std::set<std::string> connections_;
+    std::set<handle> domains_;
+    std::set<handle> networks_;
+    std::set<std::string> strings_;
+
+    std::map<int, std::pair<void (*)(void *), void *>> callbacks_;
+    int next_callback_ { 1 };
+
+    int timeout_ms_ { -1 };
+    void (*timeout_fn_)(int, void *) { nullptr };
+    void *timeout_opaque_ { nullptr };
+
+public:
+    /** Load a recording
+     *
+     * @param path Recording path
+     * @param timed Delay responses by their recorded duration
+     * @throws std::runtime_error if the recording cannot be read
+     **/
+    replay_libvirt(const std::string &path, bool timed = false);
+    ~replay_libvirt();
+
+    /** @returns Number of recorded calls loaded */
+    std::size_t size() const;
+
+    /** @returns Number of calls made which were not recorded */
+    std::size_t misses() const;
+
+    // virConnect
+    connect_ptr virConnectOpen(const char *) override;
+    int virConnectRegisterCloseCallback(connect_ptr,
+                                        void (*)(connect *, int, void *),
+                                        void *, void (*)(void *)) override;
+    std::string virConnectGetCapabilities(connect_ptr) override;
+    std::string virConnectGetHostname(connect_ptr) override;
+    int virConnectGetLibVersion(connect_ptr, unsigned long *) override;
+    int virConnectGetMaxVcpus(connect_ptr, const char *) override;
+    std::string virConnectGetSysinfo(connect_ptr, unsigned int) override;
+    const char *virConnectGetType(connect_ptr) override;
+    std::string virConnectGetURI(connect_ptr) override;
+    int virConnectGetVersion(connect_ptr, unsigned long *) override;
+    int virConnectIsEncrypted(connect_ptr) override;
+    int virConnectIsSecure(connect_ptr) override;
+    std::vector<domain_ptr> virConnectListAllDomains(connect_ptr,
+                                                     int) override;
+    std::vector<network_ptr> virConnectListAllNetworks(connect_ptr,
+                                                       int) override;
+
+    // virDomain
+    domain_ptr virDomainLookupByName(connect_ptr, const char *) override;
+    domain_ptr virDomainLookupByUUIDString(connect_ptr,
+                                           const char *) override;
+    int virDomainCreate(domain_ptr) override;
+    int virDomainRef(webvirt::domain *) override;
+    int virDomainFree(webvirt::domain *) override;
+    int virConnectDomainEventRegisterAny(
+        webvirt::connect *, webvirt::domain *, int,
+        void (*)(webvirt::connect *, webvirt::domain *, void *), void *,
+        void (*)(void *)) override;
+    int virConnectDomainEventDeregisterAny(connect_ptr, int) override;
+    int virDomainGetState(domain_ptr, int *, int *, int) override;
+    int virDomainGetID(domain_ptr) override;
+    const char *virDomainGetName(domain_ptr) override;
+    std::string virDomainGetUUIDString(domain_ptr) override;
+    int virDomainGetAutostart(domain_ptr, int *) override;
+    int virDomainSetAutostart(domain_ptr, int) override;
+    std::string virDomainGetMetadata(domain_ptr, int, const char *,
+                                     unsigned int) override;
+    int virDomainSetMetadata(domain_ptr, int, const char *, const char *,
+                             const char *, unsigned int) override;
+    c_string virDomainGetXMLDesc(domain_ptr, int) override;
+    domain_ptr virDomainDefineXML(connect_ptr, const char *) override;
+    block_info_ptr virDomainGetBlockInfo(domain_ptr, const char *,
+                                         int) override;
+    int virDomainShutdown(domain_ptr) override;
+
+    // virNetwork
+    const char *virNetworkGetName(network_ptr) override;
+    c_string virNetworkGetXMLDesc(network_ptr, unsigned int) override;
+
+    // virEvent
+    int virEventRegisterDefaultImpl() override;
+    int virEventAddTimeout(int, void (*)(int, void *), void *,
+                           void (*)(void *)) override;
+    int virEventRunDefaultImpl() override;
+
+    // virterror
+    void virConnSetErrorFunc(connect_ptr, void *,
+                             webvirt::error_function) override;
+
+private:
+    std::optional<std::string> serve(recording::api api,
+                                     const std::string &connection,
+                                     const recording::encoder &args);
+
+    domain_ptr domain(const std::string &connection,
+                      const std::optional<std::string> &name);
+    network_ptr network(const std::string &connection,
+                        const std::optional<std::string> &name);
+    const char *name(const domain_ptr &domain);
+    const char *name(const network_ptr &network);
+    const std::string &connection(const connect_ptr &conn);
+    const std::string &connection(const domain_ptr &domain);
+    const std::string &connection(const network_ptr &network);
+    const char *intern(const std::optional<std::string> &str);
+};
+
+}; // namespace webvirt::virt
+
+#endif /* VIRT_REPLAY_HPP */
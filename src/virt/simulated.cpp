@@ -0,0 +1,813 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <virt/simulated.hpp>
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <pugixml.hpp>
+#include <stdexcept>
+#include <thread>
+
+using namespace webvirt;
+using namespace webvirt::virt;
+
+// Serialize callback delivery against deregistration, so a callback's
+// opaque data is never used after its owner deregistered it. Recursive,
+// as callbacks may deregister themselves.
+static std::recursive_mutex delivery_mutex;
+
+static std::chrono::microseconds parse_duration(const std::string &value)
+{
+    std::size_t end = 0;
+    double number = std::stod(value, &end);
+    auto unit = value.substr(end);
+    if (number < 0) {
+        throw std::invalid_argument("negative duration");
+    }
+
+    double us;
+    if (unit == "us") {
+        us = number;
+    } else if (unit == "ms" || unit.empty()) {
+        us = number * 1000;
+    } else if (unit == "s") {
+        us = number * 1000000;
+    } else {
+        throw std::invalid_argument("unknown duration unit '" + unit + "'");
+    }
+    return std::chrono::microseconds(static_cast<long long>(us));
+}
+
+simulated_libvirt::options
+simulated_libvirt::options::parse(const std::string &spec)
+{
+    options opts;
+
+    std::size_t start = 0;
+    while (start < spec.size()) {
+        auto end = spec.find(',', start);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        auto entry = spec.substr(start, end - start);
+        start = end + 1;
+        if (entry.empty()) {
+            continue;
+        }
+
+        auto eq = entry.find('=');
+        if (eq == std::string::npos) {
+            throw std::invalid_argument("expected key=value, got '" + entry +
+                                        "'");
+        }
+        auto key = entry.substr(0, eq);
+        auto value = entry.substr(eq + 1);
+
+        try {
+            if (key == "domains") {
+                opts.domains = std::stoul(value);
+            } else if (key == "latency") {
+                opts.latency = parse_duration(value);
+            } else if (key == "jitter") {
+                opts.jitter = parse_duration(value);
+            } else if (key == "events") {
+                opts.events = std::stod(value);
+            } else if (key == "seed") {
+                opts.seed = std::stoul(value);
+            } else {
+                throw std::invalid_argument("unknown option '" + key + "'");
+            }
+        } catch (const std::invalid_argument &) {
+            throw;
+        } catch (const std::logic_error &) {
+            throw std::invalid_argument("invalid value for '" + key + "'");
+        }
+    }
+
+    return opts;
+}
+
+simulated_libvirt::simulated_libvirt()
+    : simulated_libvirt(options())
+{
+}
+
+simulated_libvirt::simulated_libvirt(const options &opts)
+    : opts_(opts)
+    , rng_(opts.seed)
+    , last_run_(std::chrono::steady_clock::now())
+{
+    std::size_t width = std::to_string(opts_.domains).size();
+    std::bernoulli_distribution running(0.75);
+    for (unsigned i = 1; i <= opts_.domains; ++i) {
+        add(fmt::format("sim-{:0{}}", i, width), running(rng_));
+    }
+}
+
+simulated_libvirt::~simulated_libvirt()
+{
+    for (auto &cb : callbacks_) {
+        if (cb.free_opaque) {
+            cb.free_opaque(cb.opaque);
+        }
+    }
+}
+
+const simulated_libvirt::options &simulated_libvirt::settings() const
+{
+    return opts_;
+}
+
+void simulated_libvirt::delay()
+{
+    auto us = opts_.latency.count();
+    if (opts_.jitter.count()) {
+        thread_local std::mt19937 rng(std::random_device {}());
+        std::uniform_int_distribution<long long> dist(-opts_.jitter.count(),
+                                                      opts_.jitter.count());
+        us = std::max<long long>(0, us + dist(rng));
+    }
+    if (us > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+}
+
+simulated_libvirt::record &simulated_libvirt::add(std::string name,
+                                                  bool running)
+{
+    static constexpr unsigned vcpus[] = { 1, 2, 4, 8 };
+    static constexpr unsigned long memory[] = { 1, 2, 4, 8, 16 };
+
+    auto &r = records_.emplace_back();
+    r.name = std::move(name);
+    r.uuid = fmt::format("{:08x}-{:04x}-4{:03x}-8{:03x}-{:08x}{:04x}",
+                         rng_(),
+                         rng_() & 0xffff,
+                         rng_() & 0xfff,
+                         rng_() & 0xfff,
+                         rng_(),
+                         rng_() & 0xffff);
+    r.vcpus = vcpus[rng_() % std::size(vcpus)];
+    r.memory = memory[rng_() % std::size(memory)] * 1024 * 1024;
+    r.autostart = running ? 1 : 0;
+    if (running) {
+        r.state = VIR_DOMAIN_RUNNING;
+        r.id = next_id_++;
+    }
+
+    names_[r.name] = &r;
+    uuids_[r.uuid] = &r;
+    return r;
+}
+
+simulated_libvirt::record *simulated_libvirt::find(const domain_ptr &domain)
+{
+    return reinterpret_cast<record *>(domain.get());
+}
+
+domain_ptr simulated_libvirt::handle(record &r)
+{
+    return domain_ptr(reinterpret_cast<webvirt::domain *>(&r),
+                      [](webvirt::domain *) {});
+}
+
+static std::string escape(const std::string &text)
+{
+    std::string output;
+    for (char c : text) {
+        switch (c) {
+        case '&':
+            output.append("&amp;");
+            break;
+        case '<':
+            output.append("&lt;");
+            break;
+        case '>':
+            output.append("&gt;");
+            break;
+        default:
+            output.push_back(c);
+        }
+    }
+    return output;
+}
+
+std::string simulated_libvirt::xml(const record &r) const
+{
+    if (r.xml.size()) {
+        return r.xml;
+    }
+
+    std::string metadata;
+    if (r.title.size()) {
+        metadata += fmt::format("  <title>{}</title>\n", escape(r.title));
+    }
+    if (r.description.size()) {
+        metadata += fmt::format("  <description>{}</description>\n",
+                                escape(r.description));
+    }
+
+    return fmt::format(
+        R"(<domain type="kvm"{0}>
+  <name>{1}</name>
+  <uuid>{2}</uuid>
+{3}  <memory unit="KiB">{4}</memory>
+  <currentMemory unit="KiB">{4}</currentMemory>
+  <vcpu placement="static">{5}</vcpu>
+  <os>
+    <type arch="x86_64" machine="pc-q35-7.2">hvm</type>
+    <boot dev="hd"/>
+  </os>
+  <devices>
+    <emulator>/usr/bin/qemu-system-x86_64</emulator>
+    <disk type="file" device="disk">
+      <driver name="qemu" type="qcow2"/>
+      <source file="/var/lib/libvirt/images/{1}.qcow2"/>
+      <target dev="vda" bus="virtio"/>
+    </disk>
+    <interface type="network">
+      <mac address="52:54:00:{6}:{7}:{8}"/>
+      <source network="default"/>
+      <model type="virtio"/>
+    </interface>
+    <graphics type="spice" autoport="yes"/>
+    <video>
+      <model type="qxl" heads="1" primary="yes"/>
+    </video>
+  </devices>
+</domain>
+)",
+        r.id > 0 ? fmt::format(" id=\"{}\"", r.id) : std::string(),
+        r.name,
+        r.uuid,
+        metadata,
+        r.memory,
+        r.vcpus,
+        r.uuid.substr(0, 2),
+        r.uuid.substr(2, 2),
+        r.uuid.substr(4, 2));
+}
+
+void simulated_libvirt::set_state(record &r, int state, int type, int detail)
+{
+    r.state = state;
+    r.id = state == VIR_DOMAIN_RUNNING ? next_id_++ : -1;
+    emit(VIR_DOMAIN_EVENT_ID_LIFECYCLE, r, type, detail);
+}
+
+void simulated_libvirt::emit(int event_id, record &r, int type, int detail)
+{
+    pending_.push_back({ event_id, &r, type, detail });
+}
+
+void simulated_libvirt::deliver(const pending_event &event)
+{
+    std::lock_guard<std::recursive_mutex> guard(delivery_mutex);
+
+    std::vector<callback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        callbacks = callbacks_;
+    }
+
+    using lifecycle_fn = void (*)(
+        webvirt::connect *, webvirt::domain *, int, int, void *);
+    using metadata_fn = void (*)(
+        webvirt::connect *, webvirt::domain *, int, const char *, void *);
+
+    // Callbacks are registered type-erased, as with libvirt's
+    // VIR_DOMAIN_EVENT_CALLBACK(); restore their real signature.
+    auto *conn = reinterpret_cast<webvirt::connect *>(this);
+    auto *dom = reinterpret_cast<webvirt::domain *>(event.domain);
+    for (const auto &cb : callbacks) {
+        if (cb.event_id != event.event_id) {
+            continue;
+        }
+
+        auto *fn = reinterpret_cast<void (*)()>(cb.fn);
+        if (event.event_id == VIR_DOMAIN_EVENT_ID_LIFECYCLE) {
+            reinterpret_cast<lifecycle_fn>(fn)(
+                conn, dom, event.type, event.detail, cb.opaque);
+        } else if (event.event_id == VIR_DOMAIN_EVENT_ID_METADATA_CHANGE) {
+            reinterpret_cast<metadata_fn>(fn)(
+                conn, dom, event.type, nullptr, cb.opaque);
+        }
+    }
+}
+
+/* virConnect definitions */
+connect_ptr simulated_libvirt::virConnectOpen(const char *)
+{
+    delay();
+    return connect_ptr(reinterpret_cast<webvirt::connect *>(this),
+                       [](webvirt::connect *) {});
+}
+
+int simulated_libvirt::virConnectRegisterCloseCallback(
+    connect_ptr, void (*)(connect *, int, void *), void *,
+    void (*)(void *))
+{
+    // The simulated connection is never closed.
+    return 0;
+}
+
+std::string simulated_libvirt::virConnectGetCapabilities(connect_ptr)
+{
+    delay();
+
+    std::string cpus;
+    for (unsigned i = 0; i < 16; ++i) {
+        cpus += fmt::format("            <cpu id=\"{}\" socket_id=\"0\" "
+                            "core_id=\"{}\" siblings=\"{},{}\"/>\n",
+                            i,
+                            i % 8,
+                            i % 8,
+                            i % 8 + 8);
+    }
+
+    return fmt::format(R"(<capabilities>
+  <host>
+    <uuid>00000000-0000-4000-8000-000000000000</uuid>
+    <cpu>
+      <arch>x86_64</arch>
+      <model>Skylake-Client-IBRS</model>
+      <vendor>Intel</vendor>
+      <topology sockets="1" dies="1" cores="8" threads="2"/>
+      <pages unit="KiB" size="4"/>
+      <pages unit="KiB" size="2048"/>
+    </cpu>
+    <topology>
+      <cells num="1">
+        <cell id="0">
+          <memory unit="KiB">67108864</memory>
+          <cpus num="16">
+{}          </cpus>
+        </cell>
+      </cells>
+    </topology>
+  </host>
+</capabilities>
+)",
+                       cpus);
+}
+
+std::string simulated_libvirt::virConnectGetHostname(connect_ptr)
+{
+    delay();
+    return "webvirtd-sim";
+}
+
+int simulated_libvirt::virConnectGetLibVersion(connect_ptr,
+                                               unsigned long *version)
+{
+    delay();
+    *version = 9000000;
+    return 0;
+}
+
+int simulated_libvirt::virConnectGetMaxVcpus(connect_ptr, const char *)
+{
+    delay();
+    return 255;
+}
+
+std::string simulated_libvirt::virConnectGetSysinfo(connect_ptr,
+                                                    unsigned int)
+{
+    delay();
+    return R"(<sysinfo type="smbios">
+  <system>
+    <entry name="manufacturer">webvirtd</entry>
+    <entry name="product">Simulated hypervisor</entry>
+  </system>
+</sysinfo>
+)";
+}
+
+const char *simulated_libvirt::virConnectGetType(connect_ptr)
+{
+    delay();
+    return "QEMU";
+}
+
+std::string simulated_libvirt::virConnectGetURI(connect_ptr)
+{
+    delay();
+    return "sim:///system";
+}
+
+int simulated_libvirt::virConnectGetVersion(connect_ptr,
+                                            unsigned long *version)
+{
+    delay();
+    *version = 7002000;
+    return 0;
+}
+
+int simulated_libvirt::virConnectIsEncrypted(connect_ptr)
+{
+    delay();
+    return 0;
+}
+
+int simulated_libvirt::virConnectIsSecure(connect_ptr)
+{
+    delay();
+    return 1;
+}
+
+std::vector<domain_ptr>
+simulated_libvirt::virConnectListAllDomains(connect_ptr, int flags)
+{
+    delay();
+
+    auto selected = [flags](const record &r) {
+        bool active = r.state == VIR_DOMAIN_RUNNING;
+        auto either = [flags](int a, int b, bool is_a) {
+            if ((flags & a) && !(flags & b)) {
+                return is_a;
+            }
+            if ((flags & b) && !(flags & a)) {
+                return !is_a;
+            }
+            return true;
+        };
+        return either(VIR_CONNECT_LIST_DOMAINS_ACTIVE,
+                      VIR_CONNECT_LIST_DOMAINS_INACTIVE,
+                      active) &&
+               either(VIR_CONNECT_LIST_DOMAINS_RUNNING,
+                      VIR_CONNECT_LIST_DOMAINS_SHUTOFF,
+                      active) &&
+               either(VIR_CONNECT_LIST_DOMAINS_AUTOSTART,
+                      VIR_CONNECT_LIST_DOMAINS_NO_AUTOSTART,
+                      r.autostart);
+    };
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::vector<domain_ptr> output;
+    for (auto &r : records_) {
+        if (selected(r)) {
+            output.emplace_back(handle(r));
+        }
+    }
+    return output;
+}
+
+std::vector<network_ptr>
+simulated_libvirt::virConnectListAllNetworks(connect_ptr, int)
+{
+    // The simulator has no networks.
+    delay();
+    return {};
+}
+
+/* virDomain definitions */
+domain_ptr simulated_libvirt::virDomainLookupByName(connect_ptr,
+                                                    const char *name)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = names_.find(name);
+    return it != names_.end() ? handle(*it->second) : nullptr;
+}
+
+domain_ptr simulated_libvirt::virDomainLookupByUUIDString(connect_ptr,
+                                                          const char *uuid)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = uuids_.find(uuid);
+    return it != uuids_.end() ? handle(*it->second) : nullptr;
+}
+
+int simulated_libvirt::virDomainCreate(domain_ptr domain)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &r = *find(domain);
+    if (r.state == VIR_DOMAIN_RUNNING) {
+        return -1;
+    }
+    set_state(r,
+              VIR_DOMAIN_RUNNING,
+              VIR_DOMAIN_EVENT_STARTED,
+              VIR_DOMAIN_EVENT_STARTED_BOOTED);
+    return 0;
+}
+
+int simulated_libvirt::virDomainRef(webvirt::domain *)
+{
+    // Handles stay valid for the simulator's lifetime.
+    return 0;
+}
+
+int simulated_libvirt::virDomainFree(webvirt::domain *)
+{
+    return 0;
+}
+
+int simulated_libvirt::virConnectDomainEventRegisterAny(
+    webvirt::connect *, webvirt::domain *, int event_id,
+    void (*cb)(webvirt::connect *, webvirt::domain *, void *), void *opaque,
+    void (*free_opaque)(void *))
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    int id = next_callback_++;
+    callbacks_.push_back({ id, event_id, cb, opaque, free_opaque });
+    return id;
+}
+
+int simulated_libvirt::virConnectDomainEventDeregisterAny(connect_ptr,
+                                                          int callback_id)
+{
+    delay();
+    std::lock_guard<std::recursive_mutex> delivery(delivery_mutex);
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = std::find_if(
+        callbacks_.begin(), callbacks_.end(), [callback_id](const auto &cb) {
+            return cb.id == callback_id;
+        });
+    if (it == callbacks_.end()) {
+        return -1;
+    }
+
+    if (it->free_opaque) {
+        it->free_opaque(it->opaque);
+    }
+    callbacks_.erase(it);
+    return 0;
+}
+
+int simulated_libvirt::virDomainGetState(domain_ptr domain, int *state,
+                                         int *reason, int)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    *state = find(domain)->state;
+    if (reason) {
+        *reason = 0;
+    }
+    return 0;
+}
+
+int simulated_libvirt::virDomainGetID(domain_ptr domain)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    return find(domain)->id;
+}
+
+const char *simulated_libvirt::virDomainGetName(domain_ptr domain)
+{
+    // Names never change, so the record's string can be handed out.
+    delay();
+    return find(domain)->name.c_str();
+}
+
+std::string simulated_libvirt::virDomainGetUUIDString(domain_ptr domain)
+{
+    delay();
+    return find(domain)->uuid;
+}
+
+int simulated_libvirt::virDomainGetAutostart(domain_ptr domain,
+                                             int *autostart)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    *autostart = find(domain)->autostart;
+    return 0;
+}
+
+int simulated_libvirt::virDomainSetAutostart(domain_ptr domain,
+                                             int autostart)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    find(domain)->autostart = autostart ? 1 : 0;
+    return 0;
+}
+
+std::string simulated_libvirt::virDomainGetMetadata(domain_ptr domain,
+                                                    int type,
+                                                    const char *uri,
+                                                    unsigned int)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &r = *find(domain);
+    switch (type) {
+    case VIR_DOMAIN_METADATA_TITLE:
+        return r.title;
+    case VIR_DOMAIN_METADATA_DESCRIPTION:
+        return r.description;
+    default:
+        auto it = r.metadata.find(uri ? uri : "");
+        return it != r.metadata.end() ? it->second : std::string();
+    }
+}
+
+int simulated_libvirt::virDomainSetMetadata(domain_ptr domain, int type,
+                                            const char *metadata,
+                                            const char *, const char *uri,
+                                            unsigned int)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &r = *find(domain);
+    std::string value = metadata ? metadata : "";
+    switch (type) {
+    case VIR_DOMAIN_METADATA_TITLE:
+        r.title = std::move(value);
+        break;
+    case VIR_DOMAIN_METADATA_DESCRIPTION:
+        r.description = std::move(value);
+        break;
+    default:
+        if (!uri) {
+            return -1;
+        }
+        r.metadata[uri] = std::move(value);
+    }
+    emit(VIR_DOMAIN_EVENT_ID_METADATA_CHANGE, r, type, 0);
+    return 0;
+}
+
+c_string simulated_libvirt::virDomainGetXMLDesc(domain_ptr domain, int)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    return c_string(xml(*find(domain)));
+}
+
+domain_ptr simulated_libvirt::virDomainDefineXML(connect_ptr,
+                                                 const char *xml)
+{
+    delay();
+
+    pugi::xml_document doc;
+    if (!doc.load_string(xml)) {
+        return nullptr;
+    }
+    auto node = doc.child("domain");
+    std::string name = node.child("name").child_value();
+    if (name.empty()) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = names_.find(name);
+    if (it != names_.end()) {
+        auto &r = *it->second;
+        r.xml = xml;
+        emit(VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+             r,
+             VIR_DOMAIN_EVENT_DEFINED,
+             VIR_DOMAIN_EVENT_DEFINED_UPDATED);
+        return handle(r);
+    }
+
+    auto &r = add(std::move(name), false);
+    r.xml = xml;
+    emit(VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+         r,
+         VIR_DOMAIN_EVENT_DEFINED,
+         VIR_DOMAIN_EVENT_DEFINED_ADDED);
+    return handle(r);
+}
+
+block_info_ptr simulated_libvirt::virDomainGetBlockInfo(domain_ptr domain,
+                                                        const char *,
+                                                        int)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &r = *find(domain);
+    auto info = std::make_shared<block_info>();
+    info->capacity = 32ul * 1024 * 1024 * 1024;
+    info->allocation = r.memory * 1024 + info->capacity / 4;
+    info->physical = info->allocation;
+    return info;
+}
+
+int simulated_libvirt::virDomainShutdown(domain_ptr domain)
+{
+    delay();
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &r = *find(domain);
+    if (r.state != VIR_DOMAIN_RUNNING) {
+        return -1;
+    }
+
+    // Guests shut down instantly.
+    set_state(r,
+              VIR_DOMAIN_SHUTOFF,
+              VIR_DOMAIN_EVENT_STOPPED,
+              VIR_DOMAIN_EVENT_STOPPED_SHUTDOWN);
+    return 0;
+}
+
+/* virNetwork definitions */
+const char *simulated_libvirt::virNetworkGetName(network_ptr)
+{
+    // Unreachable; no networks are listed.
+    delay();
+    return nullptr;
+}
+
+c_string simulated_libvirt::virNetworkGetXMLDesc(network_ptr, unsigned int)
+{
+    // Unreachable; no networks are listed.
+    delay();
+    return c_string();
+}
+
+/* virEvent definitions */
+int simulated_libvirt::virEventRegisterDefaultImpl()
+{
+    return 0;
+}
+
+int simulated_libvirt::virEventAddTimeout(int ms, void (*fn)(int, void *),
+                                          void *opaque, void (*)(void *))
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    timeout_ms_ = ms;
+    timeout_fn_ = fn;
+    timeout_opaque_ = opaque;
+    return 1;
+}
+
+int simulated_libvirt::virEventRunDefaultImpl()
+{
+    int ms;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        ms = pending_.empty() && timeout_ms_ > 0 ? timeout_ms_ : 0;
+    }
+    if (ms) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+
+    std::vector<pending_event> events;
+    void (*timeout_fn)(int, void *) = nullptr;
+    void *timeout_opaque = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+
+        // Flip random domains between running and shut off.
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed = now - last_run_;
+        last_run_ = now;
+        events_due_ += opts_.events * elapsed.count();
+        for (; events_due_ >= 1 && records_.size(); events_due_ -= 1) {
+            auto &r = records_[rng_() % records_.size()];
+            if (r.state == VIR_DOMAIN_RUNNING) {
+                set_state(r,
+                          VIR_DOMAIN_SHUTOFF,
+                          VIR_DOMAIN_EVENT_STOPPED,
+                          VIR_DOMAIN_EVENT_STOPPED_SHUTDOWN);
+            } else {
+                set_state(r,
+                          VIR_DOMAIN_RUNNING,
+                          VIR_DOMAIN_EVENT_STARTED,
+                          VIR_DOMAIN_EVENT_STARTED_BOOTED);
+            }
+        }
+
+        events.swap(pending_);
+        if (ms) {
+            timeout_fn = timeout_fn_;
+            timeout_opaque = timeout_opaque_;
+        }
+    }
+
+    if (timeout_fn) {
+        timeout_fn(1, timeout_opaque);
+    }
+    for (const auto &event : events) {
+        deliver(event);
+    }
+    return 0;
+}
+
+/* virError definitions */
+void simulated_libvirt::virConnSetErrorFunc(connect_ptr, void *,
+                                            error_function)
+{
+    // Simulated calls report failure through return values only.
+}
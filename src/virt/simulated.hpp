@@ -0,0 +1,221 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#ifndef VIRT_SIMULATED_HPP
+#define VIRT_SIMULATED_HPP
+
+#include <libvirt.hpp>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace webvirt::virt
+{
+
+/** An in-process simulated hypervisor
+ *
+ * Serves a configurable number of generated domains without libvirtd,
+ * so that the daemon can be exercised at scale. Every libvirt call is
+ * delayed by a configurable latency, plus or minus a uniform jitter.
+ *
+ * Domains can be started, shut down, redefined and given metadata;
+ * those changes, and optionally random ones at a given rate, are
+ * delivered to registered event callbacks from
+ * virEventRunDefaultImpl(), like libvirt's default event loop does.
+ *
+ * Handles given out point into the simulator; they need no freeing and
+ * stay valid for its lifetime.
+ **/
+class simulated_libvirt : public libvirt
+{
+public:
+    /** Simulator settings */
+    struct options {
+        /** Number of generated domains */
+        unsigned domains { 100 };
+
+        /** Latency added to every call */
+        std::chrono::microseconds latency { 0 };
+
+        /** Maximum deviation from `latency`, either way */
+        std::chrono::microseconds jitter { 0 };
+
+        /** Random lifecycle events per second, across all domains */
+        double events { 0 };
+
+        /** Seed used to generate domains and events */
+        unsigned seed { 0 };
+
+        /** Parse options from a comma-separated key=value list
+         *
+         * For example, "domains=2000,latency=2ms,jitter=500us,events=5".
+         * Durations take a us, ms or s suffix.
+         *
+         * @param spec Option list; may be empty
+         * @returns Parsed options
+         * @throws std::invalid_argument on an unknown key or bad value
+         **/
+        static options parse(const std::string &spec);
+    };
+
+private:
+    struct record {
+        std::string name;
+        std::string uuid;
+        int id { -1 };
+        int state { VIR_DOMAIN_SHUTOFF };
+        int autostart { 0 };
+        unsigned vcpus { 1 };
+        unsigned long memory { 0 };
+        std::string title;
+        std::string description;
+        std::map<std::string, std::string> metadata;
+        std::string xml;
+    };
+
+    struct callback {
+        int id;
+        int event_id;
+        void (*fn)(webvirt::connect *, webvirt::domain *, void *);
+        void *opaque;
+        void (*free_opaque)(void *);
+    };
+
+    // An event waiting to be delivered by virEventRunDefaultImpl()
+    struct pending_event {
+        int event_id;
+        record *domain;
+        int type;
+        int detail;
+    };
+
+    options opts_;
+
+    std::mutex mutex_;
+    std::mt19937 rng_;
+    // A deque keeps records in place as domains are defined.
+    std::deque<record> records_;
+    std::map<std::string, record *> names_;
+    std::map<std::string, record *> uuids_;
+    int next_id_ { 1 };
+
+    std::vector<callback> callbacks_;
+    int next_callback_ { 1 };
+    std::vector<pending_event> pending_;
+
+    int timeout_ms_ { -1 };
+    void (*timeout_fn_)(int, void *) { nullptr };
+    void *timeout_opaque_ { nullptr };
+    std::chrono::steady_clock::time_point last_run_;
+    double events_due_ { 0 };
+
+public:
+    /** Construct a simulator with default settings */
+    simulated_libvirt();
+
+    /** Construct a simulator
+     *
+     * @param opts Simulator settings
+     **/
+    explicit simulated_libvirt(const options &opts);
+    ~simulated_libvirt();
+
+    /** Return the simulator's settings
+     *
+     * @returns Settings given on construction
+     **/
+    const options &settings() const;
+
+    // virConnect
+    connect_ptr virConnectOpen(const char *) override;
+    int virConnectRegisterCloseCallback(connect_ptr,
+                                        void (*)(connect *, int, void *),
+                                        void *, void (*)(void *)) override;
+    std::string virConnectGetCapabilities(connect_ptr) override;
+    std::string virConnectGetHostname(connect_ptr) override;
+    int virConnectGetLibVersion(connect_ptr, unsigned long *) override;
+    int virConnectGetMaxVcpus(connect_ptr, const char *) override;
+    std::string virConnectGetSysinfo(connect_ptr, unsigned int) override;
+    const char *virConnectGetType(connect_ptr) override;
+    std::string virConnectGetURI(connect_ptr) override;
+    int virConnectGetVersion(connect_ptr, unsigned long *) override;
+    int virConnectIsEncrypted(connect_ptr) override;
+    int virConnectIsSecure(connect_ptr) override;
+    std::vector<domain_ptr> virConnectListAllDomains(connect_ptr,
+                                                     int) override;
+    std::vector<network_ptr> virConnectListAllNetworks(connect_ptr,
+                                                       int) override;
+
+    // virDomain
+    domain_ptr virDomainLookupByName(connect_ptr, const char *) override;
+    domain_ptr virDomainLookupByUUIDString(connect_ptr,
+                                           const char *) override;
+    int virDomainCreate(domain_ptr) override;
+    int virDomainRef(webvirt::domain *) override;
+    int virDomainFree(webvirt::domain *) override;
+    int virConnectDomainEventRegisterAny(
+        webvirt::connect *, webvirt::domain *, int,
+        void (*)(webvirt::connect *, webvirt::domain *, void *), void *,
+        void (*)(void *)) override;
+    int virConnectDomainEventDeregisterAny(connect_ptr, int) override;
+    int virDomainGetState(domain_ptr, int *, int *, int) override;
+    int virDomainGetID(domain_ptr) override;
+    const char *virDomainGetName(domain_ptr) override;
+    std::string virDomainGetUUIDString(domain_ptr) override;
+    int virDomainGetAutostart(domain_ptr, int *) override;
+    int virDomainSetAutostart(domain_ptr, int) override;
+    std::string virDomainGetMetadata(domain_ptr, int, const char *,
+                                     unsigned int) override;
+    int virDomainSetMetadata(domain_ptr, int, const char *, const char *,
+                             const char *, unsigned int) override;
+    c_string virDomainGetXMLDesc(domain_ptr, int) override;
+    domain_ptr virDomainDefineXML(connect_ptr, const char *) override;
+    block_info_ptr virDomainGetBlockInfo(domain_ptr, const char *,
+                                         int) override;
+    int virDomainShutdown(domain_ptr) override;
+
+    // virNetwork
+    const char *virNetworkGetName(network_ptr) override;
+    c_string virNetworkGetXMLDesc(network_ptr, unsigned int) override;
+
+    // virEvent
+    int virEventRegisterDefaultImpl() override;
+    int virEventAddTimeout(int, void (*)(int, void *), void *,
+                           void (*)(void *)) override;
+    int virEventRunDefaultImpl() override;
+
+    // virterror
+    void virConnSetErrorFunc(connect_ptr, void *,
+                             webvirt::error_function) override;
+
+private:
+    void delay();
+    record &add(std::string name, bool running);
+    record *find(const domain_ptr &domain);
+    domain_ptr handle(record &r);
+    std::string xml(const record &r) const;
+    void set_state(record &r, int state, int type, int detail);
+    void emit(int event_id, record &r, int type, int detail);
+    void deliver(const pending_event &event);
+};
+
+}; // namespace webvirt::virt
+
+#endif /* VIRT_SIMULATED_HPP */
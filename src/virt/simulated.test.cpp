@@ -0,0 +1,229 @@
+/*
+ * Copyright 2023 Kevin Morris
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+#include <virt/backend.hpp>
+#include <virt/simulated.hpp>
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+using namespace webvirt;
+using namespace std::chrono_literals;
+
+using testing::Test;
+
+class simulated_test : public Test
+{
+protected:
+    virt::simulated_libvirt lv { virt::simulated_libvirt::options::parse(
+        "domains=20,seed=1") };
+    connect_ptr conn = lv.virConnectOpen("sim:///system");
+
+    std::vector<std::tuple<std::string, int, int>> events;
+
+    static void on_lifecycle(webvirt::connect *, webvirt::domain *domain,
+                             int type, int detail, void *opaque)
+    {
+        auto &self = *reinterpret_cast<simulated_test *>(opaque);
+        auto ptr = domain_ptr(domain, [](webvirt::domain *) {});
+        self.events.emplace_back(
+            self.lv.virDomainGetName(ptr), type, detail);
+    }
+
+    int subscribe()
+    {
+        return lv.virConnectDomainEventRegisterAny(
+            conn.get(),
+            nullptr,
+            VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+            VIR_DOMAIN_EVENT_CALLBACK(on_lifecycle),
+            this,
+            nullptr);
+    }
+};
+
+TEST(simulated_options, parse)
+{
+    auto opts = virt::simulated_libvirt::options::parse(
+        "domains=2000,latency=2ms,jitter=500us,events=2.5,seed=7");
+    EXPECT_EQ(opts.domains, 2000u);
+    EXPECT_EQ(opts.latency, 2ms);
+    EXPECT_EQ(opts.jitter, 500us);
+    EXPECT_DOUBLE_EQ(opts.events, 2.5);
+    EXPECT_EQ(opts.seed, 7u);
+
+    opts = virt::simulated_libvirt::options::parse("");
+    EXPECT_EQ(opts.domains, 100u);
+    EXPECT_EQ(opts.latency, 0us);
+
+    EXPECT_THROW(virt::simulated_libvirt::options::parse("bogus=1"),
+                 std::invalid_argument);
+    EXPECT_THROW(virt::simulated_libvirt::options::parse("latency=2h"),
+                 std::invalid_argument);
+    EXPECT_THROW(virt::simulated_libvirt::options::parse("domains"),
+                 std::invalid_argument);
+    EXPECT_THROW(virt::simulated_libvirt::options::parse("domains=x"),
+                 std::invalid_argument);
+}
+
+TEST(simulated_backend, make_backend)
+{
+    EXPECT_EQ(virt::make_backend("libvirt"), nullptr);
+
+    auto backend = virt::make_backend("sim:domains=3");
+    auto *sim = dynamic_cast<virt::simulated_libvirt *>(backend.get());
+    ASSERT_NE(sim, nullptr);
+    EXPECT_EQ(sim->settings().domains, 3u);
+
+    EXPECT_THROW(virt::make_backend("xen"), std::invalid_argument);
+    EXPECT_THROW(virt::make_backend("sim:bogus=1"), std::invalid_argument);
+}
+
+TEST_F(simulated_test, domains)
+{
+    auto domains = lv.virConnectListAllDomains(conn, 0);
+    ASSERT_EQ(domains.size(), 20u);
+
+    auto active = lv.virConnectListAllDomains(
+        conn, VIR_CONNECT_LIST_DOMAINS_ACTIVE);
+    auto inactive = lv.virConnectListAllDomains(
+        conn, VIR_CONNECT_LIST_DOMAINS_INACTIVE);
+    EXPECT_EQ(active.size() + inactive.size(), domains.size());
+
+    std::string name = lv.virDomainGetName(domains.front());
+    EXPECT_EQ(name, "sim-01");
+
+    auto by_name = lv.virDomainLookupByName(conn, name.c_str());
+    auto uuid = lv.virDomainGetUUIDString(domains.front());
+    auto by_uuid = lv.virDomainLookupByUUIDString(conn, uuid.c_str());
+    EXPECT_EQ(by_name, domains.front());
+    EXPECT_EQ(by_uuid, domains.front());
+    EXPECT_EQ(lv.virDomainLookupByName(conn, "missing"), nullptr);
+
+    std::string xml = lv.virDomainGetXMLDesc(domains.front(), 0).c_str();
+    EXPECT_NE(xml.find("<name>sim-01</name>"), std::string::npos);
+    EXPECT_NE(xml.find("<uuid>" + uuid + "</uuid>"), std::string::npos);
+}
+
+TEST_F(simulated_test, lifecycle)
+{
+    auto domains = lv.virConnectListAllDomains(
+        conn, VIR_CONNECT_LIST_DOMAINS_INACTIVE);
+    ASSERT_FALSE(domains.empty());
+    auto domain = domains.front();
+    std::string name = lv.virDomainGetName(domain);
+
+    int id = subscribe();
+    lv.virEventAddTimeout(1, [](int, void *) {}, nullptr, nullptr);
+
+    EXPECT_EQ(lv.virDomainCreate(domain), 0);
+    EXPECT_EQ(lv.virDomainCreate(domain), -1);
+    int state;
+    lv.virDomainGetState(domain, &state, nullptr, 0);
+    EXPECT_EQ(state, VIR_DOMAIN_RUNNING);
+    EXPECT_GT(lv.virDomainGetID(domain), 0);
+
+    EXPECT_EQ(lv.virDomainShutdown(domain), 0);
+    lv.virDomainGetState(domain, &state, nullptr, 0);
+    EXPECT_EQ(state, VIR_DOMAIN_SHUTOFF);
+    EXPECT_EQ(lv.virDomainGetID(domain), -1);
+
+    // Events are delivered by the event loop.
+    EXPECT_TRUE(events.empty());
+    lv.virEventRunDefaultImpl();
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0],
+              std::make_tuple(name,
+                              int(VIR_DOMAIN_EVENT_STARTED),
+                              int(VIR_DOMAIN_EVENT_STARTED_BOOTED)));
+    EXPECT_EQ(events[1],
+              std::make_tuple(name,
+                              int(VIR_DOMAIN_EVENT_STOPPED),
+                              int(VIR_DOMAIN_EVENT_STOPPED_SHUTDOWN)));
+
+    EXPECT_EQ(lv.virConnectDomainEventDeregisterAny(conn, id), 0);
+    EXPECT_EQ(lv.virConnectDomainEventDeregisterAny(conn, id), -1);
+    lv.virDomainCreate(domain);
+    lv.virEventRunDefaultImpl();
+    EXPECT_EQ(events.size(), 2u);
+}
+
+TEST_F(simulated_test, define)
+{
+    subscribe();
+
+    const char *xml = "<domain type=\"kvm\"><name>new</name></domain>";
+    auto domain = lv.virDomainDefineXML(conn, xml);
+    ASSERT_NE(domain, nullptr);
+    EXPECT_EQ(lv.virConnectListAllDomains(conn, 0).size(), 21u);
+    EXPECT_STREQ(lv.virDomainGetXMLDesc(domain, 0).c_str(), xml);
+
+    // Defining an existing name updates it in place.
+    EXPECT_EQ(lv.virDomainDefineXML(conn, xml), domain);
+    EXPECT_EQ(lv.virConnectListAllDomains(conn, 0).size(), 21u);
+
+    EXPECT_EQ(lv.virDomainDefineXML(conn, "<domain/>"), nullptr);
+
+    lv.virEventRunDefaultImpl();
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(std::get<2>(events[0]), VIR_DOMAIN_EVENT_DEFINED_ADDED);
+    EXPECT_EQ(std::get<2>(events[1]), VIR_DOMAIN_EVENT_DEFINED_UPDATED);
+}
+
+TEST_F(simulated_test, metadata)
+{
+    auto domain = lv.virConnectListAllDomains(conn, 0).front();
+    EXPECT_EQ(lv.virDomainSetMetadata(
+                  domain, VIR_DOMAIN_METADATA_TITLE, "A & B", "", "", 0),
+              0);
+    EXPECT_EQ(lv.virDomainGetMetadata(
+                  domain, VIR_DOMAIN_METADATA_TITLE, nullptr, 0),
+              "A & B");
+
+    std::string xml = lv.virDomainGetXMLDesc(domain, 0).c_str();
+    EXPECT_NE(xml.find("<title>A &amp; B</title>"), std::string::npos);
+}
+
+TEST_F(simulated_test, random_events)
+{
+    virt::simulated_libvirt busy { virt::simulated_libvirt::options::parse(
+        "domains=5,events=1000") };
+    busy.virEventAddTimeout(10, [](int, void *) {}, nullptr, nullptr);
+
+    int count = 0;
+    busy.virConnectDomainEventRegisterAny(
+        nullptr,
+        nullptr,
+        VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+        VIR_DOMAIN_EVENT_CALLBACK(
+            +[](webvirt::connect *, webvirt::domain *, int, int, void *c) {
+                ++*reinterpret_cast<int *>(c);
+            }),
+        &count,
+        nullptr);
+    busy.virEventRunDefaultImpl();
+    EXPECT_GT(count, 0);
+}
+
+TEST_F(simulated_test, latency)
+{
+    virt::simulated_libvirt slow { virt::simulated_libvirt::options::parse(
+        "domains=1,latency=20ms") };
+    auto start = std::chrono::steady_clock::now();
+    slow.virConnectGetHostname(nullptr);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+}
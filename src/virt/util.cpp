@@ -14,6 +14,7 @@
  * permissions and limitations under the License.
  */
 #include <libvirt.hpp>
+#include <util/trace.hpp>
 #include <virt/util.hpp>
 
 #include <fmt/format.h>
@@ -43,3 +44,21 @@ std::string virt::state_string(int state)
 {
     return STATE_STRINGS.at(state);
 }
+
+// libvirt produces its own XML: no DTDs or CRLF line endings. Entity
+// escapes need processing, as do CDATA sections, which users may put in
+// <metadata> and <description>.
+static constexpr unsigned int XML_PARSE_FLAGS =
+    pugi::parse_minimal | pugi::parse_escapes | pugi::parse_cdata;
+
+pugi::xml_document virt::parse_xml(c_string xml)
+{
+    trace::span span("xml");
+    pugi::xml_document doc;
+    if (xml) {
+        auto size = xml.size();
+        doc.load_buffer_inplace_own(
+            xml.release(), size, XML_PARSE_FLAGS, pugi::encoding_utf8);
+    }
+    return doc;
+}
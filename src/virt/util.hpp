@@ -16,6 +16,9 @@
 #ifndef VIRT_UTIL_HPP
 #define VIRT_UTIL_HPP
 
+#include <libvirt.hpp>
+
+#include <pugixml.hpp>
 #include <string>
 
 namespace webvirt::virt
@@ -24,6 +27,21 @@ namespace webvirt::virt
 std::string uri(const std::string &user);
 std::string state_string(int state);
 
+/** Parse a libvirt XML description in place
+ *
+ * Ownership of the buffer held by `xml` is handed to the returned
+ * document, which parses it in place instead of copying it.
+ *
+ * By not checking load results, we return a blank xml_document on failure.
+ * A blank xml_document will produce empty string values for
+ * children/attributes read, allowing XML routes to fall through
+ * gracefully.
+ *
+ * @param xml XML description returned by libvirt
+ * @returns Parsed XML document
+ **/
+pugi::xml_document parse_xml(c_string xml);
+
 }; // namespace webvirt::virt
 
 #endif /* VIRT_UTIL_HPP */
@@ -13,6 +13,7 @@
  * implied. See the License for the specific language governing
  * permissions and limitations under the License.
  */
+#include <util/json.hpp>
 #include <virt/util.hpp>
 
 #include <gtest/gtest.h>
@@ -28,3 +29,28 @@ TEST(util, user_uri)
 {
     EXPECT_EQ(virt::uri("test"), "qemu+ssh://test@localhost/session");
 }
+
+TEST(util, parse_xml)
+{
+    auto doc = virt::parse_xml(
+        c_string("<domain><title>a &amp; b</title></domain>"));
+    EXPECT_STREQ(doc.child("domain").child("title").text().as_string(),
+                 "a & b");
+}
+
+TEST(util, parse_xml_cdata)
+{
+    auto doc = virt::parse_xml(
+        c_string("<domain><description><![CDATA[a <b> & c]]></description>"
+                 "<metadata><app><![CDATA[{\"k\": 1}]]></app></metadata>"
+                 "</domain>"));
+    auto data = json::xml_to_json(doc.child("domain"));
+    EXPECT_EQ(data["description"]["text"].asString(), "a <b> & c");
+    EXPECT_EQ(data["metadata"]["app"]["text"].asString(), "{\"k\": 1}");
+}
+
+TEST(util, parse_xml_empty)
+{
+    auto doc = virt::parse_xml(c_string());
+    EXPECT_FALSE(doc.child("domain"));
+}
@@ -120,4 +120,6 @@ void connection::async_write(beast::error_code ec, std::size_t bytes)
         CLASS_ETRACE(ec.message());
         return on_error_(ec.message().c_str(), ec);
     }
+
+    on_write_(shared_from_this());
 }
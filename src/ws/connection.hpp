@@ -46,6 +46,7 @@ private:
     http::handler<std::shared_ptr<connection>> on_accept_;
     http::handler<std::shared_ptr<connection>> on_handshake_;
     http::handler<std::shared_ptr<connection>, const std::string &> on_read_;
+    http::handler<std::shared_ptr<connection>> on_write_;
     http::handler<const char *, beast::error_code> on_error_;
     http::handler<> on_close_;
 
@@ -81,6 +82,7 @@ public:
     handler_setter(on_accept, on_accept_);
     handler_setter(on_handshake, on_handshake_);
     handler_setter(on_read, on_read_);
+    handler_setter(on_write, on_write_);
     handler_setter(on_error, on_error_);
     handler_setter(on_close, on_close_);
 
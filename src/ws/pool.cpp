@@ -14,14 +14,24 @@
  * permissions and limitations under the License.
  */
 #include <util/json.hpp>
+#include <util/metrics.hpp>
 #include <ws/pool.hpp>
 
+#include <algorithm>
+
 using namespace webvirt::websocket;
 
+static webvirt::metrics::gauge &connections_gauge()
+{
+    return webvirt::metrics::registry::ref().gauge(
+        "webvirtd_websocket_connections", "Open websocket connections");
+}
+
 pool &pool::add(const std::string &user, connection_ptr conn)
 {
     std::lock_guard<std::mutex> guard(mutex_);
     map_[user].emplace_back(std::move(conn));
+    connections_gauge().inc();
     return *this;
 }
 
@@ -29,9 +39,13 @@ pool &pool::remove(const std::string &user, connection_ptr conn)
 {
     std::lock_guard<std::mutex> guard(mutex_);
     auto &v = map_[user];
-    v.erase(std::find_if(v.begin(), v.end(), [conn](auto &c) {
+    auto it = std::find_if(v.begin(), v.end(), [conn](auto &c) {
         return c == conn;
-    }));
+    });
+    if (it != v.end()) {
+        v.erase(it);
+        connections_gauge().dec();
+    }
     return *this;
 }
 